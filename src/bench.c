@@ -0,0 +1,70 @@
+#include "bench_cache_policy.h"
+#include "bench_durability.h"
+#include "bench_large_keys.h"
+#include "bench_node_search.h"
+#include "bench_page_cache.h"
+#include "bench_pager_ops.h"
+#include "bench_parallel_scan.h"
+#include "bench_read_paths.h"
+#include "bench_scale.h"
+#include "bench_snapshot.h"
+#include "bench_threads.h"
+#include "bench_txn.h"
+#include "bench_wal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct BenchEntry
+{
+	char const* name;
+	int (*run)(int argc, char** argv);
+};
+
+static struct BenchEntry benches[] = {
+	{"scale", &bench_scale},
+	{"pager_ops", &bench_pager_ops},
+	{"read_paths", &bench_read_paths},
+	{"page_cache", &bench_page_cache},
+	{"cache_policy", &bench_cache_policy},
+	{"wal", &bench_wal},
+	{"durability", &bench_durability},
+	{"txn", &bench_txn},
+	{"snapshot", &bench_snapshot},
+	{"threads", &bench_threads},
+	{"read_scaling", &bench_read_scaling},
+	{"parallel_scan", &bench_parallel_scan},
+	{"node_search", &bench_node_search},
+	{"large_keys", &bench_large_keys},
+};
+
+static void
+usage(void)
+{
+	printf("usage: bench <name> [args...]\n");
+	for( int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++ )
+		printf("  %s\n", benches[i].name);
+}
+
+int
+main(int argc, char** argv)
+{
+	if( argc < 2 )
+	{
+		usage();
+		return 0;
+	}
+
+	for( int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++ )
+	{
+		if( strcmp(argv[1], benches[i].name) == 0 )
+		{
+			int result = benches[i].run(argc - 2, argv + 2);
+			printf("%s: %d\n", benches[i].name, result);
+			return result ? 0 : 1;
+		}
+	}
+
+	usage();
+	return 1;
+}
@@ -0,0 +1,183 @@
+#include "bench_cache_policy.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_factory.h"
+#include "btree_op_scan.h"
+#include "btree_op_select.h"
+#include "noderc.h"
+#include "page_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+#define BENCH_SCANS 16
+
+struct CacheStats
+{
+	u64 hits;
+	u64 misses;
+};
+
+static double
+hit_ratio(struct CacheStats const* stats)
+{
+	u64 total = stats->hits + stats->misses;
+	return total ? 100.0 * stats->hits / total : 0.0;
+}
+
+/**
+ * @brief 90% of lookups go to the first 1% of the keys.
+ */
+static u32
+skewed_key(u32* rng, u32 nrows)
+{
+	u32 hot = nrows / 100 > 0 ? nrows / 100 : 1;
+	if( bench_rand(rng) % 10 != 0 )
+		return (bench_rand(rng) % hot) + 1;
+	return (bench_rand(rng) % nrows) + 1;
+}
+
+static int
+lookup(struct BTree* tree, u32 key, struct CacheStats* stats)
+{
+	struct PageCache* cache = tree->pager->cache;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u64 hits = cache->hits;
+	u64 misses = cache->misses;
+	int ok = 0;
+
+	struct OpSelection op = {0};
+	btree_op_select_acquire_tbl(tree, &op, key, NULL);
+	ok = btree_op_select_prepare(&op) == BTREE_OK &&
+		 btree_op_select_commit(&op, payload, sizeof(payload)) == BTREE_OK &&
+		 memcmp(payload, &key, sizeof(key)) == 0;
+	btree_op_select_release(&op);
+
+	stats->hits += cache->hits - hits;
+	stats->misses += cache->misses - misses;
+
+	return ok;
+}
+
+static int
+run_policy(
+	char const* name,
+	enum page_cache_policy_e policy,
+	u32 nrows,
+	u32 nlookups,
+	u32 cache_size)
+{
+	int result = 0;
+	char const* db_name = "bench_cache_policy.db";
+	struct PagerFactoryOpts opts = {
+		.cache_size = cache_size, .cache_policy = policy};
+	struct Pager* pager = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u32 rng = 0x2545F491;
+	struct CacheStats warm = {0};
+	struct CacheStats point = {0};
+	struct CacheStats mixed = {0};
+
+	remove(db_name);
+
+	pager = btree_factory_pager_create_ex(db_name, &opts);
+	if( !pager )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 i = 1; i <= nrows; i++ )
+	{
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+
+	// Warm the cache, then measure lookups on their own.
+	for( u32 i = 0; i < nlookups * 2; i++ )
+	{
+		if( !lookup(tree, skewed_key(&rng, nrows), i < nlookups ? &warm : &point) )
+			goto end;
+	}
+
+	// The same lookups while a scan runs alongside; the scan moves
+	// scan_step rows per lookup and wraps around BENCH_SCANS times.
+	u32 scan_step = (u32)((u64)nrows * BENCH_SCANS / nlookups);
+	if( scan_step == 0 )
+		scan_step = 1;
+
+	u64 start = bench_now_ns();
+	struct OpScan scan = {0};
+	btree_op_scan_acquire(tree, &scan);
+	btree_op_scan_prepare(&scan);
+	for( u32 i = 0; i < nlookups; i++ )
+	{
+		for( u32 j = 0; j < scan_step; j++ )
+		{
+			if( btree_op_scan_done(&scan) )
+			{
+				btree_op_scan_release(&scan);
+				btree_op_scan_acquire(tree, &scan);
+				btree_op_scan_prepare(&scan);
+			}
+
+			btree_op_scan_current(&scan, payload, sizeof(payload));
+			btree_op_scan_next(&scan);
+		}
+
+		if( !lookup(tree, skewed_key(&rng, nrows), &mixed) )
+			break;
+	}
+	btree_op_scan_release(&scan);
+	u64 mixed_end = bench_now_ns();
+
+	printf(
+		"cache_policy: %-5s lookups %5.1f%% hits, with a scan running %5.1f%% "
+		"hits (%.2fs)\n",
+		name,
+		hit_ratio(&point),
+		hit_ratio(&mixed),
+		bench_secs(start, mixed_end));
+
+	result = 1;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+	{
+		struct PageCache* cache = pager->cache;
+		pager_destroy(pager);
+		page_cache_destroy(cache);
+	}
+	remove(db_name);
+
+	return result;
+}
+
+int
+bench_cache_policy(int argc, char** argv)
+{
+	u32 nrows = bench_arg_u64(argc, argv, 0, 200000);
+	u32 nlookups = bench_arg_u64(argc, argv, 1, 100000);
+	u32 cache_size = bench_arg_u64(argc, argv, 2, 256);
+	int result = 1;
+
+	result = run_policy("lru", PAGE_CACHE_LRU, nrows, nlookups, cache_size) &&
+			 result;
+	result =
+		run_policy("clock", PAGE_CACHE_CLOCK, nrows, nlookups, cache_size) &&
+		result;
+	result =
+		run_policy("2q", PAGE_CACHE_2Q, nrows, nlookups, cache_size) && result;
+
+	return result;
+}
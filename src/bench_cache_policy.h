@@ -0,0 +1,13 @@
+#ifndef BENCH_CACHE_POLICY_H_
+#define BENCH_CACHE_POLICY_H_
+
+/**
+ * @brief Page cache hit ratio of each replacement policy (LRU, CLOCK, 2Q) on
+ * a table btree: skewed point lookups alone, then the same lookups while a
+ * full-table scan runs alongside them.
+ *
+ * bench cache_policy [rows] [lookups] [cache_pages]
+ */
+int bench_cache_policy(int argc, char** argv);
+
+#endif
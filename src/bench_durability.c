@@ -0,0 +1,145 @@
+#include "bench_durability.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "noderc.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+
+// Where commits go.
+enum bench_store_e
+{
+	BENCH_STORE_FILE,
+	BENCH_STORE_LOG,
+	BENCH_STORE_SHADOW,
+	BENCH_NSTORES,
+};
+
+static char const* store_names[] = {"file", "log", "shadow"};
+
+static u64 bench_syncs = 0;
+static struct PagerOps counting_ops;
+
+static enum pager_e
+counting_sync(void* file)
+{
+	bench_syncs += 1;
+#ifdef _WIN32
+	return CStdOps.sync(file);
+#else
+	return PosixOps.sync(file);
+#endif
+}
+
+static int
+run_level(
+	char const* name,
+	enum pager_durability_e durability,
+	enum bench_store_e store,
+	u32 nrows,
+	u32 rows_per_commit)
+{
+	int result = 0;
+	char const* db_name = "bench_durability.db";
+	char const* wal_name = "bench_durability.db-wal";
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+
+	remove(db_name);
+	remove(wal_name);
+
+	page_cache_create(&cache, 64);
+	if( pager_create(&pager, &counting_ops, cache, 0x1000) != PAGER_OK )
+		goto end;
+	if( pager_open(pager, db_name) != PAGER_OK )
+	{
+		pager_dealloc(pager);
+		pager = NULL;
+		goto end;
+	}
+
+	pager_set_durability(pager, durability);
+	if( store == BENCH_STORE_LOG && pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+	if( store == BENCH_STORE_SHADOW && pager_enable_shadow(pager) != PAGER_OK )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	bench_syncs = 0;
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nrows; i++ )
+	{
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i + 1, payload, sizeof(payload)) != BTREE_OK ||
+			pager_flush(pager) != PAGER_OK )
+			goto end;
+
+		if( (i + 1) % rows_per_commit == 0 && pager_sync(pager) != PAGER_OK )
+			goto end;
+	}
+	u64 end = bench_now_ns();
+
+	printf(
+		"durability: %-6s %-6s %9.0f rows/s, %6.2f syncs/commit\n",
+		name,
+		store_names[store],
+		nrows / bench_secs(start, end),
+		(double)bench_syncs / (nrows / rows_per_commit));
+
+	result = 1;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+	remove(wal_name);
+
+	return result;
+}
+
+int
+bench_durability(int argc, char** argv)
+{
+	u32 nrows = bench_arg_u64(argc, argv, 0, 5000);
+	u32 rows_per_commit = bench_arg_u64(argc, argv, 1, 10);
+	int result = 1;
+
+	if( nrows == 0 || rows_per_commit == 0 || rows_per_commit > nrows )
+		return 0;
+
+#ifdef _WIN32
+	counting_ops = CStdOps;
+#else
+	counting_ops = PosixOps;
+#endif
+	counting_ops.sync = &counting_sync;
+
+	for( int store = 0; store < BENCH_NSTORES; store++ )
+	{
+		result &= run_level(
+			"off", PAGER_DURABILITY_OFF, store, nrows, rows_per_commit);
+		result &= run_level(
+			"normal", PAGER_DURABILITY_NORMAL, store, nrows, rows_per_commit);
+		result &= run_level(
+			"full", PAGER_DURABILITY_FULL, store, nrows, rows_per_commit);
+	}
+
+	return result;
+}
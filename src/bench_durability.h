@@ -0,0 +1,15 @@
+#ifndef BENCH_DURABILITY_H_
+#define BENCH_DURABILITY_H_
+
+/**
+ * @brief Cost of each durability level. Rows are inserted one at a time with
+ * a pager_flush after each, the way sqldb ends a statement, and a pager_sync
+ * every few rows as the commit. Runs each level with the pages written in
+ * place, through the write-ahead log and by shadow paging, and counts the
+ * syncs.
+ *
+ * bench durability [rows] [rows per commit]
+ */
+int bench_durability(int argc, char** argv);
+
+#endif
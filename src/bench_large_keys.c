@@ -0,0 +1,170 @@
+#include "bench_large_keys.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_node.h"
+#include "ibtree.h"
+#include "noderc.h"
+#include "page.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAGE_SIZE 0x1000
+#define BENCH_CACHE_SIZE 0x4000
+#define BENCH_INLINE_KEY_SIZE 32
+
+/**
+ * @brief Fill key with a byte pattern and i, big endian so keys sort by i,
+ * at the front or the back of the key.
+ */
+static void
+make_key(byte* key, u32 key_size, u32 i, int at_back)
+{
+	memset(key, 'k', key_size);
+
+	byte* id = at_back ? key + key_size - sizeof(i) : key;
+	for( int b = 0; b < sizeof(i); b++ )
+		id[b] = (i >> (8 * (sizeof(i) - 1 - b))) & 0xFF;
+}
+
+/**
+ * @brief Build a tree of nkeys keys and look them up at random nops times;
+ * ns per lookup, or 0 on an error or a wrong result. Searches decide on
+ * abbreviated keys where they can if abbreviate is set.
+ */
+static double
+run_lookups(
+	char const* db_name,
+	u32 key_size,
+	u32 nkeys,
+	u32 nops,
+	int at_back,
+	int abbreviate)
+{
+	double ns = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTree* tree = NULL;
+	struct BTreeNodeRC rcer = {0};
+	byte* key = malloc(key_size);
+	byte* buf = malloc(key_size);
+	u32 rand_state = 0x1234;
+
+	remove(db_name);
+
+	page_cache_create(&cache, BENCH_CACHE_SIZE);
+	if( !key || !buf ||
+		pager_cstd_create(&pager, cache, db_name, BENCH_PAGE_SIZE) !=
+			PAGER_OK )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( ibtree_init(
+			tree, pager, &rcer, 1, &ibtree_compare, &ibtree_compare_reset) !=
+		BTREE_OK )
+		goto end;
+	tree->bytewise = abbreviate;
+
+	for( u32 i = 0; i < nkeys; i++ )
+	{
+		make_key(key, key_size, i, at_back);
+		if( ibtree_insert(tree, key, key_size) != BTREE_OK )
+			goto end;
+	}
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nops; i++ )
+	{
+		make_key(key, key_size, bench_rand(&rand_state) % nkeys, at_back);
+		if( ibtree_select_ex(tree, NULL, key, key_size, buf, key_size) !=
+				BTREE_OK ||
+			memcmp(key, buf, key_size) != 0 )
+			goto end;
+	}
+	u64 end = bench_now_ns();
+
+	ns = bench_secs(start, end) * 1e9 / nops;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	free(key);
+	free(buf);
+	remove(db_name);
+
+	return ns;
+}
+
+int
+bench_large_keys(int argc, char** argv)
+{
+	char const* db_name = "bench_large_keys.db";
+	u32 nkeys = bench_arg_u64(argc, argv, 0, 500);
+	u32 nops = bench_arg_u64(argc, argv, 1, 200000);
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct BTreeNode node = {0};
+	u32 key_size = 0;
+
+	if( nkeys == 0 || nops == 0 )
+		return 0;
+
+	remove(db_name);
+
+	// Size the keys off a node that is not the first page.
+	page_cache_create(&cache, 4);
+	if( pager_cstd_create(&pager, cache, db_name, BENCH_PAGE_SIZE) !=
+			PAGER_OK ||
+		page_create(pager, &page) != PAGER_OK )
+		goto end;
+	btree_node_init_as_page_number(&node, 2, page);
+	key_size = btree_node_max_cell_size(&node) * 2;
+
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	if( key_size == 0 )
+		return 0;
+
+	// Inline keys for reference, then keys that overflow; each searched
+	// with the full compare and with abbreviated keys.
+	u32 const key_sizes[] = {BENCH_INLINE_KEY_SIZE, key_size};
+	for( u32 s = 0; s < sizeof(key_sizes) / sizeof(key_sizes[0]); s++ )
+	{
+		for( int at_back = 0; at_back < 2; at_back++ )
+		{
+			double full = run_lookups(
+				db_name, key_sizes[s], nkeys, nops, at_back, 0);
+			double abbreviated = run_lookups(
+				db_name, key_sizes[s], nkeys, nops, at_back, 1);
+			if( full == 0 || abbreviated == 0 )
+				return 0;
+
+			printf(
+				"large_keys: %u keys of %4u bytes differ at %s full %8.1f "
+				"ns/op abbreviated %8.1f ns/op\n",
+				nkeys,
+				key_sizes[s],
+				at_back ? "back " : "front",
+				full,
+				abbreviated);
+		}
+	}
+
+	return 1;
+}
\ No newline at end of file
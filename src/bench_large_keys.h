@@ -0,0 +1,16 @@
+#ifndef BENCH_LARGE_KEYS_H_
+#define BENCH_LARGE_KEYS_H_
+
+/**
+ * @brief Lookups in an index tree of keys twice btree_node_max_cell_size, so
+ * each spills to an overflow page. Runs once with keys that differ in their
+ * first bytes and once with keys that differ only in their last, where every
+ * probe of every search compares on the overflow pages. Reports ns per
+ * lookup. About four keys fit a node and cursors go eight nodes deep, so
+ * trees of much more than 700 keys fail to build.
+ *
+ * bench large_keys [keys] [lookups]
+ */
+int bench_large_keys(int argc, char** argv);
+
+#endif
\ No newline at end of file
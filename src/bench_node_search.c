@@ -0,0 +1,128 @@
+#include "bench_node_search.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_node.h"
+#include "page.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PAGE_SIZE 0x4000
+#define BENCH_PROBES 4096
+
+static u32 const node_sizes[] = {8, 32, 128, 512};
+
+/**
+ * @brief Time searches for probes in node, cycling through them until nops
+ * are done; ns per search. Adds the indexes found to checksum.
+ */
+static double
+time_search(
+	struct BTreeNode* node,
+	struct BTreeCompareContext* ctx,
+	u32 const* probes,
+	u32 nops,
+	u64* checksum)
+{
+	u32 index = 0;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nops; i++ )
+	{
+		u32 key = probes[i % BENCH_PROBES];
+		if( ctx )
+			btree_node_search_keys(ctx, node, &key, sizeof(key), &index);
+		else
+			btree_node_search_keys_tbl(node, key, &index);
+		*checksum += index;
+	}
+	u64 end = bench_now_ns();
+
+	return bench_secs(start, end) * 1e9 / nops;
+}
+
+int
+bench_node_search(int argc, char** argv)
+{
+	char const* db_name = "bench_node_search.db";
+	u32 nops = bench_arg_u64(argc, argv, 0, 5000000);
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct BTreeNode node = {0};
+	u32 probes[BENCH_PROBES];
+	u32 rand_state = 0x1234;
+
+	remove(db_name);
+
+	page_cache_create(&cache, 4);
+	if( pager_cstd_create(&pager, cache, db_name, BENCH_PAGE_SIZE) !=
+		PAGER_OK )
+		goto end;
+
+	if( page_create(pager, &page) != PAGER_OK )
+		goto end;
+
+	// How a table tree's cursor searches with the generic path.
+	struct BTreeCompareContext ctx = {
+		.compare = &btree_compare,
+		.reset = &btree_compare_reset,
+		.keyof = &btree_keyof,
+		.compare_context = NULL,
+		.pager = pager};
+
+	for( u32 s = 0; s < sizeof(node_sizes) / sizeof(node_sizes[0]); s++ )
+	{
+		u32 num_keys = node_sizes[s];
+		u64 generic_sum = 0;
+		u64 tbl_sum = 0;
+
+		memset(page->page_buffer, 0x00, page->page_size);
+		btree_node_init_as_page_number(&node, 1, page);
+
+		// Odd keys, so probes hit and miss about equally.
+		for( u32 i = 0; i < num_keys; i++ )
+		{
+			u32 payload = i;
+			struct InsertionIndex end_index = {.mode = KLIM_END};
+			struct BTreeCellInline cell = {
+				.inline_size = sizeof(payload), .payload = (byte*)&payload};
+			if( btree_node_insert_inline(&node, &end_index, i * 2 + 1, &cell) !=
+				BTREE_OK )
+				goto end;
+		}
+
+		for( u32 i = 0; i < BENCH_PROBES; i++ )
+			probes[i] = bench_rand(&rand_state) % (num_keys * 2 + 2);
+
+		double generic = time_search(&node, &ctx, probes, nops, &generic_sum);
+		double tbl = time_search(&node, NULL, probes, nops, &tbl_sum);
+		if( generic_sum != tbl_sum )
+			goto end;
+
+		printf(
+			"node_search: %4u keys generic %6.2f ns/op table %6.2f ns/op "
+			"%5.2fx\n",
+			num_keys,
+			generic,
+			tbl,
+			generic / tbl);
+	}
+
+	result = 1;
+
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef BENCH_NODE_SEARCH_H_
+#define BENCH_NODE_SEARCH_H_
+
+/**
+ * @brief Key searches within one table tree node of various sizes, through
+ * the generic btree_node_search_keys with the table tree's compare functions
+ * and through btree_node_search_keys_tbl. Reports ns per search for both.
+ *
+ * bench node_search [searches per node size]
+ */
+int bench_node_search(int argc, char** argv);
+
+#endif
\ No newline at end of file
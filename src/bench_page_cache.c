@@ -0,0 +1,85 @@
+#include "bench_page_cache.h"
+
+#include "bench_utils.h"
+#include "page_cache.h"
+#include "page_defs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+run_size(u32 capacity, u32 nops)
+{
+	int result = 0;
+	u32 npages = capacity * 2;
+	struct PageCache* cache = NULL;
+	struct Page* pages = (struct Page*)calloc(npages, sizeof(struct Page));
+	struct Page* page = NULL;
+	struct Page* evicted = NULL;
+	u32 rng = 0x9E3779B9;
+	u32 hits = 0;
+
+	if( !pages || page_cache_create(&cache, capacity) != PAGER_OK )
+		goto end;
+
+	for( u32 i = 0; i < npages; i++ )
+		pages[i].page_id = i + 1;
+
+	// Start full so every miss evicts.
+	for( u32 i = 0; i < capacity; i++ )
+	{
+		page_cache_insert(cache, &pages[i], &evicted, NULL);
+		page_cache_release(cache, &pages[i]);
+	}
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nops; i++ )
+	{
+		u32 page_id = (bench_rand(&rng) % npages) + 1;
+		if( page_cache_acquire(cache, page_id, &page) == PAGER_OK )
+		{
+			hits++;
+		}
+		else
+		{
+			page = &pages[page_id - 1];
+			evicted = NULL;
+			page_cache_insert(cache, page, &evicted, NULL);
+		}
+
+		if( page->page_id != page_id )
+			goto end;
+
+		page_cache_release(cache, page);
+	}
+	u64 end_ns = bench_now_ns();
+
+	printf(
+		"page_cache: %8u pages %7.1f ns/op, %4.1f%% hits\n",
+		capacity,
+		bench_secs(start, end_ns) * 1e9 / nops,
+		100.0 * hits / nops);
+
+	result = 1;
+
+end:
+	if( cache )
+		page_cache_destroy(cache);
+	free(pages);
+
+	return result;
+}
+
+int
+bench_page_cache(int argc, char** argv)
+{
+	u32 nops = bench_arg_u64(argc, argv, 0, 2000000);
+	u32 max_pages = bench_arg_u64(argc, argv, 1, 1000000);
+	int result = 1;
+
+	for( u32 capacity = 10; capacity <= max_pages; capacity *= 10 )
+		result = run_size(capacity, nops) && result;
+
+	return result;
+}
@@ -0,0 +1,13 @@
+#ifndef BENCH_PAGE_CACHE_H_
+#define BENCH_PAGE_CACHE_H_
+
+/**
+ * @brief PageCache acquire/insert/release throughput at cache sizes from 10
+ * up to max_pages (default 1M), without any I/O. Page ids are drawn from
+ * twice the cache size, so about half of the lookups miss and evict.
+ *
+ * bench page_cache [ops] [max_pages]
+ */
+int bench_page_cache(int argc, char** argv);
+
+#endif
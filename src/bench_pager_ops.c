@@ -0,0 +1,190 @@
+#include "bench_pager_ops.h"
+
+#include "bench_utils.h"
+#include "pager_ops.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+#include "pager_ops_uring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAGE_SIZE 0x1000
+
+static int
+run_ops(char const* name, struct PagerOps* ops, u32 npages, u32 nreads)
+{
+	int result = 0;
+	char const* db_name = "bench_pager_ops.db";
+	void* file = NULL;
+	byte* buffer = (byte*)malloc(BENCH_PAGE_SIZE);
+	u32 rng = 0x9E3779B9;
+	int bytes = 0;
+
+	remove(db_name);
+	if( ops->open(&file, db_name) != PAGER_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < npages; i++ )
+	{
+		memset(buffer, i & 0xFF, BENCH_PAGE_SIZE);
+		if( ops->write(
+				file,
+				buffer,
+				(u64)i * BENCH_PAGE_SIZE,
+				BENCH_PAGE_SIZE,
+				&bytes) != PAGER_OK )
+			goto end;
+	}
+	u64 write_end = bench_now_ns();
+
+	for( u32 i = 0; i < npages; i++ )
+	{
+		if( ops->read(
+				file,
+				buffer,
+				(u64)i * BENCH_PAGE_SIZE,
+				BENCH_PAGE_SIZE,
+				&bytes) != PAGER_OK )
+			goto end;
+	}
+	u64 seq_end = bench_now_ns();
+
+	for( u32 i = 0; i < nreads; i++ )
+	{
+		u32 page = bench_rand(&rng) % npages;
+		if( ops->read(
+				file,
+				buffer,
+				(u64)page * BENCH_PAGE_SIZE,
+				BENCH_PAGE_SIZE,
+				&bytes) != PAGER_OK ||
+			buffer[0] != (page & 0xFF) )
+			goto end;
+	}
+	u64 rand_end = bench_now_ns();
+
+	printf(
+		"pager_ops: %-6s write %8.0f pages/s, seq read %8.0f pages/s, "
+		"random read %8.0f pages/s\n",
+		name,
+		npages / bench_secs(start, write_end),
+		npages / bench_secs(write_end, seq_end),
+		nreads / bench_secs(seq_end, rand_end));
+
+	result = 1;
+
+end:
+	if( file )
+		ops->close(file);
+	free(buffer);
+	remove(db_name);
+
+	return result;
+}
+
+/**
+ * @brief Same workload as run_ops but through submit/complete, batch pages
+ * at a time.
+ */
+static int
+run_ops_batched(
+	char const* name, struct PagerOps* ops, u32 npages, u32 nreads, u32 batch)
+{
+	int result = 0;
+	char const* db_name = "bench_pager_ops.db";
+	void* file = NULL;
+	byte* buffers = (byte*)malloc((size_t)BENCH_PAGE_SIZE * batch);
+	struct PagerIO* ios = (struct PagerIO*)malloc(sizeof(struct PagerIO) * batch);
+	u32 rng = 0x9E3779B9;
+
+	remove(db_name);
+	if( ops->open(&file, db_name) != PAGER_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < npages; i += batch )
+	{
+		u32 n = npages - i < batch ? npages - i : batch;
+		for( u32 j = 0; j < n; j++ )
+		{
+			byte* buffer = buffers + (size_t)j * BENCH_PAGE_SIZE;
+			memset(buffer, (i + j) & 0xFF, BENCH_PAGE_SIZE);
+			ios[j].op = PAGER_IO_WRITE;
+			ios[j].buffer = buffer;
+			ios[j].offset = (u64)(i + j) * BENCH_PAGE_SIZE;
+			ios[j].size = BENCH_PAGE_SIZE;
+		}
+
+		if( ops->submit(file, ios, n) != PAGER_OK ||
+			ops->complete(file) != PAGER_OK )
+			goto end;
+		for( u32 j = 0; j < n; j++ )
+			if( ios[j].status != PAGER_OK )
+				goto end;
+	}
+	u64 write_end = bench_now_ns();
+
+	for( u32 i = 0; i < nreads; i += batch )
+	{
+		u32 n = nreads - i < batch ? nreads - i : batch;
+		for( u32 j = 0; j < n; j++ )
+		{
+			u32 page = bench_rand(&rng) % npages;
+			ios[j].op = PAGER_IO_READ;
+			ios[j].buffer = buffers + (size_t)j * BENCH_PAGE_SIZE;
+			ios[j].offset = (u64)page * BENCH_PAGE_SIZE;
+			ios[j].size = BENCH_PAGE_SIZE;
+		}
+
+		if( ops->submit(file, ios, n) != PAGER_OK ||
+			ops->complete(file) != PAGER_OK )
+			goto end;
+		for( u32 j = 0; j < n; j++ )
+			if( ios[j].status != PAGER_OK ||
+				((byte*)ios[j].buffer)[0] !=
+					((ios[j].offset / BENCH_PAGE_SIZE) & 0xFF) )
+				goto end;
+	}
+	u64 read_end = bench_now_ns();
+
+	printf(
+		"pager_ops: %-6s write %8.0f pages/s, random read %8.0f pages/s "
+		"(batches of %u)\n",
+		name,
+		npages / bench_secs(start, write_end),
+		nreads / bench_secs(write_end, read_end),
+		batch);
+
+	result = 1;
+
+end:
+	if( file )
+		ops->close(file);
+	free(buffers);
+	free(ios);
+	remove(db_name);
+
+	return result;
+}
+
+int
+bench_pager_ops(int argc, char** argv)
+{
+	u32 npages = bench_arg_u64(argc, argv, 0, 100000);
+	u32 nreads = bench_arg_u64(argc, argv, 1, 1000000);
+	int result = 1;
+
+	result &= run_ops("cstd", &CStdOps, npages, nreads);
+#ifndef _WIN32
+	result &= run_ops("posix", &PosixOps, npages, nreads);
+#endif
+#ifdef __linux__
+	result &= run_ops("uring", &UringOps, npages, nreads);
+	result &= run_ops_batched("uring", &UringOps, npages, nreads, 16);
+#endif
+
+	return result;
+}
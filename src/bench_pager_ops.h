@@ -0,0 +1,12 @@
+#ifndef BENCH_PAGER_OPS_H_
+#define BENCH_PAGER_OPS_H_
+
+/**
+ * @brief Compares PagerOps backends (CStdOps, PosixOps, UringOps) on raw page
+ * I/O, without the page cache. UringOps is also run with batched submits.
+ *
+ * bench pager_ops [pages] [random_reads]
+ */
+int bench_pager_ops(int argc, char** argv);
+
+#endif
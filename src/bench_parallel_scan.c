@@ -0,0 +1,156 @@
+#include "bench_parallel_scan.h"
+
+#include "bench_utils.h"
+#include "btree_factory.h"
+#include "sql_parse.h"
+#include "sql_string.h"
+#include "sqldb.h"
+#include "sqldb_interpret.h"
+#include "sqldb_scan.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_CACHE_SIZE 4096
+#define BENCH_THREADS_MAX 32
+
+static enum sql_e
+run_sql(struct SQLDB* db, char const* sql)
+{
+	struct SQLString* input = sql_string_create_from_cstring(sql);
+	struct SQLParse* parse = sql_parse_create(input);
+
+	enum sql_e result = sqldb_interpret(db, parse);
+
+	sql_parse_destroy(parse);
+	sql_string_destroy(input);
+	return result;
+}
+
+/**
+ * @brief Rows with an age of 3; about one in seven.
+ */
+static bool
+age_filter(struct SQLRecord const* record, void* ctx)
+{
+	return record->values[1].value.num.num == 3;
+}
+
+/**
+ * @brief Scan the table passes times; rows scanned per second, or 0 on an
+ * error or a wrong row count.
+ */
+static double
+run_scan(
+	struct SQLDB* db, u32 nrows, u32 passes, u32 workers, bool ordered)
+{
+	// Quoted, as the parser keeps table names.
+	struct SQLString* name = sql_string_create_from_cstring("\"bench\"");
+	struct SQLDBScanOpts opts = {0};
+	opts.workers = workers;
+	opts.ordered = ordered;
+	opts.filter = &age_filter;
+	u32 expected = 0;
+	u32 matched = 0;
+	bool ok = true;
+
+	for( u32 key = 1; key <= nrows; key++ )
+		expected += key % 7 == 3 ? passes : 0;
+
+	u64 start = bench_now_ns();
+	for( u32 pass = 0; pass < passes && ok; pass++ )
+	{
+		struct SQLDBScan scan = {0};
+		ok = sqldb_scan_acquire_ex(db, name, &opts, &scan) == SQL_OK;
+		while( ok )
+		{
+			ok = sqldb_scan_next(&scan) == SQL_OK;
+			if( !ok || !sqldb_scan_record(&scan) )
+				break;
+			matched += 1;
+		}
+		sqldb_scan_release(&scan);
+	}
+	u64 end = bench_now_ns();
+
+	sql_string_destroy(name);
+	if( !ok || matched != expected )
+		return 0;
+
+	return (double)nrows * passes / bench_secs(start, end);
+}
+
+int
+bench_parallel_scan(int argc, char** argv)
+{
+	char const* db_name = "bench_parallel_scan.db";
+	u32 nrows = bench_arg_u64(argc, argv, 0, 50000);
+	u32 max_threads = bench_arg_u64(argc, argv, 1, 8);
+	u32 passes = bench_arg_u64(argc, argv, 2, 5);
+	struct SQLDB* db = NULL;
+	char sql[0x100];
+	double ordered_base = 0;
+	double unordered_base = 0;
+
+	if( max_threads > BENCH_THREADS_MAX )
+		max_threads = BENCH_THREADS_MAX;
+
+	remove(db_name);
+
+	struct PagerFactoryOpts opts = {0};
+	opts.cache_size = BENCH_CACHE_SIZE;
+	opts.durability = PAGER_DURABILITY_OFF;
+	if( sqldb_create_ex(&db, db_name, &opts) != SQL_OK )
+		return 0;
+
+	char const* create =
+		"CREATE TABLE \"bench\" (\"age\" INT, \"name\" STRING)\n";
+	if( run_sql(db, create) != SQL_OK || run_sql(db, "BEGIN\n") != SQL_OK )
+		return 0;
+
+	// Row ids count up from 1, so row i is aged i % 7.
+	for( u32 i = 1; i <= nrows; i++ )
+	{
+		snprintf(
+			sql,
+			sizeof(sql),
+			"INSERT INTO \"bench\" (\"name\", \"age\") VALUES ('row %u', %u)\n",
+			i,
+			i % 7);
+		if( run_sql(db, sql) != SQL_OK )
+			return 0;
+	}
+
+	if( run_sql(db, "COMMIT\n") != SQL_OK )
+		return 0;
+
+	// Warm the cache.
+	if( run_scan(db, nrows, 1, 1, true) == 0 )
+		return 0;
+
+	for( u32 nthreads = 1; nthreads <= max_threads; nthreads *= 2 )
+	{
+		double ordered = run_scan(db, nrows, passes, nthreads, true);
+		double unordered = run_scan(db, nrows, passes, nthreads, false);
+		if( ordered == 0 || unordered == 0 )
+			return 0;
+
+		if( nthreads == 1 )
+		{
+			ordered_base = ordered;
+			unordered_base = unordered;
+		}
+
+		printf(
+			"parallel_scan: %2u threads ordered %10.0f rows/s %5.2fx "
+			"unordered %10.0f rows/s %5.2fx\n",
+			nthreads,
+			ordered,
+			ordered / ordered_base,
+			unordered,
+			unordered / unordered_base);
+	}
+
+	remove(db_name);
+	return 1;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef BENCH_PARALLEL_SCAN_H_
+#define BENCH_PARALLEL_SCAN_H_
+
+/**
+ * @brief Full scans of a cached sqldb table with a WHERE-style filter,
+ * from 1 up to the given number of workers, doubling; one thread scans on
+ * the caller's. Each count runs with rows handed out in row id order and as
+ * read. Reports rows scanned per second and the speedup over one thread.
+ *
+ * bench parallel_scan [rows] [max threads] [passes]
+ */
+int bench_parallel_scan(int argc, char** argv);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "bench_read_paths.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_factory.h"
+#include "btree_op_scan.h"
+#include "btree_op_select.h"
+#include "noderc.h"
+#include "page.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+
+static int
+run_backend(
+	char const* name,
+	enum pager_backend_e backend,
+	u32 nrows,
+	u32 nlookups,
+	u32 cache_size)
+{
+	int result = 0;
+	char const* db_name = "bench_read_paths.db";
+	struct PagerFactoryOpts opts = {.backend = backend, .cache_size = cache_size};
+	struct Pager* pager = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u32 rng = 0x2545F491;
+	u32 bad = 0;
+	u32 scanned = 0;
+
+	remove(db_name);
+
+	pager = btree_factory_pager_create_ex(db_name, &opts);
+	if( !pager )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 i = 1; i <= nrows; i++ )
+	{
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+
+	struct PagePoolStats pool_stats = {0};
+	page_pool_stats(pager, &pool_stats);
+	u64 allocs_before = pool_stats.block_allocs;
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nlookups; i++ )
+	{
+		u32 key = (bench_rand(&rng) % nrows) + 1;
+		struct OpSelection op = {0};
+		btree_op_select_acquire_tbl(tree, &op, key, NULL);
+		if( btree_op_select_prepare(&op) != BTREE_OK ||
+			btree_op_select_commit(&op, payload, sizeof(payload)) !=
+				BTREE_OK ||
+			memcmp(payload, &key, sizeof(key)) != 0 )
+			bad += 1;
+		btree_op_select_release(&op);
+	}
+	u64 lookup_end = bench_now_ns();
+	page_pool_stats(pager, &pool_stats);
+	u64 lookup_allocs = pool_stats.block_allocs - allocs_before;
+
+	struct OpScan scan = {0};
+	btree_op_scan_acquire(tree, &scan);
+	btree_op_scan_prepare(&scan);
+	while( !btree_op_scan_done(&scan) )
+	{
+		if( btree_op_scan_current(&scan, payload, sizeof(payload)) !=
+			BTREE_OK )
+			break;
+		scanned += 1;
+		if( btree_op_scan_next(&scan) != BTREE_OK )
+			break;
+	}
+	btree_op_scan_release(&scan);
+	u64 scan_end = bench_now_ns();
+
+	printf(
+		"read_paths: %-6s %9.0f lookups/s, %9.0f rows/s scanned, "
+		"%llu page allocs in lookups\n",
+		name,
+		nlookups / bench_secs(start, lookup_end),
+		scanned / bench_secs(lookup_end, scan_end),
+		(unsigned long long)lookup_allocs);
+
+	result = bad == 0 && scanned == nrows;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+	{
+		struct PageCache* cache = pager->cache;
+		pager_destroy(pager);
+		page_cache_destroy(cache);
+	}
+	remove(db_name);
+
+	return result;
+}
+
+int
+bench_read_paths(int argc, char** argv)
+{
+	u32 nrows = bench_arg_u64(argc, argv, 0, 200000);
+	u32 nlookups = bench_arg_u64(argc, argv, 1, 200000);
+	u32 cache_size = bench_arg_u64(argc, argv, 2, 10);
+	int result = 1;
+
+	result &=
+		run_backend("cstd", PAGER_BACKEND_CSTD, nrows, nlookups, cache_size);
+#ifndef _WIN32
+	result &=
+		run_backend("posix", PAGER_BACKEND_POSIX, nrows, nlookups, cache_size);
+	result &=
+		run_backend("mmap", PAGER_BACKEND_MMAP, nrows, nlookups, cache_size);
+#endif
+#ifdef __linux__
+	result &=
+		run_backend("uring", PAGER_BACKEND_URING, nrows, nlookups, cache_size);
+#endif
+
+	return result;
+}
@@ -0,0 +1,12 @@
+#ifndef BENCH_READ_PATHS_H_
+#define BENCH_READ_PATHS_H_
+
+/**
+ * @brief Point lookups and full scans over a table btree for each pager
+ * backend (stdio, pread, mmap, io_uring).
+ *
+ * bench read_paths [rows] [lookups] [cache_pages]
+ */
+int bench_read_paths(int argc, char** argv);
+
+#endif
@@ -0,0 +1,117 @@
+#include "bench_scale.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_op_select.h"
+#include "noderc.h"
+#include "page_cache.h"
+#include "pager_ops_cstd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int
+bench_scale(int argc, char** argv)
+{
+	int result = 0;
+	char const* db_name = "bench_scale.db";
+	u64 nrows = bench_arg_u64(argc, argv, 0, 20000000);
+	u32 payload_size = bench_arg_u64(argc, argv, 1, 100);
+	u32 cache_size = bench_arg_u64(argc, argv, 2, 10);
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte* payload = NULL;
+	byte* readback = NULL;
+	u32 rng = 0x12345678;
+
+	remove(db_name);
+
+	payload = (byte*)malloc(payload_size);
+	readback = (byte*)malloc(payload_size);
+	memset(payload, 0xAB, payload_size);
+
+	page_cache_create(&cache, cache_size);
+	if( pager_cstd_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+	{
+		printf("scale: could not open %s\n", db_name);
+		goto end;
+	}
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	printf("scale: loading %llu rows of %u bytes\n", nrows, payload_size);
+
+	u64 start = bench_now_ns();
+	u64 lap = start;
+	for( u64 i = 1; i <= nrows; i++ )
+	{
+		memcpy(payload, &i, sizeof(u32));
+		if( btree_insert(tree, (int)i, payload, payload_size) != BTREE_OK )
+		{
+			printf("scale: insert %llu failed\n", i);
+			goto end;
+		}
+
+		if( i % 1000000 == 0 )
+		{
+			u64 now = bench_now_ns();
+			printf(
+				"scale: %llu rows, %u pages (%.2f GB), %.0f rows/s\n",
+				i,
+				pager->max_page,
+				(double)pager->max_page * pager->disk_page_size / 1e9,
+				1000000.0 / bench_secs(lap, now));
+			lap = now;
+		}
+	}
+	u64 load_end = bench_now_ns();
+
+	// Spot check random rows, including ones written past the first 2GB.
+	u32 nchecks = 10000;
+	u32 bad = 0;
+	for( u32 i = 0; i < nchecks && nrows > 0; i++ )
+	{
+		u32 key = (bench_rand(&rng) % nrows) + 1;
+		struct OpSelection op = {0};
+		btree_op_select_acquire_tbl(tree, &op, key, NULL);
+		if( btree_op_select_prepare(&op) != BTREE_OK ||
+			btree_op_select_commit(&op, readback, payload_size) != BTREE_OK ||
+			memcmp(readback, &key, sizeof(key)) != 0 )
+			bad += 1;
+		btree_op_select_release(&op);
+	}
+	u64 check_end = bench_now_ns();
+
+	printf(
+		"scale: loaded %llu rows in %.2fs (%.0f rows/s); file %.2f GB\n",
+		nrows,
+		bench_secs(start, load_end),
+		nrows / bench_secs(start, load_end),
+		(double)pager->max_page * pager->disk_page_size / 1e9);
+	printf(
+		"scale: %u point lookups in %.3fs, %u mismatches\n",
+		nchecks,
+		bench_secs(load_end, check_end),
+		bad);
+
+	result = bad == 0;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	if( cache )
+		page_cache_destroy(cache);
+	free(payload);
+	free(readback);
+	remove(db_name);
+
+	return result;
+}
@@ -0,0 +1,12 @@
+#ifndef BENCH_SCALE_H_
+#define BENCH_SCALE_H_
+
+/**
+ * @brief Loads rows into a table btree to check that the pager holds up past
+ * the old 64KB (int offset) limit.
+ *
+ * bench scale [rows] [payload_size] [cache_pages]
+ */
+int bench_scale(int argc, char** argv);
+
+#endif
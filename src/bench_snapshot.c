@@ -0,0 +1,140 @@
+#include "bench_snapshot.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_op_scan.h"
+#include "noderc.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+#include "pager_snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+#define BENCH_CACHE_SIZE 64
+
+static int
+run_mode(u32 nrows, u32 inserts_per_row)
+{
+	int result = 0;
+	char const* db_name = "bench_snapshot.db";
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct PagerSnapshot* snapshot = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTreeNodeRC snapshot_rcer = {0};
+	struct BTree* tree = NULL;
+	struct BTree* snapshot_tree = NULL;
+	struct OpScan op = {0};
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u32 next_key = nrows + 1;
+	u32 scanned = 0;
+
+	remove(db_name);
+
+	page_cache_create(&cache, BENCH_CACHE_SIZE);
+#ifdef _WIN32
+	if( pager_cstd_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#else
+	if( pager_posix_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#endif
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 i = 1; i <= nrows; i++ )
+	{
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+	if( pager_sync(pager) != PAGER_OK ||
+		pager_snapshot_open(pager, &snapshot) != PAGER_OK )
+		goto end;
+
+	noderc_init(&snapshot_rcer, pager);
+	noderc_set_snapshot(&snapshot_rcer, snapshot);
+	btree_alloc(&snapshot_tree);
+	if( btree_init(snapshot_tree, pager, &snapshot_rcer, 1) != BTREE_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	if( btree_op_scan_acquire(snapshot_tree, &op) != BTREE_OK ||
+		btree_op_scan_prepare(&op) != BTREE_OK )
+		goto end;
+
+	while( !btree_op_scan_done(&op) )
+	{
+		if( btree_op_scan_current(&op, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+		scanned += 1;
+
+		// Each insert is its own statement, and commit.
+		for( u32 i = 0; i < inserts_per_row; i++ )
+		{
+			memcpy(payload, &next_key, sizeof(next_key));
+			if( btree_insert(tree, next_key, payload, sizeof(payload)) !=
+					BTREE_OK ||
+				pager_sync(pager) != PAGER_OK )
+				goto end;
+			next_key += 1;
+		}
+
+		if( btree_op_scan_next(&op) != BTREE_OK )
+			goto end;
+	}
+	u64 end = bench_now_ns();
+
+	if( scanned != nrows )
+		goto end;
+
+	double secs = bench_secs(start, end);
+	printf(
+		"snapshot: %2u inserts/row %9.0f rows scanned/s %9.0f inserts/s, "
+		"%u pages kept\n",
+		inserts_per_row,
+		scanned / secs,
+		(next_key - nrows - 1) / secs,
+		snapshot->nimages);
+
+	result = 1;
+
+end:
+	btree_op_scan_release(&op);
+	if( snapshot_tree )
+		btree_dealloc(snapshot_tree);
+	if( snapshot )
+		pager_snapshot_close(snapshot);
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+bench_snapshot(int argc, char** argv)
+{
+	u32 nrows = bench_arg_u64(argc, argv, 0, 20000);
+	u32 inserts_per_row = bench_arg_u64(argc, argv, 1, 1);
+	int result = 1;
+
+	if( nrows == 0 )
+		return 0;
+
+	result &= run_mode(nrows, 0);
+	if( inserts_per_row > 0 )
+		result &= run_mode(nrows, inserts_per_row);
+
+	return result;
+}
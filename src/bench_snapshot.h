@@ -0,0 +1,14 @@
+#ifndef BENCH_SNAPSHOT_H_
+#define BENCH_SNAPSHOT_H_
+
+/**
+ * @brief A full scan through a snapshot, the way sqldb runs a report, with
+ * rows inserted and committed between scan steps. Runs once with no inserts
+ * and once with the given number per row scanned, and reports both rates
+ * and how many page images the snapshot kept.
+ *
+ * bench snapshot [rows] [inserts per row scanned]
+ */
+int bench_snapshot(int argc, char** argv);
+
+#endif
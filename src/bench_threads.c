@@ -0,0 +1,291 @@
+#include "bench_threads.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_cursor.h"
+#include "btree_node.h"
+#include "btree_node_reader.h"
+#include "btthread.h"
+#include "noderc.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+#define BENCH_CACHE_SIZE 1024
+#define BENCH_PRELOAD_ROWS 20000
+#define BENCH_THREADS_MAX 32
+// 95% reads.
+#define BENCH_READ_SCALING_READS 19
+
+struct BenchWorker
+{
+	struct BTree* tree;
+	u32 index;
+	u32 nthreads;
+	u32 nops;
+	u32 reads_per_insert;
+	enum cursor_latch_e read_latch;
+	int ok;
+};
+
+/**
+ * @brief A point read with the given latch mode. Optimistic is what
+ * btree_select_ex does; shared couples latches down the tree instead.
+ */
+static enum btree_e
+select_row(
+	struct BTree* tree, enum cursor_latch_e latch, u32 key, byte* payload)
+{
+	enum btree_e result = BTREE_OK;
+	char found;
+	struct NodeView nv = {0};
+	struct Cursor* cursor = NULL;
+
+	if( latch == CURSOR_LATCH_OPTIMISTIC )
+		return btree_select_ex(tree, key, payload, BENCH_PAYLOAD_SIZE);
+
+	cursor = cursor_create(tree);
+	cursor_set_latch(cursor, latch);
+
+	result = noderc_acquire(cursor_rcer(cursor), &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = cursor_traverse_to(cursor, key, &found);
+	if( result != BTREE_OK )
+		goto end;
+
+	if( !found )
+	{
+		result = BTREE_ERR_KEY_NOT_FOUND;
+		goto end;
+	}
+
+	result = cursor_read_current_ro(cursor, &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = btree_node_read_at(
+		tree,
+		nv_node(&nv),
+		cursor->current_key_index.index,
+		payload,
+		BENCH_PAYLOAD_SIZE);
+
+end:
+	noderc_release(cursor_rcer(cursor), &nv);
+	cursor_destroy(cursor);
+
+	return result;
+}
+
+static void*
+run_worker(void* arg)
+{
+	struct BenchWorker* worker = (struct BenchWorker*)arg;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u32 state = worker->index * 7919 + 1;
+	u32 ninserts = 0;
+
+	worker->ok = 1;
+	for( u32 i = 0; i < worker->nops; i++ )
+	{
+		enum btree_e result = BTREE_OK;
+		if( worker->reads_per_insert != 0 &&
+			i % (worker->reads_per_insert + 1) == 0 )
+		{
+			// New keys past the preloaded ones; threads interleave.
+			u32 key = BENCH_PRELOAD_ROWS + 1 +
+					  ninserts * worker->nthreads + worker->index;
+			memcpy(payload, &key, sizeof(key));
+			result = btree_insert(worker->tree, key, payload, sizeof(payload));
+			ninserts += 1;
+		}
+		else
+		{
+			u32 key = bench_rand(&state) % BENCH_PRELOAD_ROWS + 1;
+			result = select_row(worker->tree, worker->read_latch, key, payload);
+		}
+
+		if( result != BTREE_OK )
+		{
+			worker->ok = 0;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+run_threads(
+	u32 nthreads,
+	u32 nops,
+	u32 reads_per_insert,
+	enum cursor_latch_e read_latch,
+	double* r_ops_per_sec)
+{
+	int result = 0;
+	char const* db_name = "bench_threads.db";
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	struct BenchWorker workers[BENCH_THREADS_MAX];
+	bt_thread threads[BENCH_THREADS_MAX];
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u32 started = 0;
+
+	remove(db_name);
+
+	page_cache_create(&cache, BENCH_CACHE_SIZE);
+#ifdef _WIN32
+	if( pager_cstd_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#else
+	if( pager_posix_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#endif
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 key = 1; key <= BENCH_PRELOAD_ROWS; key++ )
+	{
+		memcpy(payload, &key, sizeof(key));
+		if( btree_insert(tree, key, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+	if( pager_sync(pager) != PAGER_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	for( ; started < nthreads; started++ )
+	{
+		struct BenchWorker* worker = &workers[started];
+		worker->tree = tree;
+		worker->index = started;
+		worker->nthreads = nthreads;
+		worker->nops = nops;
+		worker->reads_per_insert = reads_per_insert;
+		worker->read_latch = read_latch;
+		worker->ok = 0;
+		if( bt_thread_create(&threads[started], &run_worker, worker) != 0 )
+			break;
+	}
+	for( u32 i = 0; i < started; i++ )
+		bt_thread_join(threads[i]);
+	u64 end = bench_now_ns();
+
+	if( started != nthreads )
+		goto end;
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		if( !workers[i].ok )
+			goto end;
+	}
+
+	*r_ops_per_sec = (double)nops * nthreads / bench_secs(start, end);
+	result = 1;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+bench_threads(int argc, char** argv)
+{
+	u32 nops = bench_arg_u64(argc, argv, 0, 50000);
+	u32 max_threads = bench_arg_u64(argc, argv, 1, BENCH_THREADS_MAX);
+	u32 reads_per_insert = bench_arg_u64(argc, argv, 2, 9);
+	double base = 0;
+
+	if( max_threads > BENCH_THREADS_MAX )
+		max_threads = BENCH_THREADS_MAX;
+
+	for( u32 nthreads = 1; nthreads <= max_threads; nthreads *= 2 )
+	{
+		double ops_per_sec = 0;
+		if( !run_threads(
+				nthreads,
+				nops,
+				reads_per_insert,
+				CURSOR_LATCH_OPTIMISTIC,
+				&ops_per_sec) )
+			return 0;
+
+		if( nthreads == 1 )
+			base = ops_per_sec;
+
+		printf(
+			"threads: %2u threads %10.0f ops/s %5.2fx\n",
+			nthreads,
+			ops_per_sec,
+			ops_per_sec / base);
+	}
+
+	return 1;
+}
+
+int
+bench_read_scaling(int argc, char** argv)
+{
+	u32 nops = bench_arg_u64(argc, argv, 0, 50000);
+	u32 max_threads = bench_arg_u64(argc, argv, 1, BENCH_THREADS_MAX);
+	double shared_base = 0;
+	double optimistic_base = 0;
+
+	if( max_threads > BENCH_THREADS_MAX )
+		max_threads = BENCH_THREADS_MAX;
+
+	for( u32 nthreads = 1; nthreads <= max_threads; nthreads *= 2 )
+	{
+		double shared = 0;
+		double optimistic = 0;
+		if( !run_threads(
+				nthreads,
+				nops,
+				BENCH_READ_SCALING_READS,
+				CURSOR_LATCH_SHARED,
+				&shared) )
+			return 0;
+		if( !run_threads(
+				nthreads,
+				nops,
+				BENCH_READ_SCALING_READS,
+				CURSOR_LATCH_OPTIMISTIC,
+				&optimistic) )
+			return 0;
+
+		if( nthreads == 1 )
+		{
+			shared_base = shared;
+			optimistic_base = optimistic;
+		}
+
+		printf(
+			"read_scaling: %2u threads shared %10.0f ops/s %5.2fx "
+			"optimistic %10.0f ops/s %5.2fx\n",
+			nthreads,
+			shared,
+			shared / shared_base,
+			optimistic,
+			optimistic / optimistic_base);
+	}
+
+	return 1;
+}
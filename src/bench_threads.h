@@ -0,0 +1,23 @@
+#ifndef BENCH_THREADS_H_
+#define BENCH_THREADS_H_
+
+/**
+ * @brief Threads sharing one tree, from 1 up to the given count, doubling.
+ * Each thread runs the same number of operations against a preloaded tree:
+ * point reads of random rows, and one insert of a new row every so many
+ * reads. Reports operations per second and the speedup over one thread.
+ *
+ * bench threads [operations per thread] [max threads] [reads per insert]
+ */
+int bench_threads(int argc, char** argv);
+
+/**
+ * @brief Like bench threads with 95% reads, once with readers coupling
+ * shared latches down the tree and once reading optimistically. Reports
+ * both side by side.
+ *
+ * bench read_scaling [operations per thread] [max threads]
+ */
+int bench_read_scaling(int argc, char** argv);
+
+#endif
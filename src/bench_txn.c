@@ -0,0 +1,113 @@
+#include "bench_txn.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "noderc.h"
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+#define BENCH_CACHE_SIZE 64
+
+static int
+run_mode(char wal, u32 nrows, u32 rows_per_txn)
+{
+	int result = 0;
+	char const* db_name = "bench_txn.db";
+	char const* wal_name = "bench_txn.db-wal";
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	int peak_capacity = BENCH_CACHE_SIZE;
+
+	remove(db_name);
+	remove(wal_name);
+
+	page_cache_create(&cache, BENCH_CACHE_SIZE);
+#ifdef _WIN32
+	if( pager_cstd_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#else
+	if( pager_posix_create(&pager, cache, db_name, 0x1000) != PAGER_OK )
+		goto end;
+#endif
+
+	if( wal && pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nrows; i++ )
+	{
+		if( rows_per_txn > 1 && i % rows_per_txn == 0 &&
+			pager_begin(pager) != PAGER_OK )
+			goto end;
+
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i + 1, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+
+		if( cache->capacity > peak_capacity )
+			peak_capacity = cache->capacity;
+
+		// Outside a transaction this is the statement's own commit.
+		if( pager_sync(pager) != PAGER_OK )
+			goto end;
+
+		if( rows_per_txn > 1 &&
+			((i + 1) % rows_per_txn == 0 || i + 1 == nrows) &&
+			pager_commit(pager) != PAGER_OK )
+			goto end;
+	}
+	u64 end = bench_now_ns();
+
+	printf(
+		"txn: %-4s %6u rows/commit %9.0f rows/s, peak cache %d pages\n",
+		wal ? "log" : "file",
+		rows_per_txn,
+		nrows / bench_secs(start, end),
+		peak_capacity);
+
+	result = 1;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+	remove(wal_name);
+
+	return result;
+}
+
+int
+bench_txn(int argc, char** argv)
+{
+	u32 nrows = bench_arg_u64(argc, argv, 0, 5000);
+	u32 rows_per_txn = bench_arg_u64(argc, argv, 1, 1000);
+	int result = 1;
+
+	if( nrows == 0 || rows_per_txn == 0 )
+		return 0;
+
+	for( char wal = 0; wal < 2; wal++ )
+	{
+		result &= run_mode(wal, nrows, 1);
+		result &= run_mode(wal, nrows, rows_per_txn);
+	}
+
+	return result;
+}
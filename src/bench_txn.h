@@ -0,0 +1,14 @@
+#ifndef BENCH_TXN_H_
+#define BENCH_TXN_H_
+
+/**
+ * @brief Rows inserted one at a time, each its own commit the way sqldb runs
+ * statements on their own, against the same rows inside pager_begin and
+ * pager_commit a batch at a time. Runs both with the pages written in place
+ * and through the write-ahead log, at the default durability.
+ *
+ * bench txn [rows] [rows per transaction]
+ */
+int bench_txn(int argc, char** argv);
+
+#endif
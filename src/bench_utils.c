@@ -0,0 +1,40 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench_utils.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+u64
+bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+double
+bench_secs(u64 start_ns, u64 end_ns)
+{
+	return (double)(end_ns - start_ns) / 1e9;
+}
+
+u32
+bench_rand(u32* state)
+{
+	u32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+u64
+bench_arg_u64(int argc, char** argv, int index, u64 default_value)
+{
+	if( index >= argc )
+		return default_value;
+
+	return strtoull(argv[index], NULL, 10);
+}
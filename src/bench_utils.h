@@ -0,0 +1,24 @@
+#ifndef BENCH_UTILS_H_
+#define BENCH_UTILS_H_
+
+#include "btint.h"
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+u64 bench_now_ns(void);
+
+double bench_secs(u64 start_ns, u64 end_ns);
+
+/**
+ * @brief xorshift32; state must be non-zero.
+ */
+u32 bench_rand(u32* state);
+
+/**
+ * @brief Parse argv[index] as an unsigned integer, or return default_value if
+ * it is not present.
+ */
+u64 bench_arg_u64(int argc, char** argv, int index, u64 default_value);
+
+#endif
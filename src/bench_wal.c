@@ -0,0 +1,209 @@
+#include "bench_wal.h"
+
+#include "bench_utils.h"
+#include "btree.h"
+#include "btree_factory.h"
+#include "noderc.h"
+#include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+#include "pager_wal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAYLOAD_SIZE 100
+#define BENCH_PAGE_SIZE 0x1000
+
+static int
+u64_cmp(void const* left, void const* right)
+{
+	u64 l = *(u64 const*)left;
+	u64 r = *(u64 const*)right;
+	return l < r ? -1 : l > r;
+}
+
+static int
+run_tree(char const* name, char wal, char checkpointer, u32 ncommits)
+{
+	int result = 0;
+	char const* db_name = "bench_wal.db";
+	struct PagerFactoryOpts opts = {.wal = wal, .checkpointer = checkpointer};
+	struct Pager* pager = NULL;
+	struct BTreeNodeRC rcer = {0};
+	struct BTree* tree = NULL;
+	byte payload[BENCH_PAYLOAD_SIZE] = {0};
+	u64* latencies = (u64*)malloc(sizeof(u64) * ncommits);
+
+	remove(db_name);
+	remove("bench_wal.db-wal");
+
+	pager = btree_factory_pager_create_ex(db_name, &opts);
+	if( !pager || !latencies )
+		goto end;
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < ncommits; i++ )
+	{
+		u64 commit_start = bench_now_ns();
+		memcpy(payload, &i, sizeof(i));
+		if( btree_insert(tree, i + 1, payload, sizeof(payload)) != BTREE_OK ||
+			pager_sync(pager) != PAGER_OK )
+			goto end;
+		latencies[i] = bench_now_ns() - commit_start;
+	}
+	u64 end = bench_now_ns();
+
+	qsort(latencies, ncommits, sizeof(u64), u64_cmp);
+
+	printf(
+		"wal: %-6s %8.0f commits/s, p50 %6.0f us, p99 %6.0f us, max %6.0f "
+		"us\n",
+		name,
+		ncommits / bench_secs(start, end),
+		latencies[ncommits / 2] / 1000.0,
+		latencies[(u64)ncommits * 99 / 100] / 1000.0,
+		latencies[ncommits - 1] / 1000.0);
+
+	if( pager->checkpointer )
+	{
+		struct PagerCheckpointerStats stats;
+		pager_checkpoint_stats(pager, &stats);
+		printf(
+			"wal: %-6s %8llu pages checkpointed, %.1f MB, lag %llu frames, "
+			"%llu log restarts\n",
+			"",
+			(unsigned long long)stats.pages_written,
+			stats.bytes_written / (1024.0 * 1024.0),
+			(unsigned long long)stats.lag_frames,
+			(unsigned long long)pager->wal->stats.restarts);
+	}
+
+	result = 1;
+
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+	{
+		struct PageCache* cache = pager->cache;
+		pager_destroy(pager);
+		page_cache_destroy(cache);
+	}
+	free(latencies);
+	remove(db_name);
+
+	return result;
+}
+
+struct GroupWorker
+{
+	struct PagerWal* wal;
+	u32 ncommits;
+	u32 page_id;
+	int ok;
+};
+
+static void*
+group_worker(void* arg)
+{
+	struct GroupWorker* worker = (struct GroupWorker*)arg;
+	byte* page = (byte*)calloc(1, BENCH_PAGE_SIZE);
+	void* pages[1] = {page};
+	u64 end = 0;
+
+	worker->ok = page != NULL;
+	for( u32 i = 0; i < worker->ncommits && worker->ok; i++ )
+	{
+		memcpy(page, &i, sizeof(i));
+		worker->ok = pager_wal_append(
+						 worker->wal,
+						 &worker->page_id,
+						 pages,
+						 1,
+						 worker->page_id,
+						 &end) == PAGER_OK &&
+					 pager_wal_sync(worker->wal, end) == PAGER_OK;
+	}
+
+	free(page);
+	return NULL;
+}
+
+static int
+run_group(char const* name, char group_commit, u32 ncommits, u32 nthreads)
+{
+	char const* wal_name = "bench_wal_group.db-wal";
+	struct PagerWal* wal = NULL;
+	struct GroupWorker workers[64];
+	bt_thread threads[64];
+	int result = 1;
+
+#ifdef _WIN32
+	struct PagerOps* ops = &CStdOps;
+#else
+	struct PagerOps* ops = &PosixOps;
+#endif
+
+	if( nthreads > 64 )
+		nthreads = 64;
+
+	remove(wal_name);
+	if( pager_wal_open(&wal, ops, wal_name, BENCH_PAGE_SIZE) != PAGER_OK )
+		return 0;
+
+	wal->group_commit = group_commit;
+
+	u64 start = bench_now_ns();
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		workers[i].wal = wal;
+		workers[i].ncommits = ncommits / nthreads;
+		workers[i].page_id = i + 1;
+		workers[i].ok = 0;
+		bt_thread_create(&threads[i], &group_worker, &workers[i]);
+	}
+
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		bt_thread_join(threads[i]);
+		result &= workers[i].ok;
+	}
+	u64 end = bench_now_ns();
+
+	printf(
+		"wal: %-6s %8.0f commits/s, %u threads, %.2f syncs/commit\n",
+		name,
+		wal->stats.commits / bench_secs(start, end),
+		nthreads,
+		wal->stats.commits ? (double)wal->stats.syncs / wal->stats.commits
+						   : 0.0);
+
+	pager_wal_close(wal, 1);
+
+	return result;
+}
+
+int
+bench_wal(int argc, char** argv)
+{
+	u32 ncommits = bench_arg_u64(argc, argv, 0, 2000);
+	u32 nthreads = bench_arg_u64(argc, argv, 1, 8);
+	int result = 1;
+
+	if( ncommits == 0 || nthreads == 0 )
+		return 0;
+
+	result &= run_tree("fsync", 0, 0, ncommits);
+	result &= run_tree("log", 1, 0, ncommits);
+	result &= run_tree("bgckpt", 1, 1, ncommits);
+	result &= run_group("single", 0, ncommits, nthreads);
+	result &= run_group("group", 1, ncommits, nthreads);
+
+	return result;
+}
@@ -0,0 +1,15 @@
+#ifndef BENCH_WAL_H_
+#define BENCH_WAL_H_
+
+/**
+ * @brief Commit latency and throughput. One row is inserted per commit, then
+ * the commit is made durable, first by writing the pages in place and
+ * fsyncing the database file, then through the write-ahead log, checkpointed
+ * inline and then by the background checkpointer. Last, threads commit
+ * single frames to one log with and without group commit.
+ *
+ * bench wal [commits] [threads]
+ */
+int bench_wal(int argc, char** argv);
+
+#endif
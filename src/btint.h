@@ -1,6 +1,8 @@
 #ifndef BTINT_H_
 #define BTINT_H_
 
+typedef unsigned long long u64; /* 8-byte unsigned integer */
+typedef long long i64;			/* 8-byte signed integer */
 typedef unsigned int u32;	/* 4-byte unsigned integer */
 typedef int i32;			/* 4-byte unsigned integer */
 typedef unsigned short u16; /* 2-byte unsigned integer */
@@ -91,10 +91,11 @@ btree_min_page_size(void)
 	u32 min_heap_required_for_largest_cell_type =
 		btree_node_heap_required_for_insertion(
 			btree_cell_overflow_min_disk_size());
-	// Minimum size to fit 4 overflow cells on the root page.
+	// Minimum size to fit 4 overflow cells on the root page; the last word
+	// is the V1 sibling link.
 	return (
 		(BTREE_HEADER_SIZE) + (4 * min_heap_required_for_largest_cell_type) +
-		+sizeof(struct BTreePageHeader));
+		+sizeof(struct BTreePageHeader) + sizeof(u32));
 }
 
 /**
@@ -118,6 +119,7 @@ btree_init(
 	tree->compare = &btree_compare;
 	tree->reset_compare = &btree_compare_reset;
 	tree->keyof = &btree_keyof;
+	tree->bytewise = 0;
 
 	// Arbitrary 4*12 is approximately 4 entries that overflow.
 	// 1 int for cell size, 2 more for overflow page meta.
@@ -189,10 +191,10 @@ btree_keyof(
 	u32* out_total_size,
 	u32* out_follow_page)
 {
-	*out_size = sizeof(node->keys[index].key);
-	*out_total_size = sizeof(node->keys[index].key);
+	*out_size = sizeof(u32);
+	*out_total_size = sizeof(u32);
 	*out_follow_page = 0;
-	return (byte*)&node->keys[index].key;
+	return (byte*)node_key_ptr_at(node, index);
 }
 
 enum btree_e
@@ -204,8 +206,13 @@ btree_insert(struct BTree* tree, int key, void* data, int data_size)
 	struct CursorBreadcrumb crumb = {0};
 	struct SplitPage split_result = {0};
 	struct SplitPageAsParent root_split_result = {0};
+	// The child page id being inserted into the parent. This can't point
+	// into split_result because splitting the parent overwrites it before
+	// the pending write happens.
+	u32 pending_child_page_id = 0;
 
 	struct Cursor* cursor = cursor_create(tree);
+	cursor_set_latch(cursor, CURSOR_LATCH_INSERT);
 
 	result = noderc_acquire(tree->rcer, &nv);
 	if( result != BTREE_OK )
@@ -265,10 +272,10 @@ btree_insert(struct BTree* tree, int key, void* data, int data_size)
 					goto end;
 
 				// TODO: Key compare function.
-				if( key <= split_result.left_page_high_key )
+				if( key > split_result.left_page_high_key )
 				{
 					result = noderc_reinit_read(
-						tree->rcer, &nv, split_result.left_page_id);
+						tree->rcer, &nv, split_result.right_page_id);
 					if( result != BTREE_OK )
 						goto end;
 				}
@@ -283,6 +290,23 @@ btree_insert(struct BTree* tree, int key, void* data, int data_size)
 				if( result != BTREE_OK )
 					goto end;
 
+				// The parent's pointer to the split page covers the upper
+				// half's keys, which are on the right page now.
+				result = noderc_reinit_read(tree->rcer, &nv, crumb.page_id);
+				if( result != BTREE_OK )
+					goto end;
+
+				result = btree_node_write_inline_as_page(
+					nv_node(&nv),
+					&crumb.key_index,
+					split_result.right_page_id);
+				if( result != BTREE_OK )
+					goto end;
+
+				result = noderc_persist_n(tree->rcer, 1, &nv);
+				if( result != BTREE_OK )
+					goto end;
+
 				// TODO: Better way to do this?
 				// Basically we have to insert the left child to the left of the
 				// node that was split.
@@ -297,8 +321,8 @@ btree_insert(struct BTree* tree, int key, void* data, int data_size)
 					goto end;
 
 				// Args for next iteration
-				// Insert the new child's page number into the parent.
-				// The parent pointer is already the key of the highest
+				// Insert the left page's number into the parent.
+				// The parent pointer keeps the key of the highest
 				// key in the right page, so that can stay the same.
 				// Insert the highest key of the left page.
 				//    K5              K<5   K5
@@ -306,8 +330,9 @@ btree_insert(struct BTree* tree, int key, void* data, int data_size)
 				//    K5              K<5   K5
 				//
 				key = split_result.left_page_high_key;
-				data = (void*)&split_result.left_page_id;
-				data_size = sizeof(split_result.left_page_id);
+				pending_child_page_id = split_result.left_page_id;
+				data = (void*)&pending_child_page_id;
+				data_size = sizeof(pending_child_page_id);
 			}
 		}
 		else
@@ -372,6 +397,7 @@ btree_delete(struct BTree* tree, int key)
 	enum btree_e result = BTREE_OK;
 
 	struct Cursor* cursor = cursor_create(tree);
+	cursor_set_latch(cursor, CURSOR_LATCH_DELETE);
 	result = delete_single(cursor, key);
 
 	if( result == BTREE_ERR_UNDERFLOW )
@@ -394,29 +420,46 @@ btree_select_ex(struct BTree* tree, u32 key, void* buffer, u32 buffer_size)
 	char found;
 	struct NodeView nv = {0};
 	struct Cursor* cursor = cursor_create(tree);
+	cursor_set_latch(cursor, CURSOR_LATCH_OPTIMISTIC);
 
 	result = noderc_acquire(cursor_rcer(cursor), &nv);
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_traverse_to(cursor, key, &found);
-	if( result != BTREE_OK )
-		goto end;
-
-	if( !found )
+	do
 	{
-		result = BTREE_ERR_KEY_NOT_FOUND;
-		goto end;
-	}
+		result = cursor_traverse_to(cursor, key, &found);
+		if( result != BTREE_OK )
+			goto end;
 
-	result = cursor_read_current(cursor, &nv);
-	if( result != BTREE_OK )
-		goto end;
+		if( !found )
+		{
+			result = BTREE_ERR_KEY_NOT_FOUND;
+			goto end;
+		}
+
+		result = cursor_read_current(cursor, &nv);
+		if( cursor_validate(cursor) != BTREE_OK )
+			result = BTREE_ERR_CONFLICT;
+		if( result == BTREE_OK )
+		{
+			assert(
+				cursor->current_key_index.index !=
+				node_num_keys(nv_node(&nv)));
+
+			// Overflow pages are only freed under the leaf's latch, so
+			// the leaf's version covers them too.
+			u32 ind = cursor->current_key_index.index;
+			result = btree_node_read_at(
+				tree, nv_node(&nv), ind, buffer, buffer_size);
+			if( cursor_validate(cursor) != BTREE_OK )
+				result = BTREE_ERR_CONFLICT;
+		}
 
-	assert(cursor->current_key_index.index != node_num_keys(nv_node(&nv)));
+		if( result == BTREE_ERR_CONFLICT )
+			cursor_reset(cursor);
+	} while( result == BTREE_ERR_CONFLICT );
 
-	u32 ind = cursor->current_key_index.index;
-	result = btree_node_read_at(tree, nv_node(&nv), ind, buffer, buffer_size);
 	if( result != BTREE_OK )
 		goto end;
 
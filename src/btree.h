@@ -37,6 +37,14 @@ byte* btree_keyof(
 	u32* out_total_size,
 	u32* out_follow_page);
 
+/**
+ * @brief Insert a row.
+ *
+ * btree_insert, btree_delete and btree_select_ex latch the pages they visit,
+ * so threads can use the same tree; see cursor_latch_e. Flush and commit
+ * while none of them is running, or the pages written may be half an
+ * insert.
+ */
 enum btree_e btree_insert(struct BTree*, int key, void* data, int data_size);
 
 /**
@@ -56,4 +64,12 @@ enum btree_e btree_insert(struct BTree*, int key, void* data, int data_size);
  */
 enum btree_e btree_delete(struct BTree*, int key);
 
+/**
+ * @brief Copy the row with key into buffer.
+ *
+ * @return BTREE_ERR_KEY_NOT_FOUND if there is none.
+ */
+enum btree_e
+btree_select_ex(struct BTree*, u32 key, void* buffer, u32 buffer_size);
+
 #endif
@@ -49,7 +49,7 @@ split_node(
 	int first_half = ((source_node->header->num_keys + 1) / 2);
 	// We need to keep track of this. If this is a nonleaf node,
 	// then the left child high key will be lost.
-	unsigned int left_child_high_key = source_node->keys[first_half - 1].key;
+	unsigned int left_child_high_key = node_key_at(source_node, first_half - 1);
 
 	for( int i = 0; i < first_half - 1; i++ )
 	{
@@ -119,6 +119,15 @@ bta_split_node_as_parent(
 	if( result != BTREE_OK )
 		goto end;
 
+	result = node_right_sibling_set(
+		nv_node(&left_nv), nv_page(&right_nv)->page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_persist_n(rcer, 1, &left_nv);
+	if( result != BTREE_OK )
+		goto end;
+
 	// When splitting a leaf-node,
 	// the right_child pointer becomes the right_page id
 	// When splitting a non-leaf node
@@ -178,10 +187,9 @@ bta_split_node(
 	if( result != BTREE_OK )
 		goto end;
 
-	// We want right page to remain stable since pointers
-	// in parent nodes are already pointing to the high-key of the input
-	// node which becomes the high key of the right child.
-	result = noderc_reinit_as(rcer, &right_nv, node->page_number);
+	// The left page keeps the input page so that the node to its left
+	// still links to it; the right page is new.
+	result = noderc_reinit_as(rcer, &left_nv, node->page_number);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -198,11 +206,25 @@ bta_split_node(
 	bool is_leaf = node_is_leaf(node);
 	node_is_leaf_set(nv_node(&left_nv), is_leaf);
 	node_is_leaf_set(nv_node(&right_nv), is_leaf);
-	result = noderc_persist_n(rcer, 2, &right_nv, &left_nv);
+	result = node_right_sibling_set(
+		nv_node(&right_nv), node_right_sibling(node));
 	if( result != BTREE_OK )
 		goto end;
 
-	result = btree_node_copy(node, nv_node(&right_nv));
+	result = noderc_persist_n(rcer, 1, &right_nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = node_right_sibling_set(
+		nv_node(&left_nv), nv_page(&right_nv)->page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_persist_n(rcer, 1, &left_nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = btree_node_copy(node, nv_node(&left_nv));
 	if( result != BTREE_OK )
 		goto end;
 
@@ -210,6 +232,7 @@ bta_split_node(
 	{
 		split_page->left_page_id = nv_page(&left_nv)->page_id;
 		split_page->left_page_high_key = split_result.left_child_high_key;
+		split_page->right_page_id = nv_page(&right_nv)->page_id;
 	}
 
 end:
@@ -483,28 +506,35 @@ bta_merge(struct Cursor* cursor, enum bta_rebalance_mode_e mode)
 			nv_node(&left_nv), node_right_child(nv_node(&right_nv)));
 	}
 
-	// Remove left parent.
+	// Result always ends up on the left-side page, so the node linking to
+	// it needn't change.
+	result = node_right_sibling_set(
+		nv_node(&left_nv), node_right_sibling(nv_node(&right_nv)));
+	if( result != BTREE_OK )
+		goto end;
+
+	// Remove left parent; the right page's separator, now the left page's,
+	// takes its place.
 	result = btree_node_remove(
 		nv_node(&parent_nv), &lparent_crumb.key_index, NULL, NULL, 0);
 	if( result != BTREE_OK )
 		goto end;
 
-	// Result always ends up on the right-side page.
-	result = btree_node_copy(nv_node(&right_nv), nv_node(&left_nv));
+	result = btree_node_write_inline_as_page(
+		nv_node(&parent_nv), &lparent_crumb.key_index, left_page_id);
 	if( result != BTREE_OK )
 		goto end;
 
 	parent_deficient =
 		node_num_keys(nv_node(&parent_nv)) < btree_underflow_lim(cursor->tree);
 
-	result = noderc_persist_n(
-		cursor_rcer(cursor), 3, &left_nv, &right_nv, &parent_nv);
+	result = noderc_persist_n(cursor_rcer(cursor), 2, &left_nv, &parent_nv);
 	if( result != BTREE_OK )
 		goto end;
 
 	// Free List
 	result = btpage_err(
-		pager_freelist_push_page(cursor_pager(cursor), nv_page(&left_nv)));
+		pager_freelist_push_page(cursor_pager(cursor), nv_page(&right_nv)));
 	if( result != BTREE_OK )
 		goto end;
 
@@ -702,6 +732,15 @@ bta_rebalance_root(struct Cursor* cursor)
 		assert(nv_page(&empty_nv)->page_id != 0);
 		node_right_child_set(nv_node(&root_nv), nv_page(&empty_nv)->page_id);
 
+		result = node_right_sibling_set(
+			nv_node(&right_nv), nv_page(&empty_nv)->page_id);
+		if( result != BTREE_OK )
+			goto end;
+
+		result = noderc_persist_n(cursor_rcer(cursor), 1, &right_nv);
+		if( result != BTREE_OK )
+			goto end;
+
 		// Take the highest key of the child and use that as the new key for the
 		// root
 		u32 high_key = node_key_at(
@@ -16,7 +16,8 @@ struct SplitPageAsParent
  *
  * Create a left and right child node; place half the data in the
  * left and right child each, then place the key for the left child
- * in the input node and set the rightmost child field.
+ * in the input node and set the rightmost child field. The left child
+ * links to the right one.
  *
  * Input node becomes parent.
  * Input node, left and right children are written to disk.
@@ -36,6 +37,7 @@ struct SplitPage
 {
 	int left_page_id;
 	int left_page_high_key;
+	int right_page_id;
 };
 
 /**
@@ -43,8 +45,12 @@ struct SplitPage
  *
  * Create a right child node. Move the upper half the data to the right child,
  * then keep the lower half in the left child.
- * Input node becomes right child.
- * Input node and left child are both written to disk.
+ * Input node becomes left child, and links to the right child, which takes
+ * over the input node's right sibling.
+ * Input node and right child are both written to disk.
+ *
+ * The parent still points at the input node for the upper half's keys; the
+ * caller points it at the right child and inserts the left child's high key.
  *
  * @param tree
  * @param node
@@ -60,6 +60,8 @@ btree_alg_test_split_nonleaf(void)
 	fake_child_page_id_as_key = 6;
 	node->header->right_child = fake_child_page_id_as_key;
 
+	pager_write_page(pager, page);
+
 	struct SplitPage split_result = {0};
 	bta_split_node(node, &rcer, &split_result);
 
@@ -67,7 +69,7 @@ btree_alg_test_split_nonleaf(void)
 	struct Page* other_page = NULL;
 	page_create(pager, &other_page);
 
-	selector.page_id = split_result.left_page_id;
+	selector.page_id = split_result.right_page_id;
 	pager_read_page(pager, &selector, other_page);
 
 	btree_node_create_from_page(&other_node, other_page);
@@ -84,7 +86,15 @@ btree_alg_test_split_nonleaf(void)
 		goto end;
 	}
 
-	if( other_node->header->right_child != 4 || node->header->right_child != 6 )
+	// The split page keeps the lower half and links to the new page.
+	if( node->header->right_child != 4 || other_node->header->right_child != 6 )
+	{
+		result = 0;
+		goto end;
+	}
+
+	if( node_right_sibling(node) != 2 ||
+		node_right_sibling(other_node) != 0 )
 	{
 		result = 0;
 		goto end;
@@ -95,8 +105,8 @@ end:
 	btree_node_destroy(other_node);
 	page_destroy(pager, page);
 	page_destroy(pager, other_page);
-	page_cache_destroy(cache);
 	pager_destroy(pager);
+	page_cache_destroy(cache);
 	remove(db_name);
 	return result;
 }
@@ -144,6 +154,8 @@ btree_alg_test_split_leaf(void)
 	btree_node_insert_inline(
 		node, &inserter, fake_child_page_id_as_key, (void*)&cell);
 
+	pager_write_page(pager, page);
+
 	struct SplitPage split_result = {0};
 	struct BTreeNodeRC rcer = {0};
 	noderc_init(&rcer, pager);
@@ -153,7 +165,7 @@ btree_alg_test_split_leaf(void)
 	struct Page* other_page = NULL;
 	page_create(pager, &other_page);
 
-	selector.page_id = split_result.left_page_id;
+	selector.page_id = split_result.right_page_id;
 	pager_read_page(pager, &selector, other_page);
 
 	btree_node_create_from_page(&other_node, other_page);
@@ -176,13 +188,20 @@ btree_alg_test_split_leaf(void)
 		goto end;
 	}
 
+	if( node_right_sibling(node) != 2 ||
+		node_right_sibling(other_node) != 0 )
+	{
+		result = 0;
+		goto end;
+	}
+
 end:
 	btree_node_destroy(node);
 	btree_node_destroy(other_node);
 	page_destroy(pager, page);
 	page_destroy(pager, other_page);
-	page_cache_destroy(cache);
 	pager_destroy(pager);
+	page_cache_destroy(cache);
 	remove(db_name);
 	return result;
 }
@@ -280,8 +299,8 @@ end:
 	btree_node_destroy(right_node);
 	page_destroy(pager, left_page);
 	page_destroy(pager, right_page);
-	page_cache_destroy(cache);
 	pager_destroy(pager);
+	page_cache_destroy(cache);
 	remove(db_name);
 	return result;
 }
@@ -374,8 +393,8 @@ end:
 	page_destroy(pager, page);
 	page_destroy(pager, left_page);
 	page_destroy(pager, right_page);
-	page_cache_destroy(cache);
 	pager_destroy(pager);
+	page_cache_destroy(cache);
 	remove(db_name);
 	return result;
 }
@@ -4,6 +4,7 @@
 #include "btree_node.h"
 #include "btree_utils.h"
 #include "noderc.h"
+#include "page_cache.h"
 #include "pager.h"
 
 #include <assert.h>
@@ -11,6 +12,25 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Most children a scan reads ahead at once.
+#define CURSOR_PREFETCH_MAX 8
+// Optimistic descents that may conflict before falling back to latching.
+#define CURSOR_OPTIMISTIC_TRIES 4
+
+// Optimistic descents read table-tree pages in place while writers may be
+// copying into the same frames, and check versions afterwards. That is a
+// race by design, and ThreadSanitizer reports it; builds with it copy.
+#if defined(__SANITIZE_THREAD__)
+#define CURSOR_READ_IN_PLACE 0
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define CURSOR_READ_IN_PLACE 0
+#endif
+#endif
+#ifndef CURSOR_READ_IN_PLACE
+#define CURSOR_READ_IN_PLACE 1
+#endif
+
 /**
  * @brief Move to the next right cell.
  *
@@ -81,41 +101,45 @@ move_to_begin(struct Cursor* cursor, struct NodeView* nv)
 	cursor->current_page_id = nv->page->page_id;
 }
 
-/**
- * @brief Gets the child page id from the cell.
- *
- * @param cursor
- * @param node
- * @param child_key_index
- * @return enum btree_e
- */
 static enum btree_e
-read_cell_page(
-	struct Cursor* cursor, struct BTreeNode* node, u32 child_key_index)
+child_page_at(
+	struct Cursor* cursor,
+	struct BTreeNode* node,
+	u32 child_key_index,
+	u32* out_page_id)
 {
 	enum btree_e result = BTREE_OK;
 	if( child_key_index >= node->header->num_keys )
 	{
-		cursor->current_page_id = node->header->right_child;
+		*out_page_id = node->header->right_child;
 	}
 	else
 	{
 		if( cursor->tree->type == BTREE_TBL )
 		{
+			// An optimistic cursor may read a torn slot; stay in the node
+			// until the version says whether it was.
+			u32 offset = node_cell_offset_at(node, child_key_index);
+			if( offset < 2 * sizeof(u32) || offset > btu_get_node_size(node) )
+			{
+				result = BTREE_ERR_CORRUPT_CELL;
+				goto end;
+			}
+
 			struct CellData cell = {0};
 			btu_read_cell(node, child_key_index, &cell);
 			u32 cell_size = btree_cell_get_size(&cell);
-			if( cell_size != sizeof(cursor->current_page_id) )
+			if( cell_size != sizeof(*out_page_id) )
 			{
 				result = BTREE_ERR_CORRUPT_CELL;
 				goto end;
 			}
 
-			memcpy(&cursor->current_page_id, cell.pointer, cell_size);
+			memcpy(out_page_id, cell.pointer, cell_size);
 		}
 		else
 		{
-			cursor->current_page_id = node->keys[child_key_index].key;
+			*out_page_id = node_key_at(node, child_key_index);
 		}
 	}
 
@@ -123,6 +147,280 @@ end:
 	return result;
 }
 
+/**
+ * @brief Gets the child page id from the cell.
+ *
+ * @param cursor
+ * @param node
+ * @param child_key_index
+ * @return enum btree_e
+ */
+static enum btree_e
+read_cell_page(
+	struct Cursor* cursor, struct BTreeNode* node, u32 child_key_index)
+{
+	u32 page_id = 0;
+	enum btree_e result = child_page_at(cursor, node, child_key_index, &page_id);
+	if( result == BTREE_OK )
+		cursor->current_page_id = page_id;
+
+	return result;
+}
+
+/**
+ * @brief Read the next few children of a node in one batch.
+ *
+ * Scans visit children left to right; fetching them a window at a time lets
+ * the pager hand the reads to the backend together. Only done at window
+ * boundaries so each child is prefetched once. The window is kept well under
+ * the cache capacity so prefetched pages aren't evicted before use.
+ *
+ * This is only a hint; errors are ignored.
+ */
+static void
+prefetch_children(
+	struct Cursor* cursor, struct BTreeNode* node, u32 child_key_index)
+{
+	struct Pager* pager = cursor_pager(cursor);
+	u32 page_ids[CURSOR_PREFETCH_MAX];
+	u32 window = pager->cache->capacity / 4;
+	u32 num = 0;
+
+	// Mapped reads don't go through the cache.
+	if( pager->ops->map != NULL )
+		return;
+
+	if( window > CURSOR_PREFETCH_MAX )
+		window = CURSOR_PREFETCH_MAX;
+
+	if( window < 2 || child_key_index % window != 0 )
+		return;
+
+	for( u32 i = child_key_index;
+		 i < child_key_index + window && i <= node_num_keys(node);
+		 i++ )
+	{
+		if( child_page_at(cursor, node, i, &page_ids[num]) != BTREE_OK )
+			break;
+		num++;
+	}
+
+	pager_prefetch(pager, page_ids, num);
+}
+
+static enum page_latch_e
+latch_mode(struct Cursor* cursor)
+{
+	return cursor->latch == CURSOR_LATCH_SHARED ? PAGE_LATCH_SHARED
+												: PAGE_LATCH_EXCLUSIVE;
+}
+
+/**
+ * @brief Latch page_id in the cursor's mode, unless the cursor holds it
+ * already.
+ */
+static enum btree_e
+latch_page(struct Cursor* cursor, u32 page_id)
+{
+	enum btree_e result = BTREE_OK;
+
+	if( cursor->latch == CURSOR_LATCH_NONE ||
+		cursor->latch == CURSOR_LATCH_OPTIMISTIC )
+		return BTREE_OK;
+
+	for( int i = 0; i < cursor->nlatched; i++ )
+	{
+		if( cursor->latched[i] == page_id )
+			return BTREE_OK;
+	}
+
+	if( cursor->nlatched == CURSOR_LATCHES_MAX )
+		return BTREE_ERR_CURSOR_DEPTH_EXCEEDED;
+
+	// Flushes wait for writes in flight; see page_cache_quiesce.
+	if( latch_mode(cursor) == PAGE_LATCH_EXCLUSIVE && !cursor->writing )
+	{
+		page_cache_write_begin(cursor_pager(cursor)->cache);
+		cursor->writing = 1;
+	}
+
+	result = btpage_err(page_cache_latch(
+		cursor_pager(cursor)->cache, page_id, latch_mode(cursor)));
+	if( result != BTREE_OK )
+	{
+		if( cursor->nlatched == 0 )
+			cursor_unlatch(cursor);
+		return result;
+	}
+
+	cursor->latched[cursor->nlatched] = page_id;
+	cursor->nlatched += 1;
+
+	return BTREE_OK;
+}
+
+/**
+ * @brief latch_page for a shared cursor, but without waiting; a scan
+ * latches the next leaf this way while it holds the current one.
+ *
+ * @return BTREE_ERR_CONFLICT if another thread holds the page exclusive.
+ */
+static enum btree_e
+latch_page_nowait(struct Cursor* cursor, u32 page_id)
+{
+	assert(cursor->latch == CURSOR_LATCH_SHARED);
+
+	if( cursor->nlatched == CURSOR_LATCHES_MAX )
+		return BTREE_ERR_CURSOR_DEPTH_EXCEEDED;
+
+	if( !page_cache_try_latch(
+			cursor_pager(cursor)->cache, page_id, PAGE_LATCH_SHARED) )
+		return BTREE_ERR_CONFLICT;
+
+	cursor->latched[cursor->nlatched] = page_id;
+	cursor->nlatched += 1;
+
+	return BTREE_OK;
+}
+
+/**
+ * @brief Release page_id if the cursor holds it.
+ */
+static void
+unlatch_page(struct Cursor* cursor, u32 page_id)
+{
+	for( int i = 0; i < cursor->nlatched; i++ )
+	{
+		if( cursor->latched[i] != page_id )
+			continue;
+
+		page_cache_unlatch(
+			cursor_pager(cursor)->cache, page_id, latch_mode(cursor));
+
+		cursor->nlatched -= 1;
+		memmove(
+			&cursor->latched[i],
+			&cursor->latched[i + 1],
+			(cursor->nlatched - i) * sizeof(cursor->latched[0]));
+		return;
+	}
+}
+
+/**
+ * @brief cursor_pop, releasing the page it leaves.
+ */
+static enum btree_e
+pop_unlatch(struct Cursor* cursor)
+{
+	struct CursorBreadcrumb crumb = {0};
+	enum btree_e result = cursor_pop(cursor, &crumb);
+	if( result == BTREE_OK )
+		unlatch_page(cursor, crumb.page_id);
+
+	return result;
+}
+
+/**
+ * @brief Release every latch but the newest.
+ */
+static void
+unlatch_ancestors(struct Cursor* cursor)
+{
+	if( cursor->nlatched < 2 )
+		return;
+
+	for( int i = 0; i < cursor->nlatched - 1; i++ )
+		page_cache_unlatch(
+			cursor_pager(cursor)->cache,
+			cursor->latched[i],
+			latch_mode(cursor));
+
+	cursor->latched[0] = cursor->latched[cursor->nlatched - 1];
+	cursor->nlatched = 1;
+}
+
+/**
+ * @brief Whether the operation the cursor latches for can't change anything
+ * above node; see cursor_latch_e.
+ */
+static bool
+node_is_safe(struct Cursor* cursor, struct BTreeNode* node)
+{
+	switch( cursor->latch )
+	{
+	case CURSOR_LATCH_INSERT:
+		return node->header->free_heap >=
+			   btree_node_heap_required_for_insertion(
+				   btree_node_max_cell_size(node));
+	case CURSOR_LATCH_DELETE:
+		return node_num_keys(node) > 1 &&
+			   node_num_keys(node) > btree_underflow_lim(cursor->tree) + 1;
+	case CURSOR_LATCH_SHARED:
+		// Index scans go back up through the path.
+		return cursor->tree->type == BTREE_TBL && !cursor->hold_path;
+	default:
+		return true;
+	}
+}
+
+/**
+ * @brief CURSOR_LATCH_OPTIMISTIC: the version of page_id before reading it.
+ *
+ * @return BTREE_ERR_CONFLICT if a writer has it latched.
+ */
+static enum btree_e
+optimistic_begin(struct Cursor* cursor, u32 page_id, u32* r_version)
+{
+	*r_version = page_cache_version(cursor_pager(cursor)->cache, page_id);
+	return *r_version != 0 ? BTREE_OK : BTREE_ERR_CONFLICT;
+}
+
+/**
+ * @brief CURSOR_LATCH_OPTIMISTIC: result, unless page_id changed since
+ * version; then whatever was read is suspect, errors included.
+ */
+static enum btree_e
+optimistic_check(
+	struct Cursor* cursor, u32 page_id, u32 version, enum btree_e result)
+{
+	if( page_cache_version(cursor_pager(cursor)->cache, page_id) != version )
+		return BTREE_ERR_CONFLICT;
+
+	return result;
+}
+
+/**
+ * @brief Read page_id into nv the way the cursor's latch mode allows.
+ *
+ * An optimistic cursor reads table-tree pages in place, in the pinned
+ * frame, with the header copied into header; see
+ * btree_node_init_optimistic. Whatever else it reads off the page must be
+ * checked against the page's version before it is used. Index trees
+ * compare keys through cells and overflow pages, which a torn offset could
+ * send outside the page, so their pages are still copied.
+ */
+static enum btree_e
+read_node_ro(
+	struct Cursor* cursor,
+	struct NodeView* nv,
+	u32 page_id,
+	struct BTreePageHeader* header)
+{
+	enum btree_e result = BTREE_OK;
+
+	if( cursor->latch != CURSOR_LATCH_OPTIMISTIC )
+		return noderc_reinit_read_ro(cursor_rcer(cursor), nv, page_id);
+
+	if( !CURSOR_READ_IN_PLACE || cursor->tree->type != BTREE_TBL )
+		return noderc_reinit_read(cursor_rcer(cursor), nv, page_id);
+
+	result = noderc_reinit_read_ro(cursor_rcer(cursor), nv, page_id);
+	if( result != BTREE_OK )
+		return result;
+
+	return btree_node_init_optimistic(&nv->node, nv->page, header);
+}
+
 struct Cursor*
 cursor_create(struct BTree* tree)
 {
@@ -152,9 +450,58 @@ cursor_create_ex(struct BTree* tree, void* compare_context)
 void
 cursor_destroy(struct Cursor* cursor)
 {
+	cursor_unlatch(cursor);
 	free(cursor);
 }
 
+void
+cursor_set_latch(struct Cursor* cursor, enum cursor_latch_e latch)
+{
+	assert(cursor->nlatched == 0);
+	cursor->latch = latch;
+}
+
+void
+cursor_reset(struct Cursor* cursor)
+{
+	cursor_unlatch(cursor);
+
+	cursor->breadcrumbs_size = 0;
+	cursor->current_page_id = cursor->tree->root_page_id;
+	cursor->current_key_index.mode = KLIM_INDEX;
+	cursor->current_key_index.index = 0;
+
+	cursor_push(cursor);
+}
+
+enum btree_e
+cursor_validate(struct Cursor* cursor)
+{
+	if( cursor->latch != CURSOR_LATCH_OPTIMISTIC )
+		return BTREE_OK;
+
+	return optimistic_check(
+		cursor, cursor->current_page_id, cursor->version, BTREE_OK);
+}
+
+void
+cursor_unlatch(struct Cursor* cursor)
+{
+	for( int i = 0; i < cursor->nlatched; i++ )
+		page_cache_unlatch(
+			cursor_pager(cursor)->cache,
+			cursor->latched[i],
+			latch_mode(cursor));
+
+	cursor->nlatched = 0;
+
+	if( cursor->writing )
+	{
+		page_cache_write_end(cursor_pager(cursor)->cache);
+		cursor->writing = 0;
+	}
+}
+
 enum btree_e
 cursor_push(struct Cursor* cursor)
 {
@@ -249,52 +596,87 @@ cursor_iter_begin(struct Cursor* cursor)
 	return cursor_traverse_smallest(cursor);
 }
 
-enum btree_e
-btree_iter_next(struct Cursor* cursor)
+/**
+ * @brief btree_iter_next from the end of a leaf through the interior nodes,
+ * for leaves that do not know their sibling or a sibling a writer holds.
+ * The crumbs above the leaf may be stale, so the cursor first goes back
+ * down to last_key, the last row it returned. A latched cursor holds the
+ * path meanwhile, as index scans do.
+ */
+static enum btree_e
+iter_next_through_parents(struct Cursor* cursor, u32 last_key)
 {
 	enum btree_e result = BTREE_OK;
 	struct NodeView nv = {0};
+	char found = 0;
 
-	assert(cursor->current_page_id != 0);
-	assert(cursor->current_key_index.mode != KLIM_RIGHT_CHILD);
+	// Unlike cursor_reset, the root's crumb is left for the traversal to
+	// push, with the index it takes.
+	cursor_unlatch(cursor);
+	cursor->breadcrumbs_size = 0;
+	cursor->current_page_id = cursor->tree->root_page_id;
+	cursor->current_key_index.mode = KLIM_INDEX;
+	cursor->current_key_index.index = 0;
+	cursor->hold_path = 1;
 
 	result = noderc_acquire(cursor_rcer(cursor), &nv);
 	if( result != BTREE_OK )
 		goto end;
 
+	result = cursor_traverse_to(cursor, last_key, &found);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_reinit_read_ro(
+		cursor_rcer(cursor), &nv, cursor->current_page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+	// Another thread deleted it meanwhile; the cursor is on the row after.
+	if( !found &&
+		cursor->current_key_index.index < node_num_keys(nv_node(&nv)) )
+		goto end;
+
 	do
 	{
-		result = noderc_reinit_read(
+		result = noderc_reinit_read_ro(
 			cursor_rcer(cursor), &nv, cursor->current_page_id);
 		if( result != BTREE_OK )
 			goto end;
 
 		if( move_right(cursor, &nv, false) == BTREE_OK )
 		{
-			if( !node_is_leaf(nv_node(&nv)) )
-			{
-				result = read_cell_page(
-					cursor, nv_node(&nv), cursor->current_key_index.index);
-				if( result != BTREE_OK )
-					goto end;
-				cursor->current_key_index.index = 0;
-				cursor->current_key_index.mode = KLIM_INDEX;
+			if( node_is_leaf(nv_node(&nv)) )
+				goto end;
 
-				result = cursor_push(cursor);
-				if( result != BTREE_OK )
-					goto end;
+			result = read_cell_page(
+				cursor, nv_node(&nv), cursor->current_key_index.index);
+			if( result != BTREE_OK )
+				goto end;
+			cursor->current_key_index.index = 0;
+			cursor->current_key_index.mode = KLIM_INDEX;
 
-				result = cursor_traverse_smallest(cursor);
-				if( result != BTREE_OK )
-					goto end;
-			}
+			result = cursor_push(cursor);
+			if( result != BTREE_OK )
+				goto end;
 
-			goto end;
+			result = cursor_traverse_smallest(cursor);
+			if( result != BTREE_OK )
+				goto end;
+
+			result = noderc_reinit_read_ro(
+				cursor_rcer(cursor), &nv, cursor->current_page_id);
+			if( result != BTREE_OK )
+				goto end;
+
+			// Empty leaves are skipped like the end of one.
+			if( node_num_keys(nv_node(&nv)) != 0 )
+				goto end;
 		}
 
 		do
 		{
-			result = cursor_pop(cursor, NULL);
+			result = pop_unlatch(cursor);
 			if( result != BTREE_OK )
 				goto end;
 
@@ -303,9 +685,101 @@ btree_iter_next(struct Cursor* cursor)
 
 	} while( cursor->current_page_id != 0 );
 
+end:
+	// The leaf was latched last.
+	cursor->hold_path = 0;
+	unlatch_ancestors(cursor);
+	noderc_release(cursor_rcer(cursor), &nv);
+	return result;
+}
+
+enum btree_e
+btree_iter_next(struct Cursor* cursor)
+{
+	enum btree_e result = BTREE_OK;
+	struct NodeView nv = {0};
+	u32 last_key = 0;
+
+	assert(cursor->current_page_id != 0);
+	assert(cursor->current_key_index.mode != KLIM_RIGHT_CHILD);
+
+	result = noderc_acquire(cursor_rcer(cursor), &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_reinit_read_ro(
+		cursor_rcer(cursor), &nv, cursor->current_page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+	assert(node_is_leaf(nv_node(&nv)));
+	if( move_right(cursor, &nv, false) == BTREE_OK )
+		goto end;
+
+	// Any leaves stepped over below are empty, so this stays the last row
+	// seen.
+	if( node_num_keys(nv_node(&nv)) != 0 )
+		last_key = node_key_at(nv_node(&nv), node_num_keys(nv_node(&nv)) - 1);
+
+	// Rows are only on the leaves, and each links to the next; the scan
+	// steps across without going back up. Only the leaf's own crumb is kept
+	// current, the ones above it are left as they were.
+	do
+	{
+		u32 page_id = cursor->current_page_id;
+		u32 next_page_id = node_right_sibling(nv_node(&nv));
+		if( next_page_id == 0 )
+		{
+			cursor->breadcrumbs_size = 0;
+			goto end;
+		}
+
+		// Converted from V0; only the parents know what comes next.
+		if( next_page_id == BTREE_SIBLING_UNKNOWN )
+		{
+			result = iter_next_through_parents(cursor, last_key);
+			goto end;
+		}
+
+		// The leaf is held until the next one is, so the link stays good.
+		// Writers latch right to left when they merge; waiting here could
+		// deadlock.
+		if( cursor->latch == CURSOR_LATCH_SHARED )
+		{
+			result = latch_page_nowait(cursor, next_page_id);
+			if( result == BTREE_ERR_CONFLICT )
+			{
+				result = iter_next_through_parents(cursor, last_key);
+				goto end;
+			}
+			if( result != BTREE_OK )
+				goto end;
+		}
+
+		result = noderc_reinit_read_ro(cursor_rcer(cursor), &nv, next_page_id);
+		if( result != BTREE_OK )
+			goto end;
+
+		unlatch_page(cursor, page_id);
+
+		result = cursor_pop(cursor, NULL);
+		if( result != BTREE_OK )
+			goto end;
+
+		cursor->current_page_id = next_page_id;
+		cursor->current_key_index.index = 0;
+		cursor->current_key_index.mode = KLIM_INDEX;
+		result = cursor_push(cursor);
+		if( result != BTREE_OK )
+			goto end;
+	} while( node_num_keys(nv_node(&nv)) == 0 );
+
 end:
 	if( cursor->breadcrumbs_size == 0 )
+	{
 		result = BTREE_ERR_ITER_DONE;
+		cursor_unlatch(cursor);
+	}
 	noderc_release(cursor_rcer(cursor), &nv);
 	return result;
 }
@@ -323,8 +797,8 @@ ibtree_iter_next(struct Cursor* cursor)
 	if( result != BTREE_OK )
 		goto end;
 
-	result =
-		noderc_reinit_read(cursor_rcer(cursor), &nv, cursor->current_page_id);
+	result = noderc_reinit_read_ro(
+		cursor_rcer(cursor), &nv, cursor->current_page_id);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -351,9 +825,11 @@ ibtree_iter_next(struct Cursor* cursor)
 		goto end;
 	}
 
+	// A latched cursor holds the path; each page is let go as the cursor
+	// leaves it.
 	do
 	{
-		result = cursor_pop(cursor, NULL);
+		result = pop_unlatch(cursor);
 		if( result != BTREE_OK )
 			goto end;
 
@@ -361,7 +837,10 @@ ibtree_iter_next(struct Cursor* cursor)
 
 end:
 	if( cursor->breadcrumbs_size == 0 )
+	{
 		result = BTREE_ERR_ITER_DONE;
+		cursor_unlatch(cursor);
+	}
 	noderc_release(cursor_rcer(cursor), &nv);
 	return result;
 }
@@ -403,6 +882,7 @@ compare_context_init(struct Cursor* cursor)
 		.compare = cursor->tree->compare,
 		.reset = cursor->tree->reset_compare,
 		.keyof = cursor->tree->keyof,
+		.bytewise = cursor->tree->bytewise,
 		.compare_context = cursor->compare_context,
 		.pager = cursor->tree->pager};
 	return ctx;
@@ -414,36 +894,61 @@ cursor_traverse_to(struct Cursor* cursor, u32 key, char* found)
 	return cursor_traverse_to_ex(cursor, &key, sizeof(key), found);
 }
 
-enum btree_e
-cursor_traverse_to_ex(
-	struct Cursor* cursor, void* key, u32 key_size, char* found)
+static enum btree_e
+traverse_to(struct Cursor* cursor, void* key, u32 key_size, char* found)
 {
 	enum btree_e result = BTREE_OK;
 	u32 child_key_index = 0;
+	u32 version = 0;
+	struct BTreePageHeader header = {0};
 	struct NodeView nv = {0};
 	struct BTreeCompareContext ctx = compare_context_init(cursor);
 	bool stop_on_found = cursor->tree->type == BTREE_INDEX;
+	bool optimistic = cursor->latch == CURSOR_LATCH_OPTIMISTIC;
 	*found = 0;
 
 	result = noderc_acquire(cursor_rcer(cursor), &nv);
 	if( result != BTREE_OK )
 		goto end;
 
+	if( optimistic )
+	{
+		result = optimistic_begin(cursor, cursor->current_page_id, &version);
+		if( result != BTREE_OK )
+			goto end;
+	}
+
 	do
 	{
-		result = noderc_reinit_read(
-			cursor_rcer(cursor), &nv, cursor->current_page_id);
+		// The parent stays latched until the child is; see cursor_latch_e.
+		result = latch_page(cursor, cursor->current_page_id);
 		if( result != BTREE_OK )
 			goto end;
 
-		result = btree_node_search_keys(
-			&ctx, nv_node(&nv), key, key_size, &child_key_index);
-		if( result == BTREE_OK )
-			*found = 1;
+		result = read_node_ro(cursor, &nv, cursor->current_page_id, &header);
+		if( optimistic )
+			result = optimistic_check(
+				cursor, cursor->current_page_id, version, result);
+		if( result != BTREE_OK )
+			goto end;
+
+		if( node_is_safe(cursor, nv_node(&nv)) )
+			unlatch_ancestors(cursor);
+
+		if( cursor->tree->type == BTREE_TBL )
+			result = btree_node_search_keys_tbl(
+				nv_node(&nv), *(u32*)key, &child_key_index);
+		else
+			result = btree_node_search_keys(
+				&ctx, nv_node(&nv), key, key_size, &child_key_index);
+		*found = result == BTREE_OK;
 
 		if( result == BTREE_ERR_KEY_NOT_FOUND )
 			result = BTREE_OK;
 
+		if( optimistic && result != BTREE_OK )
+			result = optimistic_check(
+				cursor, cursor->current_page_id, version, result);
 		if( result != BTREE_OK )
 			goto end;
 
@@ -456,18 +961,80 @@ cursor_traverse_to_ex(
 
 		if( !node_is_leaf(nv_node(&nv)) && (!stop_on_found || !(*found)) )
 		{
+			u32 parent_page_id = cursor->current_page_id;
 			result = read_cell_page(cursor, nv_node(&nv), child_key_index);
+			if( optimistic )
+				result =
+					optimistic_check(cursor, parent_page_id, version, result);
 			if( result != BTREE_OK )
 				goto end;
+
+			// The parent must not have changed by the time the child's
+			// version is taken, or the child may not be its child anymore.
+			// That check also covers the search and the child id.
+			if( optimistic )
+			{
+				u32 parent_version = version;
+				result =
+					optimistic_begin(cursor, cursor->current_page_id, &version);
+				if( result != BTREE_OK )
+					goto end;
+
+				result = optimistic_check(
+					cursor, parent_page_id, parent_version, BTREE_OK);
+				if( result != BTREE_OK )
+					goto end;
+			}
 		}
 	} while( !node_is_leaf(nv_node(&nv)) && (!stop_on_found || !(*found)) );
 
+	// The search on the last page, found included, holds only if it did not
+	// change meanwhile.
+	if( optimistic )
+	{
+		result = optimistic_check(
+			cursor, cursor->current_page_id, version, BTREE_OK);
+		if( result != BTREE_OK )
+			goto end;
+	}
+
+	cursor->version = version;
+
 end:
 	noderc_release(cursor_rcer(cursor), &nv);
 
 	return result;
 }
 
+enum btree_e
+cursor_traverse_to_ex(
+	struct Cursor* cursor, void* key, u32 key_size, char* found)
+{
+	enum btree_e result = BTREE_OK;
+	struct CursorBreadcrumb start = {
+		.key_index = cursor->current_key_index,
+		.page_id = cursor->current_page_id};
+	int start_size = cursor->breadcrumbs_size;
+
+	for( int tries = 1;; tries++ )
+	{
+		result = traverse_to(cursor, key, key_size, found);
+		if( result != BTREE_ERR_CONFLICT )
+			break;
+
+		cursor->breadcrumbs_size = start_size;
+		cursor->current_page_id = start.page_id;
+		cursor->current_key_index = start.key_index;
+
+		// Give the writer a chance to finish.
+		bt_thread_yield();
+		if( tries == CURSOR_OPTIMISTIC_TRIES )
+			cursor->latch = CURSOR_LATCH_SHARED;
+	}
+
+	return result;
+}
+
 typedef void (*mover_fn)(struct Cursor* cursor, struct NodeView* nv);
 enum btree_e
 cursor_traverse_by_mover(struct Cursor* cursor, mover_fn move)
@@ -486,14 +1053,29 @@ cursor_traverse_by_mover(struct Cursor* cursor, mover_fn move)
 		if( result != BTREE_OK )
 			goto end;
 
-		result = noderc_reinit_read(cursor_rcer(cursor), &nv, crumb.page_id);
+		// Writers release nothing on the way down; whatever is below was
+		// reached to change something above. Scans release what they can,
+		// as lookups do.
+		result = latch_page(cursor, crumb.page_id);
 		if( result != BTREE_OK )
 			goto end;
 
+		result =
+			noderc_reinit_read_ro(cursor_rcer(cursor), &nv, crumb.page_id);
+		if( result != BTREE_OK )
+			goto end;
+
+		if( cursor->latch == CURSOR_LATCH_SHARED &&
+			node_is_safe(cursor, nv_node(&nv)) )
+			unlatch_ancestors(cursor);
+
 		move(cursor, &nv);
 
 		if( !node_is_leaf(nv_node(&nv)) )
 		{
+			prefetch_children(
+				cursor, nv_node(&nv), cursor->current_key_index.index);
+
 			result = read_cell_page(
 				cursor, nv_node(&nv), cursor->current_key_index.index);
 			if( result != BTREE_OK )
@@ -599,6 +1181,11 @@ cursor_sibling(struct Cursor* cursor, enum cursor_sibling_e sibling)
 			goto end;
 	}
 
+	// The parent is latched, so the sibling can't move meanwhile.
+	result = latch_page(cursor, cursor->current_page_id);
+	if( result != BTREE_OK )
+		goto end;
+
 	// Cursor is now point to the child; point to first element of sibling.
 	cursor->current_key_index.index = 0;
 	cursor->current_key_index.mode = KLIM_INDEX;
@@ -660,6 +1247,21 @@ cursor_read_current(struct Cursor* cursor, struct NodeView* out_nv)
 	return result;
 }
 
+enum btree_e
+cursor_read_current_ro(struct Cursor* cursor, struct NodeView* out_nv)
+{
+	assert(out_nv->page != NULL);
+
+	// Callers read payloads and overflow chains off this node; an optimistic
+	// cursor copies it rather than check each of those reads.
+	if( cursor->latch == CURSOR_LATCH_OPTIMISTIC )
+		return noderc_reinit_read(
+			cursor_rcer(cursor), out_nv, cursor->current_page_id);
+
+	return noderc_reinit_read_ro(
+		cursor_rcer(cursor), out_nv, cursor->current_page_id);
+}
+
 // TODO: Deprecate this
 enum btree_e
 cursor_parent_index(struct Cursor* cursor, struct ChildListIndex* out_index)
@@ -9,6 +9,39 @@ struct Cursor* cursor_create(struct BTree* tree);
 struct Cursor* cursor_create_ex(struct BTree* tree, void* compare_context);
 void cursor_destroy(struct Cursor* cursor);
 
+/**
+ * @brief Latch the pages the cursor visits from now on, so several threads
+ * can use the tree; see cursor_latch_e. Set it on a new cursor, before it
+ * moves. Latches are held until cursor_unlatch or cursor_destroy.
+ *
+ * Traversals to a key, to the largest or smallest key and to siblings
+ * latch, and so does iterating with CURSOR_LATCH_SHARED. A cursor that
+ * latches exclusive counts as a write in flight until it lets go of its
+ * last latch; see page_cache_write_begin.
+ */
+void cursor_set_latch(struct Cursor* cursor, enum cursor_latch_e latch);
+
+/**
+ * @brief Release every latch the cursor holds.
+ */
+void cursor_unlatch(struct Cursor* cursor);
+
+/**
+ * @brief Release the cursor's latches and move it back to the root, as if
+ * just created. The latch mode stays.
+ */
+void cursor_reset(struct Cursor* cursor);
+
+/**
+ * @brief With CURSOR_LATCH_OPTIMISTIC, whether the current page is still as
+ * the traversal read it, so what was read off it since holds. Any other
+ * latch mode keeps the page from changing; always BTREE_OK.
+ *
+ * @return BTREE_ERR_CONFLICT if the page changed. cursor_reset and traverse
+ * again.
+ */
+enum btree_e cursor_validate(struct Cursor* cursor);
+
 /**
  * @brief Pushes the current index head to the crumbs
  *
@@ -106,6 +139,15 @@ cursor_read_parent(struct Cursor* cursor, struct NodeView* out_view);
 enum btree_e
 cursor_read_current(struct Cursor* cursor, struct NodeView* out_nv);
 
+/**
+ * @brief Reads the current node into out_view for read-only use.
+ *
+ * See noderc_reinit_read_ro. An optimistic cursor copies the page instead;
+ * its descent reads table pages in place.
+ */
+enum btree_e
+cursor_read_current_ro(struct Cursor* cursor, struct NodeView* out_nv);
+
 /**
  * @brief Returns the index of the parent cell in the parent node.
  */
@@ -6,6 +6,37 @@
 
 #define BTREE_HEADER_SIZE 100
 
+// Layouts of the key area after struct BTreePageHeader; the header's
+// format_version says which one a node uses.
+//
+// V0: an array of struct BTreePageKey. This is the original layout and has
+// no sibling link.
+// V1: the u32 right sibling, then the array of struct BTreePageKey.
+// V2: the u32 right sibling, then num_keys u32 keys, then num_keys u32 slots,
+// each the cell offset in the low BTREE_SLOT_FLAGS_SHIFT bits and the key's
+// flags above them. Searches touch only the keys, 16 to a cache line rather
+// than 5 or 6.
+//
+// Only table trees search the key column. In an index tree it holds each
+// key's left child, and searches compare cells; see btree_node_search_keys.
+// Index keys have no prefix in the column, so those searches still stride
+// through the heap; V2 only makes their keys 4 bytes smaller.
+//
+// Pages written before V1 have zero in format_version, which was padding.
+// Nodes are read in any format and converted to the current one the first
+// time a key is inserted or removed.
+#define BTREE_NODE_FORMAT_V0 0
+#define BTREE_NODE_FORMAT_V1 1
+#define BTREE_NODE_FORMAT_V2 2
+#define BTREE_NODE_FORMAT_CURRENT BTREE_NODE_FORMAT_V2
+
+#define BTREE_SLOT_FLAGS_SHIFT 28
+#define BTREE_SLOT_OFFSET_MASK ((1u << BTREE_SLOT_FLAGS_SHIFT) - 1)
+
+// The right sibling of a node converted from V0, which did not record it.
+// Splits and merges pass it on like any other link.
+#define BTREE_SIBLING_UNKNOWN 0xFFFFFFFFu
+
 // "Table b-trees" use a 64-bit signed integer key and store all data in the
 // leaves. "Index b-trees" use arbitrary keys and store no data at all.
 enum btree_e
@@ -26,6 +57,8 @@ enum btree_e
 	BTREE_ERR_BUFFER_TOO_SMALL,
 	BTREE_ERR_NO_MEM,
 	BTREE_ERR_ITER_DONE,
+	// An optimistic read overlapped a writer; see CURSOR_LATCH_OPTIMISTIC.
+	BTREE_ERR_CONFLICT,
 	BTREE_NEED_ROOT_INIT,
 	BTREE_ERR_UNK,
 	BTREE_NEED_ALLOC,
@@ -36,6 +69,12 @@ struct BTreePageHeader
 {
 	char is_leaf;
 	char is_root;
+	// One of BTREE_NODE_FORMAT_*.
+	u8 format_version;
+	// Length of the key prefix shared by the node's PKEY_FLAG_PREFIXED cells.
+	// It is stored once, in the top prefix_size bytes of the heap, and those
+	// cells hold only what follows it. Zero on pages written before prefixes.
+	u8 prefix_size;
 	u32 free_heap;
 	u32 num_keys;
 	u32 right_child;
@@ -44,6 +83,7 @@ struct BTreePageHeader
 	u32 cell_high_water_offset;
 };
 
+// One key of a BTREE_NODE_FORMAT_V0 or BTREE_NODE_FORMAT_V1 node.
 struct BTreePageKey
 {
 	u32 key; // Or left child.
@@ -58,8 +98,9 @@ struct BTreeNode
 	u32 root_page_id;
 
 	struct BTreePageHeader* header;
-	// Start of the keys area; this area is contiguous and sorted
-	struct BTreePageKey* keys;
+	// Start of the keys area; this area is contiguous and sorted. Read it
+	// through node_key_at and friends, which know the node's format.
+	u32* keys;
 
 	struct Page* page; // Page backing this node.
 };
@@ -67,6 +108,8 @@ struct BTreeNode
 struct BTreeNodeRC
 {
 	struct Pager* pager;
+	// Nodes are read as of this snapshot if set; see noderc_set_snapshot.
+	struct PagerSnapshot* snapshot;
 };
 
 struct NodeView
@@ -139,6 +182,10 @@ struct BTree
 	btree_keyof_fn keyof;
 	btree_compare_fn compare;
 	btree_compare_reset_fn reset_compare;
+	// Nonzero if compare orders keys as their bytes with a shorter key first
+	// on a tie, as ibtree_compare does. Searches then decide most probes on
+	// an abbreviated key.
+	char bytewise;
 };
 
 struct BTreeCompareContext
@@ -146,6 +193,8 @@ struct BTreeCompareContext
 	btree_keyof_fn keyof;
 	btree_compare_fn compare;
 	btree_compare_reset_fn reset;
+	// See struct BTree.
+	char bytewise;
 
 	void* compare_context;
 	struct Pager* pager;
@@ -185,6 +234,40 @@ struct CursorBreadcrumb
 	int page_id;
 };
 
+/**
+ * @brief How a cursor latches the pages it visits; see cursor_set_latch.
+ */
+enum cursor_latch_e
+{
+	// Nothing is latched; the tree is only used from one thread.
+	CURSOR_LATCH_NONE = 0,
+	// Lookups and scans. Each page is latched shared before its parent is
+	// released. A table scan holds its leaf and latches the next one
+	// through the sibling link before letting go; if a writer holds it, the
+	// scan descends to its last key again instead of waiting. Index scans
+	// go back up through the path, so on index trees the whole path stays
+	// latched.
+	CURSOR_LATCH_SHARED,
+	// Inserts. Pages are latched exclusive; the latches above a page go
+	// once it has room for any cell, as a split stops there.
+	CURSOR_LATCH_INSERT,
+	// Deletes. Pages are latched exclusive; the latches above a page go
+	// once it can lose a key without underflowing, as rebalancing stops
+	// there. Siblings are latched when rebalancing moves to them.
+	CURSOR_LATCH_DELETE,
+	// Lookups without latches. Table-tree pages are read in place, index
+	// pages copied, and each page's version (page_cache_version) is checked
+	// after reading it and again after reading the child's, so the search
+	// and the child pointer were current. cursor_read_current_ro copies the
+	// last page; whatever is read off it must be checked with
+	// cursor_validate too. A conflict restarts the descent; after a few the
+	// cursor falls back to CURSOR_LATCH_SHARED.
+	CURSOR_LATCH_OPTIMISTIC,
+};
+
+// Path plus the siblings a rebalance may visit on each level.
+#define CURSOR_LATCHES_MAX 24
+
 struct Cursor
 {
 	struct BTree* tree;
@@ -197,6 +280,17 @@ struct Cursor
 	int breadcrumbs_size;
 
 	void* compare_context;
+
+	enum cursor_latch_e latch;
+	// Pages latched, in the order they were latched.
+	u32 latched[CURSOR_LATCHES_MAX];
+	int nlatched;
+	// Counted by page_cache_write_begin while it holds exclusive latches.
+	char writing;
+	// Keep the whole path latched shared, even on table trees.
+	char hold_path;
+	// CURSOR_LATCH_OPTIMISTIC: version of the current page when it was read.
+	u32 version;
 };
 
 /**
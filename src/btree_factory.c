@@ -9,6 +9,9 @@
 #include "noderc.h"
 #include "pager.h"
 #include "pager_ops_cstd.h"
+#include "pager_ops_mmap.h"
+#include "pager_ops_posix.h"
+#include "pager_ops_uring.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -16,16 +19,87 @@
 
 struct Pager*
 btree_factory_pager_create(char const* filename)
+{
+	struct Pager* pager = btree_factory_pager_create_ex(filename, NULL);
+
+	assert(pager != NULL);
+
+	return pager;
+}
+
+struct Pager*
+btree_factory_pager_create_ex(
+	char const* filename, struct PagerFactoryOpts const* opts)
 {
 	struct Pager* pager = NULL;
 	struct PageCache* cache = NULL;
+	enum pager_backend_e backend =
+		opts ? opts->backend : PAGER_BACKEND_DEFAULT;
 
 	enum pager_e pres = PAGER_OK;
 
-	pres = page_cache_create(&cache, 10);
-	pres = pager_cstd_create(&pager, cache, filename, 0x1000);
+	if( backend == PAGER_BACKEND_DEFAULT )
+	{
+#ifdef _WIN32
+		backend = PAGER_BACKEND_CSTD;
+#else
+		backend = PAGER_BACKEND_POSIX;
+#endif
+	}
+
+	pres = page_cache_create_ex(
+		&cache,
+		opts && opts->cache_size ? opts->cache_size : 10,
+		opts ? opts->cache_policy : PAGE_CACHE_LRU);
+	if( pres != PAGER_OK )
+		return NULL;
 
-	assert(btpage_err(pres) == BTREE_OK);
+	switch( backend )
+	{
+#ifndef _WIN32
+	case PAGER_BACKEND_POSIX:
+		pres = pager_posix_create(&pager, cache, filename, 0x1000);
+		break;
+	case PAGER_BACKEND_MMAP:
+		pres = pager_mmap_create(&pager, cache, filename, 0x1000);
+		break;
+#endif
+#ifdef __linux__
+	case PAGER_BACKEND_URING:
+		pres = pager_uring_create(&pager, cache, filename, 0x1000);
+		break;
+#endif
+	default:
+		pres = pager_cstd_create(&pager, cache, filename, 0x1000);
+		break;
+	}
+
+	if( pres != PAGER_OK )
+	{
+		page_cache_destroy(cache);
+		return NULL;
+	}
+
+	if( opts )
+		pager_set_durability(pager, opts->durability);
+
+	if( opts && (opts->wal || opts->shadow) )
+	{
+		if( opts->wal && opts->shadow )
+			pres = PAGER_OPEN_ERR;
+		else if( opts->shadow )
+			pres = pager_enable_shadow(pager);
+		else
+			pres = pager_enable_wal(pager);
+		if( pres == PAGER_OK && opts->wal && opts->checkpointer )
+			pres = pager_start_checkpointer(pager, NULL);
+		if( pres != PAGER_OK )
+		{
+			pager_destroy(pager);
+			page_cache_destroy(cache);
+			return NULL;
+		}
+	}
 
 	return pager;
 }
@@ -85,8 +159,10 @@ btree_factory_create(char const* filename)
 void
 btree_factory_destroy(struct BTree* tree)
 {
-	page_cache_destroy(tree->pager->cache);
+	// The pager writes back dirty cached pages on destroy.
+	struct PageCache* cache = tree->pager->cache;
 	pager_destroy(tree->pager);
+	page_cache_destroy(cache);
 	free(tree->rcer);
 
 	btree_dealloc(tree);
@@ -12,11 +12,52 @@ struct BTreeView
 	struct BTreeNodeRC* rcer;
 };
 
+enum pager_backend_e
+{
+	// PAGER_BACKEND_POSIX where available, otherwise PAGER_BACKEND_CSTD.
+	PAGER_BACKEND_DEFAULT,
+	// stdio fseek + fread/fwrite.
+	PAGER_BACKEND_CSTD,
+	// File descriptor with pread/pwrite.
+	PAGER_BACKEND_POSIX,
+	// pread/pwrite plus a read-only mapping for zero-copy reads.
+	PAGER_BACKEND_MMAP,
+	// io_uring with batched reads and writes (Linux).
+	PAGER_BACKEND_URING,
+};
+
+struct PagerFactoryOpts
+{
+	enum pager_backend_e backend;
+	// Pages held by the page cache; 0 for the default.
+	u32 cache_size;
+	// Defaults to PAGE_CACHE_LRU.
+	enum page_cache_policy_e cache_policy;
+	// Commit through a write-ahead log; see pager_enable_wal.
+	char wal;
+	// With wal, checkpoint on a background thread with the default opts;
+	// see pager_start_checkpointer.
+	char checkpointer;
+	// Commit by shadow paging instead; see pager_enable_shadow. Not with
+	// wal.
+	char shadow;
+	// When commits are synced; see pager_set_durability.
+	enum pager_durability_e durability;
+};
+
 /**
  * For use when creating statically lived element
  */
 struct Pager* btree_factory_pager_create(char const* filename);
 
+/**
+ * @brief Same as btree_factory_pager_create; opts may be NULL for defaults.
+ *
+ * Returns NULL if the file could not be opened.
+ */
+struct Pager* btree_factory_pager_create_ex(
+	char const* filename, struct PagerFactoryOpts const* opts);
+
 /**
  * For use when creating statically lived element
  */
@@ -39,6 +39,127 @@ btree_node_deinit(struct BTreeNode* node)
 	return BTREE_OK;
 }
 
+// Key area bytes per key in BTREE_NODE_FORMAT_V2; a key and a slot.
+#define V2_KEY_SIZE (2 * sizeof(u32))
+
+// The header keeps prefix_size in a byte.
+#define PREFIX_SIZE_MAX 255
+
+static bool
+node_is_v0(struct BTreeNode const* node)
+{
+	return node->header->format_version == BTREE_NODE_FORMAT_V0;
+}
+
+/**
+ * @brief V0 and V1 nodes keep struct BTreePageKeys; V2 keeps columns.
+ */
+static bool
+node_has_pkeys(struct BTreeNode const* node)
+{
+	return node->header->format_version < BTREE_NODE_FORMAT_V2;
+}
+
+static struct BTreePageKey*
+pkeys(struct BTreeNode* node)
+{
+	return (struct BTreePageKey*)node->keys;
+}
+
+/**
+ * @brief The right sibling of a V1 or V2 node; the first word after the
+ * header, right before the keys. Found through the keys, as the header may
+ * be a copy; see btree_node_init_optimistic.
+ */
+static u32*
+link_word(struct BTreeNode* node)
+{
+	return node->keys - 1;
+}
+
+/**
+ * @brief Set the node's format and point node->keys at its key array.
+ */
+static void
+set_format(struct BTreeNode* node, u8 format_version)
+{
+	node->header->format_version = format_version;
+	node->keys = (u32*)&node->header[1];
+	if( format_version != BTREE_NODE_FORMAT_V0 )
+		node->keys += 1;
+}
+
+/**
+ * @brief Heap a node in format_version has; V1 and V2 spend a word on the
+ * link.
+ */
+static u32
+heap_capacity(struct BTreeNode* node, u8 format_version)
+{
+	u32 offset = node->page->page_id == 1 ? BTREE_HEADER_SIZE : 0;
+	u32 capacity =
+		node->page->page_size - sizeof(struct BTreePageHeader) - offset;
+	if( format_version != BTREE_NODE_FORMAT_V0 )
+		capacity -= sizeof(u32);
+
+	return capacity;
+}
+
+/**
+ * @brief The V2 slots; they start right after the last key.
+ */
+static u32*
+v2_slots(struct BTreeNode* node)
+{
+	return node->keys + node->header->num_keys;
+}
+
+/**
+ * @brief Rewrite a V0 or V1 node's keys in the V2 layout before it is
+ * modified. V2 keys take less room, so the difference, less the link a V0
+ * node did not have, goes back to the heap. V0 did not record the node's
+ * sibling, so its link is unknown unless it is empty.
+ */
+static enum btree_e
+upgrade_format(struct BTreeNode* node)
+{
+	if( !node_has_pkeys(node) )
+		return BTREE_OK;
+
+	u32 num_keys = node->header->num_keys;
+	u32 sibling = node_right_sibling(node);
+	u32 link_size = node_is_v0(node) ? sizeof(u32) : 0;
+	if( num_keys == 0 )
+	{
+		set_format(node, BTREE_NODE_FORMAT_V2);
+		*link_word(node) = sibling;
+		node->header->free_heap -= link_size;
+		return BTREE_OK;
+	}
+
+	u32 pkeys_size = num_keys * sizeof(struct BTreePageKey);
+	struct BTreePageKey* old = (struct BTreePageKey*)malloc(pkeys_size);
+	if( !old )
+		return BTREE_ERR_NO_MEM;
+
+	memcpy(old, node->keys, pkeys_size);
+
+	set_format(node, BTREE_NODE_FORMAT_V2);
+	*link_word(node) = sibling;
+	u32* slots = v2_slots(node);
+	for( u32 i = 0; i < num_keys; i++ )
+	{
+		node->keys[i] = old[i].key;
+		slots[i] =
+			old[i].cell_offset | (old[i].flags << BTREE_SLOT_FLAGS_SHIFT);
+	}
+	node->header->free_heap +=
+		num_keys * (sizeof(*old) - V2_KEY_SIZE) - link_size;
+
+	free(old);
+	return BTREE_OK;
+}
+
 static u32
 cell_type_code(enum btree_page_key_flags_e flag)
 {
@@ -61,7 +182,8 @@ btree_node_max_cell_size(struct BTreeNode* node)
 
 	// This is max size including key!
 	// I.e. key+payload_size must fit within this.
-	u32 max_data_size = btu_get_node_heap_size(node) / min_cells_per_page;
+	u32 max_data_size =
+		heap_capacity(node, BTREE_NODE_FORMAT_CURRENT) / min_cells_per_page;
 
 	return max_data_size;
 }
@@ -73,7 +195,7 @@ btree_pkey_set_cell_type(u32 flags, enum btree_page_key_flags_e flag)
 	if( code == 0 )
 		return flags;
 
-	assert(code < (1 << 4));
+	assert(code < PKEY_FLAG_PREFIXED);
 	return flags | (code);
 }
 
@@ -90,7 +212,7 @@ btree_pkey_is_cell_type(u32 flags, enum btree_page_key_flags_e flag)
 	if( test == 0 )
 		return 0;
 
-	return (flags & 0xF) == test;
+	return (flags & (PKEY_FLAG_PREFIXED - 1)) == test;
 }
 
 /**
@@ -106,11 +228,52 @@ btree_node_init_from_page(struct BTreeNode* node, struct Page* page)
 	node->page = page;
 	node->page_number = page->page_id;
 	node->header = (struct BTreePageHeader*)data;
-	// Trick to get a pointer to the address immediately after the header.
-	node->keys = (struct BTreePageKey*)&node->header[1];
-
-	if( node->header->num_keys == 0 )
+	set_format(node, node->header->format_version);
+
+	// Borrowed pages are read-only; nothing reading them needs free_heap.
+	// Converting an empty node copies no keys, so it cannot fail. Removing
+	// keys converts a node, so an empty V0 node is new or a root and has no
+	// sibling. An empty node also drops its prefix, which is all that is left
+	// on its heap.
+	if( node->header->num_keys == 0 && !page_is_borrowed(page) )
+	{
+		upgrade_format(node);
+		node->header->prefix_size = 0;
+		node->header->cell_high_water_offset = 0;
 		node->header->free_heap = btree_node_calc_heap_capacity(node);
+	}
+
+	return BTREE_OK;
+}
+
+enum btree_e
+btree_node_init_optimistic(
+	struct BTreeNode* node,
+	struct Page* page,
+	struct BTreePageHeader* header)
+{
+	u32 offset = page->page_id == 1 ? BTREE_HEADER_SIZE : 0;
+	struct BTreePageHeader* page_header =
+		(struct BTreePageHeader*)((char*)page->page_buffer + offset);
+
+	node->page = page;
+	node->page_number = page->page_id;
+	memcpy(header, page_header, sizeof(*header));
+
+	u8 format_version = header->format_version;
+	if( format_version > BTREE_NODE_FORMAT_CURRENT )
+		return BTREE_ERR_CONFLICT;
+
+	node->header = page_header;
+	set_format(node, format_version);
+	node->header = header;
+
+	u32 key_size = format_version < BTREE_NODE_FORMAT_V2
+					   ? sizeof(struct BTreePageKey)
+					   : V2_KEY_SIZE;
+	if( (u64)header->num_keys * key_size >
+		heap_capacity(node, format_version) )
+		return BTREE_ERR_CONFLICT;
 
 	return BTREE_OK;
 }
@@ -192,22 +355,55 @@ btree_node_destroy(struct BTreeNode* node)
 /**
  * @brief Assumes space check has already been done.
  *
- * @param array
+ * The slots sit right after the keys, so all of them move up one place to
+ * make room for the new key, and those from index_number on a second place
+ * to make room for the new slot.
  */
 static void
-insert_page_key(
-	struct BTreePageKey* array,
-	u32 array_size,
-	struct BTreePageKey* key,
-	u32 index_number)
+insert_page_key(struct BTreeNode* node, u32 index_number, u32 key, u32 slot)
 {
-	assert(array_size >= index_number);
+	u32* keys = node->keys;
+	u32 num_keys = node->header->num_keys;
+
+	assert(!node_has_pkeys(node));
+	assert(num_keys >= index_number);
 	memmove(
-		&array[index_number + 1],
-		&array[index_number],
-		(array_size - index_number) * sizeof(array[0]));
+		&keys[num_keys + index_number + 2],
+		&keys[num_keys + index_number],
+		(num_keys - index_number) * sizeof(u32));
+	memmove(&keys[num_keys + 1], &keys[num_keys], index_number * sizeof(u32));
+	memmove(
+		&keys[index_number + 1],
+		&keys[index_number],
+		(num_keys - index_number) * sizeof(u32));
 
-	memcpy(&array[index_number], key, sizeof(*key));
+	keys[index_number] = key;
+	keys[num_keys + 1 + index_number] = slot;
+	node->header->num_keys += 1;
+}
+
+/**
+ * @brief Undoes insert_page_key.
+ */
+static void
+remove_page_key(struct BTreeNode* node, u32 index_number)
+{
+	u32* keys = node->keys;
+	u32 num_keys = node->header->num_keys;
+
+	assert(!node_has_pkeys(node));
+	assert(index_number < num_keys);
+	memmove(
+		&keys[index_number],
+		&keys[index_number + 1],
+		(num_keys - index_number - 1) * sizeof(u32));
+	memmove(&keys[num_keys - 1], &keys[num_keys], index_number * sizeof(u32));
+	memmove(
+		&keys[num_keys - 1 + index_number],
+		&keys[num_keys + index_number + 1],
+		(num_keys - index_number - 1) * sizeof(u32));
+
+	node->header->num_keys -= 1;
 }
 
 static enum btree_e
@@ -224,14 +420,13 @@ write_page_key(
 		node->header->cell_high_water_offset + cell_size;
 
 	// The Raw insertion
-	struct BTreePageKey page_key = {0};
-	page_key.cell_offset = cell_left_edge_offset;
-	page_key.key = key;
-	page_key.flags = flags;
-
+	assert(cell_left_edge_offset <= BTREE_SLOT_OFFSET_MASK);
+	assert(flags < (1u << (32 - BTREE_SLOT_FLAGS_SHIFT)));
 	insert_page_key(
-		node->keys, node->header->num_keys, &page_key, index_number);
-	node->header->num_keys += 1;
+		node,
+		index_number,
+		key,
+		cell_left_edge_offset | ((u32)flags << BTREE_SLOT_FLAGS_SHIFT));
 
 	node->header->cell_high_water_offset += cell_size;
 	node->header->free_heap -=
@@ -240,6 +435,22 @@ write_page_key(
 	return BTREE_OK;
 }
 
+/**
+ * @brief Whether a cell with these flags and payload would be stored without
+ * the node's prefix. Only inline cells are; overflow cells are kept whole.
+ */
+static bool
+shares_prefix(
+	struct BTreeNode* node, u32 flags, void const* payload, u32 payload_size)
+{
+	u32 prefix_size = node->header->prefix_size;
+
+	return prefix_size != 0 &&
+		   btree_pkey_is_cell_type(flags, PKEY_FLAG_CELL_TYPE_INLINE) &&
+		   payload_size >= prefix_size &&
+		   memcmp(payload, btree_node_prefix(node), prefix_size) == 0;
+}
+
 enum btree_e
 btree_node_insert_inline(
 	struct BTreeNode* node,
@@ -264,7 +475,21 @@ btree_node_insert_inline_ex(
 	u32 flags)
 {
 	enum btree_e result = BTREE_OK;
-	u32 cell_size = btree_cell_inline_disk_size(cell->inline_size);
+	struct BTreeCellInline stored = *cell;
+
+	flags &= ~PKEY_FLAG_PREFIXED;
+	if( shares_prefix(node, flags, cell->payload, cell->inline_size) )
+	{
+		stored.payload = (byte*)cell->payload + node->header->prefix_size;
+		stored.inline_size -= node->header->prefix_size;
+		flags |= PKEY_FLAG_PREFIXED;
+	}
+
+	u32 cell_size = btree_cell_inline_disk_size(stored.inline_size);
+
+	result = upgrade_format(node);
+	if( result != BTREE_OK )
+		return result;
 
 	u32 heap_needed = btree_node_heap_required_for_insertion(cell_size);
 	if( node->header->free_heap < heap_needed )
@@ -273,7 +498,7 @@ btree_node_insert_inline_ex(
 	byte* cell_left_edge = btu_calc_highwater_offset(
 		node, node->header->cell_high_water_offset + cell_size);
 
-	result = btree_cell_write_inline(cell, cell_left_edge, cell_size);
+	result = btree_cell_write_inline(&stored, cell_left_edge, cell_size);
 	if( result != BTREE_OK )
 		return result;
 
@@ -306,6 +531,10 @@ btree_node_insert_overflow(
 	// inline payload size, we want the size of this cell as if it were inline.
 	u32 cell_size = btree_cell_inline_disk_size(cell->inline_size);
 
+	result = upgrade_format(node);
+	if( result != BTREE_OK )
+		return result;
+
 	u32 heap_needed = btree_node_heap_required_for_insertion(cell_size);
 	if( node->header->free_heap < heap_needed )
 		return BTREE_ERR_NODE_NOT_ENOUGH_SPACE;
@@ -362,6 +591,30 @@ btree_node_read_inline_as_page(
 	return BTREE_OK;
 }
 
+enum btree_e
+btree_node_write_inline_as_page(
+	struct BTreeNode* internal_node, struct ChildListIndex* index, u32 page_id)
+{
+	assert(!node_is_leaf(internal_node));
+
+	struct CellData cell = {0};
+
+	if( index->index == node_num_keys(internal_node) ||
+		index->mode != KLIM_INDEX )
+	{
+		internal_node->header->right_child = page_id;
+		return BTREE_OK;
+	}
+
+	btu_read_cell(internal_node, index->index, &cell);
+	if( btree_cell_get_size(&cell) != sizeof(page_id) )
+		return BTREE_ERR_CORRUPT_CELL;
+
+	ser_write_32bit_le(cell.pointer, page_id);
+
+	return BTREE_OK;
+}
+
 enum btree_e
 btree_node_move_cell(
 	struct BTreeNode* source_node,
@@ -369,7 +622,7 @@ btree_node_move_cell(
 	u32 source_index,
 	struct Pager* pager)
 {
-	u32 key = source_node->keys[source_index].key;
+	u32 key = node_key_at(source_node, source_index);
 	return btree_node_move_cell_ex(
 		source_node, other, source_index, key, pager);
 }
@@ -397,12 +650,38 @@ btree_node_move_cell_ex_to(
 	u32 new_key,
 	struct Pager* pager)
 {
-	u32 flags = source_node->keys[source_index].flags;
+	enum btree_e result = BTREE_OK;
+	u32 flags = node_flags_at(source_node, source_index);
+	u32 prefix_size = btree_node_prefix_size_at(source_node, source_index);
 
 	byte* cell_data = btu_get_cell_buffer(source_node, source_index);
 	u32 cell_data_size = btu_get_cell_buffer_size(source_node, source_index);
+	byte* whole_cell = NULL;
 
-	return btree_node_move_cell_from_data(
+	// The destination's prefix may differ, so a prefixed cell moves whole.
+	if( prefix_size != 0 )
+	{
+		u32 payload_size = cell_data_size - sizeof(u32);
+		whole_cell = (byte*)malloc(cell_data_size + prefix_size);
+		if( !whole_cell )
+			return BTREE_ERR_NO_MEM;
+
+		ser_write_32bit_le(whole_cell, prefix_size + payload_size);
+		memcpy(
+			whole_cell + sizeof(u32),
+			btree_node_prefix(source_node),
+			prefix_size);
+		memcpy(
+			whole_cell + sizeof(u32) + prefix_size,
+			cell_data + sizeof(u32),
+			payload_size);
+
+		flags &= ~PKEY_FLAG_PREFIXED;
+		cell_data = whole_cell;
+		cell_data_size += prefix_size;
+	}
+
+	result = btree_node_move_cell_from_data(
 		dest_node,
 		dest_index,
 		new_key,
@@ -410,6 +689,11 @@ btree_node_move_cell_ex_to(
 		cell_data,
 		cell_data_size,
 		pager);
+
+	if( whole_cell )
+		free(whole_cell);
+
+	return result;
 }
 
 enum btree_e
@@ -526,37 +810,178 @@ btree_node_reset(struct BTreeNode* node)
 	return btree_node_init_from_page(node, node->page);
 }
 
-static enum btree_e
-gc_node(struct BTreeNode* node, int deleted_offset, int deleted_size)
+byte*
+btree_node_prefix(struct BTreeNode* node)
 {
-	struct CellData cell = {0};
-	// printf("Keys After: %u > %u\n", node->header->num_keys, deleted_offset);
-	// for( int i = 0; i < node->header->num_keys; i++ )
-	// {
-	// 	printf("%i: %u\n", i, node->keys[i].cell_offset);
-	// }
-	// printf("\n");
+	return btu_calc_highwater_offset(node, node->header->prefix_size);
+}
 
-	u32 shift_size = (deleted_size + sizeof(u32));
-	for( int i = 0; i < node->header->num_keys; i++ )
+u32
+btree_node_prefix_size_at(struct BTreeNode* node, u32 index)
+{
+	if( node_flags_at(node, index) & PKEY_FLAG_PREFIXED )
+		return node->header->prefix_size;
+	else
+		return 0;
+}
+
+enum btree_e
+btree_node_prefix_init(
+	struct BTreeNode* node, byte const* prefix, u32 prefix_size)
+{
+	if( node->header->num_keys != 0 )
+		return BTREE_ERR_NODE_NOT_ENOUGH_SPACE;
+
+	assert(prefix_size <= PREFIX_SIZE_MAX);
+	node->header->format_version = BTREE_NODE_FORMAT_CURRENT;
+	node->header->prefix_size = prefix_size;
+	node->header->cell_high_water_offset = prefix_size;
+	node->header->free_heap =
+		btree_node_calc_heap_capacity(node) - prefix_size;
+	memmove(btree_node_prefix(node), prefix, prefix_size);
+
+	return BTREE_OK;
+}
+
+/**
+ * @brief Copies up to buffer_size bytes of the payload of the inline cell at
+ * index, prefix included, into buffer.
+ *
+ * @return The payload size.
+ */
+static u32
+read_whole_payload(struct BTreeNode* node, u32 index, byte* buffer, u32 size)
+{
+	u32 prefix_size = btree_node_prefix_size_at(node, index);
+	byte* cell_data = btu_get_cell_buffer(node, index);
+	u32 payload_size = btu_get_cell_buffer_size(node, index) - sizeof(u32);
+
+	u32 from_prefix = min(prefix_size, size);
+	memcpy(buffer, btree_node_prefix(node), from_prefix);
+	memcpy(
+		buffer + from_prefix,
+		cell_data + sizeof(u32),
+		min(payload_size, size - from_prefix));
+
+	return prefix_size + payload_size;
+}
+
+enum btree_e
+btree_node_prefix_recompute(struct BTreeNode* node, struct Pager* pager)
+{
+	enum btree_e result = BTREE_OK;
+	struct Page* page = NULL;
+	struct BTreeNode scratch = {0};
+	byte prefix[PREFIX_SIZE_MAX];
+	byte payload[PREFIX_SIZE_MAX];
+	u32 prefix_size = 0;
+	u32 num_inline = 0;
+	u32 num_prefixed = 0;
+
+	// Key order need not be byte order, so every inline key is compared.
+	for( u32 i = 0; i < node->header->num_keys; i++ )
 	{
-		u32 offset = node->keys[i].cell_offset;
-		if( offset < deleted_offset )
+		u32 flags = node_flags_at(node, i);
+		if( !btree_pkey_is_cell_type(flags, PKEY_FLAG_CELL_TYPE_INLINE) )
+			continue;
+
+		num_prefixed += (flags & PKEY_FLAG_PREFIXED) ? 1 : 0;
+		if( num_inline++ == 0 )
+		{
+			prefix_size =
+				read_whole_payload(node, i, prefix, sizeof(prefix));
+			prefix_size = min(prefix_size, sizeof(prefix));
 			continue;
+		}
+
+		u32 size = read_whole_payload(node, i, payload, prefix_size);
+		size = min(size, prefix_size);
+		prefix_size = 0;
+		while( prefix_size < size &&
+			   prefix[prefix_size] == payload[prefix_size] )
+			prefix_size++;
+	}
+
+	if( prefix_size == node->header->prefix_size &&
+		(prefix_size == 0 || num_prefixed == num_inline) )
+		goto end;
+
+	// Each inline cell changes by the old prefix less the new one.
+	u32 heap_needed = prefix_size;
+	for( u32 i = 0; i < node->header->num_keys; i++ )
+	{
+		u32 cell_size = btu_get_cell_buffer_size(node, i);
+		if( btree_pkey_is_cell_type(
+				node_flags_at(node, i), PKEY_FLAG_CELL_TYPE_INLINE) )
+			cell_size += btree_node_prefix_size_at(node, i) - prefix_size;
+
+		heap_needed += btree_node_heap_required_for_insertion(cell_size);
+	}
+
+	// The rewritten node is in the current format, whatever node is in.
+	if( heap_needed > heap_capacity(node, BTREE_NODE_FORMAT_CURRENT) )
+		goto end;
+
+	result = btpage_err(page_create(pager, &page));
+	if( result != BTREE_OK )
+		goto end;
 
-		btu_read_cell(node, i, &cell);
-		u32 cell_size = (*cell.size + sizeof(u32));
-		// printf("%u -> %u\n", offset, offset - shift_size);
-		byte* src = btu_calc_highwater_offset(node, offset);
-		byte* dest = btu_calc_highwater_offset(node, offset - shift_size);
+	result = btree_node_init_as_page_number(&scratch, node->page_number, page);
+	if( result != BTREE_OK )
+		goto end;
+
+	scratch.header->is_leaf = node->header->is_leaf;
+	scratch.header->is_root = node->header->is_root;
+	scratch.header->right_child = node->header->right_child;
+	result = node_right_sibling_set(&scratch, node_right_sibling(node));
+	if( result != BTREE_OK )
+		goto end;
 
-		memmove((void*)dest, (void*)src, cell_size);
-		node->keys[i].cell_offset -= shift_size;
+	result = btree_node_prefix_init(&scratch, prefix, prefix_size);
+	if( result != BTREE_OK )
+		goto end;
+
+	// Whole inline cells are never bigger than the largest cell, so none
+	// spill and no pager is needed.
+	for( u32 i = 0; i < node->header->num_keys; i++ )
+	{
+		result = btree_node_move_cell(node, &scratch, i, NULL);
+		if( result != BTREE_OK )
+			goto end;
 	}
 
-	node->header->cell_high_water_offset -= deleted_size + sizeof(u32);
+	result = btree_node_copy(node, &scratch);
+
+end:
+	if( page )
+		page_destroy(pager, page);
+
+	return result;
+}
+
+static enum btree_e
+gc_node(struct BTreeNode* node, int deleted_offset, int deleted_size)
+{
+	// Cells are packed below the high water mark, so everything written
+	// after the deleted cell slides up as one block. Moving cell by cell in
+	// key order would overwrite cells that have not moved yet whenever keys
+	// were inserted out of order.
+	u32 shift_size = (deleted_size + sizeof(u32));
+	u32 high_water = node->header->cell_high_water_offset;
+	byte* src = btu_calc_highwater_offset(node, high_water);
+	byte* dest = btu_calc_highwater_offset(node, high_water - shift_size);
+	memmove((void*)dest, (void*)src, high_water - deleted_offset);
+
+	for( int i = 0; i < node->header->num_keys; i++ )
+	{
+		u32 offset = node_cell_offset_at(node, i);
+		if( offset > deleted_offset )
+			node_cell_offset_at_set(node, i, offset - shift_size);
+	}
+
+	node->header->cell_high_water_offset -= shift_size;
 	node->header->free_heap +=
-		btree_node_heap_required_for_insertion(deleted_size + sizeof(u32));
+		btree_node_heap_required_for_insertion(shift_size);
 	return BTREE_OK;
 }
 
@@ -613,7 +1038,10 @@ btree_node_remove(
 	index_number = index->index;
 	assert(index_number < node->header->num_keys);
 
-	int deleted_offset = node->keys[index_number].cell_offset;
+	if( upgrade_format(node) != BTREE_OK )
+		return BTREE_ERR_NO_MEM;
+
+	int deleted_offset = node_cell_offset_at(node, index_number);
 	btu_read_cell(node, index_number, &cell);
 	int deleted_inline_size = btree_cell_get_size(&cell);
 
@@ -629,13 +1057,8 @@ btree_node_remove(
 	}
 
 	// Slide keys over.
-	memmove(
-		&node->keys[index_number],
-		&node->keys[index_number + 1],
-		(node->header->num_keys - index_number) *
-			sizeof(node->keys[index_number]));
+	remove_page_key(node, index_number);
 	memset(&cell, 0x00, sizeof(cell));
-	node->header->num_keys -= 1;
 
 	// Garbage collection in the heap.
 	gc_node(node, deleted_offset, deleted_inline_size);
@@ -670,9 +1093,7 @@ ibtree_node_remove(
 		}
 
 		// The rightmost non-right-child key becomes the right-child.
-		struct BTreePageKey rightmost_key =
-			node->keys[node->header->num_keys - 1];
-		u32 child_value = rightmost_key.key;
+		u32 child_value = node_key_at(node, node->header->num_keys - 1);
 
 		struct ChildListIndex delete_index = {0};
 		delete_index.index = node->header->num_keys - 1;
@@ -689,7 +1110,12 @@ ibtree_node_remove(
 	}
 
 	index_number = index->index;
-	int deleted_offset = node->keys[index_number].cell_offset;
+
+	result = upgrade_format(node);
+	if( result != BTREE_OK )
+		return result;
+
+	int deleted_offset = node_cell_offset_at(node, index_number);
 
 	if( holding_node )
 	{
@@ -702,13 +1128,8 @@ ibtree_node_remove(
 	int deleted_inline_size = btree_cell_get_size(&cell);
 
 	// Slide keys over.
-	memmove(
-		&node->keys[index_number],
-		&node->keys[index_number + 1],
-		(node->header->num_keys - index_number) *
-			sizeof(node->keys[index_number]));
+	remove_page_key(node, index_number);
 	memset(&cell, 0x00, sizeof(cell));
-	node->header->num_keys -= 1;
 
 	// Garbage collection in the heap.
 	gc_node(node, deleted_offset, deleted_inline_size);
@@ -722,26 +1143,105 @@ ibtree_node_remove(
 u32
 btree_node_heap_required_for_insertion(u32 cell_disk_size)
 {
-	return cell_disk_size + sizeof(struct BTreePageKey);
+	return cell_disk_size + V2_KEY_SIZE;
 }
 
 u32
 btree_node_calc_heap_capacity(struct BTreeNode* node)
 {
-	u32 offset = node->page->page_id == 1 ? BTREE_HEADER_SIZE : 0;
-	return node->page->page_size - sizeof(struct BTreePageHeader) - offset;
+	return heap_capacity(node, node->header->format_version);
 }
 
-// Returns 1 if key is less than index
-// 0 if equal
-// -1 if index is less.
-enum btree_e
-btree_node_compare_cell(
+/**
+ * @brief The first 8 bytes of prefix then bytes, big endian and zero padded.
+ *
+ * Under a bytewise compare, keys whose abbreviations differ order as their
+ * abbreviations do; equal abbreviations say nothing, since padding cannot be
+ * told from zero bytes.
+ */
+static u64
+abbreviate(byte const* prefix, u32 prefix_size, byte const* bytes, u32 size)
+{
+	u64 abbrev = 0;
+	u32 n = 0;
+
+	// The usual case; a fixed count lets the compiler load and swap.
+	if( prefix_size == 0 && size >= sizeof(abbrev) )
+	{
+		for( u32 i = 0; i < sizeof(abbrev); i++ )
+			abbrev = (abbrev << 8) | bytes[i];
+		return abbrev;
+	}
+
+	for( u32 i = 0; i < prefix_size && n < sizeof(abbrev); i++, n++ )
+		abbrev = (abbrev << 8) | prefix[i];
+	for( u32 i = 0; i < size && n < sizeof(abbrev); i++, n++ )
+		abbrev = (abbrev << 8) | bytes[i];
+
+	return n == 0 ? 0 : abbrev << (8 * (sizeof(abbrev) - n));
+}
+
+/**
+ * @brief abbreviate() of the key at index into *out_abbrev, from the bytes
+ * the node holds; false if those are not enough to tell.
+ *
+ * An inline cell's payload is its key in a bytewise tree. An overflow cell
+ * keeps the start of its key inline and is never prefixed; its abbreviation
+ * holds only if that start fills it, as padding would stand for bytes that
+ * are on the overflow pages.
+ */
+static bool
+abbreviate_cell(struct BTreeNode* node, u32 index, u64* out_abbrev)
+{
+	u32 flags = node_flags_at(node, index);
+	if( btree_pkey_is_cell_type(flags, PKEY_FLAG_CELL_TYPE_OVERFLOW) )
+	{
+		// Read in place rather than through a BufferReader; this runs on
+		// every probe.
+		byte* cell_buffer = btu_get_cell_buffer(node, index);
+		u32 inline_size = 0;
+		ser_read_32bit_le(&inline_size, cell_buffer);
+
+		u32 inline_payload_size =
+			btree_cell_overflow_calc_inline_payload_size(inline_size);
+		if( inline_payload_size < sizeof(*out_abbrev) )
+			return false;
+
+		*out_abbrev = abbreviate(
+			NULL,
+			0,
+			cell_buffer + btree_cell_overflow_min_disk_size(),
+			inline_payload_size);
+		return true;
+	}
+
+	if( !btree_pkey_is_cell_type(flags, PKEY_FLAG_CELL_TYPE_INLINE) )
+		return false;
+
+	struct BTreeCellInline cell = {0};
+	btree_cell_read_inline(
+		btu_get_cell_buffer(node, index), 0, &cell, NULL, 0, NULL);
+
+	u32 prefix_size =
+		(flags & PKEY_FLAG_PREFIXED) ? node->header->prefix_size : 0;
+	*out_abbrev = abbreviate(
+		btree_node_prefix(node), prefix_size, cell.payload, cell.inline_size);
+	return true;
+}
+
+/**
+ * @brief btree_node_compare_cell reading overflow pages into *overflow_page,
+ * which is created on the first one read and left for the caller to destroy.
+ * Searches pass the same page for every probe.
+ */
+static enum btree_e
+compare_cell_ex(
 	struct BTreeCompareContext* ctx,
 	struct BTreeNode* node,
 	u32 index,
 	void* key,
 	u32 key_size,
+	struct Page** overflow_page,
 	int* out_result)
 {
 	u32 bytes_compared = 0;
@@ -761,6 +1261,30 @@ btree_node_compare_cell(
 		&cmp_total_size,
 		&next_page_id);
 
+	// The key of a prefixed cell starts in the node's prefix; keyof counts
+	// the prefix in the total but gives only the stored bytes.
+	u32 prefix_size = btree_node_prefix_size_at(node, index);
+	if( prefix_size != 0 )
+	{
+		*out_result = ctx->compare(
+			ctx->compare_context,
+			btree_node_prefix(node),
+			prefix_size,
+			cmp_total_size,
+			key,
+			key_size,
+			bytes_compared,
+			&comparison_bytes_count,
+			&key_size_remaining);
+		bytes_compared += comparison_bytes_count;
+
+		if( comparison_bytes_count == 0 )
+			return BTREE_ERR_UNK;
+
+		if( *out_result != 0 || key_size_remaining == 0 || cmp_size == 0 )
+			return BTREE_OK;
+	}
+
 	*out_result = ctx->compare(
 		ctx->compare_context,
 		cmp,
@@ -785,19 +1309,23 @@ btree_node_compare_cell(
 		if( next_page_id == 0 )
 			return BTREE_OK;
 		// We have to go to overflow pages to find out.
-		struct Page* page = NULL;
 		struct BTreeOverflowReadResult ov = {0};
 
-		result = btpage_err(page_create(ctx->pager, &page));
-		if( result != BTREE_OK )
-			goto end_overflow;
+		if( !*overflow_page )
+		{
+			// Peeks read whole pages, so the page need not be zeroed.
+			result =
+				btpage_err(page_create_for_read(ctx->pager, overflow_page));
+			if( result != BTREE_OK )
+				return result;
+		}
 
 		do
 		{
-			result =
-				btree_overflow_peek(ctx->pager, page, next_page_id, &ov, &cmp);
+			result = btree_overflow_peek(
+				ctx->pager, *overflow_page, next_page_id, &ov, &cmp);
 			if( result != BTREE_OK )
-				goto end_overflow;
+				return result;
 
 			cmp_size = ov.payload_bytes;
 			next_page_id = ov.next_page_id;
@@ -820,15 +1348,34 @@ btree_node_compare_cell(
 
 		} while( next_page_id != 0 && bytes_compared < cmp_total_size &&
 				 key_size_remaining != 0 );
-
-	end_overflow:
-		if( page )
-			page_destroy(ctx->pager, page);
 	}
 
 	return result;
 }
 
+// Returns 1 if key is less than index
+// 0 if equal
+// -1 if index is less.
+enum btree_e
+btree_node_compare_cell(
+	struct BTreeCompareContext* ctx,
+	struct BTreeNode* node,
+	u32 index,
+	void* key,
+	u32 key_size,
+	int* out_result)
+{
+	struct Page* overflow_page = NULL;
+
+	enum btree_e result = compare_cell_ex(
+		ctx, node, index, key, key_size, &overflow_page, out_result);
+
+	if( overflow_page )
+		page_destroy(ctx->pager, overflow_page);
+
+	return result;
+}
+
 enum btree_e
 btree_node_search_keys(
 	struct BTreeCompareContext* ctx,
@@ -838,26 +1385,57 @@ btree_node_search_keys(
 	u32* out_index)
 {
 	u32 num_keys = node->header->num_keys;
-	enum btree_e result = BTREE_OK;
+	enum btree_e result = BTREE_ERR_KEY_NOT_FOUND;
 	int left = 0;
 	int right = num_keys - 1;
 	int mid = 0;
 	int compare_result = 0;
+	// Large keys that tie on their inline bytes go to overflow pages on most
+	// probes; one page serves the whole search.
+	struct Page* overflow_page = NULL;
+	// Bytewise keys are abbreviated once here and probes decided on the
+	// abbreviation until one ties. The range left after a tie is likely to
+	// tie too, so from there on every probe is compared in full. Cells under
+	// a prefix of 8 bytes or more all have the same abbreviation.
+	bool abbreviating =
+		ctx->bytewise && node->header->prefix_size < sizeof(u64);
+	u64 key_abbrev = 0;
+	u64 cell_abbrev = 0;
+	if( abbreviating )
+		key_abbrev = abbreviate(NULL, 0, key, key_size);
 
 	while( left <= right )
 	{
 		mid = (right - left) / 2 + left;
 
+		if( abbreviating )
+		{
+			if( abbreviate_cell(node, mid, &cell_abbrev) &&
+				cell_abbrev != key_abbrev )
+			{
+				if( cell_abbrev < key_abbrev )
+					left = mid + 1;
+				else
+					right = mid - 1;
+				continue;
+			}
+			abbreviating = false;
+		}
+
 		ctx->reset(ctx->compare_context);
-		result = btree_node_compare_cell(
-			ctx, node, mid, key, key_size, &compare_result);
-		if( result != BTREE_OK )
-			goto err;
+		enum btree_e cmp_result = compare_cell_ex(
+			ctx, node, mid, key, key_size, &overflow_page, &compare_result);
+		if( cmp_result != BTREE_OK )
+		{
+			result = cmp_result;
+			goto end;
+		}
 
 		if( compare_result == 0 )
 		{
 			*out_index = mid;
-			return BTREE_OK;
+			result = BTREE_OK;
+			goto end;
 		}
 		else if( compare_result == -1 )
 		{
@@ -870,12 +1448,51 @@ btree_node_search_keys(
 	}
 
 	*out_index = left;
-	return BTREE_ERR_KEY_NOT_FOUND;
 
-err:
+end:
+	if( overflow_page )
+		page_destroy(ctx->pager, overflow_page);
+
 	return result;
 }
 
+/**
+ * @brief btree_node_search_keys_tbl for V0 and V1 nodes, read in place.
+ */
+static u32
+lower_bound_pkeys(struct BTreeNode* node, u32 key)
+{
+	struct BTreePageKey* keys = pkeys(node);
+	u32 left = 0;
+	u32 right = node->header->num_keys;
+
+	while( left < right )
+	{
+		u32 mid = (right - left) / 2 + left;
+		if( keys[mid].key < key )
+			left = mid + 1;
+		else
+			right = mid;
+	}
+
+	return left;
+}
+
+enum btree_e
+btree_node_search_keys_tbl(struct BTreeNode* node, u32 key, u32* out_index)
+{
+	u32 num_keys = node->header->num_keys;
+	u32 index = node_has_pkeys(node)
+					? lower_bound_pkeys(node, key)
+					: btu_lower_bound_keys(node->keys, num_keys, key);
+
+	*out_index = index;
+	if( index < num_keys && node_key_at(node, index) == key )
+		return BTREE_OK;
+	else
+		return BTREE_ERR_KEY_NOT_FOUND;
+}
+
 bool
 node_is_root(struct BTreeNode* node)
 {
@@ -913,20 +1530,77 @@ node_right_child_set(struct BTreeNode* node, u32 right_child)
 	return right_child;
 }
 
+u32
+node_right_sibling(struct BTreeNode* node)
+{
+	if( !node_is_v0(node) )
+		return *link_word(node);
+
+	return node->header->num_keys == 0 ? 0 : BTREE_SIBLING_UNKNOWN;
+}
+
+enum btree_e
+node_right_sibling_set(struct BTreeNode* node, u32 right_sibling)
+{
+	if( upgrade_format(node) != BTREE_OK )
+		return BTREE_ERR_NO_MEM;
+
+	*link_word(node) = right_sibling;
+	return BTREE_OK;
+}
+
 u32
 node_flags_at(struct BTreeNode* node, u32 index)
 {
-	return node->keys[index].flags;
+	if( node_has_pkeys(node) )
+		return pkeys(node)[index].flags;
+	else
+		return v2_slots(node)[index] >> BTREE_SLOT_FLAGS_SHIFT;
+}
+
+u32
+node_cell_offset_at(struct BTreeNode* node, u32 index)
+{
+	if( node_has_pkeys(node) )
+		return pkeys(node)[index].cell_offset;
+	else
+		return v2_slots(node)[index] & BTREE_SLOT_OFFSET_MASK;
+}
+
+u32
+node_cell_offset_at_set(struct BTreeNode* node, u32 index, u32 offset)
+{
+	assert(offset <= BTREE_SLOT_OFFSET_MASK);
+	if( node_has_pkeys(node) )
+	{
+		pkeys(node)[index].cell_offset = offset;
+	}
+	else
+	{
+		u32* slot = &v2_slots(node)[index];
+		*slot = (*slot & ~BTREE_SLOT_OFFSET_MASK) | offset;
+	}
+	return offset;
+}
+
+u32*
+node_key_ptr_at(struct BTreeNode* node, u32 index)
+{
+	if( node_has_pkeys(node) )
+		return &pkeys(node)[index].key;
+	else
+		return &node->keys[index];
 }
 
 u32
 node_key_at(struct BTreeNode* node, u32 index)
 {
-	return node->keys[index].key;
+	return *node_key_ptr_at(node, index);
 }
+
 u32
 node_key_at_set(struct BTreeNode* node, u32 index, u32 key)
 {
-	node->keys[index].key = key;
+	*node_key_ptr_at(node, index) = key;
 	return key;
 }
\ No newline at end of file
@@ -17,6 +17,10 @@ enum btree_page_key_flags_e
 	PKEY_FLAG_CELL_TYPE_INLINE,
 };
 
+// Set on an inline cell stored without its node's key prefix; see
+// BTreePageHeader.prefix_size. The cell type takes the two bits below it.
+#define PKEY_FLAG_PREFIXED 0x4
+
 u32 btree_pkey_set_cell_type(u32 flags, enum btree_page_key_flags_e);
 
 /**
@@ -56,6 +60,22 @@ enum btree_e btree_node_destroy(struct BTreeNode*);
 enum btree_e
 btree_node_init_from_page(struct BTreeNode* node, struct Page* page);
 
+/**
+ * @brief btree_node_init_from_page for a borrowed cache frame that other
+ * threads may write while it is read. The header is copied into header,
+ * which the node then uses, so num_keys and the format stay put and the
+ * keys and slots they span stay inside the page. Keys, slots and cells are
+ * still read from the frame and may be torn; check the page's version
+ * before using anything read from them.
+ *
+ * @return BTREE_ERR_CONFLICT if the header could not be a node's; the frame
+ * changed, or holds something else now.
+ */
+enum btree_e btree_node_init_optimistic(
+	struct BTreeNode* node,
+	struct Page* page,
+	struct BTreePageHeader* header);
+
 enum btree_e btree_node_init_from_read(
 	struct BTreeNode* node,
 	struct Page* page,
@@ -121,6 +141,13 @@ enum btree_e btree_node_read_inline_as_page(
 	struct ChildListIndex* index,
 	u32* out_page_id);
 
+/**
+ * @brief Points the child at index of an internal table node at page_id,
+ * in place; the counterpart of btree_node_read_inline_as_page.
+ */
+enum btree_e btree_node_write_inline_as_page(
+	struct BTreeNode* internal_node, struct ChildListIndex* index, u32 page_id);
+
 /**
  * @brief Inserts overflow cell into a node. Inline payload capped at
  * max_heap_usage
@@ -175,6 +202,37 @@ enum btree_e btree_node_move_cell_from_data(
 	u32 cell_buffer_size,
 	struct Pager* pager);
 
+/**
+ * @brief The node's key prefix; btree_node_prefix_size_at of its prefixed
+ * cells bytes long.
+ */
+byte* btree_node_prefix(struct BTreeNode* node);
+
+/**
+ * @brief Bytes of the node's prefix that come before the payload stored in
+ * the cell at index; 0 unless the cell is PKEY_FLAG_PREFIXED.
+ */
+u32 btree_node_prefix_size_at(struct BTreeNode* node, u32 index);
+
+/**
+ * @brief Give an empty node a key prefix. Inline cells inserted from then on
+ * that start with it are stored without it.
+ *
+ * @return BTREE_ERR_NODE_NOT_ENOUGH_SPACE if the node has keys.
+ */
+enum btree_e btree_node_prefix_init(
+	struct BTreeNode* node, byte const* prefix, u32 prefix_size);
+
+/**
+ * @brief Rewrite the node with the longest prefix its inline cells share,
+ * up to 255 bytes. Leaves the node as it is if that changes nothing or would
+ * not fit.
+ *
+ * @param pager For a scratch page.
+ */
+enum btree_e
+btree_node_prefix_recompute(struct BTreeNode* node, struct Pager* pager);
+
 /**
  * @brief Nodes must be same size
  *
@@ -249,13 +307,43 @@ enum btree_e btree_node_search_keys(
 	u32 key_size,
 	u32* out_index);
 
+/**
+ * @brief btree_node_search_keys for BTREE_TBL nodes, whose keys are the u32s
+ * in the key array; compares them directly instead of through the tree's
+ * keyof and compare functions.
+ */
+enum btree_e
+btree_node_search_keys_tbl(struct BTreeNode* node, u32 key, u32* out_index);
+
 bool node_is_root(struct BTreeNode* node);
 bool node_is_leaf(struct BTreeNode* node);
 void node_is_leaf_set(struct BTreeNode* node, bool is_leaf);
 u32 node_num_keys(struct BTreeNode* node);
 u32 node_right_child(struct BTreeNode* node);
 u32 node_right_child_set(struct BTreeNode* node, u32 right_child);
+/**
+ * @brief Next node on the same level, 0 on the last one, or
+ * BTREE_SIBLING_UNKNOWN.
+ *
+ * Splits keep the lower half on the split page, so only the split page and
+ * the new one change; merges keep the left node, so only the pair changes.
+ * V0 nodes have no link; it is unknown unless they are empty, which only a
+ * new node or a root is.
+ */
+u32 node_right_sibling(struct BTreeNode* node);
+
+/**
+ * @brief Converts a V0 or V1 node to V2 first; BTREE_ERR_NO_MEM if it
+ * cannot.
+ */
+enum btree_e node_right_sibling_set(struct BTreeNode* node, u32 right_sibling);
 u32 node_flags_at(struct BTreeNode* node, u32 index);
+u32 node_cell_offset_at(struct BTreeNode* node, u32 index);
+u32 node_cell_offset_at_set(struct BTreeNode* node, u32 index, u32 offset);
+/**
+ * @brief Where the key at index is stored, in either node format.
+ */
+u32* node_key_ptr_at(struct BTreeNode* node, u32 index);
 u32 node_key_at(struct BTreeNode* node, u32 index);
 u32 node_key_at_set(struct BTreeNode* node, u32 index, u32 key);
 
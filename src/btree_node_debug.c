@@ -1,5 +1,6 @@
 #include "btree_node_debug.h"
 
+#include "btree_node.h"
 #include "btree_utils.h"
 
 #include <stdio.h>
@@ -21,7 +22,7 @@ dbg_print_node(struct BTreeNode* node)
 		btu_read_cell(node, i, &cell);
 		unsigned int page_id = 0;
 		memcpy(&page_id, cell.pointer, sizeof(page_id));
-		printf("%d (p.%u), ", node->keys[i].key, page_id);
+		printf("%d (p.%u), ", node_key_at(node, i), page_id);
 	}
 	if( !node->header->is_leaf )
 	{
@@ -10,6 +10,12 @@
 #include <stdio.h>
 #include <string.h>
 
+static int
+min(int left, int right)
+{
+	return left < right ? left : right;
+}
+
 enum btree_e
 btree_node_read(
 	struct BTree* tree,
@@ -52,9 +58,13 @@ btree_node_read_ex2(
 		.compare = tree->compare,
 		.reset = tree->reset_compare,
 		.keyof = tree->keyof,
+		.bytewise = tree->bytewise,
 		.compare_context = compare_ctx,
 		.pager = tree->pager};
-	result = btree_node_search_keys(&ctx, node, key, key_size, &key_index);
+	if( tree->type == BTREE_TBL )
+		result = btree_node_search_keys_tbl(node, *(u32*)key, &key_index);
+	else
+		result = btree_node_search_keys(&ctx, node, key, key_size, &key_index);
 	if( result != BTREE_OK )
 		return result;
 
@@ -85,13 +95,18 @@ btree_node_read_at(
 	{
 		struct BTreeCellInline cell = {0};
 		u32 total_size = 0;
+		u32 prefix_size = btree_node_prefix_size_at(node, key_index);
+		u32 prefix_read = min(prefix_size, buffer_size);
+		memcpy(buffer, btree_node_prefix(node), prefix_read);
+
 		btree_cell_read_inline(
 			cell_buffer,
 			cell_buffer_size,
 			&cell,
-			buffer,
-			buffer_size,
+			(byte*)buffer + prefix_read,
+			buffer_size - prefix_read,
 			&total_size);
+		total_size += prefix_size;
 
 		if( total_size > buffer_size )
 			result = BTREE_ERR_BUFFER_TOO_SMALL;
@@ -124,8 +139,9 @@ btree_node_read_at(
 		struct BTreeOverflowReadResult overflow_read_result = {0};
 		while( next_page_id != 0 && buffer_size > written_size )
 		{
-			result = btree_overflow_read(
+			result = btree_overflow_read_ex(
 				pager,
+				tree->rcer->snapshot,
 				next_page_id,
 				next_buffer,
 				buffer_size - written_size,
@@ -172,6 +188,7 @@ btree_node_payload_size_at(
 		struct BTreeCellInline cell = {0};
 		btree_cell_read_inline(
 			cell_buffer, cell_buffer_size, &cell, NULL, 0, out_size);
+		*out_size += btree_node_prefix_size_at(node, index);
 	}
 
 	return BTREE_OK;
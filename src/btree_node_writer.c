@@ -25,9 +25,8 @@ btree_node_write(
 	void* data,
 	u32 data_size)
 {
-	char found;
-	u32 insertion_index_number =
-		btu_binary_search_keys(node->keys, node->header->num_keys, key, &found);
+	u32 insertion_index_number = 0;
+	btree_node_search_keys_tbl(node, key, &insertion_index_number);
 
 	struct InsertionIndex insertion_index = {0};
 	btu_init_insertion_index_from_index(
@@ -4,6 +4,7 @@
 #include "btree_node.h"
 #include "btree_node_reader.h"
 #include "btree_node_writer.h"
+#include "btree_utils.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -25,9 +26,22 @@ btree_op_scan_acquire(struct BTree* tree, struct OpScan* op)
 }
 
 enum btree_e
-btree_op_scan_prepare(struct OpScan* op)
+btree_op_scan_acquire_shared(struct BTree* tree, struct OpScan* op)
+{
+	enum btree_e result = btree_op_scan_acquire(tree, op);
+	if( result == BTREE_OK )
+		cursor_set_latch(op->cursor, CURSOR_LATCH_SHARED);
+
+	return result;
+}
+
+/**
+ * @brief Start iterating at the cell the cursor points to; if it points past
+ * the last cell of its leaf, at the first cell after it.
+ */
+static enum btree_e
+prepare_at_cursor(struct OpScan* op)
 {
-	assert(op->step == OP_SCAN_STEP_INIT);
 	enum btree_e result = BTREE_OK;
 	struct NodeView nv = {0};
 	struct Cursor* cursor = op->cursor;
@@ -36,22 +50,22 @@ btree_op_scan_prepare(struct OpScan* op)
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_iter_begin(cursor);
+	result = cursor_read_current_ro(cursor, &nv);
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_read_current(cursor, &nv);
-	if( result != BTREE_OK )
-		goto end;
-
-	u32 ind = cursor->current_key_index.index;
-	if( node_num_keys(nv_node(&nv)) == ind )
+	if( node_num_keys(nv_node(&nv)) == cursor->current_key_index.index )
 	{
-		op->data_size = 0;
-		result = BTREE_ERR_ITER_DONE;
-		goto end;
+		result = cursor_iter_next(cursor);
+		if( result != BTREE_OK )
+			goto end;
+
+		result = cursor_read_current_ro(cursor, &nv);
+		if( result != BTREE_OK )
+			goto end;
 	}
 
+	u32 ind = cursor->current_key_index.index;
 	result = btree_node_payload_size_at(
 		cursor_tree(cursor), nv_node(&nv), ind, &op->data_size);
 	if( result != BTREE_OK )
@@ -62,6 +76,7 @@ end:
 
 	if( result == BTREE_ERR_ITER_DONE )
 	{
+		op->data_size = 0;
 		op->step = OP_SCAN_STEP_DONE;
 		result = BTREE_OK;
 	}
@@ -74,6 +89,132 @@ end:
 	return result;
 }
 
+enum btree_e
+btree_op_scan_prepare(struct OpScan* op)
+{
+	assert(op->step == OP_SCAN_STEP_INIT);
+	enum btree_e result = BTREE_OK;
+
+	result = cursor_iter_begin(op->cursor);
+	if( result != BTREE_OK )
+	{
+		op->last_status = result;
+		return result;
+	}
+
+	return prepare_at_cursor(op);
+}
+
+enum btree_e
+btree_op_scan_prepare_from(struct OpScan* op, u32 key)
+{
+	assert(op->step == OP_SCAN_STEP_INIT);
+	enum btree_e result = BTREE_OK;
+	char found = 0;
+
+	// A miss leaves the cursor where the key would go in its leaf.
+	result = cursor_traverse_to(op->cursor, key, &found);
+	if( result != BTREE_OK )
+	{
+		op->last_status = result;
+		return result;
+	}
+
+	return prepare_at_cursor(op);
+}
+
+static enum btree_e
+read_child(
+	struct BTree* tree, struct BTreeNode* node, u32 i, struct NodeView* out_nv)
+{
+	enum btree_e result = BTREE_OK;
+	struct ChildListIndex index = {0};
+	u32 child_page_id = 0;
+
+	btu_init_keylistindex_from_index(&index, node, i);
+	result = btree_node_read_inline_as_page(node, &index, &child_page_id);
+	if( result != BTREE_OK )
+		return result;
+
+	return noderc_reinit_read(tree->rcer, out_nv, child_page_id);
+}
+
+enum btree_e
+btree_op_scan_bounds(
+	struct BTree* tree, u32* bounds, u32 max_bounds, u32* out_nbounds)
+{
+	enum btree_e result = BTREE_OK;
+	struct NodeView root_nv = {0};
+	struct NodeView child_nv = {0};
+	u32* separators = NULL;
+	u32 nseparators = 0;
+	*out_nbounds = 0;
+
+	assert(tree->type == BTREE_TBL);
+
+	result = noderc_acquire_load_n(
+		tree->rcer, 2, &root_nv, tree->root_page_id, &child_nv, 0);
+	if( result != BTREE_OK )
+		goto end;
+
+	struct BTreeNode* root = nv_node(&root_nv);
+	if( node_is_leaf(root) || max_bounds == 0 )
+		goto end;
+
+	// The root's separators alone if there are enough of them; otherwise
+	// those of the level below too, in key order.
+	bool second_level = node_num_keys(root) < max_bounds;
+	u32 capacity = node_num_keys(root);
+	for( u32 i = 0; second_level && i <= node_num_keys(root); i++ )
+	{
+		result = read_child(tree, root, i, &child_nv);
+		if( result != BTREE_OK )
+			goto end;
+
+		if( node_is_leaf(nv_node(&child_nv)) )
+		{
+			second_level = false;
+			break;
+		}
+
+		capacity += node_num_keys(nv_node(&child_nv));
+	}
+
+	separators = (u32*)malloc(sizeof(u32) * (capacity + 1));
+	for( u32 i = 0; i <= node_num_keys(root); i++ )
+	{
+		if( second_level )
+		{
+			result = read_child(tree, root, i, &child_nv);
+			if( result != BTREE_OK )
+				goto end;
+
+			struct BTreeNode* child = nv_node(&child_nv);
+			for( u32 j = 0; j < node_num_keys(child); j++ )
+			{
+				if( nseparators < capacity )
+					separators[nseparators++] = node_key_at(child, j);
+			}
+		}
+
+		if( i < node_num_keys(root) && nseparators < capacity )
+			separators[nseparators++] = node_key_at(root, i);
+	}
+
+	// Every separator starts a range of about the same number of pages, so
+	// evenly spaced ones give ranges of about the same size.
+	u32 nbounds = max_bounds < nseparators ? max_bounds : nseparators;
+	for( u32 i = 0; i < nbounds; i++ )
+		bounds[i] = separators[((u64)(i + 1) * nseparators) / (nbounds + 1)];
+	*out_nbounds = nbounds;
+
+end:
+	if( separators )
+		free(separators);
+	noderc_release_n(tree->rcer, 2, &root_nv, &child_nv);
+	return result;
+}
+
 enum btree_e
 btree_op_scan_current(struct OpScan* op, void* buffer, u32 buffer_size)
 {
@@ -88,7 +229,7 @@ btree_op_scan_current(struct OpScan* op, void* buffer, u32 buffer_size)
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_read_current(cursor, &nv);
+	result = cursor_read_current_ro(cursor, &nv);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -105,6 +246,33 @@ end:
 	return result;
 }
 
+enum btree_e
+btree_op_scan_key(struct OpScan* op, u32* out_key)
+{
+	enum btree_e result = BTREE_OK;
+	struct NodeView nv = {0};
+	struct Cursor* cursor = op->cursor;
+
+	assert(op->step == OP_SCAN_STEP_ITERATING);
+	assert(cursor_tree_type(cursor) == BTREE_TBL);
+
+	result = noderc_acquire(cursor_rcer(cursor), &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = cursor_read_current_ro(cursor, &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	*out_key = node_key_at(nv_node(&nv), cursor_curr_ind(cursor)->index);
+
+end:
+	noderc_release(cursor_rcer(cursor), &nv);
+
+	op->last_status = result;
+	return result;
+}
+
 enum btree_e
 btree_op_scan_next(struct OpScan* op)
 {
@@ -122,7 +290,7 @@ btree_op_scan_next(struct OpScan* op)
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_read_current(op->cursor, &nv);
+	result = cursor_read_current_ro(op->cursor, &nv);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -158,13 +326,15 @@ btree_op_scan_update(struct OpScan* op, void* payload, u32 payload_size)
 	if( result != BTREE_OK )
 		goto end;
 
+	// Read the key before the cell goes; the next cell's key takes its
+	// place.
+	u32 key = node_key_at(nv_node(&nv), cursor_curr_ind(cursor)->index);
+
 	// TODO: Check that we're looking at a record.
 	result =
 		btree_node_delete(cursor_tree(cursor), &nv, cursor_curr_ind(cursor));
 	if( result != BTREE_OK )
 		goto end;
-
-	u32 key = node_key_at(nv_node(&nv), cursor_curr_ind(cursor)->index);
 	struct InsertionIndex insert_index = {
 		.mode = KLIM_INDEX, .index = cursor_curr_ind(cursor)->index};
 	result = btree_node_write_at(
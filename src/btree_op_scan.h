@@ -24,11 +24,48 @@ struct OpScan
 
 enum btree_e btree_op_scan_acquire(struct BTree* tree, struct OpScan* op);
 
+/**
+ * @brief btree_op_scan_acquire for a scan that other threads may write
+ * under; the cursor latches its pages shared (CURSOR_LATCH_SHARED). It is
+ * only for reading; btree_op_scan_update and btree_op_scan_delete would
+ * change pages it only holds shared.
+ *
+ * Plain scans latch nothing, since the SQL layer writes through them and
+ * inserts into tables it is scanning on the same thread.
+ */
+enum btree_e
+btree_op_scan_acquire_shared(struct BTree* tree, struct OpScan* op);
+
 enum btree_e btree_op_scan_prepare(struct OpScan* op);
 
+/**
+ * @brief btree_op_scan_prepare, but starting at the first cell with a key of
+ * at least key; for BTREE_TBL trees.
+ */
+enum btree_e btree_op_scan_prepare_from(struct OpScan* op, u32 key);
+
+/**
+ * @brief Up to max_bounds keys, ascending, that split a BTREE_TBL tree into
+ * ranges of about the same size, for scanning them in parallel. Range i
+ * holds the keys after bounds[i - 1] up to and including bounds[i]; the last
+ * holds those after the last bound. None if the root is a leaf.
+ *
+ * The bounds are separators from the root, or from the root and the level
+ * below it if the root has fewer than max_bounds, so only those nodes are
+ * read.
+ */
+enum btree_e btree_op_scan_bounds(
+	struct BTree* tree, u32* bounds, u32 max_bounds, u32* out_nbounds);
+
 enum btree_e
 btree_op_scan_current(struct OpScan* op, void* buffer, u32 buffer_size);
 
+/**
+ * @brief Key of the current cell; for BTREE_TBL trees, where keys are
+ * u32s.
+ */
+enum btree_e btree_op_scan_key(struct OpScan* op, u32* out_key);
+
 enum btree_e btree_op_scan_next(struct OpScan* op);
 
 enum btree_e
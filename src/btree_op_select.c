@@ -17,6 +17,7 @@ btree_op_select_acquire_tbl(
 	memset(op, 0x00, sizeof(struct OpSelection));
 
 	op->cursor = cursor_create_ex(tree, cmp_ctx);
+	cursor_set_latch(op->cursor, CURSOR_LATCH_OPTIMISTIC);
 
 	op->last_status = BTREE_OK;
 	op->sm_key_buf = key;
@@ -42,6 +43,7 @@ btree_op_select_acquire_index(
 	memset(op, 0x00, sizeof(struct OpSelection));
 
 	op->cursor = cursor_create_ex(tree, cmp_ctx);
+	cursor_set_latch(op->cursor, CURSOR_LATCH_OPTIMISTIC);
 
 	op->last_status = BTREE_OK;
 	op->sm_key_buf = 0;
@@ -54,12 +56,46 @@ btree_op_select_acquire_index(
 	return BTREE_OK;
 }
 
+/**
+ * @brief Move the cursor to op's key and read its node into nv, traversing
+ * again for as long as the node changes under the optimistic cursor.
+ */
+static enum btree_e
+locate(struct OpSelection* op, struct NodeView* nv)
+{
+	enum btree_e result = BTREE_OK;
+	char found;
+	struct Cursor* cursor = op->cursor;
+
+	do
+	{
+		result = cursor_traverse_to_ex(cursor, op->key, op->key_size, &found);
+		if( result != BTREE_OK )
+			break;
+
+		if( !found )
+		{
+			result = BTREE_ERR_KEY_NOT_FOUND;
+			op->step = OP_SELECTION_STEP_NOT_FOUND;
+			break;
+		}
+
+		result = cursor_read_current_ro(cursor, nv);
+		if( cursor_validate(cursor) != BTREE_OK )
+			result = BTREE_ERR_CONFLICT;
+
+		if( result == BTREE_ERR_CONFLICT )
+			cursor_reset(cursor);
+	} while( result == BTREE_ERR_CONFLICT );
+
+	return result;
+}
+
 enum btree_e
 btree_op_select_prepare(struct OpSelection* op)
 {
 	assert(op->step == OP_SELECTION_STEP_INIT);
 	enum btree_e result = BTREE_OK;
-	char found;
 	struct NodeView nv = {0};
 	struct Cursor* cursor = op->cursor;
 
@@ -67,18 +103,7 @@ btree_op_select_prepare(struct OpSelection* op)
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_traverse_to_ex(cursor, op->key, op->key_size, &found);
-	if( result != BTREE_OK )
-		goto end;
-
-	if( !found )
-	{
-		result = BTREE_ERR_KEY_NOT_FOUND;
-		op->step = OP_SELECTION_STEP_NOT_FOUND;
-		goto end;
-	}
-
-	result = cursor_read_current(cursor, &nv);
+	result = locate(op, &nv);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -109,15 +134,34 @@ btree_op_select_commit(struct OpSelection* op, void* buffer, u32 buffer_size)
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_read_current(cursor, &nv);
-	if( result != BTREE_OK )
-		goto end;
-
-	assert(cursor->current_key_index.index != node_num_keys(nv_node(&nv)));
+	result = cursor_read_current_ro(cursor, &nv);
+	if( cursor_validate(cursor) != BTREE_OK )
+		result = BTREE_ERR_CONFLICT;
 
-	u32 ind = cursor->current_key_index.index;
-	result = btree_node_read_at(
-		cursor_tree(cursor), nv_node(&nv), ind, buffer, buffer_size);
+	// The row may have moved since prepare; find it again.
+	while( result == BTREE_OK || result == BTREE_ERR_CONFLICT )
+	{
+		if( result == BTREE_ERR_CONFLICT )
+		{
+			cursor_reset(cursor);
+			result = locate(op, &nv);
+			if( result != BTREE_OK )
+				goto end;
+		}
+
+		assert(
+			cursor->current_key_index.index != node_num_keys(nv_node(&nv)));
+
+		// Overflow pages are only freed under the leaf's latch, so the
+		// leaf's version covers them too.
+		u32 ind = cursor->current_key_index.index;
+		result = btree_node_read_at(
+			cursor_tree(cursor), nv_node(&nv), ind, buffer, buffer_size);
+		if( cursor_validate(cursor) != BTREE_OK )
+			result = BTREE_ERR_CONFLICT;
+		if( result != BTREE_ERR_CONFLICT )
+			break;
+	}
 	if( result != BTREE_OK )
 		goto end;
 
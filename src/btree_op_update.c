@@ -1,5 +1,6 @@
 #include "btree_op_update.h"
 
+#include "btree.h"
 #include "btree_cursor.h"
 #include "btree_node.h"
 #include "btree_node_reader.h"
@@ -145,6 +146,12 @@ btree_op_update_commit(struct OpUpdate* op, byte* payload, u32 payload_size)
 	if( result != BTREE_OK )
 		goto end;
 
+	// Read the key before the cell goes; the next cell's key takes its
+	// place.
+	u32 key = op->not_found
+				  ? op->sm_key_buf
+				  : node_key_at(nv_node(&nv), cursor_curr_ind(cursor)->index);
+
 	if( !op->not_found )
 	{
 		result = btree_node_delete(
@@ -152,10 +159,6 @@ btree_op_update_commit(struct OpUpdate* op, byte* payload, u32 payload_size)
 		if( result != BTREE_OK )
 			goto end;
 	}
-
-	u32 key = op->not_found
-				  ? op->sm_key_buf
-				  : node_key_at(nv_node(&nv), cursor_curr_ind(cursor)->index);
 	struct InsertionIndex insert_index = {
 		.mode = KLIM_INDEX, .index = cursor_curr_ind(cursor)->index};
 	result = btree_node_write_at(
@@ -165,6 +168,47 @@ btree_op_update_commit(struct OpUpdate* op, byte* payload, u32 payload_size)
 		key,
 		payload,
 		payload_size);
+	// The leaf has to split; btree_insert does that. Whatever was under the
+	// key is deleted already.
+	if( result == BTREE_ERR_NODE_NOT_ENOUGH_SPACE &&
+		cursor_tree_type(cursor) == BTREE_TBL )
+		result = btree_insert(cursor_tree(cursor), key, payload, payload_size);
+	if( result != BTREE_OK )
+		goto end;
+
+end:
+	noderc_release(cursor_rcer(cursor), &nv);
+
+	op->step = OP_UPDATE_STEP_DONE;
+	op->last_status = result;
+	return result;
+}
+
+enum btree_e
+btree_op_update_delete(struct OpUpdate* op)
+{
+	assert(op->step == OP_UPDATE_STEP_PREPARED);
+
+	enum btree_e result = BTREE_OK;
+	struct NodeView nv = {0};
+	struct Cursor* cursor = op->cursor;
+
+	if( op->not_found )
+	{
+		result = BTREE_ERR_KEY_NOT_FOUND;
+		goto end;
+	}
+
+	result = noderc_acquire(cursor_rcer(cursor), &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = cursor_read_current(cursor, &nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result =
+		btree_node_delete(cursor_tree(cursor), &nv, cursor_curr_ind(cursor));
 	if( result != BTREE_OK )
 		goto end;
 
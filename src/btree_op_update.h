@@ -44,6 +44,13 @@ btree_op_update_preview(struct OpUpdate* op, void* buffer, u32 buffer_size);
 enum btree_e
 btree_op_update_commit(struct OpUpdate* op, byte* payload, u32 payload_size);
 
+/**
+ * @brief Remove the prepared cell. The node is not rebalanced.
+ *
+ * @return BTREE_ERR_KEY_NOT_FOUND if the key isn't there.
+ */
+enum btree_e btree_op_update_delete(struct OpUpdate* op);
+
 void btree_op_update_release(struct OpUpdate* op);
 
 u32 op_update_size(struct OpUpdate* op);
@@ -3,6 +3,7 @@
 #include "btree_defs.h"
 #include "btree_utils.h"
 #include "page.h"
+#include "pager_snapshot.h"
 #include "serialization.h"
 
 #include <assert.h>
@@ -15,9 +16,10 @@ btree_overflow_max_write_size(struct Pager* pager)
 	return pager->page_size - sizeof(u32) * 2;
 }
 
-enum btree_e
-btree_overflow_peek(
+static enum btree_e
+peek(
 	struct Pager* pager,
+	struct PagerSnapshot* snapshot,
 	struct Page* page,
 	u32 page_id,
 	struct BTreeOverflowReadResult* out,
@@ -31,8 +33,13 @@ btree_overflow_peek(
 	out->next_page_id = 0;
 	out->payload_bytes = 0;
 
+	// Callers only copy or compare the payload.
 	pager_reselect(&selector, page_id);
-	read_result = btpage_err(pager_read_page(pager, &selector, page));
+	if( snapshot )
+		read_result =
+			btpage_err(pager_snapshot_read_ro(snapshot, &selector, page));
+	else
+		read_result = btpage_err(pager_read_page_ro(pager, &selector, page));
 	if( read_result != BTREE_OK )
 		goto end;
 
@@ -57,6 +64,17 @@ end:
 	return read_result;
 }
 
+enum btree_e
+btree_overflow_peek(
+	struct Pager* pager,
+	struct Page* page,
+	u32 page_id,
+	struct BTreeOverflowReadResult* out,
+	byte** out_payload)
+{
+	return peek(pager, NULL, page, page_id, out, out_payload);
+}
+
 enum btree_e
 btree_overflow_read(
 	struct Pager* pager,
@@ -64,6 +82,19 @@ btree_overflow_read(
 	void* buffer,
 	u32 buffer_size,
 	struct BTreeOverflowReadResult* out)
+{
+	return btree_overflow_read_ex(
+		pager, NULL, page_id, buffer, buffer_size, out);
+}
+
+enum btree_e
+btree_overflow_read_ex(
+	struct Pager* pager,
+	struct PagerSnapshot* snapshot,
+	u32 page_id,
+	void* buffer,
+	u32 buffer_size,
+	struct BTreeOverflowReadResult* out)
 {
 	struct Page* page = NULL;
 	enum btree_e read_result = BTREE_OK;
@@ -76,7 +107,7 @@ btree_overflow_read(
 	if( read_result != BTREE_OK )
 		goto end;
 
-	read_result = btree_overflow_peek(pager, page, page_id, out, &payload);
+	read_result = peek(pager, snapshot, page, page_id, out, &payload);
 	if( read_result != BTREE_OK )
 		goto end;
 
@@ -49,6 +49,18 @@ enum btree_e btree_overflow_read(
 	u32 buffer_size,
 	struct BTreeOverflowReadResult* result);
 
+/**
+ * @brief btree_overflow_read as of snapshot, or the pager's current pages
+ * if NULL.
+ */
+enum btree_e btree_overflow_read_ex(
+	struct Pager* pager,
+	struct PagerSnapshot* snapshot,
+	u32 page_id,
+	void* buffer,
+	u32 buffer_size,
+	struct BTreeOverflowReadResult* result);
+
 struct BTreeOverflowWriteResult
 {
 	u32 page_id;
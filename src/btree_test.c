@@ -8,12 +8,20 @@
 #include "btree_node_debug.h"
 #include "btree_node_reader.h"
 #include "btree_node_writer.h"
+#include "btree_op_scan.h"
+#include "btree_op_select.h"
+#include "btree_op_update.h"
 #include "btree_utils.h"
+#include "btthread.h"
 #include "noderc.h"
 #include "page.h"
 #include "page_cache.h"
 #include "pagemeta.h"
 #include "pager_ops_cstd.h"
+#include "pager_ops_posix.h"
+#include "pager_shadow.h"
+#include "pager_snapshot.h"
+#include "pager_wal.h"
 #include "serialization.h"
 
 #include <assert.h>
@@ -111,7 +119,7 @@ btree_test_insert_root_with_space()
 		goto end;
 	}
 
-	if( raw_node->keys[0].key != 1 || raw_node->keys[1].key != 12 )
+	if( node_key_at(raw_node, 0) != 1 || node_key_at(raw_node, 1) != 12 )
 	{
 		result = 0;
 		goto end;
@@ -745,12 +753,15 @@ btree_test_freelist(void)
 	if( found )
 		goto fail;
 
+	pager_flush(pager);
+
 	noderc_reinit_read(&rcer, &nv, 1);
 
 	struct PageMetadata meta = {0};
 	pagemeta_read(&meta, nv_page(&nv));
 
-	if( meta.next_free_page != 2 )
+	// The overflow chain 22..2 went into one trunk: page 22 holding 21..2.
+	if( meta.next_free_page != 22 )
 		goto fail;
 
 	int SMALL_PAYLOAD_SIZE = page_size * 3 - 112;
@@ -760,13 +771,28 @@ btree_test_freelist(void)
 
 	btree_insert(tree, 4, smaller_payload, SMALL_PAYLOAD_SIZE);
 
+	pager_flush(pager);
+
 	noderc_reinit_read(&rcer, &nv, 1);
 
 	pagemeta_read(&meta, nv_page(&nv));
 
-	if( meta.next_free_page != 5 )
+	if( meta.next_free_page != 22 )
 		goto fail;
 
+	// 2, 3 and 4 were reused; 5 is next.
+	u32 trunk_count = 0;
+	u32 next_free = 0;
+	noderc_reinit_read(&rcer, &nv, 22);
+	ser_read_32bit_le(&trunk_count, nv_page(&nv)->page_buffer);
+	ser_read_32bit_le(
+		&next_free, (char*)nv_page(&nv)->page_buffer + 4 * trunk_count);
+
+	if( trunk_count != 17 || next_free != 5 )
+		goto fail;
+
+	noderc_reinit_read(&rcer, &nv, 1);
+
 	char* cmp_buf = (char*)malloc(SMALL_PAYLOAD_SIZE);
 	memset(cmp_buf, 0x00, SMALL_PAYLOAD_SIZE);
 
@@ -1028,3 +1054,1218 @@ fail:
 	result = 0;
 	goto end;
 }
+
+static int
+file_exists(char const* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if( fp )
+		fclose(fp);
+	return fp != NULL;
+}
+
+static int
+wal_check_rows(struct BTree* tree, u32 nrows)
+{
+	u32 payload[10] = {0};
+
+	for( u32 key = 1; key <= nrows; key++ )
+	{
+		struct OpSelection op = {0};
+		btree_op_select_acquire_tbl(tree, &op, key, NULL);
+		enum btree_e result = btree_op_select_prepare(&op);
+		if( result == BTREE_OK )
+			result = btree_op_select_commit(&op, payload, sizeof(payload));
+		btree_op_select_release(&op);
+
+		if( result != BTREE_OK || payload[0] != key )
+			return 0;
+	}
+
+	return 1;
+}
+
+int
+btree_test_wal_reopen(void)
+{
+	char const* db_name = "btree_test_wal.db";
+	char const* wal_name = "btree_test_wal.db-wal";
+	u32 const nrows = 4000;
+	int result = 0;
+	u32 payload[10] = {0};
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	remove(db_name);
+	remove(wal_name);
+
+	// A tiny cache spills dirty pages into the log between commits.
+	page_cache_create(&cache, 4);
+	for( int pass = 0; pass < 3; pass++ )
+	{
+		pager_posix_create(&pager, cache, db_name, 0x200);
+		// The last pass reads the checkpointed file without the log.
+		if( pass < 2 && pager_enable_wal(pager) != PAGER_OK )
+			goto end;
+
+		noderc_init(&rcer, pager);
+		btree_alloc(&tree);
+		if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+			goto end;
+
+		if( pass == 0 )
+		{
+			for( u32 key = 1; key <= nrows; key++ )
+			{
+				payload[0] = key;
+				if( btree_insert(tree, key, payload, sizeof(payload)) !=
+					BTREE_OK )
+					goto end;
+				if( key % 25 == 0 && pager_flush(pager) != PAGER_OK )
+					goto end;
+			}
+
+			if( pager_flush(pager) != PAGER_OK ||
+				pager->wal->stats.checkpoints == 0 )
+				goto end;
+		}
+
+		if( !wal_check_rows(tree, nrows) )
+			goto end;
+
+		btree_dealloc(tree);
+		tree = NULL;
+		pager_destroy(pager);
+		pager = NULL;
+
+		if( file_exists(wal_name) )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+	remove(wal_name);
+
+	return result;
+}
+
+int
+btree_test_shadow_reopen(void)
+{
+	char const* db_name = "btree_test_shadow.db";
+	u32 const nrows = 3000;
+	int result = 0;
+	u32 payload[10] = {0};
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	remove(db_name);
+
+	// A tiny cache writes dirty pages aside between commits.
+	page_cache_create(&cache, 4);
+	for( int pass = 0; pass < 2; pass++ )
+	{
+		pager_posix_create(&pager, cache, db_name, 0x400);
+		if( pager_enable_shadow(pager) != PAGER_OK )
+			goto end;
+
+		noderc_init(&rcer, pager);
+		btree_alloc(&tree);
+		if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+			goto end;
+
+		if( pass == 0 )
+		{
+			for( u32 key = 1; key <= nrows; key++ )
+			{
+				payload[0] = key;
+				if( btree_insert(tree, key, payload, sizeof(payload)) !=
+					BTREE_OK )
+					goto end;
+				if( key % 25 == 0 && pager_sync(pager) != PAGER_OK )
+					goto end;
+			}
+
+			if( pager_sync(pager) != PAGER_OK ||
+				pager->shadow->stats.commits < nrows / 25 )
+				goto end;
+		}
+
+		if( !wal_check_rows(tree, nrows) )
+			goto end;
+
+		btree_dealloc(tree);
+		tree = NULL;
+		pager_destroy(pager);
+		pager = NULL;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+/**
+ * @brief A scan through a snapshot sees every row it started with, in
+ * order, while each row is deleted and a new one inserted under it.
+ */
+int
+btree_test_snapshot_scan(void)
+{
+	char const* db_name = "btree_test_snapshot.db";
+	u32 const nrows = 1000;
+	// Every so often a row big enough to need overflow pages.
+	u32 const big_every = 50;
+	int result = 0;
+	u32 payload[400] = {0};
+	u32 read[400] = {0};
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct PagerSnapshot* snapshot = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTreeNodeRC snapshot_rcer;
+	struct BTree* tree = NULL;
+	struct BTree* snapshot_tree = NULL;
+	struct OpScan op = {0};
+	u32 seen = 0;
+	remove(db_name);
+
+	page_cache_create(&cache, 4);
+	pager_posix_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 key = 1; key <= nrows; key++ )
+	{
+		u32 size = key % big_every == 0 ? sizeof(payload) : sizeof(u32) * 4;
+		payload[0] = key;
+		payload[size / sizeof(u32) - 1] = key;
+		if( btree_insert(tree, key, payload, size) != BTREE_OK )
+			goto end;
+	}
+	if( pager_flush(pager) != PAGER_OK ||
+		pager_snapshot_open(pager, &snapshot) != PAGER_OK )
+		goto end;
+
+	noderc_init(&snapshot_rcer, pager);
+	noderc_set_snapshot(&snapshot_rcer, snapshot);
+	btree_alloc(&snapshot_tree);
+	if( btree_init(snapshot_tree, pager, &snapshot_rcer, 1) != BTREE_OK ||
+		btree_op_scan_acquire(snapshot_tree, &op) != BTREE_OK ||
+		btree_op_scan_prepare(&op) != BTREE_OK )
+		goto end;
+
+	while( !btree_op_scan_done(&op) )
+	{
+		u32 key = 0;
+		if( btree_op_scan_key(&op, &key) != BTREE_OK || key != seen + 1 ||
+			btree_op_scan_current(&op, read, sizeof(read)) != BTREE_OK ||
+			read[0] != key || read[op.data_size / sizeof(u32) - 1] != key )
+			goto end;
+		seen += 1;
+
+		struct OpUpdate delete = {0};
+		btree_op_update_acquire_tbl(tree, &delete, key, NULL);
+		enum btree_e deleted = btree_op_update_prepare(&delete);
+		if( deleted == BTREE_OK )
+			deleted = btree_op_update_delete(&delete);
+		btree_op_update_release(&delete);
+
+		payload[0] = key + nrows;
+		payload[3] = key + nrows;
+		if( deleted != BTREE_OK ||
+			btree_insert(tree, key + nrows, payload, sizeof(u32) * 4) !=
+				BTREE_OK )
+			goto end;
+
+		if( btree_op_scan_next(&op) != BTREE_OK )
+			goto end;
+	}
+
+	if( seen != nrows || snapshot->nimages == 0 )
+		goto end;
+
+	for( u32 key = 1; key <= nrows * 2; key++ )
+	{
+		struct OpSelection select = {0};
+		btree_op_select_acquire_tbl(tree, &select, key, NULL);
+		enum btree_e found = btree_op_select_prepare(&select);
+		if( found == BTREE_OK )
+			found = btree_op_select_commit(&select, read, sizeof(read));
+		btree_op_select_release(&select);
+
+		if( key <= nrows ? found != BTREE_ERR_KEY_NOT_FOUND
+						 : found != BTREE_OK || read[0] != key )
+			goto end;
+	}
+
+	result = 1;
+end:
+	btree_op_scan_release(&op);
+	if( snapshot_tree )
+		btree_dealloc(snapshot_tree);
+	if( snapshot )
+		pager_snapshot_close(snapshot);
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define LEAF_LINKS_ROWS 1500
+
+/**
+ * @brief Rows inserted out of order and every third deleted again, so leaves
+ * both split and merge; a scan, which steps from leaf to leaf by their
+ * links, must still see every row left, in order.
+ */
+int
+btree_test_leaf_links(void)
+{
+	char const* db_name = "btree_test_leaf_links.db";
+	int result = 0;
+	u32 payload[8] = {0};
+	u32 prev_key = 0;
+	u32 nrows = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct OpScan op = {0};
+	remove(db_name);
+
+	page_cache_create(&cache, 16);
+	pager_cstd_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 i = 0; i < LEAF_LINKS_ROWS; i++ )
+	{
+		u32 key = (i * 7919) % LEAF_LINKS_ROWS + 1;
+		payload[0] = key;
+		if( btree_insert(tree, key, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+
+	for( u32 key = 3; key <= LEAF_LINKS_ROWS; key += 3 )
+	{
+		if( btree_delete(tree, key) != BTREE_OK )
+			goto end;
+	}
+
+	btree_op_scan_acquire(tree, &op);
+	if( btree_op_scan_prepare(&op) != BTREE_OK )
+		goto end;
+
+	while( !btree_op_scan_done(&op) )
+	{
+		u32 key = 0;
+		if( btree_op_scan_key(&op, &key) != BTREE_OK ||
+			btree_op_scan_current(&op, payload, sizeof(payload)) !=
+				BTREE_OK ||
+			payload[0] != key || key <= prev_key || key % 3 == 0 )
+			goto end;
+
+		prev_key = key;
+		nrows += 1;
+		if( btree_op_scan_next(&op) != BTREE_OK )
+			goto end;
+	}
+
+	if( nrows != LEAF_LINKS_ROWS - LEAF_LINKS_ROWS / 3 )
+		goto end;
+
+	result = 1;
+end:
+	btree_op_scan_release(&op);
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define SCAN_BOUNDS_ROWS 3000
+#define SCAN_BOUNDS_MAX 16
+
+/**
+ * @brief Scanning each range btree_op_scan_bounds splits a tree into, from
+ * just after the bound before it up to its own, visits every row once.
+ */
+int
+btree_test_scan_bounds(void)
+{
+	char const* db_name = "btree_test_scan_bounds.db";
+	int result = 0;
+	u32 payload[8] = {0};
+	u32 bounds[SCAN_BOUNDS_MAX] = {0};
+	u32 nbounds = 0;
+	u32 prev_key = 0;
+	u32 nrows = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct OpScan op = {0};
+	remove(db_name);
+
+	page_cache_create(&cache, 16);
+	pager_cstd_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 key = 1; key <= SCAN_BOUNDS_ROWS; key++ )
+	{
+		payload[0] = key;
+		if( btree_insert(tree, key, payload, sizeof(payload)) != BTREE_OK )
+			goto end;
+	}
+
+	if( btree_op_scan_bounds(tree, bounds, SCAN_BOUNDS_MAX, &nbounds) !=
+			BTREE_OK ||
+		nbounds != SCAN_BOUNDS_MAX )
+		goto end;
+
+	for( u32 i = 0; i <= nbounds; i++ )
+	{
+		u32 low = i == 0 ? 0 : bounds[i - 1];
+		u32 high = i == nbounds ? SCAN_BOUNDS_ROWS : bounds[i];
+		if( low >= high )
+			goto end;
+
+		btree_op_scan_acquire(tree, &op);
+		if( btree_op_scan_prepare_from(&op, low + 1) != BTREE_OK )
+			goto end;
+
+		while( !btree_op_scan_done(&op) )
+		{
+			u32 key = 0;
+			if( btree_op_scan_key(&op, &key) != BTREE_OK )
+				goto end;
+			if( key > high )
+				break;
+			if( key != prev_key + 1 )
+				goto end;
+
+			prev_key = key;
+			nrows += 1;
+			if( btree_op_scan_next(&op) != BTREE_OK )
+				goto end;
+		}
+		btree_op_scan_release(&op);
+	}
+
+	if( nrows != SCAN_BOUNDS_ROWS )
+		goto end;
+
+	// Past the last key there is nothing to scan.
+	btree_op_scan_acquire(tree, &op);
+	if( btree_op_scan_prepare_from(&op, SCAN_BOUNDS_ROWS + 1) != BTREE_OK ||
+		!btree_op_scan_done(&op) )
+		goto end;
+
+	result = 1;
+end:
+	btree_op_scan_release(&op);
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define FORMAT_V0_KEYS 20
+
+/**
+ * @brief Keys, flags and cells of two nodes match.
+ */
+static bool
+nodes_match(struct BTreeNode* left, struct BTreeNode* right)
+{
+	if( node_num_keys(left) != node_num_keys(right) )
+		return false;
+
+	for( u32 i = 0; i < node_num_keys(left); i++ )
+	{
+		u32 size = btu_get_cell_buffer_size(left, i);
+		if( node_key_at(left, i) != node_key_at(right, i) ||
+			node_flags_at(left, i) != node_flags_at(right, i) ||
+			btu_get_cell_buffer_size(right, i) != size ||
+			memcmp(
+				btu_get_cell_buffer(left, i),
+				btu_get_cell_buffer(right, i),
+				size) != 0 )
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Rewrite a copy of node as it would be laid out in format_version,
+ * which keeps struct BTreePageKeys, V1 after the link.
+ */
+static void
+write_legacy_node(
+	struct BTreeNode* node,
+	struct BTreeNode* legacy,
+	struct Page* legacy_page,
+	u8 format_version,
+	u32 right_sibling)
+{
+	struct BTreePageKey keys[FORMAT_V0_KEYS];
+	u32 num_keys = node->header->num_keys;
+	for( u32 i = 0; i < num_keys; i++ )
+	{
+		keys[i].key = node_key_at(node, i);
+		keys[i].cell_offset = node_cell_offset_at(node, i);
+		keys[i].flags = node_flags_at(node, i);
+	}
+	memcpy(
+		legacy_page->page_buffer,
+		node->page->page_buffer,
+		node->page->page_size);
+
+	struct BTreePageHeader* header =
+		(struct BTreePageHeader*)legacy_page->page_buffer;
+	u32* key_area = (u32*)&header[1];
+	header->format_version = format_version;
+	header->free_heap -=
+		num_keys * (sizeof(struct BTreePageKey) - 2 * sizeof(u32));
+	if( format_version == BTREE_NODE_FORMAT_V0 )
+		header->free_heap += sizeof(u32);
+	else
+		*key_area++ = right_sibling;
+	memcpy(key_area, keys, num_keys * sizeof(struct BTreePageKey));
+
+	btree_node_init_as_page_number(legacy, 2, legacy_page);
+}
+
+/**
+ * @brief A node in format_version reads the same as one written now, and is
+ * converted when it is first modified.
+ */
+static int
+node_format_legacy(u8 format_version)
+{
+	char const* db_name = "btree_test_node_format_v0.db";
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct Page* legacy_page = NULL;
+	struct BTreeNode node = {0};
+	struct BTreeNode legacy = {0};
+	remove(db_name);
+
+	page_cache_create(&cache, 4);
+	pager_cstd_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &page);
+	page_create(pager, &legacy_page);
+	btree_node_init_as_page_number(&node, 2, page);
+
+	// Odd keys, inserted out of order.
+	for( u32 i = 0; i < FORMAT_V0_KEYS; i++ )
+	{
+		u32 key = (i * 7 % FORMAT_V0_KEYS) * 2 + 1;
+		u32 index = 0;
+		btree_node_search_keys_tbl(&node, key, &index);
+
+		struct InsertionIndex insert_index = {.mode = KLIM_INDEX};
+		insert_index.index = index;
+		struct BTreeCellInline cell = {
+			.inline_size = sizeof(key), .payload = (byte*)&key};
+		if( btree_node_insert_inline(&node, &insert_index, key, &cell) !=
+			BTREE_OK )
+			goto end;
+	}
+
+	write_legacy_node(&node, &legacy, legacy_page, format_version, 5);
+	if( legacy.header->format_version != format_version ||
+		!nodes_match(&node, &legacy) )
+		goto end;
+
+	for( u32 key = 0; key <= FORMAT_V0_KEYS * 2 + 1; key++ )
+	{
+		u32 index = 0;
+		u32 legacy_index = 0;
+		enum btree_e found = btree_node_search_keys_tbl(&node, key, &index);
+		if( btree_node_search_keys_tbl(&legacy, key, &legacy_index) != found ||
+			legacy_index != index )
+			goto end;
+	}
+
+	// Removing a key converts it, and gives back the room the keys took.
+	// V0 did not record the sibling.
+	u32 sibling = format_version == BTREE_NODE_FORMAT_V0
+					  ? BTREE_SIBLING_UNKNOWN
+					  : 5;
+	struct ChildListIndex remove_index = {.mode = KLIM_INDEX, .index = 3};
+	u32 removed = 0;
+	struct BTreeCellInline removed_cell = {0};
+	btree_node_remove(&node, &remove_index, &removed_cell, NULL, 0);
+	btree_node_remove(
+		&legacy, &remove_index, &removed_cell, &removed, sizeof(removed));
+	if( legacy.header->format_version != BTREE_NODE_FORMAT_CURRENT ||
+		legacy.header->free_heap != node.header->free_heap || removed != 7 ||
+		node_right_sibling(&legacy) != sibling ||
+		!nodes_match(&node, &legacy) )
+		goto end;
+
+	result = 1;
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( legacy_page )
+		page_destroy(pager, legacy_page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+/**
+ * @brief Nodes written in BTREE_NODE_FORMAT_V0 and BTREE_NODE_FORMAT_V1 read
+ * the same as ones written now.
+ */
+int
+btree_test_node_format_v0(void)
+{
+	return node_format_legacy(BTREE_NODE_FORMAT_V0) &&
+		   node_format_legacy(BTREE_NODE_FORMAT_V1);
+}
+
+#define BASELINE_LEAVES 4
+#define BASELINE_LEAF_ROWS 150
+#define BASELINE_ROWS (BASELINE_LEAVES * BASELINE_LEAF_ROWS)
+
+/**
+ * @brief Lay out a table node in buffer byte for byte as the original format
+ * did, at fixed offsets rather than through struct BTreePageHeader: is_leaf,
+ * is_root, two bytes of padding, free_heap, num_keys, right_child and
+ * cell_high_water_offset, then a 12-byte key, cell offset and flags per key.
+ * Each key's cell is a u32 value, written below the end of the node in key
+ * order.
+ */
+static void
+write_baseline_node(
+	byte* buffer,
+	u32 size,
+	bool is_leaf,
+	u32 right_child,
+	u32 const* keys,
+	u32 const* values,
+	u32 num_keys)
+{
+	u32 cell_size = 2 * sizeof(u32);
+	u32 high_water = 0;
+
+	memset(buffer, 0x00, size);
+	buffer[0] = is_leaf;
+	for( u32 i = 0; i < num_keys; i++ )
+	{
+		high_water += cell_size;
+		byte* cell = buffer + size - high_water;
+		ser_write_32bit_le(cell, sizeof(u32));
+		ser_write_32bit_le(cell + sizeof(u32), values[i]);
+
+		byte* key = buffer + 20 + i * 12;
+		ser_write_32bit_le(key, keys[i]);
+		ser_write_32bit_le(key + 4, high_water);
+		ser_write_32bit_le(key + 8, 1);
+	}
+
+	ser_write_32bit_le(buffer + 4, size - 20 - num_keys * (12 + cell_size));
+	ser_write_32bit_le(buffer + 8, num_keys);
+	ser_write_32bit_le(buffer + 12, right_child);
+	ser_write_32bit_le(buffer + 16, high_water);
+}
+
+/**
+ * @brief The key after key that baseline_rows_match expects; every step-th
+ * key, less multiples of skip if it is not 0.
+ */
+static u32
+baseline_next_key(u32 key, u32 step, u32 skip)
+{
+	do
+		key += step;
+	while( skip && key % skip == 0 );
+
+	return key;
+}
+
+/**
+ * @brief Every expected row is found, the rest are not, and a scan sees
+ * exactly the expected ones in order. Rows hold their key times 3.
+ */
+static bool
+baseline_rows_match(struct BTree* tree, u32 max_key, u32 step, u32 skip)
+{
+	struct OpScan op = {0};
+	u32 value = 0;
+	bool matched = false;
+
+	for( u32 key = 1; key <= max_key; key++ )
+	{
+		bool expected = key % step == 0 && (!skip || key % skip != 0);
+		enum btree_e found = btree_select_ex(tree, key, &value, sizeof(value));
+		if( expected ? found != BTREE_OK || value != key * 3
+					 : found != BTREE_ERR_KEY_NOT_FOUND )
+			return false;
+	}
+
+	btree_op_scan_acquire(tree, &op);
+	if( btree_op_scan_prepare(&op) != BTREE_OK )
+		goto end;
+
+	u32 next_key = baseline_next_key(0, step, skip);
+	while( !btree_op_scan_done(&op) )
+	{
+		u32 key = 0;
+		if( btree_op_scan_key(&op, &key) != BTREE_OK ||
+			btree_op_scan_current(&op, &value, sizeof(value)) != BTREE_OK ||
+			key != next_key || value != key * 3 )
+			goto end;
+
+		next_key = baseline_next_key(key, step, skip);
+		if( btree_op_scan_next(&op) != BTREE_OK )
+			goto end;
+	}
+
+	matched = next_key > max_key;
+end:
+	btree_op_scan_release(&op);
+	return matched;
+}
+
+/**
+ * @brief A tree written in the original node format, before versions and
+ * sibling links, is searched, inserted into, deleted from and scanned.
+ */
+int
+btree_test_baseline_pages(void)
+{
+	char const* db_name = "btree_test_baseline_pages.db";
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	u32 keys[BASELINE_LEAF_ROWS];
+	u32 values[BASELINE_LEAF_ROWS];
+	remove(db_name);
+
+	page_cache_create(&cache, 16);
+	pager_cstd_create(&pager, cache, db_name, 0x1000);
+	if( page_create(pager, &page) != PAGER_OK )
+		goto end;
+
+	// The root on page 1, after the file header, then the leaves. Each
+	// interior key is the highest key of the child its cell points to.
+	for( u32 page_id = 1; page_id <= BASELINE_LEAVES + 1; page_id++ )
+	{
+		if( page_id == 1 )
+		{
+			for( u32 i = 0; i < BASELINE_LEAVES - 1; i++ )
+			{
+				keys[i] = (i + 1) * BASELINE_LEAF_ROWS * 2;
+				values[i] = i + 2;
+			}
+			write_baseline_node(
+				(byte*)page->page_buffer + BTREE_HEADER_SIZE,
+				pager->page_size - BTREE_HEADER_SIZE,
+				false,
+				BASELINE_LEAVES + 1,
+				keys,
+				values,
+				BASELINE_LEAVES - 1);
+		}
+		else
+		{
+			for( u32 i = 0; i < BASELINE_LEAF_ROWS; i++ )
+			{
+				keys[i] = ((page_id - 2) * BASELINE_LEAF_ROWS + i + 1) * 2;
+				values[i] = keys[i] * 3;
+			}
+			write_baseline_node(
+				(byte*)page->page_buffer,
+				pager->page_size,
+				true,
+				0,
+				keys,
+				values,
+				BASELINE_LEAF_ROWS);
+		}
+
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		if( pager_write_page(pager, page) != PAGER_OK ||
+			page->page_id != page_id )
+			goto end;
+	}
+
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	if( !baseline_rows_match(tree, BASELINE_ROWS * 2, 2, 0) )
+		goto end;
+
+	// The odd keys in between split every leaf, converting it first.
+	for( u32 key = 1; key < BASELINE_ROWS * 2; key += 2 )
+	{
+		u32 value = key * 3;
+		if( btree_insert(tree, key, &value, sizeof(value)) != BTREE_OK )
+			goto end;
+	}
+
+	if( !baseline_rows_match(tree, BASELINE_ROWS * 2, 1, 0) )
+		goto end;
+
+	for( u32 key = 3; key <= BASELINE_ROWS * 2; key += 3 )
+	{
+		if( btree_delete(tree, key) != BTREE_OK )
+			goto end;
+	}
+
+	if( !baseline_rows_match(tree, BASELINE_ROWS * 2, 1, 3) )
+		goto end;
+
+	result = 1;
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define CONCURRENT_WRITERS 4
+#define CONCURRENT_READERS 2
+#define CONCURRENT_ROWS 600
+
+struct ConcurrentWorker
+{
+	struct BTree* tree;
+	u32 index;
+	int ok;
+};
+
+static u32
+concurrent_payload_size(u32 key)
+{
+	// Every so often a row big enough to need overflow pages.
+	return key % 37 == 0 ? sizeof(u32) * 400 : sizeof(u32) * 4;
+}
+
+static void*
+concurrent_writer(void* arg)
+{
+	struct ConcurrentWorker* worker = (struct ConcurrentWorker*)arg;
+	u32 payload[400] = {0};
+
+	worker->ok = 1;
+	for( u32 i = 0; i < CONCURRENT_ROWS / CONCURRENT_WRITERS; i++ )
+	{
+		// Writers interleave, so they split the same leaves.
+		u32 key = i * CONCURRENT_WRITERS + worker->index + 1;
+		u32 size = concurrent_payload_size(key);
+		payload[0] = key;
+		payload[size / sizeof(u32) - 1] = key;
+		if( btree_insert(worker->tree, key, payload, size) != BTREE_OK )
+			worker->ok = 0;
+	}
+
+	return NULL;
+}
+
+static void*
+concurrent_reader(void* arg)
+{
+	struct ConcurrentWorker* worker = (struct ConcurrentWorker*)arg;
+	u32 read[400] = {0};
+	u32 state = worker->index + 1;
+
+	worker->ok = 1;
+	for( u32 i = 0; i < CONCURRENT_ROWS * 2; i++ )
+	{
+		u32 key = state % CONCURRENT_ROWS + 1;
+		state = state * 1103515245u + 12345u;
+
+		// Not every key is in yet; those that are must be whole.
+		memset(read, 0x00, sizeof(read));
+		enum btree_e found = BTREE_OK;
+		if( worker->index % 2 == 0 )
+		{
+			found = btree_select_ex(worker->tree, key, read, sizeof(read));
+		}
+		else
+		{
+			// The select op's cursor may lose its row between prepare and
+			// commit.
+			struct OpSelection op = {0};
+			btree_op_select_acquire_tbl(worker->tree, &op, key, NULL);
+			found = btree_op_select_prepare(&op);
+			if( found == BTREE_OK )
+				found = btree_op_select_commit(&op, read, sizeof(read));
+			btree_op_select_release(&op);
+		}
+		if( found == BTREE_OK )
+		{
+			if( read[0] != key ||
+				read[concurrent_payload_size(key) / sizeof(u32) - 1] != key )
+				worker->ok = 0;
+		}
+		else if( found != BTREE_ERR_KEY_NOT_FOUND )
+		{
+			worker->ok = 0;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Writers insert interleaved keys into one tree while readers look
+ * keys up without latching; every insert must land and no read may see a
+ * torn row.
+ */
+int
+btree_test_concurrent(void)
+{
+	char const* db_name = "btree_test_concurrent.db";
+	int result = 0;
+	u32 read[400] = {0};
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct ConcurrentWorker workers[CONCURRENT_WRITERS + CONCURRENT_READERS];
+	bt_thread threads[CONCURRENT_WRITERS + CONCURRENT_READERS];
+	u32 nthreads = 0;
+	remove(db_name);
+
+	// Small pages and cache, so inserts split and pages get evicted.
+	page_cache_create(&cache, 8);
+	pager_posix_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( ; nthreads < CONCURRENT_WRITERS + CONCURRENT_READERS; nthreads++ )
+	{
+		struct ConcurrentWorker* worker = &workers[nthreads];
+		worker->tree = tree;
+		worker->index = nthreads;
+		worker->ok = 0;
+		if( bt_thread_create(
+				&threads[nthreads],
+				nthreads < CONCURRENT_WRITERS ? &concurrent_writer
+											  : &concurrent_reader,
+				worker) != 0 )
+			break;
+	}
+
+	for( u32 i = 0; i < nthreads; i++ )
+		bt_thread_join(threads[i]);
+
+	if( nthreads != CONCURRENT_WRITERS + CONCURRENT_READERS )
+		goto end;
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		if( !workers[i].ok )
+			goto end;
+	}
+
+	for( u32 key = 1; key <= CONCURRENT_ROWS; key++ )
+	{
+		if( btree_select_ex(tree, key, read, sizeof(read)) != BTREE_OK ||
+			read[0] != key ||
+			read[concurrent_payload_size(key) / sizeof(u32) - 1] != key )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define MIXED_INSERTERS 2
+#define MIXED_SCANNERS 2
+#define MIXED_ROWS 900
+
+struct MixedWorker
+{
+	struct BTree* tree;
+	u32 index;
+	// Inserters and the deleter still running; the others stop with them.
+	unsigned int volatile* writers_left;
+	int ok;
+};
+
+/**
+ * @brief Rows with key % 3 == 1 are there throughout, those with 0 are
+ * deleted and those with 2 inserted while the test runs.
+ */
+static void
+mixed_row(u32 key, u32* payload, u32* size)
+{
+	*size = concurrent_payload_size(key);
+	payload[0] = key;
+	payload[*size / sizeof(u32) - 1] = key;
+}
+
+static void*
+mixed_inserter(void* arg)
+{
+	struct MixedWorker* worker = (struct MixedWorker*)arg;
+	u32 payload[400] = {0};
+	u32 size = 0;
+
+	worker->ok = 1;
+	for( u32 key = 2 + worker->index * 3; key <= MIXED_ROWS;
+		 key += 3 * MIXED_INSERTERS )
+	{
+		mixed_row(key, payload, &size);
+		if( btree_insert(worker->tree, key, payload, size) != BTREE_OK )
+			worker->ok = 0;
+	}
+
+	bt_atomic_add(worker->writers_left, (unsigned int)-1);
+	return NULL;
+}
+
+static void*
+mixed_deleter(void* arg)
+{
+	struct MixedWorker* worker = (struct MixedWorker*)arg;
+
+	// Every other one first, so leaves thin out everywhere before any
+	// empties.
+	worker->ok = 1;
+	for( u32 pass = 0; pass < 2; pass++ )
+	{
+		for( u32 key = 3 + pass * 3; key <= MIXED_ROWS; key += 6 )
+		{
+			if( btree_delete(worker->tree, key) != BTREE_OK )
+				worker->ok = 0;
+		}
+	}
+
+	bt_atomic_add(worker->writers_left, (unsigned int)-1);
+	return NULL;
+}
+
+/**
+ * @brief Scan the tree with a latched scan until the writers are done.
+ * Keys must come in order and whole, and none of the rows that stay may be
+ * missed.
+ */
+static void*
+mixed_scanner(void* arg)
+{
+	struct MixedWorker* worker = (struct MixedWorker*)arg;
+	u32 read[400] = {0};
+
+	worker->ok = 1;
+	do
+	{
+		struct OpScan op = {0};
+		u32 last_key = 0;
+		u32 nstable = 0;
+		enum btree_e result = btree_op_scan_acquire_shared(worker->tree, &op);
+		if( result == BTREE_OK )
+			result = btree_op_scan_prepare(&op);
+		while( result == BTREE_OK && !btree_op_scan_done(&op) )
+		{
+			u32 key = 0;
+			memset(read, 0x00, sizeof(read));
+			result = btree_op_scan_key(&op, &key);
+			if( result == BTREE_OK )
+				result = btree_op_scan_current(&op, read, sizeof(read));
+			if( result != BTREE_OK || key <= last_key || read[0] != key ||
+				read[concurrent_payload_size(key) / sizeof(u32) - 1] != key )
+				worker->ok = 0;
+
+			nstable += key % 3 == 1 ? 1 : 0;
+			last_key = key;
+			result = btree_op_scan_next(&op);
+		}
+		btree_op_scan_release(&op);
+
+		if( result != BTREE_OK || nstable != (MIXED_ROWS + 2) / 3 )
+			worker->ok = 0;
+	} while( bt_atomic_load(worker->writers_left) != 0 && worker->ok );
+
+	return NULL;
+}
+
+static void*
+mixed_flusher(void* arg)
+{
+	struct MixedWorker* worker = (struct MixedWorker*)arg;
+
+	worker->ok = 1;
+	while( bt_atomic_load(worker->writers_left) != 0 )
+	{
+		if( pager_flush(worker->tree->pager) != PAGER_OK )
+			worker->ok = 0;
+		bt_thread_yield();
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Inserts, deletes, latched scans and flushes on one tree at once.
+ * Scans see every row that stays, in order; afterwards the tree holds
+ * exactly the rows it should, and so does the file it was flushed to.
+ */
+int
+btree_test_concurrent_mixed(void)
+{
+	char const* db_name = "btree_test_concurrent_mixed.db";
+	u32 const nworkers = MIXED_INSERTERS + 1 + MIXED_SCANNERS + 1;
+	int result = 0;
+	u32 payload[400] = {0};
+	u32 read[400] = {0};
+	u32 size = 0;
+	unsigned int volatile writers_left = MIXED_INSERTERS + 1;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct MixedWorker workers[MIXED_INSERTERS + 1 + MIXED_SCANNERS + 1];
+	bt_thread threads[MIXED_INSERTERS + 1 + MIXED_SCANNERS + 1];
+	u32 nthreads = 0;
+	remove(db_name);
+
+	// Small pages and cache, so leaves split, merge and get evicted.
+	page_cache_create(&cache, 8);
+	pager_posix_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 key = 1; key <= MIXED_ROWS; key++ )
+	{
+		if( key % 3 == 2 )
+			continue;
+
+		mixed_row(key, payload, &size);
+		if( btree_insert(tree, key, payload, size) != BTREE_OK )
+			goto end;
+	}
+
+	for( ; nthreads < nworkers; nthreads++ )
+	{
+		struct MixedWorker* worker = &workers[nthreads];
+		void* (*run)(void*) = &mixed_scanner;
+		if( nthreads < MIXED_INSERTERS )
+			run = &mixed_inserter;
+		else if( nthreads == MIXED_INSERTERS )
+			run = &mixed_deleter;
+		else if( nthreads == nworkers - 1 )
+			run = &mixed_flusher;
+
+		worker->tree = tree;
+		worker->index = nthreads;
+		worker->writers_left = &writers_left;
+		worker->ok = 0;
+		if( bt_thread_create(&threads[nthreads], run, worker) != 0 )
+			break;
+	}
+
+	for( u32 i = 0; i < nthreads; i++ )
+		bt_thread_join(threads[i]);
+
+	if( nthreads != nworkers )
+		goto end;
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		if( !workers[i].ok )
+			goto end;
+	}
+
+	// Read back from the file too.
+	if( pager_flush(pager) != PAGER_OK )
+		goto end;
+	btree_dealloc(tree);
+	tree = NULL;
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_create(&cache, 8);
+	pager_posix_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( btree_init(tree, pager, &rcer, 1) != BTREE_OK )
+		goto end;
+
+	for( u32 key = 1; key <= MIXED_ROWS; key++ )
+	{
+		enum btree_e found = btree_select_ex(tree, key, read, sizeof(read));
+		if( key % 3 == 0 ? found != BTREE_ERR_KEY_NOT_FOUND
+						 : found != BTREE_OK || read[0] != key )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
@@ -8,6 +8,15 @@ int btree_test_delete(void);
 int btree_test_free_heap_calcs(void);
 int btree_test_deep_tree(void);
 int btree_test_freelist(void);
+int btree_test_wal_reopen(void);
+int btree_test_shadow_reopen(void);
+int btree_test_snapshot_scan(void);
+int btree_test_leaf_links(void);
+int btree_test_scan_bounds(void);
+int btree_test_node_format_v0(void);
+int btree_test_baseline_pages(void);
+int btree_test_concurrent(void);
+int btree_test_concurrent_mixed(void);
 
 int bta_rebalance_root_nofit(void);
 int bta_rebalance_root_fit(void);
@@ -1,5 +1,6 @@
 #include "btree_utils.h"
 
+#include "btree_node.h"
 #include "serialization.h"
 
 #include <string.h>
@@ -29,7 +30,7 @@ void
 btu_read_cell(struct BTreeNode* node, int index, struct CellData* cell)
 {
 	memset(cell, 0x00, sizeof(struct CellData));
-	int offset = node->keys[index].cell_offset;
+	int offset = node_cell_offset_at(node, index);
 
 	byte* cell_buffer = btu_calc_highwater_offset(node, offset);
 	// btu_get_node_buffer(node) + btu_get_node_size(node) - offset;
@@ -77,7 +78,7 @@ btu_calc_highwater_offset(struct BTreeNode* node, int highwater)
 byte*
 btu_get_cell_buffer(struct BTreeNode* node, int index)
 {
-	u32 offset = node->keys[index].cell_offset;
+	u32 offset = node_cell_offset_at(node, index);
 
 	byte* cell_buffer = btu_calc_highwater_offset(node, offset);
 
@@ -106,11 +107,7 @@ btu_get_cell_buffer_size(struct BTreeNode* node, int index)
 u32
 btu_get_cell_flags(struct BTreeNode* node, int index)
 {
-	// TODO: This is here for debug.
-	struct BTreePageKey key = node->keys[index];
-	u32 flags = key.flags;
-
-	return flags;
+	return node_flags_at(node, index);
 }
 
 /**
@@ -126,38 +123,36 @@ btu_calc_cell_size(int size)
  * See header for details.
  */
 int
-btu_binary_search_keys(
-	struct BTreePageKey* arr, unsigned char num_keys, int key, char* found)
+btu_binary_search_keys(u32 const* keys, u32 num_keys, u32 key, char* found)
+{
+	u32 index = btu_lower_bound_keys(keys, num_keys, key);
+
+	*found = index < num_keys && keys[index] == key;
+	return index;
+}
+
+/**
+ * See header for details.
+ */
+u32
+btu_lower_bound_keys(u32 const* keys, u32 num_keys, u32 key)
 {
-	int left = 0;
-	int right = num_keys - 1;
-	int mid = 0;
-	u32 mid_key = 0;
-	*found = 0;
+	u32 const* base = keys;
+	u32 size = num_keys;
+
+	if( size == 0 )
+		return 0;
 
-	while( left <= right )
+	// The answer is in [base, base + size]; each step halves size and moves
+	// base past the lower half if its last key is too small.
+	while( size > 1 )
 	{
-		mid = (right - left) / 2 + left;
-		mid_key = arr[mid].key;
-
-		// TODO: Key compare function.
-		if( mid_key == key )
-		{
-			if( found )
-				*found = 1;
-			return mid;
-		}
-		else if( mid_key < key )
-		{
-			left = mid + 1;
-		}
-		else
-		{
-			right = mid - 1;
-		}
+		u32 half = size / 2;
+		base = base[half - 1] < key ? base + half : base;
+		size -= half;
 	}
 
-	return left;
+	return (u32)(base - keys) + (*base < key);
 }
 
 void
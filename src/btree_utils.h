@@ -78,14 +78,24 @@ int btu_calc_cell_size(int size);
  * [1, 2, 5]
  * search(3) => index 2 i.e. The index of 5.
  *
- * @param arr
+ * @param keys A sorted key column, as in a BTREE_NODE_FORMAT_V2 node.
  * @param num_keys
  * @param key
  * @param found 1 if the value was found. 0 otherwise.
  * @return int
  */
-int btu_binary_search_keys(
-	struct BTreePageKey* arr, unsigned char num_keys, int key, char* found);
+int
+btu_binary_search_keys(u32 const* keys, u32 num_keys, u32 key, char* found);
+
+/**
+ * @brief Index of the first key not less than key, or num_keys if there is
+ * none; the search table trees use instead of the tree's compare function.
+ *
+ * Branch free: every probe is a conditional move, so the probes don't
+ * mispredict on random keys and the loop runs log2(num_keys) times whatever
+ * the key.
+ */
+u32 btu_lower_bound_keys(u32 const* keys, u32 num_keys, u32 key);
 
 /**
  * @brief Converts an index key to the approprate ListIndex for breadcrumbs.
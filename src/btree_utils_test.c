@@ -8,11 +8,11 @@ btree_utils_test_bin_search_keys(void)
 	int result = 1;
 	int index;
 
-	struct BTreePageKey arr[10];
+	u32 arr[10];
 	unsigned int arr_size = sizeof(arr) / sizeof(arr[0]);
 	for( int i = 0; i < arr_size; i++ )
 	{
-		arr[i].key = i * 2;
+		arr[i] = i * 2;
 	}
 
 	char found = 0;
@@ -49,4 +49,39 @@ btree_utils_test_bin_search_keys(void)
 end:
 
 	return result;
+}
+
+#define LOWER_BOUND_KEYS_MAX 300
+
+/**
+ * @brief btu_lower_bound_keys against a linear search, for every key count up
+ * to past what an unsigned char holds and every key around those present.
+ */
+int
+btree_utils_test_lower_bound_keys(void)
+{
+	u32 arr[LOWER_BOUND_KEYS_MAX];
+	for( u32 i = 0; i < LOWER_BOUND_KEYS_MAX; i++ )
+		arr[i] = i * 2 + 1;
+
+	for( u32 num_keys = 0; num_keys <= LOWER_BOUND_KEYS_MAX; num_keys++ )
+	{
+		for( u32 key = 0; key <= num_keys * 2 + 1; key++ )
+		{
+			u32 expected = 0;
+			while( expected < num_keys && arr[expected] < key )
+				expected++;
+
+			if( btu_lower_bound_keys(arr, num_keys, key) != expected )
+				return 0;
+
+			char found = 0;
+			if( btu_binary_search_keys(arr, num_keys, key, &found) !=
+					expected ||
+				found != (key % 2 == 1 && expected < num_keys) )
+				return 0;
+		}
+	}
+
+	return 1;
 }
\ No newline at end of file
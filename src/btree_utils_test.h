@@ -2,5 +2,6 @@
 #define BTREE_UTILS_TEST_H_
 
 int btree_utils_test_bin_search_keys(void);
+int btree_utils_test_lower_bound_keys(void);
 
 #endif
\ No newline at end of file
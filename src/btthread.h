@@ -0,0 +1,303 @@
+#ifndef BTTHREAD_H_
+#define BTTHREAD_H_
+
+/**
+ * @brief Minimal mutex, condition variable and thread wrappers over pthreads
+ * or the Win32 equivalents.
+ *
+ * bt_rmutex is a mutex the holder may lock again; it is unlocked once each
+ * lock has been matched by an unlock.
+ *
+ * bt_atomic_load and bt_atomic_add are sequentially consistent;
+ * bt_atomic_add returns the new value.
+ *
+ * bt_thread_local declares a static with one instance per thread.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef SRWLOCK bt_mutex;
+typedef CRITICAL_SECTION bt_rmutex;
+typedef CONDITION_VARIABLE bt_cond;
+typedef HANDLE bt_thread;
+
+#define bt_thread_local __declspec(thread)
+
+static inline void
+bt_mutex_init(bt_mutex* mutex)
+{
+	InitializeSRWLock(mutex);
+}
+
+static inline void
+bt_mutex_destroy(bt_mutex* mutex)
+{}
+
+static inline void
+bt_mutex_lock(bt_mutex* mutex)
+{
+	AcquireSRWLockExclusive(mutex);
+}
+
+static inline void
+bt_mutex_unlock(bt_mutex* mutex)
+{
+	ReleaseSRWLockExclusive(mutex);
+}
+
+static inline void
+bt_rmutex_init(bt_rmutex* mutex)
+{
+	InitializeCriticalSection(mutex);
+}
+
+static inline void
+bt_rmutex_destroy(bt_rmutex* mutex)
+{
+	DeleteCriticalSection(mutex);
+}
+
+static inline void
+bt_rmutex_lock(bt_rmutex* mutex)
+{
+	EnterCriticalSection(mutex);
+}
+
+static inline void
+bt_rmutex_unlock(bt_rmutex* mutex)
+{
+	LeaveCriticalSection(mutex);
+}
+
+static inline unsigned int
+bt_atomic_load(unsigned int volatile* value)
+{
+	return (unsigned int)InterlockedCompareExchange(
+		(LONG volatile*)value, 0, 0);
+}
+
+static inline unsigned int
+bt_atomic_add(unsigned int volatile* value, unsigned int add)
+{
+	return (unsigned int)InterlockedExchangeAdd(
+			   (LONG volatile*)value, (LONG)add) +
+		   add;
+}
+
+static inline void
+bt_thread_yield(void)
+{
+	SwitchToThread();
+}
+
+static inline void
+bt_cond_init(bt_cond* cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+static inline void
+bt_cond_destroy(bt_cond* cond)
+{}
+
+static inline void
+bt_cond_wait(bt_cond* cond, bt_mutex* mutex)
+{
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+/**
+ * @brief bt_cond_wait that gives up after ms milliseconds.
+ */
+static inline void
+bt_cond_timedwait(bt_cond* cond, bt_mutex* mutex, unsigned int ms)
+{
+	SleepConditionVariableSRW(cond, mutex, ms, 0);
+}
+
+static inline void
+bt_cond_broadcast(bt_cond* cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+struct BtThreadStart
+{
+	void* (*fn)(void*);
+	void* arg;
+};
+
+static inline DWORD WINAPI
+bt_thread_trampoline(LPVOID param)
+{
+	struct BtThreadStart start = *(struct BtThreadStart*)param;
+	HeapFree(GetProcessHeap(), 0, param);
+	start.fn(start.arg);
+	return 0;
+}
+
+static inline int
+bt_thread_create(bt_thread* thread, void* (*fn)(void*), void* arg)
+{
+	struct BtThreadStart* start = (struct BtThreadStart*)HeapAlloc(
+		GetProcessHeap(), 0, sizeof(struct BtThreadStart));
+	if( !start )
+		return -1;
+
+	start->fn = fn;
+	start->arg = arg;
+	*thread = CreateThread(NULL, 0, bt_thread_trampoline, start, 0, NULL);
+	if( *thread == NULL )
+	{
+		HeapFree(GetProcessHeap(), 0, start);
+		return -1;
+	}
+
+	return 0;
+}
+
+static inline void
+bt_thread_join(bt_thread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+typedef pthread_mutex_t bt_mutex;
+typedef pthread_mutex_t bt_rmutex;
+typedef pthread_cond_t bt_cond;
+typedef pthread_t bt_thread;
+
+#define bt_thread_local __thread
+
+static inline void
+bt_mutex_init(bt_mutex* mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+static inline void
+bt_mutex_destroy(bt_mutex* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+static inline void
+bt_mutex_lock(bt_mutex* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+static inline void
+bt_mutex_unlock(bt_mutex* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+static inline void
+bt_rmutex_init(bt_rmutex* mutex)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static inline void
+bt_rmutex_destroy(bt_rmutex* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+static inline void
+bt_rmutex_lock(bt_rmutex* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+static inline void
+bt_rmutex_unlock(bt_rmutex* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+static inline unsigned int
+bt_atomic_load(unsigned int volatile* value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline unsigned int
+bt_atomic_add(unsigned int volatile* value, unsigned int add)
+{
+	return __atomic_add_fetch(value, add, __ATOMIC_SEQ_CST);
+}
+
+static inline void
+bt_thread_yield(void)
+{
+	sched_yield();
+}
+
+static inline void
+bt_cond_init(bt_cond* cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+static inline void
+bt_cond_destroy(bt_cond* cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+static inline void
+bt_cond_wait(bt_cond* cond, bt_mutex* mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+static inline void
+bt_cond_timedwait(bt_cond* cond, bt_mutex* mutex, unsigned int ms)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (long)(ms % 1000) * 1000000;
+	if( deadline.tv_nsec >= 1000000000 )
+	{
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_cond_timedwait(cond, mutex, &deadline);
+}
+
+static inline void
+bt_cond_broadcast(bt_cond* cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+static inline int
+bt_thread_create(bt_thread* thread, void* (*fn)(void*), void* arg)
+{
+	return pthread_create(thread, NULL, fn, arg);
+}
+
+static inline void
+bt_thread_join(bt_thread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+#endif
+
+#endif
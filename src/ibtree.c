@@ -36,6 +36,7 @@ ibtree_init(
 	tree->compare = compare;
 	tree->reset_compare = reset_compare;
 	tree->keyof = &ibtree_keyof;
+	tree->bytewise = compare == &ibtree_compare;
 	return result;
 }
 
@@ -108,9 +109,8 @@ ibtree_keyof(
 	u32* out_total_size,
 	u32* out_follow_page)
 {
-	struct BTreePageKey* key = &node->keys[index];
-	bool is_overflow =
-		btree_pkey_is_cell_type(key->flags, PKEY_FLAG_CELL_TYPE_OVERFLOW);
+	bool is_overflow = btree_pkey_is_cell_type(
+		node_flags_at(node, index), PKEY_FLAG_CELL_TYPE_OVERFLOW);
 
 	byte* cell_data = btu_get_cell_buffer(node, index);
 	u32 cell_data_size = btu_get_cell_buffer_size(node, index);
@@ -139,9 +139,12 @@ ibtree_keyof(
 		struct BTreeCellInline cell = {0};
 		btree_cell_read_inline(cell_data, cell_data_size, &cell, NULL, 0, NULL);
 
+		// Prefixed cells hold what follows the node's prefix, which
+		// btree_node_compare_cell compares first.
 		payload = (byte*)cell.payload;
 		*out_size = cell.inline_size;
-		*out_total_size = cell.inline_size;
+		*out_total_size =
+			cell.inline_size + btree_node_prefix_size_at(node, index);
 	}
 
 	return payload;
@@ -179,6 +182,7 @@ ibtree_insert_ex(
 	enum btree_e result = BTREE_OK;
 	char found;
 	struct Cursor* cursor = cursor_create_ex(tree, cmp_ctx);
+	cursor_set_latch(cursor, CURSOR_LATCH_INSERT);
 
 	result = cursor_traverse_to_ex(cursor, payload, payload_size, &found);
 	if( result != BTREE_OK )
@@ -318,6 +322,7 @@ ibtree_delete_ex(struct BTree* tree, void* key, int key_size, void* cmp_ctx)
 {
 	enum btree_e result = BTREE_OK;
 	struct Cursor* cursor = cursor_create_ex(tree, cmp_ctx);
+	cursor_set_latch(cursor, CURSOR_LATCH_DELETE);
 
 	result = delete_single(cursor, key, key_size);
 	// If the leaf node underflows, then we need to rebalance.
@@ -350,29 +355,46 @@ ibtree_select_ex(
 	char found;
 	struct NodeView nv = {0};
 	struct Cursor* cursor = cursor_create_ex(tree, cmp_ctx);
+	cursor_set_latch(cursor, CURSOR_LATCH_OPTIMISTIC);
 
 	result = noderc_acquire(cursor_rcer(cursor), &nv);
 	if( result != BTREE_OK )
 		goto end;
 
-	result = cursor_traverse_to_ex(cursor, key, key_size, &found);
-	if( result != BTREE_OK )
-		goto end;
-
-	if( !found )
+	do
 	{
-		result = BTREE_ERR_KEY_NOT_FOUND;
-		goto end;
-	}
+		result = cursor_traverse_to_ex(cursor, key, key_size, &found);
+		if( result != BTREE_OK )
+			goto end;
 
-	result = cursor_read_current(cursor, &nv);
-	if( result != BTREE_OK )
-		goto end;
+		if( !found )
+		{
+			result = BTREE_ERR_KEY_NOT_FOUND;
+			goto end;
+		}
+
+		result = cursor_read_current(cursor, &nv);
+		if( cursor_validate(cursor) != BTREE_OK )
+			result = BTREE_ERR_CONFLICT;
+		if( result == BTREE_OK )
+		{
+			assert(
+				cursor->current_key_index.index !=
+				node_num_keys(nv_node(&nv)));
+
+			// Overflow pages are only freed under the leaf's latch, so
+			// the leaf's version covers them too.
+			u32 ind = cursor->current_key_index.index;
+			result = btree_node_read_at(
+				tree, nv_node(&nv), ind, buffer, buffer_size);
+			if( cursor_validate(cursor) != BTREE_OK )
+				result = BTREE_ERR_CONFLICT;
+		}
 
-	assert(cursor->current_key_index.index != node_num_keys(nv_node(&nv)));
+		if( result == BTREE_ERR_CONFLICT )
+			cursor_reset(cursor);
+	} while( result == BTREE_ERR_CONFLICT );
 
-	u32 ind = cursor->current_key_index.index;
-	result = btree_node_read_at(tree, nv_node(&nv), ind, buffer, buffer_size);
 	if( result != BTREE_OK )
 		goto end;
 
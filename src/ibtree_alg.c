@@ -14,6 +14,7 @@
 #include "serialization.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +24,59 @@ struct split_node_t
 	unsigned int left_child_index;
 };
 
+/**
+ * @brief Bytes of the key at index, or UINT_MAX if it spills to overflow
+ * pages, so that any key kept in the node is preferred.
+ */
+static u32
+split_key_cost(struct BTreeNode* node, u32 index)
+{
+	if( !btree_pkey_is_cell_type(
+			node_flags_at(node, index), PKEY_FLAG_CELL_TYPE_INLINE) )
+		return UINT_MAX;
+
+	return btu_get_cell_buffer_size(node, index) +
+		   btree_node_prefix_size_at(node, index);
+}
+
+/**
+ * @brief The index of the key that goes up to the parent when node splits.
+ *
+ * Index keys are whole entries, so the promoted key cannot be cut short.
+ * Instead, the shortest key within an eighth of the keys of the middle is
+ * promoted, the one nearest the middle on a tie. Parents then hold short keys
+ * wherever the keys' sizes vary, and long keys only when every candidate is.
+ */
+static u32
+split_index(struct BTreeNode* node)
+{
+	u32 num_keys = node_num_keys(node);
+	u32 middle = (num_keys + 1) / 2 - 1;
+	u32 spread = num_keys / 8;
+
+	u32 best = middle;
+	u32 best_cost = split_key_cost(node, middle);
+	for( u32 d = 1; d <= spread; d++ )
+	{
+		u32 candidates[] = {middle - d, middle + d};
+		for( u32 c = 0; c < 2; c++ )
+		{
+			u32 index = candidates[c];
+			if( index >= num_keys )
+				continue;
+
+			u32 cost = split_key_cost(node, index);
+			if( cost < best_cost )
+			{
+				best = index;
+				best_cost = cost;
+			}
+		}
+	}
+
+	return best;
+}
+
 static enum btree_e
 split_node(
 	struct BTreeNode* source_node,
@@ -36,31 +90,38 @@ split_node(
 	if( source_node->header->num_keys == 0 )
 		return BTREE_OK;
 
-	int first_half = ((source_node->header->num_keys + 1) / 2);
+	u32 promoted = split_index(source_node);
+
+	split_result->left_child_index = promoted;
 
-	split_result->left_child_index = first_half - 1;
+	// Both halves start with the source's prefix so that its cells keep
+	// their size and are sure to fit.
+	enum btree_e result = BTREE_OK;
+	byte* prefix = btree_node_prefix(source_node);
+	u32 prefix_size = source_node->header->prefix_size;
+	result = btree_node_prefix_init(left, prefix, prefix_size);
+	if( result != BTREE_OK )
+		return result;
+
+	result = btree_node_prefix_init(right, prefix, prefix_size);
+	if( result != BTREE_OK )
+		return result;
 
-	for( int i = 0; i < first_half - 1; i++ )
+	for( u32 i = 0; i < promoted; i++ )
 	{
 		btree_node_move_cell(source_node, left, i, pager);
 	}
 
-	// The last child on the left node is not included in ibtrees split. That
-	// must go to the parent.
-	if( first_half > 0 )
-	{
-		if( holding_node )
-		{
-			btree_node_move_cell(
-				source_node, holding_node, first_half - 1, pager);
-		}
+	// The promoted key is not included in ibtrees split. That must go to the
+	// parent.
+	if( holding_node )
+		btree_node_move_cell(source_node, holding_node, promoted, pager);
 
-		// The left node's right child becomes the page of the key that gets
-		// promoted to the parent.
-		left->header->right_child = source_node->keys[first_half - 1].key;
-	}
+	// The left node's right child becomes the page of the key that gets
+	// promoted to the parent.
+	left->header->right_child = node_key_at(source_node, promoted);
 
-	for( int i = first_half; i < source_node->header->num_keys; i++ )
+	for( u32 i = promoted + 1; i < source_node->header->num_keys; i++ )
 	{
 		btree_node_move_cell(source_node, right, i, pager);
 	}
@@ -69,7 +130,13 @@ split_node(
 	if( !source_node->header->is_leaf )
 		right->header->right_child = source_node->header->right_child;
 
-	return BTREE_OK;
+	// Each half's keys are closer together than the source's were, so they
+	// may share more.
+	result = btree_node_prefix_recompute(left, pager);
+	if( result != BTREE_OK )
+		return result;
+
+	return btree_node_prefix_recompute(right, pager);
 }
 
 /**
@@ -115,6 +182,15 @@ ibta_split_node_as_parent(
 	if( result != BTREE_OK )
 		goto end;
 
+	result = node_right_sibling_set(
+		nv_node(&left_nv), nv_page(&right_nv)->page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_persist_n(rcer, 1, &left_nv);
+	if( result != BTREE_OK )
+		goto end;
+
 	result = btree_node_move_cell_ex(
 		node,
 		nv_node(&parent_nv),
@@ -169,17 +245,13 @@ ibta_split_node(
 	struct NodeView left_nv = {0};
 	struct NodeView right_nv = {0};
 
-	// We want right page to remain stable since pointers
-	// in parent nodes are already pointing to the high-key of the input
-	// node which becomes the high key of the right child.
 	result = noderc_acquire_load_n(rcer, 2, &left_nv, 0, &right_nv, 0);
 	if( result != BTREE_OK )
 		goto end;
 
-	// We want right page to remain stable since pointers
-	// in parent nodes are already pointing to the high-key of the input
-	// node which becomes the high key of the right child.
-	result = noderc_reinit_as(rcer, &right_nv, node->page_number);
+	// The left page keeps the input page so that the node to its left
+	// still links to it; the right page is new.
+	result = noderc_reinit_as(rcer, &left_nv, node->page_number);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -197,11 +269,25 @@ ibta_split_node(
 	bool is_leaf = node_is_leaf(node);
 	node_is_leaf_set(nv_node(&left_nv), is_leaf);
 	node_is_leaf_set(nv_node(&right_nv), is_leaf);
-	result = noderc_persist_n(rcer, 2, &right_nv, &left_nv);
+	result = node_right_sibling_set(
+		nv_node(&right_nv), node_right_sibling(node));
+	if( result != BTREE_OK )
+		goto end;
+
+	result = noderc_persist_n(rcer, 1, &right_nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = node_right_sibling_set(
+		nv_node(&left_nv), nv_page(&right_nv)->page_id);
 	if( result != BTREE_OK )
 		goto end;
 
-	result = btree_node_copy(node, nv_node(&right_nv));
+	result = noderc_persist_n(rcer, 1, &left_nv);
+	if( result != BTREE_OK )
+		goto end;
+
+	result = btree_node_copy(node, nv_node(&left_nv));
 	if( result != BTREE_OK )
 		goto end;
 
@@ -209,6 +295,7 @@ ibta_split_node(
 	{
 		split_page->left_page_id = nv_page(&left_nv)->page_id;
 		split_page->left_page_high_key = split_result.left_child_index;
+		split_page->right_page_id = nv_page(&right_nv)->page_id;
 	}
 
 end:
@@ -242,25 +329,26 @@ from_cli(struct ChildListIndex* cli)
 }
 
 /**
- * @brief
+ * @brief Which node an insertion at index goes to once its node is split
+ * with the key at promoted going up; index becomes its place in that node.
  *
  * @param index
- * @param node
+ * @param promoted
  * @return int 1 for right, -1 for left
  */
 static int
-left_or_right_insertion(struct InsertionIndex* index, struct BTreeNode* node)
+left_or_right_insertion(struct InsertionIndex* index, u32 promoted)
 {
 	if( index->mode != KLIM_INDEX )
 		return 1;
 
-	u32 first_half = (node->header->num_keys + 1) / 2;
-	if( index->index < first_half )
+	if( index->index <= promoted )
 	{
 		return -1;
 	}
 	else
 	{
+		index->index -= promoted + 1;
 		return 1;
 	}
 }
@@ -339,9 +427,7 @@ ibta_insert_at(struct Cursor* cursor, struct ibta_insert_at* insert_at)
 			writer_mode);
 		if( result == BTREE_ERR_NODE_NOT_ENOUGH_SPACE )
 		{
-			// TODO: This first half thing is shaky.
-			u32 first_half = (node_num_keys(nv_node(&nv)) + 1) / 2;
-			int child_insertion = left_or_right_insertion(&index, nv_node(&nv));
+			int child_insertion = 0;
 			if( nv_page(&nv)->page_id == cursor->tree->root_page_id )
 			{
 				struct SplitPageAsParent split_result;
@@ -350,6 +436,8 @@ ibta_insert_at(struct Cursor* cursor, struct ibta_insert_at* insert_at)
 				if( result != BTREE_OK )
 					goto end;
 
+				child_insertion = left_or_right_insertion(
+					&index, split_result.left_child_high_key);
 				result = noderc_reinit_read(
 					cursor_rcer(cursor),
 					&nv,
@@ -358,9 +446,6 @@ ibta_insert_at(struct Cursor* cursor, struct ibta_insert_at* insert_at)
 				if( result != BTREE_OK )
 					goto end;
 
-				if( child_insertion == 1 )
-					index.index -= first_half;
-
 				result = btree_node_write_ex(
 					nv_node(&nv),
 					cursor_pager(cursor),
@@ -391,18 +476,16 @@ ibta_insert_at(struct Cursor* cursor, struct ibta_insert_at* insert_at)
 				if( result != BTREE_OK )
 					goto end;
 
-				// TODO: Key compare function.
-				if( child_insertion == -1 )
+				child_insertion = left_or_right_insertion(
+					&index, split_result.left_page_high_key);
+				if( child_insertion == 1 )
 				{
 					result = noderc_reinit_read(
-						cursor_rcer(cursor), &nv, split_result.left_page_id);
+						cursor_rcer(cursor), &nv, split_result.right_page_id);
 					if( result != BTREE_OK )
 						goto end;
 				}
 
-				if( child_insertion == 1 )
-					index.index -= first_half;
-
 				// Write the input payload to the correct child.
 				result = btree_node_write_ex(
 					nv_node(&nv),
@@ -421,13 +504,34 @@ ibta_insert_at(struct Cursor* cursor, struct ibta_insert_at* insert_at)
 				if( result != BTREE_OK )
 					goto end;
 
+				// The parent's pointer to the split page covers the upper
+				// half's keys, which are on the right page now.
+				result =
+					noderc_reinit_read(cursor_rcer(cursor), &nv, crumb.page_id);
+				if( result != BTREE_OK )
+					goto end;
+
+				if( crumb.key_index.mode == KLIM_RIGHT_CHILD ||
+					crumb.key_index.index == node_num_keys(nv_node(&nv)) )
+					node_right_child_set(
+						nv_node(&nv), split_result.right_page_id);
+				else
+					node_key_at_set(
+						nv_node(&nv),
+						crumb.key_index.index,
+						split_result.right_page_id);
+
+				result = noderc_persist_n(cursor_rcer(cursor), 1, &nv);
+				if( result != BTREE_OK )
+					goto end;
+
 				crumb.key_index.mode = KLIM_INDEX;
 				result = cursor_push_crumb(cursor, &crumb);
 				if( result != BTREE_OK )
 					goto end;
 
 				writer_mode = WRITER_EX_MODE_CELL_MOVE;
-				flags = nv_node(next_holding_nv)->keys[0].flags;
+				flags = node_flags_at(nv_node(next_holding_nv), 0);
 				page_index_as_key = split_result.left_page_id;
 
 				payload = btu_get_cell_buffer(nv_node(next_holding_nv), 0);
@@ -750,11 +854,28 @@ ibta_merge(struct Cursor* cursor, enum bta_rebalance_mode_e mode)
 	node_right_child_set(
 		nv_node(&left_nv), node_right_child(nv_node(&right_nv)));
 
-	result = btree_node_copy(nv_node(&right_nv), nv_node(&left_nv));
+	result =
+		btree_node_prefix_recompute(nv_node(&left_nv), cursor_pager(cursor));
+	if( result != BTREE_OK )
+		goto end;
+
+	// Result always ends up on the left-side page, so the node linking to
+	// it needn't change; the parent's pointer to the right page moves to it.
+	result = node_right_sibling_set(
+		nv_node(&left_nv), node_right_sibling(nv_node(&right_nv)));
 	if( result != BTREE_OK )
 		goto end;
 
-	result = noderc_persist_n(cursor_rcer(cursor), 1, &right_nv);
+	if( parent_index.index == node_num_keys(nv_node(&parent_nv)) )
+		node_right_child_set(
+			nv_node(&parent_nv), nv_node(&left_nv)->page_number);
+	else
+		node_key_at_set(
+			nv_node(&parent_nv),
+			parent_index.index,
+			nv_node(&left_nv)->page_number);
+
+	result = noderc_persist_n(cursor_rcer(cursor), 2, &left_nv, &parent_nv);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -889,6 +1010,14 @@ ibta_rebalance_root(struct Cursor* cursor)
 
 		node_is_leaf_set(nv_node(&root_nv), true);
 
+		// With the child's prefix its cells take the same room on the root.
+		result = btree_node_prefix_init(
+			nv_node(&root_nv),
+			btree_node_prefix(nv_node(&right_nv)),
+			nv_node(&right_nv)->header->prefix_size);
+		if( result != BTREE_OK )
+			goto end;
+
 		for( int i = 0; i < node_num_keys(nv_node(&right_nv)); i++ )
 		{
 			result = btree_node_move_cell(
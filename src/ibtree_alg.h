@@ -8,7 +8,7 @@
 /**
  * @brief Split node algorithm.
  *
- * Create a left and right child node; place half the data in the
+ * Create a left and right child node; place about half the data in the
  * left and right child each, then place the key for the left child
  * in the input node and set the rightmost child field.
  *
@@ -30,11 +30,16 @@ enum btree_e ibta_split_node_as_parent(
  * @brief Split node algorithm
  *
  * Split Page->left_child_high_key becomes the index of the key that was not
- * included from the parent. (The index as it was in the parent node.)
+ * included from the parent. (The index as it was in the parent node.) That is
+ * the shortest key near the middle rather than the middle one, so that
+ * parents hold short keys; see split_index.
  *
  * If the input node has more than 1 key, the holding_node will contain one
  * key
  *
+ * As with bta_split_node, the input node keeps the lower half and the new
+ * right page is linked after it; the caller repoints the parent.
+ *
  * @param tree
  * @param node
  * @param split_page [Optional] If the page_id of the right child is needed,
@@ -52,7 +52,6 @@ struct KeyBytes
 	// Used for cmp key only.
 	u32 lwnd;
 	bool not_in_window;
-	bool has_more;
 };
 
 static u32
@@ -141,7 +140,6 @@ cmpbytes(struct IBTLSCompareContext* ctx, struct Comparison* cmp)
 		bytes.nbytes =
 			min(cmp->cmp_wnd_size - lwnd,
 				keystate->key_size - keystate->consumed_size);
-		bytes.has_more = (lwnd + bytes.nbytes) < cmp->cmp_wnd_size;
 	}
 	else
 	{
@@ -212,6 +210,9 @@ initialize_rkey_offsets(struct IBTLSCompareContext* ctx, struct Comparison* cmp)
 		else
 		{
 			rkey_size = ctx->schema.key_definitions[i].size;
+
+			keystate->rkey_offset = offset;
+			keystate->rkey_size = rkey_size;
 			offset += rkey_size;
 			rptr += rkey_size;
 		}
@@ -260,7 +261,6 @@ ibtls_compare(
 	init_if_not(ctx, &cmp);
 
 	int cmp_result = 0;
-	int nbytes_to_cmp = 0;
 	do
 	{
 		cmp_bytes = cmpbytes(ctx, &cmp);
@@ -276,58 +276,44 @@ ibtls_compare(
 		struct RKeyState* r_keystate = &ctx->rkeys[ctx->curr_key];
 		key_bytes = keybytes(ctx, &cmp);
 
-		nbytes_to_cmp = min(key_bytes.nbytes, cmp_bytes.nbytes);
+		u32 nbytes_to_cmp = min(key_bytes.nbytes, cmp_bytes.nbytes);
 		cmp_result = memcmp(cmp_bytes.bytes, key_bytes.bytes, nbytes_to_cmp);
 
 		cmp_keystate->consumed_size += nbytes_to_cmp;
 
-		if( cmp_keystate->consumed_size == r_keystate->rkey_size )
-			ctx->curr_key += 1;
-
-		// Check if the rkey is completely done.
-		// Have we consumed all the rkey bytes and we are on the last key.
-		bool rkey_remaining;
-		if( cmp_keystate->consumed_size == r_keystate->rkey_size &&
-			ctx->curr_key == ctx->nvarkeys )
-			rkey_remaining = false;
-		else
-			rkey_remaining = true;
-
-		// Check if the cmp key is completely done.
-		// Have we consumed all the cmp key bytes and we are on the last key.
-		bool cmp_remaining;
-		if( cmp_keystate->consumed_size == cmp_keystate->key_size &&
-			ctx->curr_key == ctx->nvarkeys )
-			cmp_remaining = false;
-		else
-			cmp_remaining = true;
+		// Offsets are from the start of the window, so the bytes before the
+		// key are counted once.
+		cmp.cmp_offset = cmp_bytes.lwnd + nbytes_to_cmp;
+		*cmp.out_bytes_compared = cmp.cmp_offset;
 
-		*cmp.out_bytes_compared += cmp_bytes.lwnd + nbytes_to_cmp;
-		cmp.cmp_offset += cmp_bytes.lwnd + nbytes_to_cmp;
-		*cmp.out_key_size_remaining = rkey_remaining ? 1 : 0;
+		bool cmp_key_done =
+			cmp_keystate->consumed_size == cmp_keystate->key_size;
+		bool rkey_key_done =
+			cmp_keystate->consumed_size == r_keystate->rkey_size;
+		bool last_key = ctx->curr_key + 1 == ctx->nvarkeys;
+		*cmp.out_key_size_remaining = rkey_key_done && last_key ? 0 : 1;
 
 		if( cmp_result != 0 )
-			return cmp_result;
+			return cmp_result < 0 ? -1 : 1;
 
-		if( rkey_remaining && cmp_remaining )
-		{} // Do nothing... keep comparing.
-		else if( rkey_remaining )
-			// The key is longer than the stored bytes.
+		if( cmp_key_done && !rkey_key_done )
+			// The stored key is a prefix of the key; it sorts first.
 			return -1;
-		else if( cmp_remaining )
-			// The stored bytes are longer than the key
+		else if( rkey_key_done && !cmp_key_done )
+			// The key is a prefix of the stored key.
 			return 1;
-		else
-			// They are both done.
-			return 0;
+		else if( cmp_key_done && rkey_key_done )
+		{
+			if( last_key )
+				return 0;
 
-		// There are remaining bytes for both keys. Wait for caller to call
-		// again.
-	} while( cmp_bytes.has_more && nbytes_to_cmp != 0 );
+			ctx->curr_key += 1;
+		}
 
-	assert(nbytes_to_cmp != 0);
+		// Both keys go on, in this window or the caller's next one.
+	} while( cmp.cmp_offset < cmp.cmp_wnd_size );
 
-	return cmp_result;
+	return 0;
 }
 
 void
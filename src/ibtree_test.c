@@ -7,6 +7,7 @@
 #include "btree_node_debug.h"
 #include "btree_node_reader.h"
 #include "btree_node_writer.h"
+#include "btthread.h"
 #include "ibtree.h"
 #include "ibtree_alg.h"
 #include "noderc.h"
@@ -445,7 +446,7 @@ ibta_rotate_test(void)
 
 	if( right_node->header->num_keys != 1 )
 		goto fail;
-	if( right_node->keys[0].key != left_node_right_most_child )
+	if( node_key_at(right_node, 0) != left_node_right_most_child )
 		goto fail;
 
 	btree_node_init_from_read(
@@ -497,7 +498,7 @@ ibta_rotate_test(void)
 		goto fail;
 	if( left_node->header->right_child != left_node_right_most_child )
 		goto fail;
-	if( left_node->keys[1].key != middlemost_child_page )
+	if( node_key_at(left_node, 1) != middlemost_child_page )
 		goto fail;
 
 	btree_node_init_from_read(
@@ -1442,4 +1443,587 @@ end:
 fail:
 	result = 0;
 	goto end;
-}
\ No newline at end of file
+}
+#define CONCURRENT_WRITERS 4
+#define CONCURRENT_KEYS 400
+#define CONCURRENT_KEY_SIZE 24
+
+struct ConcurrentInserter
+{
+	struct BTree* tree;
+	u32 index;
+	int ok;
+};
+
+static void
+concurrent_key(u32 n, char* key)
+{
+	memset(key, 0x00, CONCURRENT_KEY_SIZE);
+	snprintf(key, CONCURRENT_KEY_SIZE, "key-%08u", n);
+}
+
+static void*
+concurrent_inserter(void* arg)
+{
+	struct ConcurrentInserter* inserter = (struct ConcurrentInserter*)arg;
+	char key[CONCURRENT_KEY_SIZE];
+
+	inserter->ok = 1;
+	for( u32 i = 0; i < CONCURRENT_KEYS / CONCURRENT_WRITERS; i++ )
+	{
+		concurrent_key(i * CONCURRENT_WRITERS + inserter->index, key);
+		if( ibtree_insert(inserter->tree, key, sizeof(key)) != BTREE_OK )
+			inserter->ok = 0;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Threads insert interleaved keys into one index; every key must be
+ * found afterwards.
+ */
+int
+ibtree_test_concurrent(void)
+{
+	char const* db_name = "ibtree_test_concurrent.db";
+	int result = 0;
+	char key[CONCURRENT_KEY_SIZE];
+	char read[CONCURRENT_KEY_SIZE];
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct ConcurrentInserter inserters[CONCURRENT_WRITERS];
+	bt_thread threads[CONCURRENT_WRITERS];
+	u32 nthreads = 0;
+	remove(db_name);
+
+	page_cache_create(&cache, 8);
+	pager_cstd_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( ibtree_init(
+			tree, pager, &rcer, 1, &ibtree_compare, &ibtree_compare_reset) !=
+		BTREE_OK )
+		goto end;
+
+	for( ; nthreads < CONCURRENT_WRITERS; nthreads++ )
+	{
+		inserters[nthreads].tree = tree;
+		inserters[nthreads].index = nthreads;
+		inserters[nthreads].ok = 0;
+		if( bt_thread_create(
+				&threads[nthreads],
+				&concurrent_inserter,
+				&inserters[nthreads]) != 0 )
+			break;
+	}
+
+	for( u32 i = 0; i < nthreads; i++ )
+		bt_thread_join(threads[i]);
+
+	if( nthreads != CONCURRENT_WRITERS )
+		goto end;
+	for( u32 i = 0; i < nthreads; i++ )
+	{
+		if( !inserters[i].ok )
+			goto end;
+	}
+
+	for( u32 n = 0; n < CONCURRENT_KEYS; n++ )
+	{
+		concurrent_key(n, key);
+		memset(read, 0x00, sizeof(read));
+		if( ibtree_select_ex(
+				tree, NULL, key, sizeof(key), read, sizeof(read)) !=
+				BTREE_OK ||
+			memcmp(key, read, sizeof(key)) != 0 )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define PREFIX_KEYS 600
+#define PREFIX_KEY_SIZE 48
+
+static void
+prefix_key(u32 n, char* key)
+{
+	memset(key, 0x00, PREFIX_KEY_SIZE);
+	snprintf(
+		key, PREFIX_KEY_SIZE, "/home/users/accounts/2024/profile-%06u", n);
+}
+
+/**
+ * @brief Iterates the tree; it must hold each of the keys that are left, in
+ * order, and every leaf must have a prefix.
+ *
+ * @param out_max_keys Most keys on one leaf.
+ */
+static int
+prefix_check_scan(struct BTree* tree, u32 nkeys, u32* out_max_keys)
+{
+	int result = 0;
+	char prev[PREFIX_KEY_SIZE] = {0};
+	char read[PREFIX_KEY_SIZE];
+	struct NodeView nv = {0};
+	u32 seen = 0;
+
+	*out_max_keys = 0;
+	struct Cursor* cursor = cursor_create(tree);
+	noderc_acquire(cursor_rcer(cursor), &nv);
+
+	enum btree_e iter = cursor_iter_begin(cursor);
+	while( iter == BTREE_OK )
+	{
+		if( nv.page->page_id != cursor->current_page_id )
+		{
+			noderc_reinit_read(
+				cursor_rcer(cursor), &nv, cursor->current_page_id);
+
+			struct BTreeNode* node = nv_node(&nv);
+			if( node_is_leaf(node) && node->header->prefix_size == 0 )
+				goto end;
+			if( node_is_leaf(node) && node_num_keys(node) > *out_max_keys )
+				*out_max_keys = node_num_keys(node);
+		}
+
+		memset(read, 0x00, sizeof(read));
+		if( btree_node_read_at(
+				tree,
+				nv_node(&nv),
+				cursor->current_key_index.index,
+				read,
+				sizeof(read)) != BTREE_OK ||
+			memcmp(prev, read, sizeof(read)) >= 0 )
+			goto end;
+
+		memcpy(prev, read, sizeof(read));
+		seen += 1;
+		iter = cursor_iter_next(cursor);
+	}
+
+	result = seen == nkeys;
+end:
+	noderc_release(cursor_rcer(cursor), &nv);
+	cursor_destroy(cursor);
+	return result;
+}
+
+/**
+ * @brief Keys sharing a long prefix are stored without it, so more fit on a
+ * leaf than would whole; they must still be found, read and deleted.
+ */
+int
+ibtree_test_prefix_compression(void)
+{
+	char const* db_name = "ibtree_test_prefix.db";
+	int result = 0;
+	char key[PREFIX_KEY_SIZE];
+	char read[PREFIX_KEY_SIZE];
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	u32 max_keys = 0;
+	remove(db_name);
+
+	page_cache_create(&cache, 16);
+	pager_cstd_create(&pager, cache, db_name, 0x400);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( ibtree_init(
+			tree, pager, &rcer, 1, &ibtree_compare, &ibtree_compare_reset) !=
+		BTREE_OK )
+		goto end;
+	btree_underflow_lim_set(tree, 3);
+
+	// 7 and PREFIX_KEYS are coprime, so this inserts every key, out of order.
+	for( u32 i = 0; i < PREFIX_KEYS; i++ )
+	{
+		prefix_key((i * 7) % PREFIX_KEYS, key);
+		if( ibtree_insert(tree, key, sizeof(key)) != BTREE_OK )
+			goto end;
+	}
+
+	if( !prefix_check_scan(tree, PREFIX_KEYS, &max_keys) )
+		goto end;
+
+	// Whole keys, each with its size, slot and key, would fit this many.
+	struct BTreeNode leaf = {0};
+	struct Page* page = NULL;
+	page_create(pager, &page);
+	btree_node_init_as_page_number(&leaf, 2, page);
+	u32 whole_keys_max =
+		btree_node_calc_heap_capacity(&leaf) /
+		btree_node_heap_required_for_insertion(
+			btree_cell_inline_disk_size(PREFIX_KEY_SIZE));
+	page_destroy(pager, page);
+	if( max_keys <= whole_keys_max )
+		goto end;
+
+	for( u32 n = 0; n < PREFIX_KEYS; n += 2 )
+	{
+		prefix_key(n, key);
+		if( ibtree_delete(tree, key, sizeof(key)) != BTREE_OK )
+			goto end;
+	}
+
+	for( u32 n = 0; n < PREFIX_KEYS; n++ )
+	{
+		prefix_key(n, key);
+		memset(read, 0x00, sizeof(read));
+		enum btree_e selected =
+			ibtree_select_ex(tree, NULL, key, sizeof(key), read, sizeof(read));
+		if( n % 2 == 0 && selected != BTREE_ERR_KEY_NOT_FOUND )
+			goto end;
+		if( n % 2 == 1 &&
+			(selected != BTREE_OK || memcmp(key, read, sizeof(key)) != 0) )
+			goto end;
+	}
+
+	if( !prefix_check_scan(tree, PREFIX_KEYS / 2, &max_keys) )
+		goto end;
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+#define SEPARATOR_KEYS 1000
+#define SEPARATOR_KEY_SIZE_MAX 128
+
+/**
+ * @brief One key in five is short; the rest are long.
+ */
+static u32
+separator_key(u32 n, char* key)
+{
+	u32 size = n % 5 == 0 ? 8 : SEPARATOR_KEY_SIZE_MAX;
+
+	memset(key, 'x', size);
+	snprintf(key, size, "k%05u", n);
+	key[6] = '-';
+
+	return size;
+}
+
+/**
+ * @brief When a node splits, a short key near its middle goes up rather than
+ * a long one, so parents hold mostly short keys; every key is still found in
+ * order.
+ */
+int
+ibtree_test_short_separators(void)
+{
+	char const* db_name = "ibtree_test_separators.db";
+	int result = 0;
+	char key[SEPARATOR_KEY_SIZE_MAX];
+	char read[SEPARATOR_KEY_SIZE_MAX];
+	char prev[SEPARATOR_KEY_SIZE_MAX] = {0};
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	struct Cursor* cursor = NULL;
+	struct NodeView nv = {0};
+	u64 all_bytes = 0;
+	u64 parent_bytes = 0;
+	u32 parent_keys = 0;
+	u32 seen = 0;
+	remove(db_name);
+
+	page_cache_create(&cache, 16);
+	pager_cstd_create(&pager, cache, db_name, 0x1000);
+	noderc_init(&rcer, pager);
+	btree_alloc(&tree);
+	if( ibtree_init(
+			tree, pager, &rcer, 1, &ibtree_compare, &ibtree_compare_reset) !=
+		BTREE_OK )
+		goto end;
+
+	for( u32 i = 0; i < SEPARATOR_KEYS; i++ )
+	{
+		u32 size = separator_key((i * 7) % SEPARATOR_KEYS, key);
+		if( ibtree_insert(tree, key, size) != BTREE_OK )
+			goto end;
+		all_bytes += size;
+	}
+
+	cursor = cursor_create(tree);
+	noderc_acquire(cursor_rcer(cursor), &nv);
+
+	enum btree_e iter = cursor_iter_begin(cursor);
+	while( iter == BTREE_OK )
+	{
+		if( nv.page->page_id != cursor->current_page_id )
+			noderc_reinit_read(
+				cursor_rcer(cursor), &nv, cursor->current_page_id);
+
+		u32 index = cursor->current_key_index.index;
+		u32 size = 0;
+		btree_node_payload_size_at(tree, nv_node(&nv), index, &size);
+		if( !node_is_leaf(nv_node(&nv)) )
+		{
+			parent_bytes += size;
+			parent_keys += 1;
+		}
+
+		memset(read, 0x00, sizeof(read));
+		if( btree_node_read_at(tree, nv_node(&nv), index, read, size) !=
+				BTREE_OK ||
+			memcmp(prev, read, sizeof(read)) >= 0 )
+			goto end;
+
+		memcpy(prev, read, sizeof(read));
+		seen += 1;
+		iter = cursor_iter_next(cursor);
+	}
+
+	if( seen != SEPARATOR_KEYS || parent_keys == 0 )
+		goto end;
+
+	// Half the mean key size is far more than a short key's.
+	if( parent_bytes * SEPARATOR_KEYS * 2 >= all_bytes * parent_keys )
+		goto end;
+
+	result = 1;
+end:
+	if( cursor )
+	{
+		noderc_release(cursor_rcer(cursor), &nv);
+		cursor_destroy(cursor);
+	}
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+#define REOPEN_KEYS 500
+#define REOPEN_KEY_SIZE 64
+
+static void
+reopen_key(u32 i, char* key)
+{
+	memset(key, 0x00, REOPEN_KEY_SIZE);
+	snprintf(key, REOPEN_KEY_SIZE, "reopen key %05u", i);
+}
+
+/**
+ * @brief Open the tree on db_name with a write-back pager, as main does.
+ */
+static int
+reopen_open(
+	char const* db_name,
+	struct PageCache** cache,
+	struct Pager** pager,
+	struct BTreeNodeRC* rcer,
+	struct BTree** tree)
+{
+	page_cache_create(cache, 4);
+	if( pager_cstd_create(pager, *cache, db_name, 0x1000) != PAGER_OK )
+		return 0;
+	noderc_init(rcer, *pager);
+	btree_alloc(tree);
+
+	return ibtree_init(
+			   *tree,
+			   *pager,
+			   rcer,
+			   1,
+			   &ibtree_compare,
+			   &ibtree_compare_reset) == BTREE_OK;
+}
+
+int
+ibtree_test_reopen_write_back(void)
+{
+	char const* db_name = "ibtree_test_reopen.db";
+	int result = 0;
+	char key[REOPEN_KEY_SIZE];
+	char read[REOPEN_KEY_SIZE];
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct BTreeNodeRC rcer;
+	struct BTree* tree = NULL;
+	remove(db_name);
+
+	if( !reopen_open(db_name, &cache, &pager, &rcer, &tree) )
+		goto end;
+
+	for( u32 i = 0; i < REOPEN_KEYS; i++ )
+	{
+		reopen_key((i * 7) % REOPEN_KEYS, key);
+		if( ibtree_insert(tree, key, sizeof(key)) != BTREE_OK )
+			goto end;
+	}
+
+	// No flush; tearing the pager down writes back what the cache holds.
+	btree_dealloc(tree);
+	tree = NULL;
+	enum pager_e destroyed = pager_destroy(pager);
+	pager = NULL;
+	page_cache_destroy(cache);
+	cache = NULL;
+	if( destroyed != PAGER_OK )
+		goto end;
+
+	if( !reopen_open(db_name, &cache, &pager, &rcer, &tree) )
+		goto end;
+
+	for( u32 i = 0; i < REOPEN_KEYS; i++ )
+	{
+		reopen_key(i, key);
+		memset(read, 0x00, sizeof(read));
+		if( ibtree_select_ex(
+				tree, NULL, key, sizeof(key), read, sizeof(read)) !=
+				BTREE_OK ||
+			memcmp(key, read, sizeof(key)) != 0 )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( tree )
+		btree_dealloc(tree);
+	if( pager )
+		pager_destroy(pager);
+	if( cache )
+		page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+// Keys in bytewise order; many tie on their first 8 bytes or differ only in
+// zero bytes past the end of a shorter key.
+static char const* const abbrev_keys[] = {
+	"\x00",
+	"\x00\x00",
+	"a",
+	"ab",
+	"ab\x00",
+	"ab\x00\x00\x00\x00\x00\x00",
+	"ab\x00\x00\x00\x00\x00\x00\x00",
+	"ab\x00\x00\x00\x00\x00\x00\x01",
+	"abcdefgh",
+	"abcdefgh\x00",
+	"abcdefghi",
+	"abcdefgi",
+	"b",
+	"\x7f",
+	"\x80",
+	"\xff",
+	"\xff\xff\xff\xff\xff\xff\xff\xff\xff",
+};
+static u32 const abbrev_key_sizes[] = {
+	1, 2, 1, 2, 3, 8, 9, 9, 8, 9, 9, 8, 1, 1, 1, 1, 9};
+
+// Keys not in the node, each between two that are.
+static char const* const abbrev_misses[] = {
+	"\x00\x00\x00",
+	"a\x00",
+	"ab\x00\x00",
+	"abcdefgh\xff",
+	"c",
+	"\xff\xff",
+};
+static u32 const abbrev_miss_sizes[] = {3, 2, 4, 9, 1, 2};
+
+/**
+ * @brief Searching a node with abbreviated keys finds what the full compare
+ * finds, for keys that hit and keys that miss.
+ */
+int
+ibtree_test_abbreviated_keys(void)
+{
+	char const* db_name = "ibtree_test_abbreviated.db";
+	int result = 0;
+	u32 nkeys = sizeof(abbrev_keys) / sizeof(abbrev_keys[0]);
+	u32 nmisses = sizeof(abbrev_misses) / sizeof(abbrev_misses[0]);
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct BTreeNode node = {0};
+	remove(db_name);
+
+	page_cache_create(&cache, 4);
+	if( pager_cstd_create(&pager, cache, db_name, 0x1000) != PAGER_OK ||
+		page_create(pager, &page) != PAGER_OK )
+		goto end;
+
+	btree_node_init_as_page_number(&node, 2, page);
+	for( u32 i = 0; i < nkeys; i++ )
+	{
+		struct InsertionIndex end_index = {.mode = KLIM_END};
+		struct BTreeCellInline cell = {
+			.inline_size = abbrev_key_sizes[i],
+			.payload = (byte*)abbrev_keys[i]};
+		if( btree_node_insert_inline(&node, &end_index, 0, &cell) !=
+			BTREE_OK )
+			goto end;
+	}
+
+	struct BTreeCompareContext full = {
+		.compare = &ibtree_compare,
+		.reset = &ibtree_compare_reset,
+		.keyof = &ibtree_keyof,
+		.bytewise = 0,
+		.compare_context = NULL,
+		.pager = pager};
+	struct BTreeCompareContext abbreviated = full;
+	abbreviated.bytewise = 1;
+
+	for( u32 i = 0; i < nkeys + nmisses; i++ )
+	{
+		bool hit = i < nkeys;
+		void* key = (void*)(hit ? abbrev_keys[i] : abbrev_misses[i - nkeys]);
+		u32 size = hit ? abbrev_key_sizes[i] : abbrev_miss_sizes[i - nkeys];
+		u32 full_index = 0;
+		u32 abbrev_index = 0;
+
+		enum btree_e full_result =
+			btree_node_search_keys(&full, &node, key, size, &full_index);
+		enum btree_e abbrev_result = btree_node_search_keys(
+			&abbreviated, &node, key, size, &abbrev_index);
+		if( full_result != abbrev_result || full_index != abbrev_index )
+			goto end;
+		if( hit && (abbrev_result != BTREE_OK || abbrev_index != i) )
+			goto end;
+		if( !hit && abbrev_result != BTREE_ERR_KEY_NOT_FOUND )
+			goto end;
+	}
+
+	result = 1;
+
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
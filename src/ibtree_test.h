@@ -12,4 +12,9 @@ int ibta_rebalance_nonleaf_test(void);
 int ibta_rebalance_root_fit(void);
 int ibta_rebalance_root_nofit(void);
 int ibta_cmp_ctx_test(void);
+int ibtree_test_concurrent(void);
+int ibtree_test_prefix_compression(void);
+int ibtree_test_short_separators(void);
+int ibtree_test_reopen_write_back(void);
+int ibtree_test_abbreviated_keys(void);
 #endif
\ No newline at end of file
@@ -69,6 +69,7 @@ deserialize_my_record(struct MyRecordType* rc, byte* buffer, u32 buffer_size)
 int
 main()
 {
+	int rc = -1;
 	struct BTree* tree = NULL;
 	struct BTreeNodeRC rcer = {0};
 	struct Pager* pager = NULL;
@@ -119,7 +120,7 @@ main()
 	if( result != BTREE_OK )
 	{
 		printf("Bad insert billy %d\n", result);
-		return -1;
+		goto end;
 	}
 
 	memcpy(r.name, alice, sizeof(alice));
@@ -133,7 +134,7 @@ main()
 	if( result != BTREE_OK )
 	{
 		printf("Bad insert alice %d\n", result);
-		return -1;
+		goto end;
 	}
 
 	memcpy(r.name, candace, sizeof(candace));
@@ -147,7 +148,7 @@ main()
 	if( result != BTREE_OK )
 	{
 		printf("Bad insert candy %d\n", result);
-		return -1;
+		goto end;
 	}
 
 	byte read_buf[0x500];
@@ -163,21 +164,21 @@ main()
 	if( result != BTREE_OK )
 	{
 		printf("Bad acquire select %d\n", result);
-		return -1;
+		goto end;
 	}
 
 	result = btree_op_select_prepare(&op);
 	if( result != BTREE_OK )
 	{
 		printf("Bad prepare select %d\n", result);
-		return -1;
+		goto end;
 	}
 
 	result = btree_op_select_commit(&op, read_buf, op_select_size(&op));
 	if( result != BTREE_OK )
 	{
 		printf("Bad commit select %d\n", result);
-		return -1;
+		goto end;
 	}
 	struct MyRecordType out = {0};
 	deserialize_my_record(&out, read_buf, op_select_size(&op));
@@ -186,8 +187,21 @@ main()
 	if( result != BTREE_OK )
 	{
 		printf("Bad release %d\n", result);
-		return -1;
+		goto end;
 	}
 
-	return 0;
+	rc = 0;
+
+end:
+	// Writes sit in the page cache until the pager writes them back.
+	if( tree )
+		btree_dealloc(tree);
+	if( pager && pager_destroy(pager) != PAGER_OK )
+	{
+		printf("Bad pager destroy\n");
+		rc = -1;
+	}
+	page_cache_destroy(cache);
+
+	return rc;
 }
@@ -3,7 +3,9 @@
 #include "btree_node.h"
 #include "btree_utils.h"
 #include "page.h"
+#include "pager_snapshot.h"
 
+#include <assert.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -11,6 +13,35 @@ void
 noderc_init(struct BTreeNodeRC* rcer, struct Pager* pager)
 {
 	rcer->pager = pager;
+	rcer->snapshot = NULL;
+}
+
+void
+noderc_set_snapshot(struct BTreeNodeRC* rcer, struct PagerSnapshot* snapshot)
+{
+	rcer->snapshot = snapshot;
+}
+
+/**
+ * @brief btree_node_init_from_read, from the snapshot if there is one.
+ */
+static enum btree_e
+read_node(struct BTreeNodeRC* rcer, struct NodeView* view, u32 page_id)
+{
+	enum btree_e result = BTREE_OK;
+	struct PageSelector selector = {0};
+
+	if( !rcer->snapshot )
+		return btree_node_init_from_read(
+			&view->node, view->page, rcer->pager, page_id);
+
+	pager_reselect(&selector, page_id);
+	result =
+		btpage_err(pager_snapshot_read(rcer->snapshot, &selector, view->page));
+	if( result != BTREE_OK )
+		return result;
+
+	return btree_node_init_from_page(&view->node, view->page);
 }
 
 enum btree_e
@@ -84,8 +115,7 @@ noderc_acquire_load(
 	if( result != BTREE_OK )
 		goto end;
 
-	result = btree_node_init_from_read(
-		&out_view->node, out_view->page, rcer->pager, page_id);
+	result = read_node(rcer, out_view, page_id);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -97,19 +127,24 @@ enum btree_e
 noderc_persist_n(struct BTreeNodeRC* rcer, u32 num, ...)
 {
 	enum btree_e result = BTREE_OK;
+	struct Page* pages[NODERC_PERSIST_MAX];
+	struct Pager* pager = rcer->pager;
 	va_list argp;
 
+	assert(num <= NODERC_PERSIST_MAX);
+
 	va_start(argp, num);
 	for( int i = 0; i < num; i++ )
 	{
 		struct NodeView* node = va_arg(argp, struct NodeView*);
-		result = btpage_err(pager_write_page(node->pager, node->page));
-		if( result != BTREE_OK )
-			goto end;
+		pages[i] = node->page;
+		pager = node->pager;
 	}
 	va_end(argp);
 
-end:
+	// Split and merge write several nodes; send them as one batch.
+	result = btpage_err(pager_write_pages(pager, pages, num));
+
 	return result;
 }
 
@@ -146,8 +181,52 @@ noderc_reinit_read(
 {
 	enum btree_e result;
 
-	result = btree_node_init_from_read(
-		&out_view->node, out_view->page, rcer->pager, page_id);
+	result = read_node(rcer, out_view, page_id);
+	if( result != BTREE_OK )
+		goto end;
+
+end:
+	return result;
+}
+
+enum btree_e
+noderc_reinit_read_ro(
+	struct BTreeNodeRC* rcer, struct NodeView* out_view, u32 page_id)
+{
+	enum btree_e result;
+	struct PageSelector selector = {0};
+	pager_reselect(&selector, page_id);
+
+	if( rcer->snapshot )
+		result = btpage_err(
+			pager_snapshot_read_ro(rcer->snapshot, &selector, out_view->page));
+	else
+		result = btpage_err(
+			pager_read_page_ro(rcer->pager, &selector, out_view->page));
+	if( result != BTREE_OK )
+		goto end;
+
+	result = btree_node_init_from_page(&out_view->node, out_view->page);
+	if( result != BTREE_OK )
+		goto end;
+
+end:
+	return result;
+}
+
+enum btree_e
+noderc_make_writable(struct BTreeNodeRC* rcer, struct NodeView* view)
+{
+	enum btree_e result;
+
+	if( !page_is_borrowed(view->page) )
+		return BTREE_OK;
+
+	result = btpage_err(page_make_writable(rcer->pager, view->page));
+	if( result != BTREE_OK )
+		goto end;
+
+	result = btree_node_init_from_page(&view->node, view->page);
 	if( result != BTREE_OK )
 		goto end;
 
@@ -161,6 +240,8 @@ noderc_reinit_as(
 {
 	enum btree_e result;
 
+	page_unborrow(rcer->pager, out_view->page);
+
 	result = btree_node_init_as_page_number(
 		&out_view->node, page_id, out_view->page);
 	if( result != BTREE_OK )
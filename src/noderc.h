@@ -11,6 +11,13 @@
 
 void noderc_init(struct BTreeNodeRC* rcer, struct Pager* pager);
 
+/**
+ * @brief Read nodes as of snapshot, or the pager's current pages if NULL.
+ * Nothing read through a snapshot may be written back.
+ */
+void
+noderc_set_snapshot(struct BTreeNodeRC* rcer, struct PagerSnapshot* snapshot);
+
 enum btree_e
 noderc_acquire(struct BTreeNodeRC* rcer, struct NodeView* out_view);
 
@@ -47,6 +54,9 @@ enum btree_e noderc_acquire_load_n(struct BTreeNodeRC* rcer, u32 num, ...);
 enum btree_e noderc_acquire_load(
 	struct BTreeNodeRC* rcer, struct NodeView* out_view, u32 page_id);
 
+// Most node views noderc_persist_n writes at once.
+#define NODERC_PERSIST_MAX 8
+
 enum btree_e noderc_persist_n(struct BTreeNodeRC* rcer, u32 num, ...);
 
 void noderc_release(struct BTreeNodeRC* rcer, struct NodeView* out_view);
@@ -56,6 +66,33 @@ void noderc_release_n(struct BTreeNodeRC* rcer, u32 num, ...);
 enum btree_e noderc_reinit_read(
 	struct BTreeNodeRC* rcer, struct NodeView* out_view, u32 page_id);
 
+/**
+ * @brief Same as noderc_reinit_read but the view borrows the page from the
+ * pager instead of copying it (see pager_read_page_ro). A borrowed cache frame
+ * stays pinned until the view is reread or released. The node must not be
+ * modified; see noderc_make_writable.
+ *
+ * @param rcer
+ * @param out_view
+ * @param page_id
+ * @return enum btree_e
+ */
+enum btree_e noderc_reinit_read_ro(
+	struct BTreeNodeRC* rcer, struct NodeView* out_view, u32 page_id);
+
+/**
+ * @brief Copy-on-write for a view read with noderc_reinit_read_ro.
+ *
+ * If the view borrows its page, copy it into the view's own buffer, release
+ * the borrowed frame and point the node at the copy. No-op otherwise.
+ *
+ * @param rcer
+ * @param view
+ * @return enum btree_e
+ */
+enum btree_e
+noderc_make_writable(struct BTreeNodeRC* rcer, struct NodeView* view);
+
 enum btree_e noderc_reinit_as(
 	struct BTreeNodeRC* rcer, struct NodeView* out_view, u32 page_id);
 
@@ -1,22 +1,124 @@
 #include "page.h"
 
+#include "page_cache.h"
 #include "pagemeta.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Buffers start on a cache line; also the block alignment.
+#define PAGE_POOL_ALIGN 64
+// Free blocks kept per pool list; the rest go back to the system.
+#define PAGE_POOL_MAX_FREE 256
+
+static size_t
+round_up(size_t size, size_t align)
+{
+	return (size + align - 1) / align * align;
+}
+
+static size_t
+header_size(void)
+{
+	return round_up(sizeof(struct Page), PAGE_POOL_ALIGN);
+}
+
+static size_t
+block_size(struct Pager* pager)
+{
+	return header_size() + round_up(pager->disk_page_size, PAGE_POOL_ALIGN);
+}
+
+static void*
+block_alloc(size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, PAGE_POOL_ALIGN);
+#else
+	return aligned_alloc(PAGE_POOL_ALIGN, size);
+#endif
+}
+
+static void
+block_free(void* block)
+{
+#ifdef _WIN32
+	_aligned_free(block);
+#else
+	free(block);
+#endif
+}
+
+// Which of the pool's lists the calling thread uses; assigned on first use,
+// round robin.
+static bt_thread_local int thread_list = -1;
+static unsigned int volatile next_list = 0;
+
+static struct PagePoolList*
+pool_list(struct Pager* pager)
+{
+	if( thread_list == -1 )
+		thread_list = bt_atomic_add(&next_list, 1) % PAGE_POOL_LISTS;
+
+	return &pager->pool.lists[thread_list];
+}
+
 static enum pager_e
 pager_page_alloc(struct Pager* pager, struct Page** r_page)
 {
-	*r_page = (struct Page*)malloc(sizeof(struct Page));
+	struct PagePoolList* list = pool_list(pager);
+
+	bt_mutex_lock(&list->mutex);
+
+	void* block = list->free_list;
+	if( block )
+	{
+		memcpy(&list->free_list, block, sizeof(void*));
+		list->free_count -= 1;
+	}
+	else
+	{
+		block = block_alloc(block_size(pager));
+		if( !block )
+		{
+			bt_mutex_unlock(&list->mutex);
+			return PAGER_ERR_NO_MEM;
+		}
+
+		list->stats.block_allocs += 1;
+	}
+
+	list->stats.page_creates += 1;
+
+	bt_mutex_unlock(&list->mutex);
+
+	*r_page = (struct Page*)block;
 	return PAGER_OK;
 }
 
 static enum pager_e
-pager_page_dealloc(struct Page* page)
+pager_page_dealloc(struct Pager* pager, struct Page* page)
 {
-	free(page);
+	struct PagePoolList* list = pool_list(pager);
+
+	bt_mutex_lock(&list->mutex);
+
+	if( list->free_count >= PAGE_POOL_MAX_FREE )
+	{
+		list->stats.block_frees += 1;
+		bt_mutex_unlock(&list->mutex);
+
+		block_free(page);
+		return PAGER_OK;
+	}
+
+	memcpy(page, &list->free_list, sizeof(void*));
+	list->free_list = page;
+	list->free_count += 1;
+
+	bt_mutex_unlock(&list->mutex);
+
 	return PAGER_OK;
 }
 
@@ -28,10 +130,9 @@ pager_page_init(struct Pager* pager, struct Page* page, int page_id)
 	page->status = PAGER_ERR_PAGE_PERSISTENCE_UNKNOWN;
 	page->page_size = pager->page_size;
 
-	void* page_buffer = malloc(pager->disk_page_size);
+	void* page_buffer = (char*)page + header_size();
 	page->page_buffer = pagemeta_adjust_buffer(page_buffer);
-
-	pagemeta_memset_page(page, 0x00, pager);
+	page->owned_buffer = page->page_buffer;
 
 	return PAGER_OK;
 }
@@ -39,7 +140,6 @@ pager_page_init(struct Pager* pager, struct Page* page, int page_id)
 static enum pager_e
 pager_page_deinit(struct Page* page)
 {
-	free(pagemeta_deadjust_buffer(page->page_buffer));
 	memset(page, 0x00, sizeof(*page));
 
 	return PAGER_OK;
@@ -54,7 +154,22 @@ pager_reselect(struct PageSelector* selector, int page_id)
 enum pager_e
 page_create(struct Pager* pager, struct Page** r_page)
 {
-	pager_page_alloc(pager, r_page);
+	enum pager_e result = page_create_for_read(pager, r_page);
+	if( result != PAGER_OK )
+		return result;
+
+	pagemeta_memset_page(*r_page, 0x00, pager);
+
+	return PAGER_OK;
+}
+
+enum pager_e
+page_create_for_read(struct Pager* pager, struct Page** r_page)
+{
+	enum pager_e result = pager_page_alloc(pager, r_page);
+	if( result != PAGER_OK )
+		return result;
+
 	pager_page_init(pager, *r_page, PAGE_CREATE_NEW_PAGE);
 
 	return PAGER_OK;
@@ -63,8 +178,115 @@ page_create(struct Pager* pager, struct Page** r_page)
 enum pager_e
 page_destroy(struct Pager* pager, struct Page* page)
 {
+	page_unborrow(pager, page);
 	pager_page_deinit(page);
-	pager_page_dealloc(page);
+	pager_page_dealloc(pager, page);
+
+	return PAGER_OK;
+}
+
+void
+page_pool_init(struct Pager* pager)
+{
+	for( int i = 0; i < PAGE_POOL_LISTS; i++ )
+	{
+		struct PagePoolList* list = &pager->pool.lists[i];
+
+		memset(list, 0x00, sizeof(*list));
+		bt_mutex_init(&list->mutex);
+	}
+}
+
+void
+page_pool_deinit(struct Pager* pager)
+{
+	page_pool_drain(pager);
+
+	for( int i = 0; i < PAGE_POOL_LISTS; i++ )
+		bt_mutex_destroy(&pager->pool.lists[i].mutex);
+}
+
+void
+page_pool_drain(struct Pager* pager)
+{
+	for( int i = 0; i < PAGE_POOL_LISTS; i++ )
+	{
+		struct PagePoolList* list = &pager->pool.lists[i];
+
+		bt_mutex_lock(&list->mutex);
+
+		while( list->free_list )
+		{
+			void* block = list->free_list;
+			memcpy(&list->free_list, block, sizeof(void*));
+			block_free(block);
+			list->stats.block_frees += 1;
+		}
+
+		list->free_count = 0;
+
+		bt_mutex_unlock(&list->mutex);
+	}
+}
+
+void
+page_pool_stats(struct Pager* pager, struct PagePoolStats* r_stats)
+{
+	memset(r_stats, 0x00, sizeof(*r_stats));
+
+	for( int i = 0; i < PAGE_POOL_LISTS; i++ )
+	{
+		struct PagePoolList* list = &pager->pool.lists[i];
+
+		bt_mutex_lock(&list->mutex);
+		r_stats->page_creates += list->stats.page_creates;
+		r_stats->block_allocs += list->stats.block_allocs;
+		r_stats->block_frees += list->stats.block_frees;
+		bt_mutex_unlock(&list->mutex);
+	}
+}
+
+bool
+page_is_borrowed(struct Page const* page)
+{
+	return page->page_buffer != page->owned_buffer;
+}
+
+void
+page_borrow(struct Page* page, void const* disk_buffer)
+{
+	page->page_buffer = pagemeta_adjust_buffer((void*)disk_buffer);
+}
+
+void
+page_pin(struct Page* page, struct Page* frame)
+{
+	assert(page->pinned_frame == NULL);
+	page->page_buffer = frame->page_buffer;
+	page->pinned_frame = frame;
+}
+
+void
+page_unborrow(struct Pager* pager, struct Page* page)
+{
+	if( page->pinned_frame )
+		page_cache_release(pager->cache, page->pinned_frame);
+
+	page->pinned_frame = NULL;
+	page->page_buffer = page->owned_buffer;
+}
+
+enum pager_e
+page_make_writable(struct Pager* pager, struct Page* page)
+{
+	if( !page_is_borrowed(page) )
+		return PAGER_OK;
+
+	memcpy(
+		pagemeta_deadjust_buffer(page->owned_buffer),
+		pagemeta_deadjust_buffer(page->page_buffer),
+		pager->disk_page_size);
+	page_unborrow(pager, page);
 
 	return PAGER_OK;
 }
\ No newline at end of file
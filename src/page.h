@@ -3,6 +3,8 @@
 
 #include "page_defs.h"
 
+#include <stdbool.h>
+
 /**
  * @brief Selects the page_id; DOES NOT LOAD THE PAGE.
  *
@@ -25,6 +27,12 @@ void pager_reselect(struct PageSelector* selector, int page_id);
  */
 enum pager_e page_create(struct Pager* pager, struct Page** r_page);
 
+/**
+ * @brief page_create without zeroing the buffer, for a page that is about to
+ * be filled by a read.
+ */
+enum pager_e page_create_for_read(struct Pager* pager, struct Page** r_page);
+
 /**
  * @brief Release page; Takes ownership of page
  *
@@ -34,4 +42,59 @@ enum pager_e page_create(struct Pager* pager, struct Page** r_page);
  */
 enum pager_e page_destroy(struct Pager* pager, struct Page* page);
 
+/**
+ * @brief Set up the pager's page pool; the pool is empty.
+ */
+void page_pool_init(struct Pager* pager);
+
+/**
+ * @brief Drain the pager's page pool and free its locks.
+ */
+void page_pool_deinit(struct Pager* pager);
+
+/**
+ * @brief Free the pager's pooled page blocks. Pages still in use are not
+ * affected and are freed individually when destroyed.
+ */
+void page_pool_drain(struct Pager* pager);
+
+/**
+ * @brief The pool's stats summed over its lists.
+ */
+void page_pool_stats(struct Pager* pager, struct PagePoolStats* r_stats);
+
+/**
+ * @brief True if page_buffer points at memory the page does not own.
+ *
+ * Borrowed pages are read-only.
+ */
+bool page_is_borrowed(struct Page const* page);
+
+/**
+ * @brief Point the page at disk_buffer (a whole disk page, including the page
+ * meta) without copying.
+ */
+void page_borrow(struct Page* page, void const* disk_buffer);
+
+/**
+ * @brief Borrow a page cache frame's buffer.
+ *
+ * The caller hands over one cache reference on frame; it is released when the
+ * page is unborrowed or destroyed, so the frame can't be evicted while the
+ * page points at it.
+ */
+void page_pin(struct Page* page, struct Page* frame);
+
+/**
+ * @brief Point the page back at its own buffer; does not copy. Releases the
+ * frame if the page is pinned.
+ */
+void page_unborrow(struct Pager* pager, struct Page* page);
+
+/**
+ * @brief Copy a borrowed page into the page's own buffer so it can be
+ * modified. No-op if the page is not borrowed.
+ */
+enum pager_e page_make_writable(struct Pager* pager, struct Page* page);
+
 #endif
\ No newline at end of file
@@ -5,82 +5,362 @@
 #include <stdlib.h>
 #include <string.h>
 
-void
-assert_cache_correct(struct PageCache* cache)
+static u32
+hash_page_id(struct PageCache* cache, u32 page_id)
 {
-	for( int i = 1; i < cache->size; i++ )
-	{
-		if( cache->pages[i - 1].page_id >= cache->pages[i].page_id )
-		{
-			assert(cache->pages[i - 1].page_id < cache->pages[i].page_id);
-		}
-	}
+	// Fibonacci hashing; page ids are dense and sequential.
+	return (page_id * 0x9E3779B1u) & cache->table_mask;
 }
 
 /**
- * @brief Returns insertion location.
+ * @brief Returns the table slot holding page_id, or the empty slot where it
+ * would go.
  *
  * @param cache
  * @param page_id
  * @param found
- * @return int
+ * @return u32
  */
-static int
+static u32
 find_in_cache(struct PageCache* cache, u32 page_id, char* found)
 {
-	int left = 0;
-	int right = cache->size - 1;
-	int mid = 0;
+	u32 slot = hash_page_id(cache, page_id);
 
-	while( left <= right )
+	while( cache->table[slot] != 0 )
 	{
-		mid = (right - left) / 2 + left;
-
-		unsigned int cache_page_id = cache->pages[mid].page_id;
-		if( cache_page_id == page_id )
+		if( cache->pages[cache->table[slot] - 1].page_id == page_id )
 		{
 			if( found )
 				*found = 1;
-			return mid;
+			return slot;
 		}
-		else if( cache_page_id < page_id )
+
+		slot = (slot + 1) & cache->table_mask;
+	}
+
+	return slot;
+}
+
+/**
+ * @brief Backward-shift deletion; keeps every probe sequence unbroken without
+ * tombstones.
+ */
+static void
+table_remove(struct PageCache* cache, u32 slot)
+{
+	u32 hole = slot;
+	u32 next = (slot + 1) & cache->table_mask;
+
+	while( cache->table[next] != 0 )
+	{
+		u32 home =
+			hash_page_id(cache, cache->pages[cache->table[next] - 1].page_id);
+
+		// Move the entry into the hole unless its home slot lies cyclically
+		// in (hole, next].
+		if( ((next - home) & cache->table_mask) >=
+			((next - hole) & cache->table_mask) )
 		{
-			left = mid + 1;
+			cache->table[hole] = cache->table[next];
+			hole = next;
 		}
-		else
+
+		next = (next + 1) & cache->table_mask;
+	}
+
+	cache->table[hole] = 0;
+}
+
+static void
+queue_unlink(struct PageCache* cache, int frame)
+{
+	struct PageCacheKey* pck = &cache->pages[frame];
+	struct PageCacheQueue* queue = &cache->queues[(int)pck->queue];
+
+	if( pck->lru_prev != -1 )
+		cache->pages[pck->lru_prev].lru_next = pck->lru_next;
+	else
+		queue->head = pck->lru_next;
+
+	if( pck->lru_next != -1 )
+		cache->pages[pck->lru_next].lru_prev = pck->lru_prev;
+	else
+		queue->tail = pck->lru_prev;
+
+	pck->lru_prev = -1;
+	pck->lru_next = -1;
+	queue->size -= 1;
+}
+
+static void
+queue_push_front(struct PageCache* cache, int queue_id, int frame)
+{
+	struct PageCacheKey* pck = &cache->pages[frame];
+	struct PageCacheQueue* queue = &cache->queues[queue_id];
+
+	pck->queue = queue_id;
+	pck->lru_prev = -1;
+	pck->lru_next = queue->head;
+
+	if( queue->head != -1 )
+		cache->pages[queue->head].lru_prev = frame;
+	else
+		queue->tail = frame;
+
+	queue->head = frame;
+	queue->size += 1;
+}
+
+/**
+ * @brief Oldest unreferenced frame in the queue, or -1.
+ */
+static int
+queue_victim(struct PageCache* cache, int queue_id)
+{
+	int frame = cache->queues[queue_id].tail;
+
+	// Referenced pages are rare; walk past them.
+	while( frame != -1 && cache->pages[frame].ref != 0 )
+		frame = cache->pages[frame].lru_prev;
+
+	return frame;
+}
+
+static u32
+ghost_hash(struct PageCache* cache, u32 page_id)
+{
+	return (page_id * 0x9E3779B1u) & cache->ghost_mask;
+}
+
+static u32
+ghost_find(struct PageCache* cache, u32 page_id, char* found)
+{
+	u32 slot = ghost_hash(cache, page_id);
+
+	while( cache->ghost_table[slot] != 0 )
+	{
+		if( cache->ghost_table[slot] == page_id )
 		{
-			right = mid - 1;
+			*found = 1;
+			return slot;
 		}
+
+		slot = (slot + 1) & cache->ghost_mask;
+	}
+
+	return slot;
+}
+
+/**
+ * @brief Same backward-shift deletion as table_remove.
+ */
+static void
+ghost_table_remove(struct PageCache* cache, u32 page_id)
+{
+	char found = 0;
+	u32 hole = ghost_find(cache, page_id, &found);
+	if( !found )
+		return;
+
+	u32 next = (hole + 1) & cache->ghost_mask;
+	while( cache->ghost_table[next] != 0 )
+	{
+		u32 home = ghost_hash(cache, cache->ghost_table[next]);
+		if( ((next - home) & cache->ghost_mask) >=
+			((next - hole) & cache->ghost_mask) )
+		{
+			cache->ghost_table[hole] = cache->ghost_table[next];
+			hole = next;
+		}
+
+		next = (next + 1) & cache->ghost_mask;
+	}
+
+	cache->ghost_table[hole] = 0;
+}
+
+/**
+ * @brief Remember a page evicted from probation.
+ *
+ * The ring may still hold ids that were taken out of the set when they were
+ * promoted; they just age out. If the same id was pushed again meanwhile, the
+ * stale copy forgets it early, which only costs a promotion.
+ */
+static void
+ghost_push(struct PageCache* cache, u32 page_id)
+{
+	char found = 0;
+	u32 slot = ghost_find(cache, page_id, &found);
+	if( found )
+		return;
+
+	if( cache->ghost_count == cache->ghost_capacity )
+	{
+		ghost_table_remove(cache, cache->ghosts[cache->ghost_head]);
+		cache->ghost_head = (cache->ghost_head + 1) % cache->ghost_capacity;
+		cache->ghost_count -= 1;
+
+		// The removal may have shifted the empty slot.
+		slot = ghost_find(cache, page_id, &found);
 	}
 
-	return left;
+	int tail = (cache->ghost_head + cache->ghost_count) % cache->ghost_capacity;
+	cache->ghosts[tail] = page_id;
+	cache->ghost_count += 1;
+	cache->ghost_table[slot] = page_id;
+}
+
+/**
+ * @brief Whether page_id was evicted from probation recently; forgets it if
+ * so.
+ */
+static char
+ghost_take(struct PageCache* cache, u32 page_id)
+{
+	char found = 0;
+	ghost_find(cache, page_id, &found);
+	if( found )
+		ghost_table_remove(cache, page_id);
+
+	return found;
+}
+
+static u32
+table_size_for(u32 entries)
+{
+	u32 table_size = 2;
+	while( table_size < entries * 2 )
+		table_size <<= 1;
+
+	return table_size;
 }
 
 static enum pager_e
-page_cache_init(struct PageCache* cache, int capacity)
+page_cache_init(
+	struct PageCache* cache, int capacity, enum page_cache_policy_e policy)
 {
 	memset(cache, 0x00, sizeof(struct PageCache));
 
+	u32 table_size = table_size_for(capacity);
+
+	cache->policy = policy;
 	cache->capacity = capacity;
+	cache->base_capacity = capacity;
 	cache->pages =
 		(struct PageCacheKey*)malloc(sizeof(struct PageCacheKey) * capacity);
+	cache->table = (int*)calloc(table_size, sizeof(int));
+	if( !cache->pages || !cache->table )
+		goto nomem;
+
+	cache->table_mask = table_size - 1;
+	for( int i = 0; i < PAGE_CACHE_NQUEUES; i++ )
+	{
+		cache->queues[i].head = -1;
+		cache->queues[i].tail = -1;
+	}
+
+	if( policy == PAGE_CACHE_2Q )
+	{
+		// Kin = 25% and Kout = 50% of the cache, as suggested for 2Q.
+		cache->probation_capacity = capacity / 4 > 0 ? capacity / 4 : 1;
+		cache->ghost_capacity = capacity / 2 > 0 ? capacity / 2 : 1;
+
+		u32 ghost_table_size = table_size_for(cache->ghost_capacity);
+		cache->ghosts = (u32*)malloc(sizeof(u32) * cache->ghost_capacity);
+		cache->ghost_table = (u32*)calloc(ghost_table_size, sizeof(u32));
+		if( !cache->ghosts || !cache->ghost_table )
+			goto nomem;
+
+		cache->ghost_mask = ghost_table_size - 1;
+	}
+
+	cache->latches = (struct PageLatchShard*)calloc(
+		PAGE_LATCH_SHARDS, sizeof(struct PageLatchShard));
+	if( !cache->latches )
+		goto nomem;
+
+	for( int i = 0; i < PAGE_LATCH_SHARDS; i++ )
+	{
+		bt_mutex_init(&cache->latches[i].mutex);
+		bt_cond_init(&cache->latches[i].released);
+	}
+
+	cache->versions = (u32*)calloc(PAGE_VERSION_SLOTS, sizeof(u32));
+	if( !cache->versions )
+		goto nomem;
+
+	bt_mutex_init(&cache->mutex);
+	bt_mutex_init(&cache->gate_mutex);
+	bt_cond_init(&cache->gate_changed);
 
 	memset(cache->pages, 0x00, sizeof(struct PageCacheKey) * capacity);
 	return PAGER_OK;
+
+nomem:
+	free(cache->latches);
+	free(cache->pages);
+	free(cache->table);
+	free(cache->ghosts);
+	free(cache->ghost_table);
+	return PAGER_ERR_NO_MEM;
+}
+
+static void
+free_latches(struct PageLatch* latch)
+{
+	while( latch )
+	{
+		struct PageLatch* next = latch->next;
+		free(latch);
+		latch = next;
+	}
 }
 
 static enum pager_e
 page_cache_deinit(struct PageCache* cache)
 {
+	for( int i = 0; i < PAGE_LATCH_SHARDS; i++ )
+	{
+		struct PageLatchShard* shard = &cache->latches[i];
+		for( int j = 0; j < PAGE_LATCH_BUCKETS; j++ )
+		{
+			// Nothing may be latched anymore.
+			assert(shard->buckets[j] == NULL);
+			free_latches(shard->buckets[j]);
+		}
+		free_latches(shard->spare);
+
+		bt_cond_destroy(&shard->released);
+		bt_mutex_destroy(&shard->mutex);
+	}
+
+	bt_mutex_destroy(&cache->mutex);
+	bt_cond_destroy(&cache->gate_changed);
+	bt_mutex_destroy(&cache->gate_mutex);
+
+	free(cache->versions);
+	free(cache->latches);
 	free(cache->pages);
+	free(cache->table);
+	free(cache->ghosts);
+	free(cache->ghost_table);
 	return PAGER_OK;
 }
 
 enum pager_e
 page_cache_create(struct PageCache** r_cache, int capacity)
+{
+	return page_cache_create_ex(r_cache, capacity, PAGE_CACHE_LRU);
+}
+
+enum pager_e
+page_cache_create_ex(
+	struct PageCache** r_cache,
+	int capacity,
+	enum page_cache_policy_e policy)
 {
 	*r_cache = (struct PageCache*)malloc(sizeof(struct PageCache));
-	return page_cache_init(*r_cache, capacity);
+	return page_cache_init(*r_cache, capacity, policy);
 }
 
 enum pager_e
@@ -91,104 +371,771 @@ page_cache_destroy(struct PageCache* cache)
 	return PAGER_OK;
 }
 
+/**
+ * @brief Record a use of a cached frame for the replacement policy.
+ */
+static void
+touch(struct PageCache* cache, int frame)
+{
+	struct PageCacheKey* pck = &cache->pages[frame];
+
+	switch( cache->policy )
+	{
+	case PAGE_CACHE_CLOCK:
+		pck->referenced = 1;
+		break;
+	case PAGE_CACHE_2Q:
+		// Probation is FIFO; a hit there does not reorder it.
+		if( pck->queue == PAGE_CACHE_QUEUE_PROBATION )
+			break;
+		// fallthrough
+	case PAGE_CACHE_LRU:
+		// Pinned frames are out of the running anyway.
+		if( pck->queue == PAGE_CACHE_QUEUE_PINNED )
+			break;
+		if( cache->queues[(int)pck->queue].head != frame )
+		{
+			queue_unlink(cache, frame);
+			queue_push_front(cache, PAGE_CACHE_QUEUE_MAIN, frame);
+		}
+		break;
+	}
+}
+
+static int
+lookup(struct PageCache* cache, int page_number)
+{
+	char page_found = 0;
+	u32 slot = find_in_cache(cache, page_number, &page_found);
+
+	return page_found ? cache->table[slot] - 1 : -1;
+}
+
 enum pager_e
 page_cache_acquire(
 	struct PageCache* cache, int page_number, struct Page** r_page)
 {
-	char page_found = 0;
-	int cache_index = find_in_cache(cache, page_number, &page_found);
+	enum pager_e result = PAGER_OK;
 
-	if( page_found )
+	bt_mutex_lock(&cache->mutex);
+
+	int frame = lookup(cache, page_number);
+	if( frame != -1 )
 	{
-		struct PageCacheKey* pck = &cache->pages[cache_index];
+		struct PageCacheKey* pck = &cache->pages[frame];
 
 		pck->ref += 1;
 		*r_page = pck->page;
 
-		return PAGER_OK;
+		touch(cache, frame);
+		cache->hits += 1;
 	}
 	else
 	{
-		return PAGER_ERR_CACHE_MISS;
+		cache->misses += 1;
+		result = PAGER_ERR_CACHE_MISS;
+	}
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+enum pager_e
+page_cache_peek(struct PageCache* cache, int page_number, struct Page** r_page)
+{
+	enum pager_e result = PAGER_OK;
+
+	bt_mutex_lock(&cache->mutex);
+
+	int frame = lookup(cache, page_number);
+	if( frame != -1 )
+	{
+		cache->pages[frame].ref += 1;
+		*r_page = cache->pages[frame].page;
+	}
+	else
+	{
+		result = PAGER_ERR_CACHE_MISS;
 	}
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return result;
 }
 
 enum pager_e
 page_cache_release(struct PageCache* cache, struct Page* page)
 {
 	char page_found = 0;
-	int cache_index = find_in_cache(cache, page->page_id, &page_found);
 
+	bt_mutex_lock(&cache->mutex);
+
+	u32 slot = find_in_cache(cache, page->page_id, &page_found);
 	if( page_found )
 	{
-		struct PageCacheKey* pck = &cache->pages[cache_index];
+		struct PageCacheKey* pck = &cache->pages[cache->table[slot] - 1];
 
 		pck->ref -= pck->ref != 0 ? 1 : 0;
+	}
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return PAGER_OK;
+}
+
+static int
+clock_victim(struct PageCache* cache)
+{
+	if( cache->pin_dirty && cache->ndirty == cache->size )
+		return -1;
+
+	// Two full sweeps clear every reference bit; if nothing is found by then
+	// every page is referenced or pinned.
+	for( int i = 0; i < cache->size * 2; i++ )
+	{
+		int frame = cache->hand;
+		struct PageCacheKey* pck = &cache->pages[frame];
+		cache->hand = (cache->hand + 1) % cache->size;
+
+		if( pck->ref != 0 || (cache->pin_dirty && pck->dirty) )
+			continue;
 
-		return PAGER_OK;
+		if( !pck->referenced )
+			return frame;
+
+		pck->referenced = 0;
 	}
-	else
+
+	return -1;
+}
+
+static int
+select_victim(struct PageCache* cache)
+{
+	int frame = -1;
+
+	switch( cache->policy )
 	{
-		return PAGER_OK;
+	case PAGE_CACHE_CLOCK:
+		frame = clock_victim(cache);
+		break;
+	case PAGE_CACHE_2Q:
+		if( cache->queues[PAGE_CACHE_QUEUE_PROBATION].size >=
+			cache->probation_capacity )
+			frame = queue_victim(cache, PAGE_CACHE_QUEUE_PROBATION);
+		if( frame == -1 )
+			frame = queue_victim(cache, PAGE_CACHE_QUEUE_MAIN);
+		if( frame == -1 )
+			frame = queue_victim(cache, PAGE_CACHE_QUEUE_PROBATION);
+		break;
+	case PAGE_CACHE_LRU:
+		frame = queue_victim(cache, PAGE_CACHE_QUEUE_MAIN);
+		break;
 	}
+
+	return frame;
 }
 
+/**
+ * @brief Removes an unreferenced frame's page from the cache.
+ */
 static void
-cache_evict(struct PageCache* cache, struct Page** r_evicted_page)
+evict_frame(
+	struct PageCache* cache,
+	int evict_index,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
 {
-	assert(cache->size != 0);
-	int evict_index = -1;
+	struct PageCacheKey* pck = &cache->pages[evict_index];
+	assert(pck->ref == 0);
 
-	// TODO: Selection algorithm.
-	for( int i = 0; i < cache->size; i++ )
+	*r_evicted_page = pck->page;
+	if( r_evicted_dirty )
+		*r_evicted_dirty = pck->dirty;
+	if( pck->dirty )
+		cache->ndirty -= 1;
+
+	if( cache->policy == PAGE_CACHE_2Q &&
+		pck->queue == PAGE_CACHE_QUEUE_PROBATION )
+		ghost_push(cache, pck->page_id);
+
+	char page_found = 0;
+	u32 slot = find_in_cache(cache, pck->page_id, &page_found);
+	assert(page_found);
+	table_remove(cache, slot);
+	if( cache->policy != PAGE_CACHE_CLOCK )
+		queue_unlink(cache, evict_index);
+
+	memset(pck, 0x00, sizeof(*pck));
+	cache->size -= 1;
+}
+
+/**
+ * @brief Moves an in-use frame to an empty one, fixing up the page table
+ * and queue links.
+ */
+static void
+move_frame(struct PageCache* cache, int from, int to)
+{
+	struct PageCacheKey* pck = &cache->pages[from];
+	struct PageCacheQueue* queue = &cache->queues[(int)pck->queue];
+
+	char page_found = 0;
+	u32 slot = find_in_cache(cache, pck->page_id, &page_found);
+	assert(page_found);
+	cache->table[slot] = to + 1;
+
+	if( cache->policy != PAGE_CACHE_CLOCK )
 	{
-		if( cache->pages[i].ref == 0 )
-		{
-			evict_index = i;
-			break;
-		}
+		if( pck->lru_prev != -1 )
+			cache->pages[pck->lru_prev].lru_next = to;
+		else
+			queue->head = to;
+
+		if( pck->lru_next != -1 )
+			cache->pages[pck->lru_next].lru_prev = to;
+		else
+			queue->tail = to;
 	}
 
-	assert(evict_index != -1);
+	cache->pages[to] = *pck;
+	memset(pck, 0x00, sizeof(*pck));
+}
 
-	*r_evicted_page = cache->pages[evict_index].page;
+/**
+ * @brief page_cache_evict with the mutex held.
+ */
+static enum pager_e
+evict(
+	struct PageCache* cache,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
+{
+	int frame = cache->size > 0 ? select_victim(cache) : -1;
+	if( frame == -1 )
+		return PAGER_ERR_CACHE_MISS;
 
-	memmove(
-		&cache->pages[evict_index],
-		&cache->pages[evict_index + 1],
-		sizeof(cache->pages[0]) * (cache->capacity - 1 - (evict_index)));
-	memset(&cache->pages[cache->capacity - 1], 0x00, sizeof(cache->pages[0]));
+	evict_frame(cache, frame, r_evicted_page, r_evicted_dirty);
 
-	cache->size -= 1;
+	// Keep the in-use frames at the front.
+	if( frame != cache->size )
+		move_frame(cache, cache->size, frame);
+
+	if( cache->hand >= cache->size )
+		cache->hand = 0;
+
+	return PAGER_OK;
 }
 
 enum pager_e
-page_cache_insert(
-	struct PageCache* cache, struct Page* page, struct Page** r_evicted_page)
+page_cache_evict(
+	struct PageCache* cache,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
+{
+	bt_mutex_lock(&cache->mutex);
+	enum pager_e result = evict(cache, r_evicted_page, r_evicted_dirty);
+	bt_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+/**
+ * @brief Double the frames and rebuild the page table for them.
+ */
+static enum pager_e
+grow(struct PageCache* cache)
+{
+	int capacity = cache->capacity * 2;
+	u32 table_size = table_size_for(capacity);
+
+	int* table = (int*)calloc(table_size, sizeof(int));
+	if( !table )
+		return PAGER_ERR_NO_MEM;
+
+	struct PageCacheKey* pages = (struct PageCacheKey*)realloc(
+		cache->pages, sizeof(struct PageCacheKey) * capacity);
+	if( !pages )
+	{
+		free(table);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	memset(
+		pages + cache->capacity,
+		0x00,
+		sizeof(struct PageCacheKey) * (capacity - cache->capacity));
+
+	free(cache->table);
+	cache->pages = pages;
+	cache->capacity = capacity;
+	cache->table = table;
+	cache->table_mask = table_size - 1;
+
+	for( int i = 0; i < cache->size; i++ )
+	{
+		u32 slot = find_in_cache(cache, cache->pages[i].page_id, NULL);
+		cache->table[slot] = i + 1;
+	}
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief page_cache_insert with the mutex held.
+ */
+static enum pager_e
+insert(
+	struct PageCache* cache,
+	struct Page* page,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
 {
 	assert(r_evicted_page);
 	assert(page->page_id != 0);
 
+	// Frames fill in order until the cache is full; after that a page only
+	// goes into the frame its evicted page left.
+	int frame = cache->size;
+
 	// We need to evict to make room for this page.
 	if( cache->size == cache->capacity )
-		cache_evict(cache, r_evicted_page);
+	{
+		frame = select_victim(cache);
+		if( frame != -1 )
+			evict_frame(cache, frame, r_evicted_page, r_evicted_dirty);
+		else
+		{
+			enum pager_e result = grow(cache);
+			if( result != PAGER_OK )
+				return result;
+			frame = cache->size;
+		}
+	}
 
 	char page_found = 0;
-	int cache_index = find_in_cache(cache, page->page_id, &page_found);
+	u32 slot = find_in_cache(cache, page->page_id, &page_found);
 	assert(page_found == 0);
 
-	memmove(
-		&cache->pages[cache_index + 1],
-		&cache->pages[cache_index],
-		sizeof(cache->pages[0]) * ((cache->capacity - 1) - cache_index));
-
-	struct PageCacheKey* pck = &cache->pages[cache_index];
+	struct PageCacheKey* pck = &cache->pages[frame];
 	pck->page = page;
 	pck->page_id = page->page_id;
 	pck->ref = 1;
+	pck->dirty = 0;
 
-	assert_cache_correct(cache);
+	cache->table[slot] = frame + 1;
+
+	switch( cache->policy )
+	{
+	case PAGE_CACHE_CLOCK:
+		pck->referenced = 0;
+		break;
+	case PAGE_CACHE_2Q:
+		queue_push_front(
+			cache,
+			ghost_take(cache, page->page_id) ? PAGE_CACHE_QUEUE_MAIN
+											 : PAGE_CACHE_QUEUE_PROBATION,
+			frame);
+		break;
+	case PAGE_CACHE_LRU:
+		queue_push_front(cache, PAGE_CACHE_QUEUE_MAIN, frame);
+		break;
+	}
 
 	cache->size += 1;
 	return PAGER_OK;
 }
+
+enum pager_e
+page_cache_insert(
+	struct PageCache* cache,
+	struct Page* page,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
+{
+	bt_mutex_lock(&cache->mutex);
+	enum pager_e result =
+		insert(cache, page, r_evicted_page, r_evicted_dirty);
+	bt_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+enum pager_e
+page_cache_set_dirty(struct PageCache* cache, int page_number, char dirty)
+{
+	char page_found = 0;
+
+	bt_mutex_lock(&cache->mutex);
+
+	u32 slot = find_in_cache(cache, page_number, &page_found);
+	if( !page_found )
+	{
+		bt_mutex_unlock(&cache->mutex);
+		return PAGER_ERR_CACHE_MISS;
+	}
+
+	int frame = cache->table[slot] - 1;
+	struct PageCacheKey* pck = &cache->pages[frame];
+	dirty = dirty ? 1 : 0;
+	cache->ndirty += dirty - pck->dirty;
+	pck->dirty = dirty;
+
+	// Keep pinned frames off the queues victims come from.
+	if( cache->pin_dirty && cache->policy != PAGE_CACHE_CLOCK &&
+		dirty != (pck->queue == PAGE_CACHE_QUEUE_PINNED) )
+	{
+		queue_unlink(cache, frame);
+		queue_push_front(
+			cache,
+			dirty ? PAGE_CACHE_QUEUE_PINNED : PAGE_CACHE_QUEUE_MAIN,
+			frame);
+	}
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief page_cache_pin_dirty with the mutex held.
+ */
+static void
+pin_dirty(struct PageCache* cache, char pin)
+{
+	if( cache->pin_dirty == pin )
+		return;
+
+	cache->pin_dirty = pin;
+	if( cache->policy == PAGE_CACHE_CLOCK )
+		return;
+
+	for( int i = 0; i < cache->size; i++ )
+	{
+		struct PageCacheKey* pck = &cache->pages[i];
+		if( pin ? !pck->dirty : pck->queue != PAGE_CACHE_QUEUE_PINNED )
+			continue;
+
+		queue_unlink(cache, i);
+		queue_push_front(
+			cache, pin ? PAGE_CACHE_QUEUE_PINNED : PAGE_CACHE_QUEUE_MAIN, i);
+	}
+}
+
+void
+page_cache_pin_dirty(struct PageCache* cache, char pin)
+{
+	bt_mutex_lock(&cache->mutex);
+	pin_dirty(cache, pin ? 1 : 0);
+	bt_mutex_unlock(&cache->mutex);
+}
+
+enum pager_e
+page_cache_trim(
+	struct PageCache* cache,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty)
+{
+	enum pager_e result = PAGER_ERR_CACHE_MISS;
+
+	bt_mutex_lock(&cache->mutex);
+
+	if( cache->size > cache->base_capacity &&
+		evict(cache, r_evicted_page, r_evicted_dirty) == PAGER_OK )
+		result = PAGER_OK;
+	else
+		cache->capacity = cache->size > cache->base_capacity
+							  ? cache->size
+							  : cache->base_capacity;
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return result;
+}
+
+char
+page_cache_is_dirty(struct PageCache* cache, int page_number)
+{
+	char page_found = 0;
+
+	bt_mutex_lock(&cache->mutex);
+
+	u32 slot = find_in_cache(cache, page_number, &page_found);
+	char dirty = page_found && cache->pages[cache->table[slot] - 1].dirty;
+
+	bt_mutex_unlock(&cache->mutex);
+
+	return dirty;
+}
+
+static int
+compare_page_id(void const* left, void const* right)
+{
+	u32 left_id = (*(struct Page* const*)left)->page_id;
+	u32 right_id = (*(struct Page* const*)right)->page_id;
+
+	return (left_id > right_id) - (left_id < right_id);
+}
+
+int
+page_cache_collect_dirty(struct PageCache* cache, struct Page** r_pages)
+{
+	int num = 0;
+
+	bt_mutex_lock(&cache->mutex);
+
+	for( int i = 0; i < cache->size; i++ )
+	{
+		if( cache->pages[i].dirty )
+			r_pages[num++] = cache->pages[i].page;
+	}
+
+	bt_mutex_unlock(&cache->mutex);
+
+	qsort(r_pages, num, sizeof(r_pages[0]), &compare_page_id);
+
+	return num;
+}
+
+static struct PageLatchShard*
+latch_shard(struct PageCache* cache, u32 page_id)
+{
+	return &cache->latches[(page_id * 0x9E3779B1u) >> 26];
+}
+
+#define VERSION_WRITER 1u
+#define VERSION_RELEASE (1u << 16)
+#define VERSION_WRITERS_MASK (VERSION_RELEASE - 1)
+
+static u32*
+version_slot(struct PageCache* cache, u32 page_id)
+{
+	// Top 12 bits of the Fibonacci hash.
+	return &cache->versions[(page_id * 0x9E3779B1u) >> 20];
+}
+
+static struct PageLatch**
+latch_bucket(struct PageLatchShard* shard, u32 page_id)
+{
+	return &shard->buckets[page_id % PAGE_LATCH_BUCKETS];
+}
+
+/**
+ * @brief Find the latch of page_id in its shard, or add an unheld one.
+ */
+static struct PageLatch*
+latch_get(struct PageLatchShard* shard, u32 page_id)
+{
+	struct PageLatch** bucket = latch_bucket(shard, page_id);
+	struct PageLatch* latch = *bucket;
+
+	while( latch && latch->page_id != page_id )
+		latch = latch->next;
+	if( latch )
+		return latch;
+
+	if( shard->spare )
+	{
+		latch = shard->spare;
+		shard->spare = latch->next;
+	}
+	else
+	{
+		latch = (struct PageLatch*)malloc(sizeof(struct PageLatch));
+		if( !latch )
+			return NULL;
+	}
+
+	memset(latch, 0x00, sizeof(*latch));
+	latch->page_id = page_id;
+	latch->next = *bucket;
+	*bucket = latch;
+
+	return latch;
+}
+
+/**
+ * @brief Move the latch to the spare list once nobody holds or waits for it.
+ */
+static void
+latch_put(struct PageLatchShard* shard, struct PageLatch* latch)
+{
+	if( latch->holders != 0 || latch->waiting != 0 )
+		return;
+
+	struct PageLatch** link = latch_bucket(shard, latch->page_id);
+	while( *link != latch )
+		link = &(*link)->next;
+	*link = latch->next;
+
+	latch->next = shard->spare;
+	shard->spare = latch;
+}
+
+enum pager_e
+page_cache_latch(struct PageCache* cache, u32 page_id, enum page_latch_e mode)
+{
+	struct PageLatchShard* shard = latch_shard(cache, page_id);
+
+	bt_mutex_lock(&shard->mutex);
+
+	struct PageLatch* latch = latch_get(shard, page_id);
+	if( !latch )
+	{
+		bt_mutex_unlock(&shard->mutex);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	latch->waiting += 1;
+	if( mode == PAGE_LATCH_EXCLUSIVE )
+	{
+		latch->writers_waiting += 1;
+		while( latch->holders != 0 )
+			bt_cond_wait(&shard->released, &shard->mutex);
+		latch->writers_waiting -= 1;
+		latch->holders = -1;
+
+		// Before anything in the page can change.
+		bt_atomic_add(version_slot(cache, page_id), VERSION_WRITER);
+	}
+	else
+	{
+		while( latch->holders < 0 || latch->writers_waiting > 0 )
+			bt_cond_wait(&shard->released, &shard->mutex);
+		latch->holders += 1;
+	}
+	latch->waiting -= 1;
+
+	bt_mutex_unlock(&shard->mutex);
+
+	return PAGER_OK;
+}
+
+void
+page_cache_unlatch(struct PageCache* cache, u32 page_id, enum page_latch_e mode)
+{
+	struct PageLatchShard* shard = latch_shard(cache, page_id);
+
+	bt_mutex_lock(&shard->mutex);
+
+	struct PageLatch* latch = *latch_bucket(shard, page_id);
+	while( latch->page_id != page_id )
+		latch = latch->next;
+
+	if( mode == PAGE_LATCH_EXCLUSIVE )
+	{
+		assert(latch->holders == -1);
+		latch->holders = 0;
+
+		bt_atomic_add(
+			version_slot(cache, page_id), VERSION_RELEASE - VERSION_WRITER);
+	}
+	else
+	{
+		assert(latch->holders > 0);
+		latch->holders -= 1;
+	}
+
+	if( latch->holders == 0 && latch->waiting > 0 )
+		bt_cond_broadcast(&shard->released);
+	latch_put(shard, latch);
+
+	bt_mutex_unlock(&shard->mutex);
+}
+
+char
+page_cache_try_latch(
+	struct PageCache* cache, u32 page_id, enum page_latch_e mode)
+{
+	struct PageLatchShard* shard = latch_shard(cache, page_id);
+	char latched = 0;
+
+	bt_mutex_lock(&shard->mutex);
+
+	struct PageLatch* latch = latch_get(shard, page_id);
+	if( !latch )
+		goto end;
+
+	if( mode == PAGE_LATCH_EXCLUSIVE )
+	{
+		if( latch->holders == 0 )
+		{
+			latch->holders = -1;
+			bt_atomic_add(version_slot(cache, page_id), VERSION_WRITER);
+			latched = 1;
+		}
+	}
+	else if( latch->holders >= 0 && latch->writers_waiting == 0 )
+	{
+		latch->holders += 1;
+		latched = 1;
+	}
+
+	latch_put(shard, latch);
+
+end:
+	bt_mutex_unlock(&shard->mutex);
+
+	return latched;
+}
+
+void
+page_cache_write_begin(struct PageCache* cache)
+{
+	bt_mutex_lock(&cache->gate_mutex);
+	while( cache->quiescing > 0 )
+		bt_cond_wait(&cache->gate_changed, &cache->gate_mutex);
+	cache->writing += 1;
+	bt_mutex_unlock(&cache->gate_mutex);
+}
+
+void
+page_cache_write_end(struct PageCache* cache)
+{
+	bt_mutex_lock(&cache->gate_mutex);
+	assert(cache->writing > 0);
+	cache->writing -= 1;
+	if( cache->writing == 0 )
+		bt_cond_broadcast(&cache->gate_changed);
+	bt_mutex_unlock(&cache->gate_mutex);
+}
+
+void
+page_cache_quiesce(struct PageCache* cache)
+{
+	bt_mutex_lock(&cache->gate_mutex);
+	cache->quiescing += 1;
+	while( cache->writing > 0 )
+		bt_cond_wait(&cache->gate_changed, &cache->gate_mutex);
+	bt_mutex_unlock(&cache->gate_mutex);
+}
+
+void
+page_cache_quiesce_end(struct PageCache* cache)
+{
+	bt_mutex_lock(&cache->gate_mutex);
+	assert(cache->quiescing > 0);
+	cache->quiescing -= 1;
+	if( cache->quiescing == 0 )
+		bt_cond_broadcast(&cache->gate_changed);
+	bt_mutex_unlock(&cache->gate_mutex);
+}
+
+u32
+page_cache_version(struct PageCache* cache, u32 page_id)
+{
+	u32 version = bt_atomic_load(version_slot(cache, page_id));
+
+	// Never 0 otherwise; the writer bits are clear.
+	return (version & VERSION_WRITERS_MASK) ? 0 : version | 1;
+}
+
+void
+page_cache_reset_stats(struct PageCache* cache)
+{
+	bt_mutex_lock(&cache->mutex);
+	cache->hits = 0;
+	cache->misses = 0;
+	bt_mutex_unlock(&cache->mutex);
+}
@@ -1,22 +1,168 @@
 #ifndef PAGE_CACHE_H_
 #define PAGE_CACHE_H_
 
+#include "btint.h"
+#include "btthread.h"
 #include "page_defs.h"
 #include "pager_e.h"
 
+/**
+ * @brief Which unreferenced page to evict when the cache is full.
+ */
+enum page_cache_policy_e
+{
+	// Least recently acquired.
+	PAGE_CACHE_LRU,
+	// Second chance; one reference bit per frame and a sweeping hand.
+	PAGE_CACHE_CLOCK,
+	// Simplified 2Q. Pages enter a FIFO probation queue and only move to
+	// the main LRU queue when they are read again after leaving it, so a
+	// one-pass scan does not flush pages that are used repeatedly.
+	PAGE_CACHE_2Q,
+};
+
+// 2Q queues; LRU and CLOCK only use PAGE_CACHE_QUEUE_MAIN.
+#define PAGE_CACHE_QUEUE_MAIN 0
+#define PAGE_CACHE_QUEUE_PROBATION 1
+// Dirty frames while pin_dirty is set (LRU and 2Q); never a victim.
+#define PAGE_CACHE_QUEUE_PINNED 2
+#define PAGE_CACHE_NQUEUES 3
+
+/**
+ * @brief A cache frame.
+ */
 struct PageCacheKey
 {
 	int page_id;
 	struct Page* page;
 
 	int ref;
+	// Written in the cache but not yet on disk.
+	char dirty;
+
+	// CLOCK reference bit.
+	char referenced;
+	// Which queue the frame is on.
+	char queue;
+	// Queue links; frame indexes, -1 at either end.
+	int lru_prev;
+	int lru_next;
+};
+
+enum page_latch_e
+{
+	PAGE_LATCH_SHARED,
+	PAGE_LATCH_EXCLUSIVE,
 };
 
+/**
+ * @brief A page's reader/writer latch. Only exists while it is held or
+ * waited for.
+ */
+struct PageLatch
+{
+	u32 page_id;
+	// Shared holders, or -1 while held exclusive.
+	int holders;
+	int waiting;
+	// Waiting to latch it exclusive; new shared holders wait behind them.
+	int writers_waiting;
+	struct PageLatch* next;
+};
+
+#define PAGE_LATCH_SHARDS 64
+#define PAGE_LATCH_BUCKETS 16
+// Page versions; see page_cache_version.
+#define PAGE_VERSION_SLOTS 4096
+
+/**
+ * @brief Latches hash to a shard by page id; each shard has its own mutex,
+ * so threads latching different pages rarely meet.
+ */
+struct PageLatchShard
+{
+	bt_mutex mutex;
+	bt_cond released;
+	struct PageLatch* buckets[PAGE_LATCH_BUCKETS];
+	// Unused latches, kept for reuse.
+	struct PageLatch* spare;
+};
+
+struct PageCacheQueue
+{
+	// Most recently inserted (LRU: used) at the head.
+	int head;
+	int tail;
+	int size;
+};
+
+/**
+ * @brief Array of frames plus an open-addressing page table mapping page ids
+ * to frames.
+ *
+ * Lookups are one hash probe sequence and every replacement policy evicts
+ * without scanning the whole cache, so acquire, release and insert do not
+ * depend on the capacity.
+ */
 struct PageCache
 {
+	enum page_cache_policy_e policy;
+
+	// capacity frames; the first size are in use.
 	struct PageCacheKey* pages;
 	int size;
 	int capacity;
+	// Capacity asked for at create; the cache only grows past it when every
+	// frame is referenced or pinned. See page_cache_trim.
+	int base_capacity;
+
+	// Linear probing, no tombstones. Entries are a frame index + 1; 0 is
+	// empty. table_mask + 1 is a power of two at least twice capacity.
+	int* table;
+	u32 table_mask;
+
+	struct PageCacheQueue queues[PAGE_CACHE_NQUEUES];
+
+	// CLOCK hand; a frame index.
+	int hand;
+
+	// 2Q: page ids recently evicted from probation, oldest at ghost_head,
+	// plus a hash set of the same ids (0 is empty) for lookups.
+	u32* ghosts;
+	int ghost_head;
+	int ghost_count;
+	int ghost_capacity;
+	u32* ghost_table;
+	u32 ghost_mask;
+	int probation_capacity;
+
+	int ndirty;
+	// Dirty pages are not evicted; see page_cache_pin_dirty.
+	char pin_dirty;
+
+	// Guards the frames, table, queues, ghosts and counters. Every
+	// page_cache_* function takes it and holds it only for the call; it
+	// is never held across I/O, and the cache never takes the pager's lock
+	// while holding it.
+	bt_mutex mutex;
+
+	// Page latches; PAGE_LATCH_SHARDS of them, each with its own mutex.
+	struct PageLatchShard* latches;
+	// PAGE_VERSION_SLOTS words, by page id hash, only accessed atomically.
+	// The low half counts exclusive latches held on the slot's pages; the
+	// high half counts their releases.
+	u32* versions;
+
+	// Tree operations that change pages, between page_cache_write_begin
+	// and page_cache_write_end, and callers of page_cache_quiesce waiting
+	// for them or holding new ones off. Guarded by gate_mutex.
+	bt_mutex gate_mutex;
+	bt_cond gate_changed;
+	int writing;
+	int quiescing;
+
+	u64 hits;
+	u64 misses;
 };
 
 // Page Cache does not load pages
@@ -31,21 +177,159 @@ struct PageCache
 //   - evict on no space; crash if no eviction
 
 enum pager_e page_cache_create(struct PageCache**, int);
+/**
+ * @brief page_cache_create with a replacement policy; page_cache_create uses
+ * PAGE_CACHE_LRU.
+ */
+enum pager_e page_cache_create_ex(
+	struct PageCache**, int capacity, enum page_cache_policy_e policy);
 enum pager_e page_cache_destroy(struct PageCache*);
 
+/**
+ * @brief Acquire a cached page; counts a hit or a miss.
+ *
+ * @return PAGER_ERR_CACHE_MISS if the page is not cached.
+ */
 enum pager_e page_cache_acquire(
 	struct PageCache* cache, int page_number, struct Page** r_page);
+
+/**
+ * @brief page_cache_acquire that is not a use of the page; it does not count
+ * as a hit or miss and does not affect replacement.
+ */
+enum pager_e
+page_cache_peek(struct PageCache* cache, int page_number, struct Page** r_page);
 enum pager_e page_cache_release(struct PageCache* cache, struct Page* page);
 
 /**
  * @brief Inserts page into cache and acquires
  *
+ * The page is inserted clean. If no page can be evicted, because every page
+ * is referenced or pinned dirty, the cache doubles its capacity instead.
+ *
  * @param cache
  * @param page
  * @param r_evicted_page Evicted page if there is one.
+ * @param r_evicted_dirty Optional; set if the evicted page was dirty. The
+ * caller must write it back before destroying it.
  * @return enum pager_e
  */
 enum pager_e page_cache_insert(
-	struct PageCache* cache, struct Page* page, struct Page** r_evicted_page);
+	struct PageCache* cache,
+	struct Page* page,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty);
+
+/**
+ * @brief Evicts one unreferenced page chosen by the cache policy.
+ *
+ * @param r_evicted_dirty Optional; set if the page was dirty.
+ * @return PAGER_ERR_CACHE_MISS if every cached page is referenced or the
+ * cache is empty.
+ */
+enum pager_e page_cache_evict(
+	struct PageCache* cache,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty);
+
+/**
+ * @brief Set or clear the dirty bit of a cached page.
+ *
+ * @return PAGER_ERR_CACHE_MISS if the page is not cached.
+ */
+enum pager_e
+page_cache_set_dirty(struct PageCache* cache, int page_number, char dirty);
+
+/**
+ * @brief While set, dirty pages are never evicted, so nothing reaches the disk
+ * until they are cleaned; the cache grows if it fills up with them. Clearing
+ * it makes them evictable again.
+ */
+void page_cache_pin_dirty(struct PageCache* cache, char pin);
+
+/**
+ * @brief Evict one unreferenced page while the cache holds more than its
+ * base capacity. Once it doesn't, the capacity goes back down.
+ *
+ * @param r_evicted_dirty Optional; set if the page was dirty.
+ * @return PAGER_ERR_CACHE_MISS when there is nothing more to evict.
+ */
+enum pager_e page_cache_trim(
+	struct PageCache* cache,
+	struct Page** r_evicted_page,
+	char* r_evicted_dirty);
+
+/**
+ * @brief Whether the page is cached and dirty.
+ */
+char page_cache_is_dirty(struct PageCache* cache, int page_number);
+
+/**
+ * @brief Collects the dirty pages, in page id order.
+ *
+ * @param r_pages Room for at least cache->ndirty pages; the cache keeps
+ * ownership.
+ * @return int Number of pages collected.
+ */
+int page_cache_collect_dirty(struct PageCache* cache, struct Page** r_pages);
+
+/**
+ * @brief Latch page_id, waiting for it if another thread holds it in a mode
+ * that conflicts. Latches are independent of the frames; the page need not
+ * be cached and stays evictable.
+ *
+ * Latches are not recursive; a thread must not latch a page it holds.
+ *
+ * @return PAGER_ERR_NO_MEM
+ */
+enum pager_e
+page_cache_latch(struct PageCache* cache, u32 page_id, enum page_latch_e mode);
+
+void page_cache_unlatch(
+	struct PageCache* cache, u32 page_id, enum page_latch_e mode);
+
+/**
+ * @brief page_cache_latch, unless that would wait.
+ *
+ * @return 1 if page_id is now latched; 0 if it is held in a mode that
+ * conflicts, or on PAGER_ERR_NO_MEM.
+ */
+char page_cache_try_latch(
+	struct PageCache* cache, u32 page_id, enum page_latch_e mode);
+
+/**
+ * @brief Count a tree operation that changes pages as in flight, waiting
+ * first while page_cache_quiesce holds new ones off. Cursors call it before
+ * their first exclusive latch and page_cache_write_end after their last.
+ */
+void page_cache_write_begin(struct PageCache* cache);
+void page_cache_write_end(struct PageCache* cache);
+
+/**
+ * @brief Wait until no operation is between page_cache_write_begin and
+ * page_cache_write_end, and hold new ones off until page_cache_quiesce_end.
+ * Pages flushed or dropped meanwhile are never half way through a split or
+ * a merge. The caller must not hold latches, or an operation waiting for
+ * one never finishes.
+ */
+void page_cache_quiesce(struct PageCache* cache);
+void page_cache_quiesce_end(struct PageCache* cache);
+
+/**
+ * @brief Version of page_id for optimistic reads, without latching it. The
+ * version changes whenever an exclusive latch on the page is released, so a
+ * reader that gets the same version before and after reading the page saw
+ * no write. Pages share versions by hash; an unrelated write may look like
+ * a conflict, but a write to the page never goes unseen.
+ *
+ * @return 0 while the page, or one sharing its version, is latched
+ * exclusive.
+ */
+u32 page_cache_version(struct PageCache* cache, u32 page_id);
+
+/**
+ * @brief Zero the hit and miss counters.
+ */
+void page_cache_reset_stats(struct PageCache* cache);
 
 #endif
@@ -2,6 +2,7 @@
 #define PAGE_DEFS_H_
 
 #include "btint.h"
+#include "btthread.h"
 #include "pager_e.h"
 
 #define PAGE_CREATE_NEW_PAGE 0
@@ -18,20 +19,146 @@ struct Page
 	enum pager_e status;
 
 	void* page_buffer;
+	// The buffer allocated with the page. Normally the same as page_buffer;
+	// when the page is borrowed, page_buffer points at memory owned by the
+	// pager (e.g. a read-only mapping) instead.
+	void* owned_buffer;
+	// Set when page_buffer is a page cache frame's buffer; the page holds a
+	// cache reference on the frame until it is unborrowed.
+	struct Page* pinned_frame;
+};
+
+struct PagePoolStats
+{
+	// page_create calls.
+	u64 page_creates;
+	// Blocks allocated from and returned to the system; page_creates that
+	// reuse a pooled block don't count.
+	u64 block_allocs;
+	u64 block_frees;
+};
+
+#define PAGE_POOL_LISTS 8
+
+/**
+ * @brief One of the pool's free lists; each thread uses one of them.
+ */
+struct PagePoolList
+{
+	bt_mutex mutex;
+	// Linked through the first word of each free block.
+	void* free_list;
+	u32 free_count;
+
+	struct PagePoolStats stats;
+};
+
+/**
+ * @brief Free lists of page blocks. A block is the Page header followed by a
+ * cache-line-aligned disk page buffer, so page_create is one allocation, or
+ * none when a block is reused.
+ *
+ * Threads are spread over PAGE_POOL_LISTS lists, each with its own mutex,
+ * so creating and destroying pages does not take the pager's lock and
+ * threads rarely share a list. A block goes back to the list of the thread
+ * that destroys it.
+ */
+struct PagePool
+{
+	struct PagePoolList lists[PAGE_POOL_LISTS];
+};
+
+/**
+ * @brief When the pager asks the backend to make writes durable.
+ */
+enum pager_durability_e
+{
+	// PAGER_DURABILITY_NORMAL.
+	PAGER_DURABILITY_DEFAULT,
+	// Never sync. Survives the process crashing but not the machine; a power
+	// loss can lose or tear recent commits. For bulk loads that can be
+	// redone.
+	PAGER_DURABILITY_OFF,
+	// Sync at commit: pager_sync and pager_destroy. With a log, the log is
+	// also synced before a checkpoint writes its pages to the database file.
+	PAGER_DURABILITY_NORMAL,
+	// Also sync at every barrier: each pager_flush is durable when it
+	// returns.
+	PAGER_DURABILITY_FULL,
+};
+
+/**
+ * @brief In-memory side of the free list.
+ *
+ * On disk the free list is a chain of trunk pages starting at the id in
+ * page 1's meta. A trunk's body is a count followed by that many free page
+ * ids. Freed pages are queued in pending and moved into trunks by
+ * pager_freelist_commit.
+ */
+struct PagerFreelist
+{
+	// First trunk page, 0 if none. Page 1's meta is stamped with it on
+	// write and on commit.
+	u32 head;
+	// Set when head moved since page 1 was last stamped.
+	char head_dirty;
+
+	u32* pending;
+	u32 npending;
+	u32 pending_capacity;
+};
+
+/**
+ * @brief What pager_rollback puts back; see pager_begin.
+ */
+struct PagerTxn
+{
+	char active;
+	u32 max_page;
+	u32 freelist_head;
 };
 
 struct Pager
 {
+	// Taken by every pager call that does I/O or changes the pager, so
+	// threads can share the pager. Guards the pager, its page pool, logs
+	// and backend, but not what is in the pages (see page_cache_latch)
+	// nor the cache, which locks itself; reads that hit the cache do not
+	// take it. Taken before the cache's mutex. Recursive since pager calls
+	// nest.
+	bt_rmutex lock;
+
 	char pager_name_str[32];
 	struct PagerOps* ops;
 	// Size of page as it's allocated on disk.
 	u32 disk_page_size;
 	// Size of page useable by client modules.
 	u32 page_size;
+	// Page ids are 32-bit on disk; file offsets are computed in 64-bit so the
+	// file may grow to 2^32 pages.
 	u32 max_page;
 	void* file;
 
 	struct PageCache* cache;
+
+	struct PagePool pool;
+
+	struct PagerFreelist freelist;
+
+	// Write-ahead log; NULL unless pager_enable_wal was called.
+	struct PagerWal* wal;
+	// NULL unless pager_start_checkpointer was called.
+	struct PagerCheckpointer* checkpointer;
+	// Page map for shadow paging; NULL unless pager_enable_shadow was
+	// called.
+	struct PagerShadow* shadow;
+	// Open snapshots; see pager_snapshot.h.
+	struct PagerSnapshot* snapshots;
+
+	// Never PAGER_DURABILITY_DEFAULT.
+	enum pager_durability_e durability;
+
+	struct PagerTxn txn;
 };
 
 #endif
@@ -3,8 +3,12 @@
 #include "page.h"
 #include "page_cache.h"
 #include "pagemeta.h"
+#include "pager_checkpointer.h"
 #include "pager_freelist.h"
 #include "pager_internal.h"
+#include "pager_shadow.h"
+#include "pager_snapshot.h"
+#include "pager_wal.h"
 #include "serialization.h"
 
 #include <assert.h>
@@ -29,6 +33,8 @@ pager_alloc(struct Pager** r_pager)
 enum pager_e
 pager_dealloc(struct Pager* pager)
 {
+	page_pool_deinit(pager);
+	bt_rmutex_destroy(&pager->lock);
 	free(pager);
 	return PAGER_OK;
 }
@@ -41,11 +47,14 @@ pager_init(
 	int disk_page_size)
 {
 	memset(pager, 0x00, sizeof(*pager));
+	bt_rmutex_init(&pager->lock);
+	page_pool_init(pager);
 	pager->disk_page_size = disk_page_size;
 	pager->page_size = disk_page_size - pagemeta_size();
 	pager->ops = ops;
 
 	pager->cache = cache;
+	pager->durability = PAGER_DURABILITY_NORMAL;
 
 	return PAGER_OK;
 }
@@ -53,6 +62,7 @@ pager_init(
 enum pager_e
 pager_deinit(struct Pager* pager)
 {
+	pager_freelist_deinit(pager);
 	return PAGER_OK;
 }
 
@@ -64,11 +74,17 @@ pager_open(struct Pager* pager, char const* pager_str)
 		pager_str,
 		min(sizeof(pager->pager_name_str) - 1, strlen(pager_str)));
 
-	pager->ops->open(&pager->file, pager->pager_name_str);
-	int size = pager->ops->size(pager->file);
-	pager->max_page = size / pager->disk_page_size;
+	enum pager_e result = pager->ops->open(&pager->file, pager->pager_name_str);
+	if( result != PAGER_OK )
+		return result;
 
-	return PAGER_OK;
+	i64 size = pager->ops->size(pager->file);
+	if( size < 0 )
+		return PAGER_SEEK_ERR;
+
+	pager->max_page = (u32)((u64)size / pager->disk_page_size);
+
+	return pager_freelist_load(pager);
 }
 
 enum pager_e
@@ -101,22 +117,195 @@ err:
 	return pager_result;
 }
 
+/**
+ * @brief Destroy the cached pages; they were allocated from this pager.
+ */
+static void
+release_cached_pages(struct Pager* pager)
+{
+	struct Page* page = NULL;
+	while( page_cache_evict(pager->cache, &page, NULL) == PAGER_OK )
+		page_destroy(pager, page);
+}
+
+enum pager_e
+pager_enable_wal(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+	char wal_name[sizeof(pager->pager_name_str) + 8];
+
+	assert(pager->wal == NULL);
+	assert(pager->shadow == NULL);
+	assert(pager->cache->ndirty == 0);
+
+	snprintf(wal_name, sizeof(wal_name), "%s-wal", pager->pager_name_str);
+
+	result = pager_wal_open(
+		&pager->wal, pager->ops, wal_name, pager->disk_page_size);
+	if( result != PAGER_OK )
+		return result;
+
+	pager->wal->nosync = pager->durability == PAGER_DURABILITY_OFF;
+
+	// Anything cached came from the database file and may be older than the
+	// log.
+	release_cached_pages(pager);
+
+	if( pager->wal->max_page > pager->max_page )
+		pager->max_page = pager->wal->max_page;
+
+	return pager_freelist_load(pager);
+}
+
+enum pager_e
+pager_enable_shadow(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	assert(pager->wal == NULL);
+	assert(pager->shadow == NULL);
+	assert(pager->cache->ndirty == 0);
+
+	result = pager_shadow_open(
+		&pager->shadow, pager->ops, pager->file, pager->disk_page_size);
+	if( result != PAGER_OK )
+		return result;
+
+	// pager_open read the file as if page ids were file offsets.
+	release_cached_pages(pager);
+	pager->max_page = pager->shadow->max_page;
+
+	return pager_freelist_load(pager);
+}
+
+void
+pager_set_durability(struct Pager* pager, enum pager_durability_e durability)
+{
+	assert(pager->checkpointer == NULL);
+
+	if( durability == PAGER_DURABILITY_DEFAULT )
+		durability = PAGER_DURABILITY_NORMAL;
+
+	pager->durability = durability;
+	if( pager->wal )
+		pager->wal->nosync = durability == PAGER_DURABILITY_OFF;
+}
+
+enum pager_e
+pager_start_checkpointer(
+	struct Pager* pager, struct PagerCheckpointerOpts const* opts)
+{
+	assert(pager->wal != NULL);
+	assert(pager->checkpointer == NULL);
+
+	return pager_checkpointer_start(
+		&pager->checkpointer,
+		pager->wal,
+		pager->ops,
+		pager->pager_name_str,
+		pager->disk_page_size,
+		opts);
+}
+
+enum pager_e
+pager_wait_checkpoint(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	if( pager->checkpointer == NULL )
+		return PAGER_OK;
+
+	// The checkpointer only takes commits that are durable.
+	result = pager_wal_sync(pager->wal, pager_wal_end(pager->wal));
+	if( result != PAGER_OK )
+		return result;
+
+	return pager_checkpointer_wait(pager->checkpointer);
+}
+
+void
+pager_checkpoint_stats(
+	struct Pager* pager, struct PagerCheckpointerStats* r_stats)
+{
+	memset(r_stats, 0x00, sizeof(*r_stats));
+
+	if( pager->checkpointer )
+		pager_checkpointer_stats(pager->checkpointer, r_stats);
+	else if( pager->wal )
+	{
+		r_stats->lag_frames = pager_wal_lag(pager->wal);
+		r_stats->lag_bytes =
+			r_stats->lag_frames *
+			(PAGER_WAL_FRAME_HEADER_SIZE + pager->disk_page_size);
+	}
+}
+
 enum pager_e
 pager_destroy(struct Pager* pager)
 {
+	assert(pager->snapshots == NULL);
+
+	// An open transaction never happened.
+	if( pager->txn.active )
+		pager_rollback(pager);
+
+	enum pager_e result = pager_sync(pager);
+
+	if( pager->checkpointer )
+	{
+		enum pager_e stop_result = pager_checkpointer_stop(pager->checkpointer);
+		pager->checkpointer = NULL;
+		if( result == PAGER_OK )
+			result = stop_result;
+	}
+
+	if( pager->wal )
+	{
+		// Leave the log for recovery if its pages didn't make it into the
+		// database file.
+		if( result == PAGER_OK )
+			result = pager_internal_checkpoint(pager);
+		pager_wal_close(pager->wal, result == PAGER_OK);
+		pager->wal = NULL;
+	}
+
+	if( pager->shadow )
+	{
+		pager_shadow_close(pager->shadow);
+		pager->shadow = NULL;
+	}
+
+	release_cached_pages(pager);
+	page_pool_drain(pager);
 	pager_close(pager);
 	pager_deinit(pager);
 	pager_dealloc(pager);
-	return PAGER_OK;
+	return result;
 }
 
 enum pager_e
 pager_read_page(
 	struct Pager* pager, struct PageSelector* selector, struct Page* page)
 {
+	// Cache hits do not take the pager's lock; a miss takes it itself.
 	return pager_internal_cached_read(pager, selector, page);
 }
 
+enum pager_e
+pager_read_page_ro(
+	struct Pager* pager, struct PageSelector* selector, struct Page* page)
+{
+	// Without a mapping this is a pinned read, which locks only on a miss.
+	if( pager->ops->map == NULL )
+		return pager_internal_pinned_read(pager, selector, page);
+
+	bt_rmutex_lock(&pager->lock);
+	enum pager_e result = pager_internal_mapped_read(pager, selector, page);
+	bt_rmutex_unlock(&pager->lock);
+
+	return result;
+}
+
 static void
 write_new_page_meta(struct Page* page, int page_number)
 {
@@ -153,8 +342,12 @@ end:
 	return result;
 }
 
+/**
+ * @brief Page 1 carries the free list head in its meta; stamp the current
+ * head whenever it is written.
+ */
 static void
-set_in_use(struct Page* page)
+set_in_use(struct Pager* pager, struct Page* page)
 {
 	struct PageMetadata old;
 	pagemeta_read(&old, page);
@@ -163,6 +356,12 @@ set_in_use(struct Page* page)
 		.next_free_page = old.next_free_page,
 		.page_number = page->page_id};
 
+	if( page->page_id == 1 )
+	{
+		meta.next_free_page = pager->freelist.head;
+		pager->freelist.head_dirty = 0;
+	}
+
 	pagemeta_write(page, &meta);
 }
 
@@ -172,6 +371,12 @@ pager_write_page(struct Pager* pager, struct Page* page)
 	assert(pager->ops);
 	enum pager_e result = PAGER_OK;
 
+	bt_rmutex_lock(&pager->lock);
+
+	result = page_make_writable(pager, page);
+	if( result != PAGER_OK )
+		goto end;
+
 	if( page->page_id == PAGE_CREATE_NEW_PAGE )
 	{
 		// Get the page
@@ -180,20 +385,280 @@ pager_write_page(struct Pager* pager, struct Page* page)
 			goto end;
 	}
 
-	set_in_use(page);
+	set_in_use(pager, page);
 
 	result = pager_internal_cached_write(pager, page);
 
 end:
+	bt_rmutex_unlock(&pager->lock);
 	return result;
 }
 
+enum pager_e
+pager_write_pages(struct Pager* pager, struct Page** pages, int num)
+{
+	assert(pager->ops);
+	enum pager_e result = PAGER_OK;
+
+	bt_rmutex_lock(&pager->lock);
+
+	// Page ids come from the freelist, which is read and written one page at
+	// a time, so assign them all before batching the page writes.
+	for( int i = 0; i < num; i++ )
+	{
+		struct Page* page = pages[i];
+		result = page_make_writable(pager, page);
+		if( result != PAGER_OK )
+			goto end;
+
+		if( page->page_id == PAGE_CREATE_NEW_PAGE )
+		{
+			result = pager_disk_page(pager, page);
+			if( result != PAGER_OK )
+				goto end;
+		}
+
+		// Later new pages in the batch must not get the same id; this is
+		// what writing the pages one at a time would have done.
+		if( page->page_id > pager->max_page )
+			pager->max_page = page->page_id;
+	}
+
+	// After every id is assigned, so page 1 gets the final free list head.
+	for( int i = 0; i < num; i++ )
+		set_in_use(pager, pages[i]);
+
+	result = pager_internal_cached_write_n(pager, pages, num);
+
+end:
+	bt_rmutex_unlock(&pager->lock);
+	return result;
+}
+
+enum pager_e
+pager_prefetch(struct Pager* pager, u32 const* page_ids, int num)
+{
+	bt_rmutex_lock(&pager->lock);
+	enum pager_e result = pager_internal_prefetch(pager, page_ids, num);
+	bt_rmutex_unlock(&pager->lock);
+
+	return result;
+}
+
+/**
+ * @brief Make everything flushed so far durable. With a log that is the log
+ * alone; checkpoints sync the database file themselves.
+ */
+static enum pager_e
+sync_files(struct Pager* pager)
+{
+	if( pager->wal )
+		return pager_wal_sync(pager->wal, pager_wal_end(pager->wal));
+
+	if( pager->ops->sync == NULL )
+		return PAGER_OK;
+
+	return pager->ops->sync(pager->file);
+}
+
+static enum pager_e
+flush(struct Pager* pager)
+{
+	enum pager_e result = pager_freelist_commit(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	result = pager_internal_flush(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	if( pager->durability == PAGER_DURABILITY_FULL )
+		result = sync_files(pager);
+
+	return result;
+}
+
+static enum pager_e
+flush_and_sync(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	result = flush(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	// The flush only wrote pages aside; the commit is the root swap.
+	if( pager->shadow )
+		return pager_shadow_commit(
+			pager->shadow,
+			pager->max_page,
+			pager->durability != PAGER_DURABILITY_OFF);
+
+	// At full durability the flush already synced.
+	if( pager->durability != PAGER_DURABILITY_NORMAL )
+		return PAGER_OK;
+
+	return sync_files(pager);
+}
+
+enum pager_e
+pager_flush(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	// Never in the middle of a tree operation; see page_cache_quiesce.
+	page_cache_quiesce(pager->cache);
+	bt_rmutex_lock(&pager->lock);
+	// The transaction's pages wait for pager_commit.
+	if( !pager->txn.active )
+		result = flush(pager);
+	bt_rmutex_unlock(&pager->lock);
+	page_cache_quiesce_end(pager->cache);
+
+	return result;
+}
+
+enum pager_e
+pager_sync(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	page_cache_quiesce(pager->cache);
+	bt_rmutex_lock(&pager->lock);
+	if( !pager->txn.active )
+		result = flush_and_sync(pager);
+	bt_rmutex_unlock(&pager->lock);
+	page_cache_quiesce_end(pager->cache);
+
+	return result;
+}
+
+/**
+ * @brief Shrink the cache back after a transaction made it grow.
+ */
+static void
+trim_cache(struct Pager* pager)
+{
+	struct Page* page = NULL;
+	while( page_cache_trim(pager->cache, &page, NULL) == PAGER_OK )
+		page_destroy(pager, page);
+}
+
+static enum pager_e
+begin(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	assert(!pager->txn.active);
+
+	result = flush(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	// Nothing is pending after the flush, so the free list is just its head.
+	pager->txn.active = 1;
+	pager->txn.max_page = pager->max_page;
+	pager->txn.freelist_head = pager->freelist.head;
+	page_cache_pin_dirty(pager->cache, 1);
+
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_begin(struct Pager* pager)
+{
+	page_cache_quiesce(pager->cache);
+	bt_rmutex_lock(&pager->lock);
+	enum pager_e result = begin(pager);
+	bt_rmutex_unlock(&pager->lock);
+	page_cache_quiesce_end(pager->cache);
+
+	return result;
+}
+
+static enum pager_e
+commit(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+
+	assert(pager->txn.active);
+
+	result = flush_and_sync(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	pager->txn.active = 0;
+	page_cache_pin_dirty(pager->cache, 0);
+	trim_cache(pager);
+
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_commit(struct Pager* pager)
+{
+	page_cache_quiesce(pager->cache);
+	bt_rmutex_lock(&pager->lock);
+	enum pager_e result = commit(pager);
+	bt_rmutex_unlock(&pager->lock);
+	page_cache_quiesce_end(pager->cache);
+
+	return result;
+}
+
+static enum pager_e
+rollback(struct Pager* pager)
+{
+	assert(pager->txn.active);
+	enum pager_e result = PAGER_OK;
+
+	// Snapshots opened in the transaction see its pages.
+	result = pager_snapshot_preserve_dirty(pager);
+	if( result != PAGER_OK )
+		return result;
+
+	// Every dirty page belongs to the transaction; the clean ones are
+	// dropped too rather than sorted out.
+	page_cache_pin_dirty(pager->cache, 0);
+	release_cached_pages(pager);
+	trim_cache(pager);
+	assert(pager->cache->ndirty == 0);
+
+	pager->max_page = pager->txn.max_page;
+	pager->freelist.head = pager->txn.freelist_head;
+	pager->freelist.head_dirty = 0;
+	pager->freelist.npending = 0;
+	pager->txn.active = 0;
+
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_rollback(struct Pager* pager)
+{
+	page_cache_quiesce(pager->cache);
+	bt_rmutex_lock(&pager->lock);
+	enum pager_e result = rollback(pager);
+	bt_rmutex_unlock(&pager->lock);
+	page_cache_quiesce_end(pager->cache);
+
+	return result;
+}
+
+char
+pager_in_transaction(struct Pager* pager)
+{
+	return pager->txn.active;
+}
+
 enum pager_e
 pager_extend(struct Pager* pager, u32* out_page_id)
 {
 	enum pager_e result = PAGER_OK;
 	struct Page* page = NULL;
 
+	bt_rmutex_lock(&pager->lock);
+
 	result = page_create(pager, &page);
 	if( result != PAGER_OK )
 		goto end;
@@ -209,13 +674,16 @@ pager_extend(struct Pager* pager, u32* out_page_id)
 end:
 	if( page )
 		page_destroy(pager, page);
+	bt_rmutex_unlock(&pager->lock);
 	return result;
 }
 
 enum pager_e
 pager_next_unused(struct Pager* pager, u32* out_page_id)
 {
+	bt_rmutex_lock(&pager->lock);
 	*out_page_id = pager->max_page + 1;
+	bt_rmutex_unlock(&pager->lock);
 	return PAGER_OK;
 }
 
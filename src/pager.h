@@ -4,6 +4,7 @@
 #include "btint.h"
 #include "page_cache.h"
 #include "page_defs.h"
+#include "pager_checkpointer.h"
 #include "pager_ops.h"
 
 enum pager_e pager_open(struct Pager*, char const*);
@@ -14,7 +15,15 @@ enum pager_e pager_create(
 	struct PagerOps* ops,
 	struct PageCache* cache,
 	int disk_page_size);
+/**
+ * @brief Writes back dirty pages, then closes and frees the pager. It is
+ * freed even if writing back fails; the error is returned.
+ */
 enum pager_e pager_destroy(struct Pager*);
+/**
+ * @brief Frees a pager that was created but is not open.
+ */
+enum pager_e pager_dealloc(struct Pager*);
 
 /**
  * @brief Read page from pager.
@@ -27,12 +36,165 @@ enum pager_e pager_read_page(
 	struct Pager*, struct PageSelector* selector, struct Page* page);
 
 /**
- * @brief Writes page to disk; if page is NEW, assign page number.
+ * @brief Read page for read-only access.
+ *
+ * The page borrows the mapped file if the backend maps it, otherwise the page
+ * cache frame, instead of copying it (see page_is_borrowed). A borrowed cache
+ * frame is pinned until the page is reread, unborrowed or destroyed. The page
+ * must not be modified; it is copied on pager_write_page or by
+ * page_make_writable.
+ *
+ * @param selector
+ * @param page An already allocated page.
+ * @return enum pager_e
+ */
+enum pager_e pager_read_page_ro(
+	struct Pager*, struct PageSelector* selector, struct Page* page);
+
+/**
+ * @brief Writes page to the cache; if page is NEW, assign page number.
+ *
+ * The page is written to disk later; see pager_flush.
  *
  * @return enum pager_e
  */
 enum pager_e pager_write_page(struct Pager*, struct Page*);
 
+/**
+ * @brief pager_write_page for several pages.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_write_pages(struct Pager*, struct Page** pages, int num);
+
+/**
+ * @brief Hint that the pages will be read soon.
+ *
+ * Pages not already cached are read into the cache in one batch.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_prefetch(struct Pager*, u32 const* page_ids, int num);
+
+/**
+ * @brief Writes dirty cached pages back to the file.
+ *
+ * pager_write_page only updates the cache; pages reach the file when they are
+ * evicted, on pager_flush, or on pager_destroy. Pages freed since the last
+ * flush are committed to the free list first.
+ *
+ * A flush is a barrier; it is only synced at PAGER_DURABILITY_FULL.
+ *
+ * It waits for tree operations other threads have in flight to finish, so
+ * a split or merge is never flushed half done; the same goes for
+ * pager_sync, pager_begin, pager_commit and pager_rollback. See
+ * page_cache_quiesce.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_flush(struct Pager*);
+
+/**
+ * @brief Start a transaction; anything written before is flushed first.
+ *
+ * Until pager_commit or pager_rollback, pager_flush and pager_sync do
+ * nothing and dirty pages are never evicted, so neither the file nor the log
+ * sees the transaction's pages. If the cache fills up with them it grows;
+ * pager_commit shrinks it back.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_begin(struct Pager*);
+
+/**
+ * @brief Write the transaction's pages as one commit and sync it as
+ * pager_sync would.
+ *
+ * @return enum pager_e If it fails the transaction is still open.
+ */
+enum pager_e pager_commit(struct Pager*);
+
+/**
+ * @brief Drop the transaction's pages; the pager is back where pager_begin
+ * left it. Open snapshots keep seeing the pages they saw.
+ *
+ * @return enum pager_e If it fails the transaction is still open.
+ */
+enum pager_e pager_rollback(struct Pager*);
+
+char pager_in_transaction(struct Pager*);
+
+/**
+ * @brief Set when pager_flush and pager_sync sync; see pager_durability_e.
+ * The default is PAGER_DURABILITY_NORMAL.
+ *
+ * Call before pager_start_checkpointer.
+ */
+void pager_set_durability(struct Pager*, enum pager_durability_e);
+
+/**
+ * @brief Route writes through a write-ahead log next to the database file
+ * ("<name>-wal"), recovering any commits already in it.
+ *
+ * Call right after the pager is opened, before any pages are written. Each
+ * pager_flush then appends the dirty pages to the log as one commit; the
+ * log is synced as the durability level says. The database file is only
+ * written by checkpoints, when the log reaches PAGER_WAL_AUTOCHECKPOINT
+ * frames and on pager_destroy.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_enable_wal(struct Pager*);
+
+/**
+ * @brief Commit by shadow paging instead of a log; see pager_shadow.h. Page
+ * ids map to physical pages, and pages are written out of place.
+ *
+ * Call right after the pager is opened, on an empty file or one written in
+ * this mode. pager_flush writes dirty pages aside; only pager_sync (or
+ * pager_commit) makes them the database, by swapping the root record.
+ * Opening after a crash needs no recovery.
+ *
+ * @return PAGER_OPEN_ERR if the file wasn't written in this mode.
+ */
+enum pager_e pager_enable_shadow(struct Pager*);
+
+/**
+ * @brief Checkpoint on a background thread instead of in pager_flush.
+ *
+ * Needs a log. Commits never wait for the thread; the log restarts on the
+ * first commit after the thread has caught up. opts may be NULL for the
+ * defaults. The thread stops in pager_destroy, which copies whatever it had
+ * not.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_start_checkpointer(
+	struct Pager*, struct PagerCheckpointerOpts const* opts);
+
+/**
+ * @brief Wait for the background checkpointer to copy every commit so far
+ * into the database file. Syncs the log first; the checkpointer only copies
+ * durable commits.
+ *
+ * @return The checkpointer's first error, if any.
+ */
+enum pager_e pager_wait_checkpoint(struct Pager*);
+
+/**
+ * @brief Checkpoint lag and the background checkpointer's counters; zero
+ * without a log or checkpointer.
+ */
+void pager_checkpoint_stats(struct Pager*, struct PagerCheckpointerStats*);
+
+/**
+ * @brief Commit: pager_flush, then ask the backend to make the file durable,
+ * or just the log if there is one. Doesn't sync at PAGER_DURABILITY_OFF.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_sync(struct Pager*);
+
 enum pager_e pager_extend(struct Pager*, u32* out_page_id);
 enum pager_e pager_next_unused(struct Pager*, u32* out_page_id);
 
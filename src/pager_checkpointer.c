@@ -0,0 +1,306 @@
+#include "pager_checkpointer.h"
+
+#include <stdlib.h>
+
+static u64
+page_offset(struct PagerCheckpointer* cp, u32 page_id)
+{
+	return (u64)cp->disk_page_size * (u64)(page_id - 1);
+}
+
+/**
+ * @brief Write a batch through the backend's submit/complete if it has them,
+ * otherwise one page at a time.
+ */
+static enum pager_e
+write_batch(struct PagerCheckpointer* cp, struct PagerIO* ios, int num)
+{
+	enum pager_e result = PAGER_OK;
+	int bytes = 0;
+
+	if( cp->ops->submit == NULL )
+	{
+		for( int i = 0; i < num; i++ )
+		{
+			result = cp->ops->write(
+				cp->file, ios[i].buffer, ios[i].offset, ios[i].size, &bytes);
+			if( result != PAGER_OK )
+				return result;
+		}
+
+		return PAGER_OK;
+	}
+
+	result = cp->ops->submit(cp->file, ios, num);
+	if( result == PAGER_OK )
+		result = cp->ops->complete(cp->file);
+	if( result != PAGER_OK )
+		return result;
+
+	for( int i = 0; i < num; i++ )
+	{
+		if( ios[i].status != PAGER_OK )
+			return ios[i].status;
+	}
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Pause between batches; cut short by pager_checkpointer_stop or
+ * pager_checkpointer_wait.
+ *
+ * @return 1 if the checkpointer is stopping.
+ */
+static char
+pause_batch(struct PagerCheckpointer* cp)
+{
+	bt_mutex_lock(&cp->mutex);
+	if( !cp->stop && cp->opts.pause_ms )
+		bt_cond_timedwait(&cp->wake, &cp->mutex, cp->opts.pause_ms);
+	char stop = cp->stop;
+	bt_mutex_unlock(&cp->mutex);
+
+	return stop;
+}
+
+/**
+ * @brief One round: copy the pages committed since the last round and sync
+ * the database file.
+ */
+static enum pager_e
+backfill(struct PagerCheckpointer* cp, char* r_caught_up)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerIO ios[PAGER_CHECKPOINTER_BATCH];
+	struct PagerWalEntry* entries = NULL;
+	byte* buffers = NULL;
+	u32 batch_pages = cp->opts.batch_pages;
+	u32 mark = 0;
+	u32 num = 0;
+
+	result = pager_wal_backfill_collect(cp->wal, &mark, &entries, &num);
+	if( result != PAGER_OK )
+		return result;
+
+	*r_caught_up = mark == 0;
+	if( mark == 0 )
+		return PAGER_OK;
+
+	if( num > 0 )
+	{
+		buffers = (byte*)malloc((size_t)cp->disk_page_size * batch_pages);
+		if( !buffers )
+		{
+			result = PAGER_ERR_NO_MEM;
+			goto end;
+		}
+	}
+
+	// Page id order, so the database file is written front to back.
+	for( u32 start = 0; start < num; start += batch_pages )
+	{
+		u32 batch = num - start;
+		if( batch > batch_pages )
+			batch = batch_pages;
+
+		for( u32 i = 0; i < batch; i++ )
+		{
+			struct PagerWalEntry* entry = &entries[start + i];
+			void* buffer = buffers + (size_t)cp->disk_page_size * i;
+
+			result = pager_wal_read_file(
+				cp->wal, cp->log_file, entry->frame, buffer);
+			if( result != PAGER_OK )
+				goto end;
+
+			ios[i].op = PAGER_IO_WRITE;
+			ios[i].buffer = buffer;
+			ios[i].offset = page_offset(cp, entry->page_id);
+			ios[i].size = cp->disk_page_size;
+		}
+
+		result = write_batch(cp, ios, batch);
+		if( result != PAGER_OK )
+			goto end;
+
+		bt_mutex_lock(&cp->mutex);
+		cp->stats.pages_written += batch;
+		cp->stats.bytes_written += (u64)batch * cp->disk_page_size;
+		bt_mutex_unlock(&cp->mutex);
+
+		// The round is left unfinished; the next checkpointer, or the final
+		// checkpoint, copies these pages again.
+		if( start + batch < num && pause_batch(cp) )
+			goto end;
+	}
+
+	// The log may only restart once the database file is durable.
+	if( num > 0 && cp->ops->sync && !cp->wal->nosync )
+	{
+		result = cp->ops->sync(cp->file);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	if( num > 0 )
+	{
+		bt_mutex_lock(&cp->mutex);
+		cp->stats.rounds += 1;
+		bt_mutex_unlock(&cp->mutex);
+	}
+
+	pager_wal_backfill_done(cp->wal, mark);
+
+end:
+	free(buffers);
+	free(entries);
+	return result;
+}
+
+static void*
+checkpointer_main(void* arg)
+{
+	struct PagerCheckpointer* cp = (struct PagerCheckpointer*)arg;
+	enum pager_e result = PAGER_OK;
+	char caught_up = 0;
+
+	bt_mutex_lock(&cp->mutex);
+	while( !cp->stop )
+	{
+		bt_mutex_unlock(&cp->mutex);
+		result = backfill(cp, &caught_up);
+		bt_mutex_lock(&cp->mutex);
+
+		if( result != PAGER_OK )
+			cp->status = result;
+		bt_cond_broadcast(&cp->round_done);
+		if( result != PAGER_OK )
+			break;
+
+		// Keep going while there is a backlog; commits made during a round
+		// are picked up right away.
+		if( caught_up && !cp->stop )
+			bt_cond_timedwait(&cp->wake, &cp->mutex, cp->opts.idle_ms);
+	}
+	bt_mutex_unlock(&cp->mutex);
+
+	return NULL;
+}
+
+enum pager_e
+pager_checkpointer_start(
+	struct PagerCheckpointer** r_cp,
+	struct PagerWal* wal,
+	struct PagerOps* ops,
+	char const* filename,
+	u32 disk_page_size,
+	struct PagerCheckpointerOpts const* opts)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerCheckpointer* cp = (struct PagerCheckpointer*)calloc(
+		1, sizeof(struct PagerCheckpointer));
+	if( !cp )
+		return PAGER_ERR_NO_MEM;
+
+	cp->wal = wal;
+	cp->ops = ops;
+	cp->disk_page_size = disk_page_size;
+	if( opts )
+		cp->opts = *opts;
+	if( cp->opts.batch_pages == 0 ||
+		cp->opts.batch_pages > PAGER_CHECKPOINTER_BATCH )
+		cp->opts.batch_pages = PAGER_CHECKPOINTER_BATCH;
+	if( cp->opts.idle_ms == 0 )
+		cp->opts.idle_ms = PAGER_CHECKPOINTER_IDLE_MS;
+
+	result = ops->open(&cp->file, filename);
+	if( result != PAGER_OK )
+	{
+		cp->file = NULL;
+		goto err;
+	}
+
+	result = ops->open(&cp->log_file, wal->filename);
+	if( result != PAGER_OK )
+	{
+		cp->log_file = NULL;
+		goto err;
+	}
+
+	bt_mutex_init(&cp->mutex);
+	bt_cond_init(&cp->wake);
+	bt_cond_init(&cp->round_done);
+
+	if( bt_thread_create(&cp->thread, checkpointer_main, cp) != 0 )
+	{
+		bt_cond_destroy(&cp->round_done);
+		bt_cond_destroy(&cp->wake);
+		bt_mutex_destroy(&cp->mutex);
+		result = PAGER_UNK_ERR;
+		goto err;
+	}
+
+	*r_cp = cp;
+	return PAGER_OK;
+
+err:
+	if( cp->log_file )
+		ops->close(cp->log_file);
+	if( cp->file )
+		ops->close(cp->file);
+	free(cp);
+	*r_cp = NULL;
+	return result;
+}
+
+enum pager_e
+pager_checkpointer_stop(struct PagerCheckpointer* cp)
+{
+	bt_mutex_lock(&cp->mutex);
+	cp->stop = 1;
+	bt_cond_broadcast(&cp->wake);
+	bt_mutex_unlock(&cp->mutex);
+
+	bt_thread_join(cp->thread);
+
+	enum pager_e result = cp->status;
+
+	cp->ops->close(cp->log_file);
+	cp->ops->close(cp->file);
+	bt_cond_destroy(&cp->round_done);
+	bt_cond_destroy(&cp->wake);
+	bt_mutex_destroy(&cp->mutex);
+	free(cp);
+
+	return result;
+}
+
+enum pager_e
+pager_checkpointer_wait(struct PagerCheckpointer* cp)
+{
+	bt_mutex_lock(&cp->mutex);
+	while( cp->status == PAGER_OK && pager_wal_lag(cp->wal) > 0 )
+	{
+		// Skip the idle wait and any pauses.
+		bt_cond_broadcast(&cp->wake);
+		bt_cond_wait(&cp->round_done, &cp->mutex);
+	}
+	enum pager_e result = cp->status;
+	bt_mutex_unlock(&cp->mutex);
+
+	return result;
+}
+
+void
+pager_checkpointer_stats(
+	struct PagerCheckpointer* cp, struct PagerCheckpointerStats* r_stats)
+{
+	bt_mutex_lock(&cp->mutex);
+	*r_stats = cp->stats;
+	bt_mutex_unlock(&cp->mutex);
+
+	r_stats->lag_frames = pager_wal_lag(cp->wal);
+	r_stats->lag_bytes = r_stats->lag_frames *
+						 (PAGER_WAL_FRAME_HEADER_SIZE + cp->disk_page_size);
+}
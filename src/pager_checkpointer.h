@@ -0,0 +1,103 @@
+#ifndef PAGER_CHECKPOINTER_H_
+#define PAGER_CHECKPOINTER_H_
+
+#include "btint.h"
+#include "btthread.h"
+#include "pager_e.h"
+#include "pager_ops.h"
+#include "pager_wal.h"
+
+/**
+ * Background checkpointer.
+ *
+ * A thread that copies committed pages from the log into the database file
+ * while commits go on. Each round takes the pages of the commits made
+ * durable since the last one (pager_wal_backfill_collect) and writes them
+ * in page id order, a batch at a time with a pause after each batch, then
+ * syncs the database file.
+ * Once a round ends with nothing newer in the log, the next commit restarts
+ * the log from the top instead of growing it.
+ *
+ * The thread has its own handles on the database file and the log, so it
+ * never shares a handle with the writer. It only writes pages that are in
+ * the log, which the writer reads from the log, not the database file.
+ */
+
+// Pages copied between pauses.
+#define PAGER_CHECKPOINTER_BATCH 64
+// How often an idle checkpointer looks for new commits, in milliseconds.
+#define PAGER_CHECKPOINTER_IDLE_MS 10
+
+struct PagerCheckpointerOpts
+{
+	// Pages per batch; 0 for PAGER_CHECKPOINTER_BATCH.
+	u32 batch_pages;
+	// Pause after each batch, in milliseconds. Caps the copy rate at
+	// batch_pages pages per pause; 0 copies flat out.
+	u32 pause_ms;
+	// 0 for PAGER_CHECKPOINTER_IDLE_MS.
+	u32 idle_ms;
+};
+
+struct PagerCheckpointerStats
+{
+	// Rounds that copied at least one page.
+	u64 rounds;
+	u64 pages_written;
+	u64 bytes_written;
+	// Committed frames not in the database file yet, and their size in the
+	// log.
+	u64 lag_frames;
+	u64 lag_bytes;
+};
+
+struct PagerCheckpointer
+{
+	struct PagerWal* wal;
+	struct PagerOps* ops;
+	void* file;
+	void* log_file;
+	u32 disk_page_size;
+	struct PagerCheckpointerOpts opts;
+
+	bt_thread thread;
+	// Guards stop, status and stats.
+	bt_mutex mutex;
+	// Wakes the thread early: to stop, or because someone is waiting.
+	bt_cond wake;
+	// Broadcast after each round.
+	bt_cond round_done;
+	char stop;
+	// First error; the thread exits on it.
+	enum pager_e status;
+
+	struct PagerCheckpointerStats stats;
+};
+
+/**
+ * @brief Start a checkpointer for the log of the database file at filename.
+ */
+enum pager_e pager_checkpointer_start(
+	struct PagerCheckpointer** r_cp,
+	struct PagerWal* wal,
+	struct PagerOps* ops,
+	char const* filename,
+	u32 disk_page_size,
+	struct PagerCheckpointerOpts const* opts);
+
+/**
+ * @brief Stop the thread, mid-round if need be, and free the checkpointer.
+ *
+ * @return The first error the thread hit, if any.
+ */
+enum pager_e pager_checkpointer_stop(struct PagerCheckpointer* cp);
+
+/**
+ * @brief Wait until every frame committed so far is in the database file.
+ */
+enum pager_e pager_checkpointer_wait(struct PagerCheckpointer* cp);
+
+void pager_checkpointer_stats(
+	struct PagerCheckpointer* cp, struct PagerCheckpointerStats* r_stats);
+
+#endif
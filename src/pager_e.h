@@ -15,6 +15,8 @@ enum pager_e
 	PAGER_SEEK_ERR,
 	PAGER_READ_ERR,
 	PAGER_WRITE_ERR,
+	// The OS reported an error (see errno).
+	PAGER_IO_ERR,
 };
 
 #endif
@@ -3,149 +3,336 @@
 #include "page.h"
 #include "pagemeta.h"
 #include "pager_internal.h"
+#include "serialization.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Trunk body: u32 count, then count free page ids.
+#define TRUNK_COUNT_SIZE 4
+
+static u32
+trunk_capacity(struct Pager* pager)
+{
+	return (pager->page_size - TRUNK_COUNT_SIZE) / sizeof(u32);
+}
+
+static u32
+trunk_count(struct Page* trunk)
+{
+	u32 count = 0;
+	ser_read_32bit_le(&count, trunk->page_buffer);
+	return count;
+}
+
+static void
+trunk_set_count(struct Page* trunk, u32 count)
+{
+	ser_write_32bit_le(trunk->page_buffer, count);
+}
+
+static u32
+trunk_id(struct Page* trunk, u32 index)
+{
+	u32 page_id = 0;
+	ser_read_32bit_le(
+		&page_id,
+		(char*)trunk->page_buffer + TRUNK_COUNT_SIZE + index * sizeof(u32));
+	return page_id;
+}
+
+static void
+trunk_set_id(struct Page* trunk, u32 index, u32 page_id)
+{
+	ser_write_32bit_le(
+		(char*)trunk->page_buffer + TRUNK_COUNT_SIZE + index * sizeof(u32),
+		page_id);
+}
 
 /**
- * Read the free page list.
- *
- * @param pager
- * @return enum pager_e
+ * @brief Turn a freed page into an empty trunk that chains to next.
  */
+static void
+trunk_init(struct Pager* pager, struct Page* trunk, u32 page_id, u32 next)
+{
+	struct PageMetadata meta = {
+		.is_free = true, .next_free_page = next, .page_number = page_id};
+
+	pagemeta_memset_page(trunk, 0x00, pager);
+	trunk->page_id = page_id;
+	pagemeta_write(trunk, &meta);
+}
+
+static enum pager_e
+read_page(struct Pager* pager, u32 page_id, struct Page* page)
+{
+	struct PageSelector selector = {.page_id = page_id};
+	return pager_internal_cached_read(pager, &selector, page);
+}
+
 enum pager_e
-pager_freelist_pop(struct Pager* pager, int* out_free_page)
+pager_freelist_load(struct Pager* pager)
 {
 	enum pager_e result = PAGER_OK;
-
-	struct PageSelector selector = {.page_id = 1};
 	struct Page* root_page = NULL;
-	struct Page* page = NULL;
-	struct PageMetadata root_meta = {0};
 	struct PageMetadata meta = {0};
-	int next_free_page = 0;
 
-	result = page_create(pager, &root_page);
-	if( result != PAGER_OK )
-		goto end;
+	pager->freelist.head = 0;
+	pager->freelist.head_dirty = 0;
 
-	result = page_create(pager, &page);
-	if( result != PAGER_OK )
-		goto end;
+	if( pager->max_page == 0 )
+		return PAGER_OK;
 
-	result = pager_internal_cached_read(pager, &selector, root_page);
+	result = page_create_for_read(pager, &root_page);
 	if( result != PAGER_OK )
-		goto end;
+		return result;
 
-	pagemeta_read(&root_meta, root_page);
-
-	if( root_meta.next_free_page == 0 )
+	result = read_page(pager, 1, root_page);
+	if( result == PAGER_ERR_NIF )
 	{
-		result = PAGER_ERR_NO_FREE_PAGE;
+		result = PAGER_OK;
 		goto end;
 	}
-
-	pager_reselect(&selector, root_meta.next_free_page);
-	result = pager_internal_cached_read(pager, &selector, page);
 	if( result != PAGER_OK )
 		goto end;
 
-	pagemeta_read(&meta, page);
+	pagemeta_read(&meta, root_page);
+	pager->freelist.head = meta.next_free_page;
 
-	next_free_page = root_meta.next_free_page;
-	*out_free_page = next_free_page;
+end:
+	page_destroy(pager, root_page);
+	return result;
+}
 
-	root_meta.next_free_page = meta.next_free_page;
-	pagemeta_write(root_page, &root_meta);
+/**
+ * Pages freed since the last commit come back first, most recent first;
+ * then the head trunk's ids, and the trunk page itself once it is empty.
+ *
+ * @param pager
+ * @return enum pager_e
+ */
+enum pager_e
+pager_freelist_pop(struct Pager* pager, int* out_free_page)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerFreelist* freelist = &pager->freelist;
+	struct Page* trunk = NULL;
+	struct PageMetadata meta = {0};
 
-	result = pager_internal_cached_write(pager, root_page);
+	if( freelist->npending > 0 )
+	{
+		freelist->npending -= 1;
+		*out_free_page = freelist->pending[freelist->npending];
+		return PAGER_OK;
+	}
+
+	if( freelist->head == 0 )
+		return PAGER_ERR_NO_FREE_PAGE;
+
+	result = page_create_for_read(pager, &trunk);
+	if( result != PAGER_OK )
+		return result;
+
+	result = read_page(pager, freelist->head, trunk);
 	if( result != PAGER_OK )
 		goto end;
 
+	u32 count = trunk_count(trunk);
+	if( count > 0 )
+	{
+		*out_free_page = trunk_id(trunk, count - 1);
+		trunk_set_count(trunk, count - 1);
+
+		result = pager_internal_cached_write(pager, trunk);
+		if( result != PAGER_OK )
+			goto end;
+	}
+	else
+	{
+		pagemeta_read(&meta, trunk);
+
+		*out_free_page = freelist->head;
+		freelist->head = meta.next_free_page;
+		freelist->head_dirty = 1;
+	}
+
 end:
-	page_destroy(pager, root_page);
-	page_destroy(pager, page);
+	page_destroy(pager, trunk);
 	return result;
 }
 
 enum pager_e
 pager_freelist_push(struct Pager* pager, u32 page_number)
 {
+	assert(page_number != PAGE_CREATE_NEW_PAGE);
 	enum pager_e result = PAGER_OK;
-	struct PageSelector selector = {.page_id = page_number};
-	struct Page* page = NULL;
-	result = page_create(pager, &page);
-	if( result != PAGER_OK )
-		goto end;
+	struct PagerFreelist* freelist = &pager->freelist;
 
-	result = pager_internal_cached_read(pager, &selector, page);
-	if( result != PAGER_OK )
-		goto end;
+	bt_rmutex_lock(&pager->lock);
 
-	result = pager_freelist_push_page(pager, page);
-	if( result != PAGER_OK )
-		goto end;
+	if( freelist->npending == freelist->pending_capacity )
+	{
+		u32 capacity =
+			freelist->pending_capacity ? freelist->pending_capacity * 2 : 16;
+		u32* pending =
+			(u32*)realloc(freelist->pending, sizeof(u32) * capacity);
+		if( !pending )
+		{
+			result = PAGER_ERR_NO_MEM;
+			goto end;
+		}
+
+		freelist->pending = pending;
+		freelist->pending_capacity = capacity;
+	}
 
-end:
-	page_destroy(pager, page);
+	freelist->pending[freelist->npending] = page_number;
+	freelist->npending += 1;
 
+end:
+	bt_rmutex_unlock(&pager->lock);
 	return result;
 }
 
-/**
- * The head of the free list is stored on the page 1.
- *
- * TODO: We can write to the page itself immediately,
- * but for concurrent algorithms, we may need to defer
- * updating the root page. We can traverse the list
- * of free pages without worry as there are no references
- * to those pages, but the root page must be synchronized.
- *
- * @param pager
- * @param page
- * @return enum pager_e
- */
 enum pager_e
 pager_freelist_push_page(struct Pager* pager, struct Page* page)
 {
 	assert(page->page_id != PAGE_CREATE_NEW_PAGE);
-	enum pager_e result = PAGER_OK;
+	return pager_freelist_push(pager, page->page_id);
+}
 
-	struct PageSelector selector = {.page_id = 1};
+/**
+ * @brief Write the head into page 1's meta.
+ */
+static enum pager_e
+stamp_head(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
 	struct Page* root_page = NULL;
 	struct PageMetadata meta = {0};
 
-	result = page_create(pager, &root_page);
+	result = page_create_for_read(pager, &root_page);
 	if( result != PAGER_OK )
-		goto end;
+		return result;
 
-	result = pager_internal_cached_read(pager, &selector, root_page);
+	result = read_page(pager, 1, root_page);
 	if( result != PAGER_OK )
 		goto end;
 
 	pagemeta_read(&meta, root_page);
-
-	int old_free_head_id = meta.next_free_page;
-	meta.next_free_page = page->page_id;
-
+	meta.next_free_page = pager->freelist.head;
 	pagemeta_write(root_page, &meta);
 
 	result = pager_internal_cached_write(pager, root_page);
 	if( result != PAGER_OK )
 		goto end;
 
-	pagemeta_read(&meta, page);
+	pager->freelist.head_dirty = 0;
 
-	meta.is_free = true;
-	meta.next_free_page = old_free_head_id;
+end:
+	page_destroy(pager, root_page);
+	return result;
+}
 
-	pagemeta_write(page, &meta);
+/**
+ * Pending ids are appended to the head trunk. When it is full, the next
+ * pending page becomes the new head trunk, so freeing N pages writes about
+ * N / trunk_capacity trunks and page 1 once.
+ *
+ * @param pager
+ * @return enum pager_e
+ */
+enum pager_e
+pager_freelist_commit(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerFreelist* freelist = &pager->freelist;
+	struct Page* trunk = NULL;
+	u32 capacity = trunk_capacity(pager);
+	u32 count = 0;
+	u32 committed = 0;
+	bool trunk_dirty = false;
+
+	assert(capacity > 0);
 
-	result = pager_internal_cached_write(pager, page);
+	if( freelist->npending == 0 )
+		goto stamp;
+
+	result = page_create_for_read(pager, &trunk);
 	if( result != PAGER_OK )
-		goto end;
+		return result;
+
+	if( freelist->head != 0 )
+	{
+		result = read_page(pager, freelist->head, trunk);
+		if( result != PAGER_OK )
+			goto end;
+
+		count = trunk_count(trunk);
+	}
+
+	for( ; committed < freelist->npending; committed++ )
+	{
+		u32 page_id = freelist->pending[committed];
+
+		if( freelist->head != 0 && count < capacity )
+		{
+			trunk_set_id(trunk, count, page_id);
+			count += 1;
+			trunk_set_count(trunk, count);
+			trunk_dirty = true;
+			continue;
+		}
+
+		if( trunk_dirty )
+		{
+			result = pager_internal_cached_write(pager, trunk);
+			if( result != PAGER_OK )
+				goto end;
+		}
+
+		trunk_init(pager, trunk, page_id, freelist->head);
+		freelist->head = page_id;
+		freelist->head_dirty = 1;
+		count = 0;
+		trunk_dirty = true;
+	}
+
+	if( trunk_dirty )
+	{
+		result = pager_internal_cached_write(pager, trunk);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+stamp:
+	if( freelist->head_dirty )
+		result = stamp_head(pager);
 
 end:
-	page_destroy(pager, root_page);
+	// On failure, ids already placed in an unwritten trunk are leaked rather
+	// than risk handing them out twice.
+	if( committed > 0 )
+	{
+		memmove(
+			freelist->pending,
+			freelist->pending + committed,
+			sizeof(u32) * (freelist->npending - committed));
+		freelist->npending -= committed;
+	}
+
+	if( trunk )
+		page_destroy(pager, trunk);
 	return result;
 }
+
+void
+pager_freelist_deinit(struct Pager* pager)
+{
+	free(pager->freelist.pending);
+	pager->freelist.pending = NULL;
+	pager->freelist.npending = 0;
+	pager->freelist.pending_capacity = 0;
+}
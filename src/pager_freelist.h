@@ -4,7 +4,27 @@
 #include "btint.h"
 #include "page_defs.h"
 
+/**
+ * @brief Read the free list head from page 1. Called when the pager opens.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_freelist_load(struct Pager* pager);
+
+/**
+ * @brief Take a free page; pages freed since the last commit are reused
+ * first.
+ *
+ * @return PAGER_ERR_NO_FREE_PAGE if the free list is empty.
+ */
 enum pager_e pager_freelist_pop(struct Pager* pager, int* out_free_page);
+
+/**
+ * @brief Queue a page to be freed. Nothing is written until
+ * pager_freelist_commit.
+ *
+ * @return enum pager_e
+ */
 enum pager_e pager_freelist_push(struct Pager* pager, u32 page_number);
 
 /**
@@ -14,4 +34,17 @@ enum pager_e pager_freelist_push(struct Pager* pager, u32 page_number);
  */
 enum pager_e pager_freelist_push_page(struct Pager*, struct Page*);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Write the queued pages into trunk pages and stamp the head into
+ * page 1. pager_flush calls this.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_freelist_commit(struct Pager* pager);
+
+/**
+ * @brief Release the pending queue.
+ */
+void pager_freelist_deinit(struct Pager* pager);
+
+#endif
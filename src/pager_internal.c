@@ -5,14 +5,94 @@
 #include "page_defs.h"
 #include "pagemeta.h"
 #include "pager_ops.h"
+#include "pager_shadow.h"
+#include "pager_snapshot.h"
+#include "pager_wal.h"
 
 #include <assert.h>
 #include <stdlib.h>
 
+/**
+ * @brief Byte offset of a page in the file. With shadow paging that is
+ * wherever the page map says; the page must be in it.
+ *
+ * Computed in 64 bits; disk_page_size * page_id overflows an int once the file
+ * passes 2GB.
+ */
+static u64
+page_offset(struct Pager* pager, u32 page_id)
+{
+	if( pager->shadow )
+	{
+		char found = pager_shadow_find(pager->shadow, page_id, &page_id);
+		assert(found);
+		(void)found;
+	}
+
+	return (u64)pager->disk_page_size * (u64)(page_id - 1);
+}
+
+/**
+ * @brief Whether page_id was ever written; only shadow paging knows
+ * without reading.
+ */
+static char
+page_on_disk(struct Pager* pager, u32 page_id)
+{
+	u32 physical = 0;
+	return pager->shadow == NULL ||
+		   pager_shadow_find(pager->shadow, page_id, &physical);
+}
+
+/**
+ * @brief Shadow paging never overwrites a committed page; move page_id
+ * aside before it is written.
+ */
+static enum pager_e
+place_page(struct Pager* pager, u32 page_id)
+{
+	u32 physical = 0;
+
+	if( pager->shadow == NULL )
+		return PAGER_OK;
+
+	return pager_shadow_place(pager->shadow, page_id, &physical);
+}
+
+/**
+ * @brief With a log, the page is appended as a frame that is not a commit by
+ * itself; the next commit covers it.
+ */
+static enum pager_e
+write_to_disk(struct Pager* pager, struct Page* page)
+{
+	enum pager_e result = PAGER_OK;
+	int bytes_written;
+
+	if( pager->wal )
+	{
+		void* disk_page = pagemeta_deadjust_buffer(page->page_buffer);
+		return pager_wal_append(
+			pager->wal, &page->page_id, &disk_page, 1, 0, NULL);
+	}
+
+	result = place_page(pager, page->page_id);
+	if( result != PAGER_OK )
+		return result;
+
+	return pager->ops->write(
+		pager->file,
+		pagemeta_deadjust_buffer(page->page_buffer),
+		page_offset(pager, page->page_id),
+		pager->disk_page_size,
+		&bytes_written);
+}
+
 /**
  * @brief Commit new pages; Takes ownership of page
  *
- * Page MUST be written to disk prior to commit.
+ * The page is inserted clean and acquired. If the cache evicts a dirty page
+ * to make room, it is written back before it is destroyed.
  *
  * @param pager
  * @param page
@@ -22,14 +102,24 @@ static enum pager_e
 page_commit(struct Pager* pager, struct Page* page)
 {
 	assert(page->page_id != 0);
+	enum pager_e result = PAGER_OK;
 
 	struct Page* evicted_page = NULL;
-	page_cache_insert(pager->cache, page, &evicted_page);
+	char evicted_dirty = 0;
+	result =
+		page_cache_insert(pager->cache, page, &evicted_page, &evicted_dirty);
+	if( result != PAGER_OK )
+		return result;
 
 	if( evicted_page != NULL )
+	{
+		if( evicted_dirty )
+			result = write_to_disk(pager, evicted_page);
+
 		page_destroy(pager, evicted_page);
+	}
 
-	return PAGER_OK;
+	return result;
 }
 
 static enum pager_e
@@ -40,13 +130,27 @@ read_from_disk(
 	assert(selector->page_id != PAGE_CREATE_NEW_PAGE);
 	enum pager_e pager_result = PAGER_OK;
 
-	int offset = pager->disk_page_size * (selector->page_id - 1);
 	int pages_read = 0;
+	u32 frame = 0;
+
+	if( pager->wal && pager_wal_find(pager->wal, selector->page_id, &frame) )
+	{
+		pager_result = pager_wal_read(
+			pager->wal, frame, pagemeta_deadjust_buffer(page->page_buffer));
+		page->page_id = selector->page_id;
+		return pager_result;
+	}
+
+	if( !page_on_disk(pager, selector->page_id) )
+	{
+		page->page_id = selector->page_id;
+		return PAGER_ERR_NIF;
+	}
 
 	pager_result = pager->ops->read(
 		pager->file,
 		pagemeta_deadjust_buffer(page->page_buffer),
-		offset,
+		page_offset(pager, selector->page_id),
 		pager->disk_page_size,
 		&pages_read);
 
@@ -69,32 +173,77 @@ pager_internal_read(
 	return read_from_disk(pager, selector, page);
 }
 
-enum pager_e
-pager_internal_cached_read(
-	struct Pager* pager, struct PageSelector* selector, struct Page* page)
+/**
+ * @brief Acquire the cache frame for a page, reading it on a miss.
+ *
+ * On success the caller holds one cache reference on *r_frame.
+ */
+static enum pager_e
+acquire_frame(
+	struct Pager* pager, struct PageSelector* selector, struct Page** r_frame)
 {
-	assert(selector->page_id != PAGE_CREATE_NEW_PAGE);
-
-	int page_id = selector->page_id;
 	struct Page* cached_page = NULL;
+
+	// A hit only takes the cache's own mutex, so it does not wait behind
+	// another thread's miss.
 	enum pager_e result =
-		page_cache_acquire(pager->cache, page_id, &cached_page);
+		page_cache_acquire(pager->cache, selector->page_id, &cached_page);
+	if( result == PAGER_OK )
+	{
+		*r_frame = cached_page;
+		return result;
+	}
+
+	// The backends and the log are not thread-safe, so misses load under
+	// the pager's lock; another thread may have loaded the page meanwhile.
+	bt_rmutex_lock(&pager->lock);
+
+	result = page_cache_peek(pager->cache, selector->page_id, &cached_page);
 	if( result == PAGER_ERR_CACHE_MISS )
 	{
-		page_create(pager, &cached_page);
+		result = page_create_for_read(pager, &cached_page);
+		if( result != PAGER_OK )
+			goto end;
+
 		result = pager_internal_read(pager, selector, cached_page);
 		if( result == PAGER_READ_ERR )
 		{
 			page_destroy(pager, cached_page);
 			result = PAGER_ERR_NIF;
 		}
+		else if( result != PAGER_OK )
+		{
+			page_destroy(pager, cached_page);
+		}
 		else
 		{
-			page_commit(pager, cached_page);
-			result = PAGER_OK;
+			result = page_commit(pager, cached_page);
+			if( result != PAGER_OK )
+				page_cache_release(pager->cache, cached_page);
 		}
 	}
 
+	if( result == PAGER_OK )
+		*r_frame = cached_page;
+
+end:
+	bt_rmutex_unlock(&pager->lock);
+
+	return result;
+}
+
+enum pager_e
+pager_internal_cached_read(
+	struct Pager* pager, struct PageSelector* selector, struct Page* page)
+{
+	assert(selector->page_id != PAGE_CREATE_NEW_PAGE);
+
+	int page_id = selector->page_id;
+	struct Page* cached_page = NULL;
+
+	page_unborrow(pager, page);
+
+	enum pager_e result = acquire_frame(pager, selector, &cached_page);
 	if( result == PAGER_OK )
 	{
 		pagemeta_memcpy_page(page, cached_page, pager);
@@ -108,26 +257,72 @@ pager_internal_cached_read(
 	return result;
 }
 
-/**
- * @brief Writes page to disk; if page is NEW, assign page number.
- *
- * @return enum pager_e
- */
 enum pager_e
-pager_internal_write(struct Pager* pager, struct Page* page)
+pager_internal_pinned_read(
+	struct Pager* pager, struct PageSelector* selector, struct Page* page)
 {
-	assert(pager->ops);
-	int write_result;
-	int offset;
+	assert(selector->page_id != PAGE_CREATE_NEW_PAGE);
+
+	int page_id = selector->page_id;
+	struct Page* cached_page = NULL;
 
-	offset = pager->disk_page_size * (page->page_id - 1);
+	page_unborrow(pager, page);
+
+	// The frame reference moves to the page.
+	enum pager_e result = acquire_frame(pager, selector, &cached_page);
+	if( result == PAGER_OK )
+		page_pin(page, cached_page);
+
+	page->page_id = page_id;
+	page->status = result;
+
+	return result;
+}
 
-	pager->ops->write(
+enum pager_e
+pager_internal_mapped_read(
+	struct Pager* pager, struct PageSelector* selector, struct Page* page)
+{
+	assert(selector->page_id != PAGE_CREATE_NEW_PAGE);
+	enum pager_e result = PAGER_OK;
+	void const* disk_page = NULL;
+	u32 frame = 0;
+
+	// The mapping only sees what has been written back; a dirty page's
+	// current contents are in the cache, a logged page's are in the log.
+	if( pager->ops->map == NULL || !page_on_disk(pager, selector->page_id) ||
+		page_cache_is_dirty(pager->cache, selector->page_id) ||
+		(pager->wal && pager_wal_find(pager->wal, selector->page_id, &frame)) )
+		return pager_internal_pinned_read(pager, selector, page);
+
+	page_unborrow(pager, page);
+
+	result = pager->ops->map(
 		pager->file,
-		pagemeta_deadjust_buffer(page->page_buffer),
-		offset,
+		page_offset(pager, selector->page_id),
 		pager->disk_page_size,
-		&write_result);
+		&disk_page);
+	if( result == PAGER_READ_ERR )
+		result = PAGER_ERR_NIF;
+
+	if( result == PAGER_OK )
+		page_borrow(page, disk_page);
+
+	page->page_id = selector->page_id;
+	page->status = result;
+
+	return result;
+}
+
+enum pager_e
+pager_internal_write(struct Pager* pager, struct Page* page)
+{
+	assert(pager->ops);
+	enum pager_e result = PAGER_OK;
+
+	result = write_to_disk(pager, page);
+	if( result != PAGER_OK )
+		return result;
 
 	pager->max_page =
 		page->page_id > pager->max_page ? page->page_id : pager->max_page;
@@ -135,27 +330,393 @@ pager_internal_write(struct Pager* pager, struct Page* page)
 	return PAGER_OK;
 }
 
+/**
+ * @brief Runs a batch of page I/O.
+ *
+ * One submit/complete if the backend supports it, otherwise the blocking
+ * calls one at a time. Per-request results are in ios[i].status.
+ */
+static enum pager_e
+io_batch(struct Pager* pager, struct PagerIO* ios, int num)
+{
+	enum pager_e result = PAGER_OK;
+	int bytes = 0;
+
+	if( pager->ops->submit == NULL )
+	{
+		for( int i = 0; i < num; i++ )
+		{
+			if( ios[i].op == PAGER_IO_READ )
+				ios[i].status = pager->ops->read(
+					pager->file, ios[i].buffer, ios[i].offset, ios[i].size, &bytes);
+			else
+				ios[i].status = pager->ops->write(
+					pager->file, ios[i].buffer, ios[i].offset, ios[i].size, &bytes);
+		}
+
+		return PAGER_OK;
+	}
+
+	result = pager->ops->submit(pager->file, ios, num);
+	if( result != PAGER_OK )
+		return result;
+
+	return pager->ops->complete(pager->file);
+}
+
+enum pager_e
+pager_internal_cached_write_n(
+	struct Pager* pager, struct Page** pages, int num)
+{
+	enum pager_e result = PAGER_OK;
+
+	for( int i = 0; i < num; i++ )
+	{
+		result = pager_internal_cached_write(pager, pages[i]);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Append the dirty pages to the log, the last one as the commit
+ * frame. Checkpoints once the log is long enough.
+ *
+ * Syncing the log is up to the durability level; see pager_flush.
+ */
+static enum pager_e
+wal_commit(struct Pager* pager, struct Page** pages, int ndirty)
+{
+	enum pager_e result = PAGER_OK;
+	u32 page_ids[PAGER_IO_BATCH_MAX];
+	void* disk_pages[PAGER_IO_BATCH_MAX];
+	u64 end = 0;
+
+	if( ndirty == 0 )
+	{
+		result = pager_wal_commit_pending(pager->wal, pager->max_page, &end);
+		if( result != PAGER_OK || end == 0 )
+			return result;
+	}
+
+	for( int start = 0; start < ndirty; start += PAGER_IO_BATCH_MAX )
+	{
+		int batch = ndirty - start;
+		if( batch > PAGER_IO_BATCH_MAX )
+			batch = PAGER_IO_BATCH_MAX;
+
+		for( int i = 0; i < batch; i++ )
+		{
+			page_ids[i] = pages[start + i]->page_id;
+			disk_pages[i] =
+				pagemeta_deadjust_buffer(pages[start + i]->page_buffer);
+		}
+
+		char last = start + batch == ndirty;
+		result = pager_wal_append(
+			pager->wal,
+			page_ids,
+			disk_pages,
+			batch,
+			last ? pager->max_page : 0,
+			&end);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	// The log has the pages now.
+	for( int i = 0; i < ndirty; i++ )
+		page_cache_set_dirty(pager->cache, pages[i]->page_id, 0);
+
+	// A background checkpointer restarts the log by itself.
+	if( pager->checkpointer == NULL &&
+		pager->wal->nframes >= PAGER_WAL_AUTOCHECKPOINT )
+		result = pager_internal_checkpoint(pager);
+
+	return result;
+}
+
+enum pager_e
+pager_internal_flush(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerIO ios[PAGER_IO_BATCH_MAX];
+	struct Page** pages = NULL;
+	int ndirty = 0;
+
+	if( pager->cache->ndirty == 0 )
+	{
+		// Pages written back on eviction still need their commit.
+		if( pager->wal && pager->wal->nframes > pager->wal->ncommitted )
+			return wal_commit(pager, NULL, 0);
+		return PAGER_OK;
+	}
+
+	pages = (struct Page**)malloc(sizeof(struct Page*) * pager->cache->ndirty);
+	if( !pages )
+		return PAGER_ERR_NO_MEM;
+
+	// Dirty pages come back in page id order, so each batch is a run of
+	// ascending offsets.
+	ndirty = page_cache_collect_dirty(pager->cache, pages);
+
+	if( pager->wal )
+	{
+		result = wal_commit(pager, pages, ndirty);
+		goto end;
+	}
+
+	for( int start = 0; start < ndirty; start += PAGER_IO_BATCH_MAX )
+	{
+		int batch = ndirty - start;
+		if( batch > PAGER_IO_BATCH_MAX )
+			batch = PAGER_IO_BATCH_MAX;
+
+		for( int i = 0; i < batch; i++ )
+		{
+			struct Page* page = pages[start + i];
+			result = place_page(pager, page->page_id);
+			if( result != PAGER_OK )
+				goto end;
+
+			ios[i].op = PAGER_IO_WRITE;
+			ios[i].buffer = pagemeta_deadjust_buffer(page->page_buffer);
+			ios[i].offset = page_offset(pager, page->page_id);
+			ios[i].size = pager->disk_page_size;
+		}
+
+		result = io_batch(pager, ios, batch);
+		if( result != PAGER_OK )
+			goto end;
+
+		for( int i = 0; i < batch; i++ )
+		{
+			// Failed pages stay dirty.
+			if( ios[i].status != PAGER_OK )
+				result = ios[i].status;
+			else
+				page_cache_set_dirty(
+					pager->cache, pages[start + i]->page_id, 0);
+		}
+
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+end:
+	free(pages);
+	return result;
+}
+
+enum pager_e
+pager_internal_prefetch(struct Pager* pager, u32 const* page_ids, int num)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerIO ios[PAGER_IO_BATCH_MAX];
+	struct Page* pages[PAGER_IO_BATCH_MAX];
+	struct Page* cached_page = NULL;
+	u32 frame = 0;
+
+	for( int start = 0; start < num; start += PAGER_IO_BATCH_MAX )
+	{
+		int batch = 0;
+		for( int i = start; i < num && i < start + PAGER_IO_BATCH_MAX; i++ )
+		{
+			u32 page_id = page_ids[i];
+			if( page_id == 0 || page_id > pager->max_page ||
+				!page_on_disk(pager, page_id) )
+				continue;
+
+			// Logged pages are read from the log on demand.
+			if( pager->wal && pager_wal_find(pager->wal, page_id, &frame) )
+				continue;
+
+			if( page_cache_peek(pager->cache, page_id, &cached_page) ==
+				PAGER_OK )
+			{
+				page_cache_release(pager->cache, cached_page);
+				continue;
+			}
+
+			result = page_create_for_read(pager, &pages[batch]);
+			if( result != PAGER_OK )
+				break;
+
+			pages[batch]->page_id = page_id;
+			ios[batch].op = PAGER_IO_READ;
+			ios[batch].buffer =
+				pagemeta_deadjust_buffer(pages[batch]->page_buffer);
+			ios[batch].offset = page_offset(pager, page_id);
+			ios[batch].size = pager->disk_page_size;
+			batch++;
+		}
+
+		if( result == PAGER_OK )
+			result = io_batch(pager, ios, batch);
+
+		for( int i = 0; i < batch; i++ )
+		{
+			if( result == PAGER_OK && ios[i].status == PAGER_OK )
+			{
+				result = page_commit(pager, pages[i]);
+				page_cache_release(pager->cache, pages[i]);
+			}
+			else
+			{
+				page_destroy(pager, pages[i]);
+			}
+		}
+
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	return result;
+}
+
 enum pager_e
 pager_internal_cached_write(struct Pager* pager, struct Page* page)
 {
 	assert(pager->ops);
+	assert(page->page_id != PAGE_CREATE_NEW_PAGE);
 	enum pager_e result = PAGER_OK;
-
-	// TODO: Hack - all writes also write to disk.
-	// Some reads are from cache... need to think this through.
 	struct Page* cached_page = NULL;
+
+	if( pager->snapshots )
+	{
+		result = pager_snapshot_preserve(pager, page->page_id);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	// Only the cached copy is updated; the page goes to disk when it is
+	// evicted or on pager_flush.
 	result = page_cache_acquire(pager->cache, page->page_id, &cached_page);
-	if( result == PAGER_OK )
+	if( result == PAGER_ERR_CACHE_MISS )
 	{
+		result = page_create_for_read(pager, &cached_page);
+		if( result != PAGER_OK )
+			goto end;
+
+		cached_page->page_id = page->page_id;
 		pagemeta_memcpy_page(cached_page, page, pager);
-		page_cache_release(pager->cache, cached_page);
+
+		result = page_commit(pager, cached_page);
+	}
+	else
+	{
+		pagemeta_memcpy_page(cached_page, page, pager);
+	}
+
+	page_cache_set_dirty(pager->cache, page->page_id, 1);
+	page_cache_release(pager->cache, cached_page);
+
+	if( page->page_id > pager->max_page )
+		pager->max_page = page->page_id;
+
+end:
+	page->status = result;
+
+	return result;
+}
+
+enum pager_e
+pager_internal_checkpoint(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerWal* wal = pager->wal;
+	struct PagerIO ios[PAGER_IO_BATCH_MAX];
+	struct PagerWalEntry* entries = NULL;
+	byte* buffers = NULL;
+	u32 num = 0;
+
+	if( wal == NULL )
+		return PAGER_OK;
+
+	// Only whole commits are copied, and not alongside a background
+	// checkpointer.
+	assert(wal->nframes == wal->ncommitted);
+	assert(pager->checkpointer == NULL);
+
+	// If the log lost the commits in a crash, the database file must not
+	// have their pages either.
+	result = pager_wal_sync(wal, pager_wal_end(wal));
+	if( result != PAGER_OK )
+		return result;
+
+	result = pager_wal_collect(wal, &entries, &num);
+	if( result != PAGER_OK )
+		return result;
+
+	if( num == 0 )
+		goto end;
+
+	// A background checkpointer may have copied some of the pages already.
+	u32 kept = 0;
+	for( u32 i = 0; i < num; i++ )
+	{
+		if( entries[i].frame >= wal->nbackfilled )
+			entries[kept++] = entries[i];
+	}
+	num = kept;
+
+	buffers = (byte*)malloc((size_t)pager->disk_page_size * PAGER_IO_BATCH_MAX);
+	if( !buffers )
+	{
+		result = PAGER_ERR_NO_MEM;
+		goto end;
 	}
 
-	pager_internal_write(pager, page);
+	// Page id order, so each batch is a run of ascending offsets.
+	for( u32 start = 0; start < num; start += PAGER_IO_BATCH_MAX )
+	{
+		int batch = num - start;
+		if( batch > PAGER_IO_BATCH_MAX )
+			batch = PAGER_IO_BATCH_MAX;
+
+		for( int i = 0; i < batch; i++ )
+		{
+			struct PagerWalEntry* entry = &entries[start + i];
+			void* buffer = buffers + (size_t)pager->disk_page_size * i;
 
-	// TODO: Error check.
-	page->status = PAGER_OK;
-	result = PAGER_OK;
+			result = pager_wal_read(wal, entry->frame, buffer);
+			if( result != PAGER_OK )
+				goto end;
 
+			ios[i].op = PAGER_IO_WRITE;
+			ios[i].buffer = buffer;
+			ios[i].offset = page_offset(pager, entry->page_id);
+			ios[i].size = pager->disk_page_size;
+		}
+
+		result = io_batch(pager, ios, batch);
+		if( result != PAGER_OK )
+			goto end;
+
+		for( int i = 0; i < batch; i++ )
+		{
+			if( ios[i].status != PAGER_OK )
+			{
+				result = ios[i].status;
+				goto end;
+			}
+		}
+	}
+
+	// The log may only restart once the database file is durable.
+	if( pager->ops->sync && pager->durability != PAGER_DURABILITY_OFF )
+	{
+		result = pager->ops->sync(pager->file);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	result = pager_wal_reset(wal);
+
+end:
+	free(buffers);
+	free(entries);
 	return result;
-}
\ No newline at end of file
+}
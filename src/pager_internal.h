@@ -2,6 +2,7 @@
 #define PAGER_INTERNAL_H_
 
 #include "page_defs.h"
+#include "pager_ops.h"
 
 /**
  * @brief Read page from pager.
@@ -16,6 +17,21 @@ enum pager_e pager_internal_read(
 enum pager_e pager_internal_cached_read(
 	struct Pager*, struct PageSelector* selector, struct Page* page);
 
+/**
+ * @brief Borrow the page's cache frame instead of copying it; the frame stays
+ * pinned until the page is unborrowed (see page_pin).
+ */
+enum pager_e pager_internal_pinned_read(
+	struct Pager*, struct PageSelector* selector, struct Page* page);
+
+/**
+ * @brief Borrow the page straight from the file mapping; falls back to
+ * pager_internal_pinned_read if the backend has no map op or the cached copy
+ * is newer.
+ */
+enum pager_e pager_internal_mapped_read(
+	struct Pager*, struct PageSelector* selector, struct Page* page);
+
 /**
  * @brief Writes page to disk; if page is NEW, assign page number.
  *
@@ -23,6 +39,42 @@ enum pager_e pager_internal_cached_read(
  */
 enum pager_e pager_internal_write(struct Pager*, struct Page*);
 
+/**
+ * @brief Writes page into the cache and marks it dirty. It reaches the disk
+ * when the cache evicts it or on pager_internal_flush.
+ *
+ * @return enum pager_e
+ */
 enum pager_e pager_internal_cached_write(struct Pager*, struct Page*);
 
+// Largest batch handed to the backend at once.
+#define PAGER_IO_BATCH_MAX 16
+
+/**
+ * @brief pager_internal_cached_write for pages that already have page ids.
+ */
+enum pager_e
+pager_internal_cached_write_n(struct Pager*, struct Page** pages, int num);
+
+/**
+ * @brief Writes every dirty cached page back to disk in page id order,
+ * batched through the backend's submit/complete where available.
+ *
+ * With a log, the pages are appended to it as one commit instead.
+ */
+enum pager_e pager_internal_flush(struct Pager*);
+
+/**
+ * @brief Copies the latest image of every logged page into the database
+ * file, syncs it and restarts the log. No-op without a log.
+ */
+enum pager_e pager_internal_checkpoint(struct Pager*);
+
+/**
+ * @brief Reads pages that are not already cached into the cache in one
+ * batch. Page ids of 0 or past the end of the file are skipped.
+ */
+enum pager_e
+pager_internal_prefetch(struct Pager*, u32 const* page_ids, int num);
+
 #endif
\ No newline at end of file
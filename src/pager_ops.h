@@ -1,21 +1,79 @@
 #ifndef PAGER_OPS_H_
 #define PAGER_OPS_H_
 
+#include "btint.h"
 #include "pager_e.h"
 
+enum pager_io_op_e
+{
+	PAGER_IO_READ,
+	PAGER_IO_WRITE,
+};
+
+/**
+ * @brief One page read or write for PagerOps submit/complete.
+ *
+ * The request and its buffer must stay alive until complete returns.
+ */
+struct PagerIO
+{
+	enum pager_io_op_e op;
+	void* buffer;
+	u64 offset;
+	int size;
+	// Set by complete. A read past the end of the file is PAGER_READ_ERR,
+	// same as the blocking read.
+	enum pager_e status;
+};
+
+/**
+ * @brief File operations used by the pager.
+ *
+ * Offsets and file sizes are 64-bit so that a single database file is not
+ * limited by the width of int; an individual read or write is at most one
+ * disk page.
+ */
 struct PagerOps
 {
 	enum pager_e (*open)(void** file, char const* filename);
 	enum pager_e (*read)(
-		void* file, void* buffer, int offset, int read_size, int* bytes_read);
+		void* file, void* buffer, u64 offset, int read_size, int* bytes_read);
 	enum pager_e (*write)(
 		void* file,
 		void* buffer,
-		int offset,
+		u64 offset,
 		int write_size,
 		int* bytes_written);
 	enum pager_e (*close)(void*);
-	int (*size)(void*);
+	/**
+	 * @brief Size of the file in bytes; negative on error.
+	 */
+	i64 (*size)(void*);
+	/**
+	 * @brief Optional; NULL if the backend can't map the file.
+	 *
+	 * Points out_ptr at read_size bytes of the file at offset. The memory is
+	 * read-only and stays valid until close. Returns PAGER_READ_ERR if the
+	 * range is past the end of the file.
+	 */
+	enum pager_e (*map)(
+		void* file, u64 offset, int read_size, void const** out_ptr);
+	/**
+	 * @brief Optional; NULL if the backend only has blocking I/O.
+	 *
+	 * submit queues the requests and hands them to the OS without waiting.
+	 * complete waits for every request submitted since the last complete and
+	 * sets each one's status.
+	 */
+	enum pager_e (*submit)(void* file, struct PagerIO* ios, int num);
+	enum pager_e (*complete)(void* file);
+	/**
+	 * @brief Optional; NULL if the backend can't force writes to stable
+	 * storage.
+	 *
+	 * Returns once every completed write is durable.
+	 */
+	enum pager_e (*sync)(void* file);
 };
 
 #endif
@@ -7,10 +7,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-// This is because of some crazy os caching I can't seem to control...
-// Posix only.
-// #include <unistd.h>
-// #include <fcntl.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+// fseek/ftell take a long, which is 32-bit on Windows.
+#ifdef _WIN32
+#define co_fseek _fseeki64
+#define co_ftell _ftelli64
+#else
+#define co_fseek fseeko
+#define co_ftell ftello
+#endif
 
 static enum pager_e
 co_open(void** file, char const* filename)
@@ -21,6 +31,10 @@ co_open(void** file, char const* filename)
 
 	if( fp )
 	{
+		// Reads and writes are whole pages. Unbuffered, a read also sees
+		// what another handle on the file wrote since, e.g. a background
+		// checkpointer's.
+		setvbuf(fp, NULL, _IONBF, 0);
 		*file = fp;
 		return PAGER_OK;
 	}
@@ -30,11 +44,12 @@ co_open(void** file, char const* filename)
 	}
 }
 
-static int
+static i64
 co_size(void* file)
 {
-	fseek(file, 0L, SEEK_END);
-	return ftell(file);
+	if( co_fseek(file, 0L, SEEK_END) != 0 )
+		return -1;
+	return co_ftell(file);
 }
 
 static enum pager_e
@@ -47,11 +62,11 @@ co_close(void* file)
 }
 
 static enum pager_e
-co_read(void* file, void* buffer, int offset, int read_size, int* bytes_read)
+co_read(void* file, void* buffer, u64 offset, int read_size, int* bytes_read)
 {
 	int result;
 
-	result = fseek(file, offset, SEEK_SET);
+	result = co_fseek(file, (i64)offset, SEEK_SET);
 	if( result != 0 )
 		return PAGER_SEEK_ERR;
 
@@ -59,18 +74,20 @@ co_read(void* file, void* buffer, int offset, int read_size, int* bytes_read)
 	if( result != 1 )
 		return PAGER_READ_ERR;
 
+	if( bytes_read )
+		*bytes_read = read_size;
+
 	return PAGER_OK;
 }
 
 static enum pager_e
 co_write(
-	void* file, void* buffer, int offset, int write_size, int* bytes_written)
+	void* file, void* buffer, u64 offset, int write_size, int* bytes_written)
 {
 	int seek_result;
 	unsigned int write_result;
-	assert(offset < 0x10000);
 
-	seek_result = fseek(file, offset, SEEK_SET);
+	seek_result = co_fseek(file, (i64)offset, SEEK_SET);
 	if( seek_result != 0 )
 		return PAGER_SEEK_ERR;
 
@@ -78,6 +95,9 @@ co_write(
 	if( write_result != 1 )
 		return PAGER_WRITE_ERR;
 
+	if( bytes_written )
+		*bytes_written = write_size;
+
 	// https://developer.apple.com/library/archive/documentation/System/Conceptual/ManPages_iPhoneOS/man2/fsync.2.html
 	// From fsync docs.
 	// 	For applications that require tighter guarantees about the integrity of
@@ -96,12 +116,31 @@ co_write(
 	return PAGER_OK;
 }
 
+static enum pager_e
+co_sync(void* file)
+{
+	if( fflush(file) != 0 )
+		return PAGER_WRITE_ERR;
+
+	// fflush only hands the stdio buffer to the OS.
+#ifdef _WIN32
+	if( _commit(_fileno(file)) != 0 )
+		return PAGER_IO_ERR;
+#else
+	if( fsync(fileno(file)) != 0 )
+		return PAGER_IO_ERR;
+#endif
+
+	return PAGER_OK;
+}
+
 struct PagerOps CStdOps = {
 	.open = &co_open,	//
 	.close = &co_close, //
 	.read = &co_read,	//
 	.write = &co_write, //
-	.size = &co_size	//
+	.size = &co_size,	//
+	.sync = &co_sync	//
 };
 
 enum pager_e
@@ -120,7 +159,11 @@ pager_cstd_create(
 
 	pager_result = pager_open(*r_pager, filename);
 	if( pager_result != PAGER_OK )
+	{
+		pager_dealloc(*r_pager);
+		*r_pager = NULL;
 		return pager_result;
+	}
 
 	return PAGER_OK;
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pager_ops_fd.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum pager_e
+pager_fd_open(char const* filename, int* out_fd)
+{
+	int fd = -1;
+
+	do
+	{
+		fd = open(filename, O_RDWR | O_CREAT, 0644);
+	} while( fd < 0 && errno == EINTR );
+
+	if( fd < 0 )
+		return PAGER_OPEN_ERR;
+
+	*out_fd = fd;
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_fd_close(int fd)
+{
+	return close(fd) == 0 ? PAGER_OK : PAGER_IO_ERR;
+}
+
+i64
+pager_fd_size(int fd)
+{
+	struct stat st;
+
+	if( fstat(fd, &st) != 0 )
+		return -1;
+
+	return (i64)st.st_size;
+}
+
+enum pager_e
+pager_fd_read(int fd, void* buffer, u64 offset, int size, int* bytes_read)
+{
+	char* dst = (char*)buffer;
+	int total = 0;
+
+	while( total < size )
+	{
+		ssize_t result =
+			pread(fd, dst + total, size - total, (off_t)(offset + total));
+		if( result < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			return PAGER_IO_ERR;
+		}
+
+		// Past the end of the file. Same as a short fread; the page does not
+		// exist on disk.
+		if( result == 0 )
+			break;
+
+		total += result;
+	}
+
+	if( bytes_read )
+		*bytes_read = total;
+
+	return total == size ? PAGER_OK : PAGER_READ_ERR;
+}
+
+enum pager_e
+pager_fd_write(
+	int fd, void const* buffer, u64 offset, int size, int* bytes_written)
+{
+	char const* src = (char const*)buffer;
+	int total = 0;
+
+	while( total < size )
+	{
+		ssize_t result =
+			pwrite(fd, src + total, size - total, (off_t)(offset + total));
+		if( result < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			return PAGER_IO_ERR;
+		}
+
+		if( result == 0 )
+			break;
+
+		total += result;
+	}
+
+	if( bytes_written )
+		*bytes_written = total;
+
+	return total == size ? PAGER_OK : PAGER_WRITE_ERR;
+}
+
+enum pager_e
+pager_fd_sync(int fd)
+{
+	int result;
+
+	do
+	{
+		result = fsync(fd);
+	} while( result != 0 && errno == EINTR );
+
+	return result == 0 ? PAGER_OK : PAGER_IO_ERR;
+}
+
+#endif
\ No newline at end of file
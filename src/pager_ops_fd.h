@@ -0,0 +1,51 @@
+#ifndef PAGER_OPS_FD_H_
+#define PAGER_OPS_FD_H_
+
+#include "btint.h"
+#include "pager_e.h"
+
+/**
+ * @brief File descriptor I/O shared by the PagerOps backends built on POSIX
+ * files: PosixOps, MmapOps and UringOps.
+ *
+ * An error the OS reports (errno) is PAGER_IO_ERR. A transfer that stops
+ * short without an error is PAGER_READ_ERR or PAGER_WRITE_ERR; for reads
+ * that means the range is past the end of the file.
+ *
+ * Not available on Windows.
+ */
+
+/**
+ * @brief Open filename read-write, creating it if needed.
+ *
+ * @return PAGER_OPEN_ERR if it can't be opened.
+ */
+enum pager_e pager_fd_open(char const* filename, int* out_fd);
+
+enum pager_e pager_fd_close(int fd);
+
+/**
+ * @brief Size of the file in bytes; negative on error.
+ */
+i64 pager_fd_size(int fd);
+
+/**
+ * @brief pread until size bytes are read or the file ends.
+ *
+ * @param bytes_read [out] Optional; bytes read, unless the OS failed the read.
+ */
+enum pager_e pager_fd_read(
+	int fd, void* buffer, u64 offset, int size, int* bytes_read);
+
+/**
+ * @brief pwrite until size bytes are written.
+ *
+ * @param bytes_written [out] Optional; bytes written, unless the OS failed
+ * the write.
+ */
+enum pager_e pager_fd_write(
+	int fd, void const* buffer, u64 offset, int size, int* bytes_written);
+
+enum pager_e pager_fd_sync(int fd);
+
+#endif
\ No newline at end of file
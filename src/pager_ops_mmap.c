@@ -0,0 +1,231 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pager_ops_mmap.h"
+
+#include "pager_ops.h"
+#include "pager_ops_fd.h"
+
+#ifndef _WIN32
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Mappings grow by at least this much so that extending the file a page at a
+// time does not remap on every new page.
+#define MMAP_MIN_GROWTH (1ull << 24)
+
+struct MmapRegion
+{
+	void* addr;
+	u64 length;
+};
+
+struct MmapFile
+{
+	int fd;
+
+	// Number of bytes at the start of the mapping known to be backed by the
+	// file. Touching mapped bytes past the end of the file is a SIGBUS.
+	u64 valid_length;
+
+	// regions[nregions - 1] is the current mapping. Older, smaller mappings
+	// stay mapped until close because borrowed pages may still point into
+	// them.
+	struct MmapRegion* regions;
+	int nregions;
+};
+
+static struct MmapRegion*
+current_region(struct MmapFile* mf)
+{
+	return mf->nregions > 0 ? &mf->regions[mf->nregions - 1] : NULL;
+}
+
+/**
+ * @brief Make sure [0, end) is mapped and backed by the file.
+ *
+ * @return PAGER_READ_ERR if end is past the end of the file.
+ */
+static enum pager_e
+ensure_mapped(struct MmapFile* mf, u64 end)
+{
+	struct MmapRegion* region = NULL;
+
+	if( end <= mf->valid_length )
+		return PAGER_OK;
+
+	// The file may have grown since we last looked.
+	i64 file_size = pager_fd_size(mf->fd);
+	if( file_size < 0 )
+		return PAGER_IO_ERR;
+
+	if( (u64)file_size < end )
+		return PAGER_READ_ERR;
+
+	region = current_region(mf);
+	if( region == NULL || region->length < (u64)file_size )
+	{
+		u64 length = region ? region->length * 2 : 0;
+		if( length < (u64)file_size + MMAP_MIN_GROWTH )
+			length = (u64)file_size + MMAP_MIN_GROWTH;
+
+		// Mapping past the end of the file is allowed; only touching those
+		// bytes faults, and valid_length keeps us from handing them out.
+		void* addr = mmap(NULL, length, PROT_READ, MAP_SHARED, mf->fd, 0);
+		if( addr == MAP_FAILED )
+			return PAGER_IO_ERR;
+
+		struct MmapRegion* regions = (struct MmapRegion*)realloc(
+			mf->regions, sizeof(struct MmapRegion) * (mf->nregions + 1));
+		if( !regions )
+		{
+			munmap(addr, length);
+			return PAGER_ERR_NO_MEM;
+		}
+
+		mf->regions = regions;
+		mf->regions[mf->nregions].addr = addr;
+		mf->regions[mf->nregions].length = length;
+		mf->nregions += 1;
+	}
+
+	mf->valid_length = (u64)file_size;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+mm_open(void** file, char const* filename)
+{
+	struct MmapFile* mf = NULL;
+	int fd = -1;
+	enum pager_e result = PAGER_OK;
+
+	result = pager_fd_open(filename, &fd);
+	if( result != PAGER_OK )
+		return result;
+
+	mf = (struct MmapFile*)malloc(sizeof(struct MmapFile));
+	if( !mf )
+	{
+		pager_fd_close(fd);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	memset(mf, 0x00, sizeof(*mf));
+	mf->fd = fd;
+
+	*file = mf;
+	return PAGER_OK;
+}
+
+static i64
+mm_size(void* file)
+{
+	struct MmapFile* mf = (struct MmapFile*)file;
+
+	return pager_fd_size(mf->fd);
+}
+
+static enum pager_e
+mm_close(void* file)
+{
+	struct MmapFile* mf = (struct MmapFile*)file;
+
+	for( int i = 0; i < mf->nregions; i++ )
+		munmap(mf->regions[i].addr, mf->regions[i].length);
+
+	enum pager_e result = pager_fd_close(mf->fd);
+	free(mf->regions);
+	free(mf);
+
+	return result;
+}
+
+static enum pager_e
+mm_map(void* file, u64 offset, int read_size, void const** out_ptr)
+{
+	struct MmapFile* mf = (struct MmapFile*)file;
+	enum pager_e result = PAGER_OK;
+
+	result = ensure_mapped(mf, offset + read_size);
+	if( result != PAGER_OK )
+		return result;
+
+	*out_ptr = (char const*)current_region(mf)->addr + offset;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+mm_read(void* file, void* buffer, u64 offset, int read_size, int* bytes_read)
+{
+	enum pager_e result = PAGER_OK;
+	void const* src = NULL;
+
+	result = mm_map(file, offset, read_size, &src);
+	if( result != PAGER_OK )
+		return result;
+
+	memcpy(buffer, src, read_size);
+
+	if( bytes_read )
+		*bytes_read = read_size;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+mm_write(
+	void* file, void* buffer, u64 offset, int write_size, int* bytes_written)
+{
+	struct MmapFile* mf = (struct MmapFile*)file;
+
+	return pager_fd_write(mf->fd, buffer, offset, write_size, bytes_written);
+}
+
+// Writes go through pwrite, not the mapping, so there is nothing to msync.
+static enum pager_e
+mm_sync(void* file)
+{
+	struct MmapFile* mf = (struct MmapFile*)file;
+
+	return pager_fd_sync(mf->fd);
+}
+
+struct PagerOps MmapOps = {
+	.open = &mm_open,	//
+	.close = &mm_close, //
+	.read = &mm_read,	//
+	.write = &mm_write, //
+	.size = &mm_size,	//
+	.map = &mm_map,		//
+	.sync = &mm_sync	//
+};
+
+enum pager_e
+pager_mmap_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size)
+{
+	enum pager_e pager_result;
+
+	pager_result = pager_create(r_pager, &MmapOps, cache, page_size);
+	if( pager_result != PAGER_OK )
+		return pager_result;
+
+	pager_result = pager_open(*r_pager, filename);
+	if( pager_result != PAGER_OK )
+	{
+		pager_dealloc(*r_pager);
+		*r_pager = NULL;
+		return pager_result;
+	}
+
+	return PAGER_OK;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PAGER_OPS_MMAP_H_
+#define PAGER_OPS_MMAP_H_
+
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops.h"
+
+/**
+ * @brief pread/pwrite ops that also map the file read-only.
+ *
+ * pager_read_page_ro borrows pages straight from the mapping. Writes still go
+ * through pwrite; the mapping is MAP_SHARED so it sees them immediately.
+ *
+ * Not available on Windows.
+ */
+extern struct PagerOps MmapOps;
+
+enum pager_e pager_mmap_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size);
+
+#endif
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pager_ops_posix.h"
+
+#include "pager_ops.h"
+#include "pager_ops_fd.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <stdlib.h>
+
+struct PosixFile
+{
+	int fd;
+};
+
+static enum pager_e
+po_open(void** file, char const* filename)
+{
+	struct PosixFile* pf = NULL;
+	int fd = -1;
+	enum pager_e result = PAGER_OK;
+
+	result = pager_fd_open(filename, &fd);
+	if( result != PAGER_OK )
+		return result;
+
+	pf = (struct PosixFile*)malloc(sizeof(struct PosixFile));
+	if( !pf )
+	{
+		pager_fd_close(fd);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	pf->fd = fd;
+
+	// Btree pages are visited by key, not by file position, so turn off
+	// kernel readahead. This is only a hint; ignore failures.
+#ifdef POSIX_FADV_RANDOM
+	posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
+	*file = pf;
+	return PAGER_OK;
+}
+
+static i64
+po_size(void* file)
+{
+	struct PosixFile* pf = (struct PosixFile*)file;
+
+	return pager_fd_size(pf->fd);
+}
+
+static enum pager_e
+po_close(void* file)
+{
+	struct PosixFile* pf = (struct PosixFile*)file;
+	enum pager_e result = pager_fd_close(pf->fd);
+	free(pf);
+
+	return result;
+}
+
+static enum pager_e
+po_read(void* file, void* buffer, u64 offset, int read_size, int* bytes_read)
+{
+	struct PosixFile* pf = (struct PosixFile*)file;
+
+	return pager_fd_read(pf->fd, buffer, offset, read_size, bytes_read);
+}
+
+static enum pager_e
+po_write(
+	void* file, void* buffer, u64 offset, int write_size, int* bytes_written)
+{
+	struct PosixFile* pf = (struct PosixFile*)file;
+
+	return pager_fd_write(pf->fd, buffer, offset, write_size, bytes_written);
+}
+
+static enum pager_e
+po_sync(void* file)
+{
+	struct PosixFile* pf = (struct PosixFile*)file;
+
+	return pager_fd_sync(pf->fd);
+}
+
+struct PagerOps PosixOps = {
+	.open = &po_open,	//
+	.close = &po_close, //
+	.read = &po_read,	//
+	.write = &po_write, //
+	.size = &po_size,	//
+	.sync = &po_sync	//
+};
+
+enum pager_e
+pager_posix_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size)
+{
+	enum pager_e pager_result;
+
+	pager_result = pager_create(r_pager, &PosixOps, cache, page_size);
+	if( pager_result != PAGER_OK )
+		return pager_result;
+
+	pager_result = pager_open(*r_pager, filename);
+	if( pager_result != PAGER_OK )
+	{
+		pager_dealloc(*r_pager);
+		*r_pager = NULL;
+		return pager_result;
+	}
+
+	return PAGER_OK;
+}
+
+#endif
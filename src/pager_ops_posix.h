@@ -0,0 +1,24 @@
+#ifndef PAGER_OPS_POSIX_H_
+#define PAGER_OPS_POSIX_H_
+
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops.h"
+
+/**
+ * @brief File descriptor backed ops using pread/pwrite.
+ *
+ * Unlike CStdOps there is no shared file position and no stdio buffer, so
+ * each page is copied once between the kernel and the page buffer.
+ *
+ * Not available on Windows.
+ */
+extern struct PagerOps PosixOps;
+
+enum pager_e pager_posix_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size);
+
+#endif
@@ -0,0 +1,442 @@
+#define _GNU_SOURCE
+
+#include "pager_ops_uring.h"
+
+#include "pager_ops.h"
+#include "pager_ops_fd.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_ENTRIES 64
+
+struct UringRing
+{
+	int ring_fd;
+	unsigned sq_entries;
+	unsigned cq_entries;
+
+	void* sq_ptr;
+	size_t sq_len;
+	unsigned* sq_head;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	struct io_uring_sqe* sqes;
+	size_t sqes_len;
+
+	void* cq_ptr;
+	size_t cq_len;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_cqe* cqes;
+};
+
+struct UringFile
+{
+	int fd;
+	// ring.ring_fd < 0 if io_uring is not available.
+	struct UringRing ring;
+	// Queued in the SQ but not yet handed to the kernel.
+	unsigned unsubmitted;
+	// Handed to the kernel but not yet reaped.
+	unsigned inflight;
+};
+
+static int
+sys_io_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int
+sys_io_uring_enter(
+	int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(
+		__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int
+ring_init(struct UringRing* ring)
+{
+	struct io_uring_params params;
+	memset(&params, 0x00, sizeof(params));
+	memset(ring, 0x00, sizeof(*ring));
+
+	ring->ring_fd = sys_io_uring_setup(URING_ENTRIES, &params);
+	if( ring->ring_fd < 0 )
+		return -1;
+
+	ring->sq_entries = params.sq_entries;
+	ring->cq_entries = params.cq_entries;
+	ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_len =
+		params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if( single_mmap )
+	{
+		if( ring->cq_len > ring->sq_len )
+			ring->sq_len = ring->cq_len;
+		ring->cq_len = ring->sq_len;
+	}
+
+	ring->sq_ptr = mmap(
+		NULL,
+		ring->sq_len,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		ring->ring_fd,
+		IORING_OFF_SQ_RING);
+	if( ring->sq_ptr == MAP_FAILED )
+		goto fail;
+
+	if( single_mmap )
+	{
+		ring->cq_ptr = ring->sq_ptr;
+	}
+	else
+	{
+		ring->cq_ptr = mmap(
+			NULL,
+			ring->cq_len,
+			PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE,
+			ring->ring_fd,
+			IORING_OFF_CQ_RING);
+		if( ring->cq_ptr == MAP_FAILED )
+			goto fail;
+	}
+
+	ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe*)mmap(
+		NULL,
+		ring->sqes_len,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		ring->ring_fd,
+		IORING_OFF_SQES);
+	if( ring->sqes == MAP_FAILED )
+		goto fail;
+
+	char* sq = (char*)ring->sq_ptr;
+	ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+	char* cq = (char*)ring->cq_ptr;
+	ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return 0;
+
+fail:
+	if( ring->sq_ptr && ring->sq_ptr != MAP_FAILED )
+		munmap(ring->sq_ptr, ring->sq_len);
+	if( ring->cq_ptr && ring->cq_ptr != MAP_FAILED &&
+		ring->cq_ptr != ring->sq_ptr )
+		munmap(ring->cq_ptr, ring->cq_len);
+	close(ring->ring_fd);
+	ring->ring_fd = -1;
+	return -1;
+}
+
+static void
+ring_deinit(struct UringRing* ring)
+{
+	if( ring->ring_fd < 0 )
+		return;
+
+	munmap(ring->sqes, ring->sqes_len);
+	if( ring->cq_ptr != ring->sq_ptr )
+		munmap(ring->cq_ptr, ring->cq_len);
+	munmap(ring->sq_ptr, ring->sq_len);
+	close(ring->ring_fd);
+	ring->ring_fd = -1;
+}
+
+static enum pager_e
+status_from_result(struct PagerIO* io, int res)
+{
+	if( res < 0 )
+		return PAGER_IO_ERR;
+	if( res == io->size )
+		return PAGER_OK;
+
+	// Short read means the page is past the end of the file.
+	return io->op == PAGER_IO_READ ? PAGER_READ_ERR : PAGER_WRITE_ERR;
+}
+
+/**
+ * @brief Hand queued SQEs to the kernel and reap until at most max_inflight
+ * requests are outstanding.
+ */
+static enum pager_e
+ring_enter(struct UringFile* uf, unsigned max_inflight)
+{
+	struct UringRing* ring = &uf->ring;
+
+	while( uf->unsubmitted > 0 || uf->inflight > max_inflight )
+	{
+		unsigned wait =
+			uf->inflight > max_inflight ? uf->inflight - max_inflight : 0;
+		int result = sys_io_uring_enter(
+			ring->ring_fd,
+			uf->unsubmitted,
+			wait,
+			wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+		if( result < 0 )
+		{
+			if( errno == EINTR || errno == EAGAIN || errno == EBUSY )
+				continue;
+			return PAGER_IO_ERR;
+		}
+
+		uf->unsubmitted -= (unsigned)result;
+
+		unsigned head = *ring->cq_head;
+		unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+		while( head != tail )
+		{
+			struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+			struct PagerIO* io = (struct PagerIO*)(uintptr_t)cqe->user_data;
+
+			io->status = status_from_result(io, cqe->res);
+
+			head++;
+			uf->inflight--;
+		}
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	return PAGER_OK;
+}
+
+static void
+sync_io(struct UringFile* uf, struct PagerIO* io)
+{
+	io->status =
+		io->op == PAGER_IO_READ
+			? pager_fd_read(uf->fd, io->buffer, io->offset, io->size, NULL)
+			: pager_fd_write(uf->fd, io->buffer, io->offset, io->size, NULL);
+}
+
+static enum pager_e
+ur_submit(void* file, struct PagerIO* ios, int num)
+{
+	struct UringFile* uf = (struct UringFile*)file;
+	struct UringRing* ring = &uf->ring;
+	enum pager_e result = PAGER_OK;
+
+	if( ring->ring_fd < 0 )
+	{
+		for( int i = 0; i < num; i++ )
+			sync_io(uf, &ios[i]);
+		return PAGER_OK;
+	}
+
+	for( int i = 0; i < num; i++ )
+	{
+		unsigned tail = *ring->sq_tail;
+		unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+		// SQ full, or the CQ could overflow; push what we have and reap.
+		if( tail - head == ring->sq_entries ||
+			uf->inflight + uf->unsubmitted == ring->cq_entries )
+		{
+			result = ring_enter(uf, ring->cq_entries - ring->sq_entries);
+			if( result != PAGER_OK )
+				return result;
+			tail = *ring->sq_tail;
+		}
+
+		unsigned index = tail & *ring->sq_mask;
+		struct io_uring_sqe* sqe = &ring->sqes[index];
+		memset(sqe, 0x00, sizeof(*sqe));
+		sqe->opcode =
+			ios[i].op == PAGER_IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = uf->fd;
+		sqe->addr = (u64)(uintptr_t)ios[i].buffer;
+		sqe->len = ios[i].size;
+		sqe->off = ios[i].offset;
+		sqe->user_data = (u64)(uintptr_t)&ios[i];
+
+		ring->sq_array[index] = index;
+		__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+		ios[i].status = PAGER_ERR_PAGE_PERSISTENCE_UNKNOWN;
+		uf->unsubmitted++;
+		uf->inflight++;
+	}
+
+	// Don't wait; just hand the batch to the kernel.
+	return ring_enter(uf, uf->inflight);
+}
+
+static enum pager_e
+ur_complete(void* file)
+{
+	struct UringFile* uf = (struct UringFile*)file;
+
+	if( uf->ring.ring_fd < 0 )
+		return PAGER_OK;
+
+	return ring_enter(uf, 0);
+}
+
+static enum pager_e
+ur_open(void** file, char const* filename)
+{
+	struct UringFile* uf = NULL;
+	int fd = -1;
+	enum pager_e result = PAGER_OK;
+
+	result = pager_fd_open(filename, &fd);
+	if( result != PAGER_OK )
+		return result;
+
+	uf = (struct UringFile*)malloc(sizeof(struct UringFile));
+	if( !uf )
+	{
+		pager_fd_close(fd);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	memset(uf, 0x00, sizeof(*uf));
+	uf->fd = fd;
+
+	// Falls back to pread/pwrite on failure.
+	ring_init(&uf->ring);
+
+	*file = uf;
+	return PAGER_OK;
+}
+
+static i64
+ur_size(void* file)
+{
+	struct UringFile* uf = (struct UringFile*)file;
+
+	return pager_fd_size(uf->fd);
+}
+
+static enum pager_e
+ur_close(void* file)
+{
+	struct UringFile* uf = (struct UringFile*)file;
+
+	ur_complete(uf);
+	ring_deinit(&uf->ring);
+
+	enum pager_e result = pager_fd_close(uf->fd);
+	free(uf);
+
+	return result;
+}
+
+static enum pager_e
+blocking_io(
+	void* file,
+	enum pager_io_op_e op,
+	void* buffer,
+	u64 offset,
+	int size,
+	int* bytes)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerIO io = {
+		.op = op, .buffer = buffer, .offset = offset, .size = size};
+
+	result = ur_submit(file, &io, 1);
+	if( result != PAGER_OK )
+		return result;
+
+	result = ur_complete(file);
+	if( result != PAGER_OK )
+		return result;
+
+	if( bytes )
+		*bytes = io.status == PAGER_OK ? size : 0;
+
+	return io.status;
+}
+
+static enum pager_e
+ur_read(void* file, void* buffer, u64 offset, int read_size, int* bytes_read)
+{
+	return blocking_io(
+		file, PAGER_IO_READ, buffer, offset, read_size, bytes_read);
+}
+
+static enum pager_e
+ur_write(
+	void* file, void* buffer, u64 offset, int write_size, int* bytes_written)
+{
+	return blocking_io(
+		file, PAGER_IO_WRITE, buffer, offset, write_size, bytes_written);
+}
+
+static enum pager_e
+ur_sync(void* file)
+{
+	struct UringFile* uf = (struct UringFile*)file;
+	enum pager_e result = PAGER_OK;
+
+	// fsync only covers writes that have completed.
+	result = ur_complete(uf);
+	if( result != PAGER_OK )
+		return result;
+
+	return pager_fd_sync(uf->fd);
+}
+
+struct PagerOps UringOps = {
+	.open = &ur_open,		  //
+	.close = &ur_close,		  //
+	.read = &ur_read,		  //
+	.write = &ur_write,		  //
+	.size = &ur_size,		  //
+	.submit = &ur_submit,	  //
+	.complete = &ur_complete, //
+	.sync = &ur_sync,		  //
+};
+
+enum pager_e
+pager_uring_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size)
+{
+	enum pager_e pager_result;
+
+	pager_result = pager_create(r_pager, &UringOps, cache, page_size);
+	if( pager_result != PAGER_OK )
+		return pager_result;
+
+	pager_result = pager_open(*r_pager, filename);
+	if( pager_result != PAGER_OK )
+	{
+		pager_dealloc(*r_pager);
+		*r_pager = NULL;
+		return pager_result;
+	}
+
+	return PAGER_OK;
+}
+
+#endif
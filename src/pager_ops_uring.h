@@ -0,0 +1,25 @@
+#ifndef PAGER_OPS_URING_H_
+#define PAGER_OPS_URING_H_
+
+#include "page_cache.h"
+#include "pager.h"
+#include "pager_ops.h"
+
+/**
+ * @brief io_uring ops with batched submit/complete.
+ *
+ * The blocking read/write are a submit of one request followed by complete.
+ * If the kernel refuses io_uring (old kernel, seccomp, io_uring_disabled),
+ * the same API falls back to pread/pwrite.
+ *
+ * Linux only.
+ */
+extern struct PagerOps UringOps;
+
+enum pager_e pager_uring_create(
+	struct Pager** r_pager,
+	struct PageCache* cache,
+	char const* filename,
+	unsigned int page_size);
+
+#endif
@@ -0,0 +1,782 @@
+#include "pager_shadow.h"
+
+#include "serialization.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SHADOW_MAGIC 0x53484431
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * @brief The fields of a root record; see pager_shadow.h.
+ */
+struct ShadowRecord
+{
+	u32 generation;
+	u32 dir_page;
+	u32 ndir_pages;
+	u32 nmap_pages;
+	u32 max_page;
+	u32 disk_page_size;
+};
+
+static u32
+checksum(byte const* data, u32 size)
+{
+	u32 hash = FNV_OFFSET;
+	for( u32 i = 0; i < size; i++ )
+	{
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static u64
+physical_offset(struct PagerShadow* shadow, u32 physical)
+{
+	return (u64)shadow->disk_page_size * (u64)(physical - 1);
+}
+
+// Entries in a map page.
+static u32
+map_entries(struct PagerShadow* shadow)
+{
+	return shadow->disk_page_size / 4;
+}
+
+// Map page ids in a directory page, after the next link and the count.
+static u32
+dir_entries(struct PagerShadow* shadow)
+{
+	return shadow->disk_page_size / 4 - 2;
+}
+
+static u32
+grown(u32 capacity, u32 needed)
+{
+	u32 grown = capacity ? capacity : 64;
+	while( grown < needed )
+		grown *= 2;
+
+	return grown;
+}
+
+static enum pager_e
+push(u32** list, u32* num, u32* capacity, u32 value)
+{
+	if( *num == *capacity )
+	{
+		u32 new_capacity = grown(*capacity, *num + 1);
+		u32* new_list = (u32*)realloc(*list, sizeof(u32) * new_capacity);
+		if( !new_list )
+			return PAGER_ERR_NO_MEM;
+
+		*list = new_list;
+		*capacity = new_capacity;
+	}
+
+	(*list)[*num] = value;
+	*num += 1;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+ensure_map(struct PagerShadow* shadow, u32 npages)
+{
+	if( npages <= shadow->map_capacity )
+		return PAGER_OK;
+
+	u32 capacity = grown(shadow->map_capacity, npages);
+	u32* map = (u32*)realloc(shadow->map, sizeof(u32) * capacity);
+	if( !map )
+		return PAGER_ERR_NO_MEM;
+
+	memset(
+		map + shadow->map_capacity,
+		0x00,
+		sizeof(u32) * (capacity - shadow->map_capacity));
+	shadow->map = map;
+	shadow->map_capacity = capacity;
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Room for nmap_pages map pages; new ones have no physical page yet.
+ */
+static enum pager_e
+ensure_map_pages(struct PagerShadow* shadow, u32 nmap_pages)
+{
+	if( nmap_pages > shadow->map_pages_capacity )
+	{
+		u32 capacity = grown(shadow->map_pages_capacity, nmap_pages);
+		u32* pages =
+			(u32*)realloc(shadow->map_pages, sizeof(u32) * capacity);
+		if( !pages )
+			return PAGER_ERR_NO_MEM;
+		shadow->map_pages = pages;
+
+		char* dirty = (char*)realloc(shadow->map_dirty, capacity);
+		if( !dirty )
+			return PAGER_ERR_NO_MEM;
+		shadow->map_dirty = dirty;
+
+		shadow->map_pages_capacity = capacity;
+	}
+
+	for( u32 i = shadow->nmap_pages; i < nmap_pages; i++ )
+	{
+		shadow->map_pages[i] = 0;
+		shadow->map_dirty[i] = 1;
+	}
+	if( nmap_pages > shadow->nmap_pages )
+		shadow->nmap_pages = nmap_pages;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+ensure_physical(struct PagerShadow* shadow, u32 nphysical)
+{
+	if( nphysical > shadow->state_capacity )
+	{
+		u32 capacity = grown(shadow->state_capacity, nphysical);
+		byte* state = (byte*)realloc(shadow->state, capacity);
+		if( !state )
+			return PAGER_ERR_NO_MEM;
+
+		memset(
+			state + shadow->state_capacity,
+			PAGER_SHADOW_FREE,
+			capacity - shadow->state_capacity);
+		shadow->state = state;
+		shadow->state_capacity = capacity;
+	}
+
+	if( nphysical > shadow->nphysical )
+		shadow->nphysical = nphysical;
+
+	return PAGER_OK;
+}
+
+static byte*
+state_of(struct PagerShadow* shadow, u32 physical)
+{
+	return &shadow->state[physical - 1];
+}
+
+/**
+ * @brief Take a free physical page, or one past the end of the file.
+ */
+static enum pager_e
+alloc_physical(struct PagerShadow* shadow, u32* r_physical)
+{
+	enum pager_e result = PAGER_OK;
+	u32 physical = 0;
+
+	// Room on the fresh list first, so nothing needs undoing after.
+	result = push(
+		&shadow->fresh, &shadow->nfresh, &shadow->fresh_capacity, 0);
+	if( result != PAGER_OK )
+		return result;
+
+	if( shadow->nfree > 0 )
+	{
+		shadow->nfree -= 1;
+		physical = shadow->free_pages[shadow->nfree];
+	}
+	else
+	{
+		physical = shadow->nphysical + 1;
+		result = ensure_physical(shadow, physical);
+		if( result != PAGER_OK )
+		{
+			shadow->nfresh -= 1;
+			return result;
+		}
+	}
+
+	shadow->fresh[shadow->nfresh - 1] = physical;
+	*state_of(shadow, physical) = PAGER_SHADOW_FRESH;
+	*r_physical = physical;
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Where the next image of something stored at physical (0 if
+ * nowhere yet) goes. Pages written since the last commit are rewritten in
+ * place; anything else moves.
+ */
+static enum pager_e
+relocate(struct PagerShadow* shadow, u32 physical, u32* r_physical)
+{
+	enum pager_e result = PAGER_OK;
+
+	if( physical != 0 && *state_of(shadow, physical) == PAGER_SHADOW_FRESH )
+	{
+		*r_physical = physical;
+		return PAGER_OK;
+	}
+
+	if( physical != 0 )
+	{
+		result = push(
+			&shadow->retired,
+			&shadow->nretired,
+			&shadow->retired_capacity,
+			physical);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	result = alloc_physical(shadow, r_physical);
+	if( result != PAGER_OK )
+	{
+		if( physical != 0 )
+			shadow->nretired -= 1;
+		return result;
+	}
+
+	if( physical != 0 )
+		*state_of(shadow, physical) = PAGER_SHADOW_RETIRED;
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+read_physical(struct PagerShadow* shadow, u32 physical, byte* buffer)
+{
+	int bytes = 0;
+	return shadow->ops->read(
+		shadow->file,
+		buffer,
+		physical_offset(shadow, physical),
+		shadow->disk_page_size,
+		&bytes);
+}
+
+static enum pager_e
+write_physical(struct PagerShadow* shadow, u32 physical, byte* buffer)
+{
+	int bytes = 0;
+	return shadow->ops->write(
+		shadow->file,
+		buffer,
+		physical_offset(shadow, physical),
+		shadow->disk_page_size,
+		&bytes);
+}
+
+static enum pager_e
+write_record(struct PagerShadow* shadow, struct ShadowRecord const* record)
+{
+	byte buffer[PAGER_SHADOW_RECORD_SIZE] = {0};
+	int bytes = 0;
+
+	ser_write_32bit_le(buffer, SHADOW_MAGIC);
+	ser_write_32bit_le(buffer + 4, record->generation);
+	ser_write_32bit_le(buffer + 8, record->dir_page);
+	ser_write_32bit_le(buffer + 12, record->ndir_pages);
+	ser_write_32bit_le(buffer + 16, record->nmap_pages);
+	ser_write_32bit_le(buffer + 20, record->max_page);
+	ser_write_32bit_le(buffer + 24, record->disk_page_size);
+	ser_write_32bit_le(buffer + 28, checksum(buffer, 28));
+
+	return shadow->ops->write(
+		shadow->file,
+		buffer,
+		(u64)(record->generation & 1) * PAGER_SHADOW_SLOT_STRIDE,
+		sizeof(buffer),
+		&bytes);
+}
+
+/**
+ * @brief Read the record in slot; 0 if it isn't valid.
+ */
+static char
+read_record(struct PagerShadow* shadow, u32 slot, struct ShadowRecord* record)
+{
+	byte buffer[PAGER_SHADOW_RECORD_SIZE] = {0};
+	u32 magic = 0;
+	u32 record_checksum = 0;
+	int bytes = 0;
+
+	if( shadow->ops->read(
+			shadow->file,
+			buffer,
+			(u64)slot * PAGER_SHADOW_SLOT_STRIDE,
+			sizeof(buffer),
+			&bytes) != PAGER_OK )
+		return 0;
+
+	ser_read_32bit_le(&magic, buffer);
+	ser_read_32bit_le(&record->generation, buffer + 4);
+	ser_read_32bit_le(&record->dir_page, buffer + 8);
+	ser_read_32bit_le(&record->ndir_pages, buffer + 12);
+	ser_read_32bit_le(&record->nmap_pages, buffer + 16);
+	ser_read_32bit_le(&record->max_page, buffer + 20);
+	ser_read_32bit_le(&record->disk_page_size, buffer + 24);
+	ser_read_32bit_le(&record_checksum, buffer + 28);
+
+	return magic == SHADOW_MAGIC && record_checksum == checksum(buffer, 28) &&
+		   (record->generation & 1) == slot;
+}
+
+/**
+ * @brief Mark a page the record uses; 0 if it can't be one.
+ */
+static char
+mark_live(struct PagerShadow* shadow, u32 physical)
+{
+	if( physical < 2 || physical > shadow->nphysical ||
+		*state_of(shadow, physical) != PAGER_SHADOW_FREE )
+		return 0;
+
+	*state_of(shadow, physical) = PAGER_SHADOW_LIVE;
+	return 1;
+}
+
+/**
+ * @brief Load the directory and map pages the record names.
+ */
+static enum pager_e
+load(struct PagerShadow* shadow, struct ShadowRecord const* record)
+{
+	enum pager_e result = PAGER_OK;
+	byte* buffer = (byte*)malloc(shadow->disk_page_size);
+	u32 dir_page = record->dir_page;
+	u32 nmap_pages = 0;
+
+	if( !buffer )
+		return PAGER_ERR_NO_MEM;
+
+	shadow->generation = record->generation;
+	shadow->max_page = record->max_page;
+
+	result = ensure_map(shadow, record->max_page);
+	if( result != PAGER_OK )
+		goto end;
+
+	result = ensure_map_pages(shadow, record->nmap_pages);
+	if( result != PAGER_OK )
+		goto end;
+
+	for( u32 i = 0; i < record->ndir_pages; i++ )
+	{
+		u32 count = 0;
+
+		if( !mark_live(shadow, dir_page) )
+			goto corrupt;
+
+		result = push(
+			&shadow->dir_pages,
+			&shadow->ndir_pages,
+			&shadow->dir_pages_capacity,
+			dir_page);
+		if( result != PAGER_OK )
+			goto end;
+
+		result = read_physical(shadow, dir_page, buffer);
+		if( result != PAGER_OK )
+			goto end;
+
+		ser_read_32bit_le(&dir_page, buffer);
+		ser_read_32bit_le(&count, buffer + 4);
+		if( count > dir_entries(shadow) ||
+			nmap_pages + count > record->nmap_pages )
+			goto corrupt;
+
+		for( u32 j = 0; j < count; j++ )
+		{
+			u32 map_page = 0;
+			ser_read_32bit_le(&map_page, buffer + 8 + 4 * j);
+			if( !mark_live(shadow, map_page) )
+				goto corrupt;
+
+			shadow->map_pages[nmap_pages] = map_page;
+			shadow->map_dirty[nmap_pages] = 0;
+			nmap_pages += 1;
+		}
+	}
+
+	if( nmap_pages != record->nmap_pages )
+		goto corrupt;
+
+	for( u32 i = 0; i < nmap_pages; i++ )
+	{
+		result = read_physical(shadow, shadow->map_pages[i], buffer);
+		if( result != PAGER_OK )
+			goto end;
+
+		u32 first = i * map_entries(shadow);
+		for( u32 j = 0; j < map_entries(shadow); j++ )
+		{
+			u32 physical = 0;
+			if( first + j >= record->max_page )
+				break;
+
+			ser_read_32bit_le(&physical, buffer + 4 * j);
+			if( physical != 0 && !mark_live(shadow, physical) )
+				goto corrupt;
+
+			shadow->map[first + j] = physical;
+		}
+	}
+
+end:
+	free(buffer);
+	return result;
+
+corrupt:
+	free(buffer);
+	return PAGER_OPEN_ERR;
+}
+
+enum pager_e
+pager_shadow_open(
+	struct PagerShadow** r_shadow,
+	struct PagerOps* ops,
+	void* file,
+	u32 disk_page_size)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerShadow* shadow =
+		(struct PagerShadow*)calloc(1, sizeof(struct PagerShadow));
+	struct ShadowRecord records[2] = {0};
+	char valid[2] = {0};
+
+	if( !shadow )
+		return PAGER_ERR_NO_MEM;
+
+	shadow->ops = ops;
+	shadow->file = file;
+	shadow->disk_page_size = disk_page_size;
+
+	// Both records must fit in page 1, in sectors of their own.
+	if( disk_page_size < 2 * PAGER_SHADOW_SLOT_STRIDE )
+	{
+		result = PAGER_OPEN_ERR;
+		goto err;
+	}
+
+	i64 size = ops->size(file);
+	if( size < 0 )
+	{
+		result = PAGER_SEEK_ERR;
+		goto err;
+	}
+
+	result = ensure_physical(
+		shadow, (u32)(((u64)size + disk_page_size - 1) / disk_page_size));
+	if( result != PAGER_OK )
+		goto err;
+
+	if( size == 0 )
+	{
+		byte* page = (byte*)calloc(1, disk_page_size);
+		if( !page )
+		{
+			result = PAGER_ERR_NO_MEM;
+			goto err;
+		}
+
+		result = ensure_physical(shadow, 1);
+		if( result == PAGER_OK )
+			result = write_physical(shadow, 1, page);
+		free(page);
+		if( result != PAGER_OK )
+			goto err;
+
+		struct ShadowRecord empty = {.disk_page_size = disk_page_size};
+		result = write_record(shadow, &empty);
+		if( result != PAGER_OK )
+			goto err;
+	}
+	else
+	{
+		for( u32 slot = 0; slot < 2; slot++ )
+			valid[slot] = read_record(shadow, slot, &records[slot]);
+
+		if( !valid[0] && !valid[1] )
+		{
+			result = PAGER_OPEN_ERR;
+			goto err;
+		}
+
+		// Generations wrap; the newer one is ahead by less than half.
+		u32 slot = valid[1];
+		if( valid[0] && valid[1] )
+			slot = (int)(records[1].generation - records[0].generation) > 0;
+		if( records[slot].disk_page_size != disk_page_size )
+		{
+			result = PAGER_OPEN_ERR;
+			goto err;
+		}
+
+		result = load(shadow, &records[slot]);
+		if( result != PAGER_OK )
+			goto err;
+	}
+
+	*state_of(shadow, 1) = PAGER_SHADOW_LIVE;
+
+	// Highest first, so the lowest pages are handed out first.
+	for( u32 physical = shadow->nphysical; physical > 1; physical-- )
+	{
+		if( *state_of(shadow, physical) != PAGER_SHADOW_FREE )
+			continue;
+
+		result = push(
+			&shadow->free_pages,
+			&shadow->nfree,
+			&shadow->free_capacity,
+			physical);
+		if( result != PAGER_OK )
+			goto err;
+	}
+
+	*r_shadow = shadow;
+	return PAGER_OK;
+
+err:
+	pager_shadow_close(shadow);
+	*r_shadow = NULL;
+	return result;
+}
+
+void
+pager_shadow_close(struct PagerShadow* shadow)
+{
+	free(shadow->map);
+	free(shadow->map_pages);
+	free(shadow->map_dirty);
+	free(shadow->dir_pages);
+	free(shadow->state);
+	free(shadow->free_pages);
+	free(shadow->fresh);
+	free(shadow->retired);
+	free(shadow);
+}
+
+char
+pager_shadow_find(struct PagerShadow* shadow, u32 page_id, u32* r_physical)
+{
+	if( page_id == 0 || page_id > shadow->map_capacity ||
+		shadow->map[page_id - 1] == 0 )
+		return 0;
+
+	*r_physical = shadow->map[page_id - 1];
+	return 1;
+}
+
+enum pager_e
+pager_shadow_place(struct PagerShadow* shadow, u32 page_id, u32* r_physical)
+{
+	enum pager_e result = PAGER_OK;
+	u32 physical = 0;
+
+	result = ensure_map(shadow, page_id);
+	if( result != PAGER_OK )
+		return result;
+
+	u32 current = shadow->map[page_id - 1];
+	result = relocate(shadow, current, &physical);
+	if( result != PAGER_OK )
+		return result;
+
+	if( physical != current )
+	{
+		u32 map_page = (page_id - 1) / map_entries(shadow);
+		result = ensure_map_pages(shadow, map_page + 1);
+		if( result != PAGER_OK )
+			return result;
+
+		shadow->map[page_id - 1] = physical;
+		shadow->map_dirty[map_page] = 1;
+		shadow->stats.pages_moved += 1;
+	}
+
+	*r_physical = physical;
+	return PAGER_OK;
+}
+
+/**
+ * @brief Write the map pages that changed, each to a page of its own.
+ */
+static enum pager_e
+write_map(struct PagerShadow* shadow, u32 max_page, byte* buffer)
+{
+	enum pager_e result = PAGER_OK;
+
+	for( u32 i = 0; i < shadow->nmap_pages; i++ )
+	{
+		if( !shadow->map_dirty[i] )
+			continue;
+
+		result = relocate(shadow, shadow->map_pages[i], &shadow->map_pages[i]);
+		if( result != PAGER_OK )
+			return result;
+
+		memset(buffer, 0x00, shadow->disk_page_size);
+		u32 first = i * map_entries(shadow);
+		for( u32 j = 0; j < map_entries(shadow); j++ )
+		{
+			if( first + j >= max_page || first + j >= shadow->map_capacity )
+				break;
+			ser_write_32bit_le(buffer + 4 * j, shadow->map[first + j]);
+		}
+
+		result = write_physical(shadow, shadow->map_pages[i], buffer);
+		if( result != PAGER_OK )
+			return result;
+
+		shadow->map_dirty[i] = 0;
+		shadow->stats.map_pages_written += 1;
+	}
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Write the whole directory to fresh pages; it is a page per
+ * dir_entries map pages, so rewriting it is cheap.
+ */
+static enum pager_e
+write_dir(struct PagerShadow* shadow, byte* buffer)
+{
+	enum pager_e result = PAGER_OK;
+	u32 per_dir = dir_entries(shadow);
+	u32 ndir_pages = (shadow->nmap_pages + per_dir - 1) / per_dir;
+
+	for( u32 i = 0; i < ndir_pages; i++ )
+	{
+		u32 current = i < shadow->ndir_pages ? shadow->dir_pages[i] : 0;
+		u32 physical = 0;
+
+		result = relocate(shadow, current, &physical);
+		if( result != PAGER_OK )
+			return result;
+
+		if( i < shadow->ndir_pages )
+			shadow->dir_pages[i] = physical;
+		else
+		{
+			result = push(
+				&shadow->dir_pages,
+				&shadow->ndir_pages,
+				&shadow->dir_pages_capacity,
+				physical);
+			if( result != PAGER_OK )
+				return result;
+		}
+	}
+
+	for( u32 i = 0; i < ndir_pages; i++ )
+	{
+		u32 first = i * per_dir;
+		u32 count = shadow->nmap_pages - first;
+		if( count > per_dir )
+			count = per_dir;
+
+		memset(buffer, 0x00, shadow->disk_page_size);
+		ser_write_32bit_le(
+			buffer, i + 1 < ndir_pages ? shadow->dir_pages[i + 1] : 0);
+		ser_write_32bit_le(buffer + 4, count);
+		for( u32 j = 0; j < count; j++ )
+			ser_write_32bit_le(
+				buffer + 8 + 4 * j, shadow->map_pages[first + j]);
+
+		result = write_physical(shadow, shadow->dir_pages[i], buffer);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_shadow_commit(struct PagerShadow* shadow, u32 max_page, char sync)
+{
+	enum pager_e result = PAGER_OK;
+	byte* buffer = NULL;
+
+	if( shadow->nfresh == 0 && max_page == shadow->max_page )
+		return PAGER_OK;
+
+	u32 nmap_pages = (max_page + map_entries(shadow) - 1) / map_entries(shadow);
+	result = ensure_map_pages(shadow, nmap_pages);
+	if( result != PAGER_OK )
+		return result;
+
+	buffer = (byte*)malloc(shadow->disk_page_size);
+	if( !buffer )
+		return PAGER_ERR_NO_MEM;
+
+	result = write_map(shadow, max_page, buffer);
+	if( result != PAGER_OK )
+		goto end;
+
+	result = write_dir(shadow, buffer);
+	if( result != PAGER_OK )
+		goto end;
+
+	// The record must not reach the disk before the pages it names.
+	if( sync && shadow->ops->sync )
+	{
+		result = shadow->ops->sync(shadow->file);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	struct ShadowRecord record = {
+		.generation = shadow->generation + 1,
+		.dir_page = shadow->ndir_pages ? shadow->dir_pages[0] : 0,
+		.ndir_pages = shadow->ndir_pages,
+		.nmap_pages = shadow->nmap_pages,
+		.max_page = max_page,
+		.disk_page_size = shadow->disk_page_size};
+	result = write_record(shadow, &record);
+	if( result != PAGER_OK )
+		goto end;
+
+	if( sync && shadow->ops->sync )
+	{
+		result = shadow->ops->sync(shadow->file);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	shadow->generation = record.generation;
+	shadow->max_page = max_page;
+	shadow->stats.commits += 1;
+
+	for( u32 i = 0; i < shadow->nfresh; i++ )
+		*state_of(shadow, shadow->fresh[i]) = PAGER_SHADOW_LIVE;
+	shadow->nfresh = 0;
+
+	// The old commit is gone; its pages are free now.
+	for( u32 i = 0; i < shadow->nretired; i++ )
+	{
+		u32 physical = shadow->retired[i];
+		*state_of(shadow, physical) = PAGER_SHADOW_FREE;
+		result = push(
+			&shadow->free_pages,
+			&shadow->nfree,
+			&shadow->free_capacity,
+			physical);
+		if( result != PAGER_OK )
+			break;
+	}
+	shadow->nretired = 0;
+
+end:
+	free(buffer);
+	return result;
+}
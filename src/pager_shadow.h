@@ -0,0 +1,149 @@
+#ifndef PAGER_SHADOW_H_
+#define PAGER_SHADOW_H_
+
+#include "btint.h"
+#include "pager_e.h"
+#include "pager_ops.h"
+
+/**
+ * Shadow paging.
+ *
+ * Page ids stay what the btree sees; a page map says where each one lives
+ * in the file. A page that was part of the last commit is never written in
+ * place: its next image goes to a free physical page and the map entry
+ * moves. A commit writes the map pages that changed, each to a fresh page
+ * too, and a directory listing the map pages. It then swaps the root
+ * record, the only thing written in place.
+ *
+ * Physical page 1 holds two root records, PAGER_SHADOW_SLOT_STRIDE apart,
+ * and commits alternate between them. A record names the directory, the
+ * database size in pages and a generation, and is checksummed. On open the
+ * valid record with the newest generation wins, so a torn record write
+ * falls back to the commit before it. Nothing is replayed; pages written
+ * after the last commit are just not in the map and become free.
+ *
+ * Pages the last commit still uses are only reused after the next commit
+ * has been written, so the committed state on disk is always whole. They
+ * are not kept any longer than that for readers of an older commit: only
+ * the newest commit's map is loaded, so nothing could find them. Readers
+ * that need the database as it was open a pager snapshot, which keeps its
+ * own copy of each page changed after it was opened; see pager_snapshot.h.
+ */
+
+#define PAGER_SHADOW_SLOT_STRIDE 512
+// magic, generation, directory page, directory pages, map pages,
+// database size, disk page size, checksum.
+#define PAGER_SHADOW_RECORD_SIZE 32
+
+enum pager_shadow_state_e
+{
+	PAGER_SHADOW_FREE = 0,
+	// Used by the last commit.
+	PAGER_SHADOW_LIVE,
+	// Written since the last commit.
+	PAGER_SHADOW_FRESH,
+	// Used by the last commit but replaced since; free once the next commit
+	// is written.
+	PAGER_SHADOW_RETIRED,
+};
+
+struct PagerShadowStats
+{
+	u64 commits;
+	// Pages moved to a fresh physical page; a page written twice between
+	// commits only moves once.
+	u64 pages_moved;
+	u64 map_pages_written;
+};
+
+struct PagerShadow
+{
+	struct PagerOps* ops;
+	// The database file; owned by the pager.
+	void* file;
+	u32 disk_page_size;
+
+	u32 generation;
+	u32 max_page;
+
+	// Page id - 1 -> physical page; 0 if the page was never written.
+	u32* map;
+	u32 map_capacity;
+	// Physical page of each map page as of the last commit (0 if none yet),
+	// and whether its entries changed since.
+	u32* map_pages;
+	char* map_dirty;
+	u32 nmap_pages;
+	u32 map_pages_capacity;
+
+	u32* dir_pages;
+	u32 ndir_pages;
+	u32 dir_pages_capacity;
+
+	// enum pager_shadow_state_e of each physical page, by page - 1.
+	byte* state;
+	u32 nphysical;
+	u32 state_capacity;
+
+	// Physical pages that are free; popped from the end.
+	u32* free_pages;
+	u32 nfree;
+	u32 free_capacity;
+
+	// Written since the last commit, and used by the last commit but
+	// replaced since.
+	u32* fresh;
+	u32 nfresh;
+	u32 fresh_capacity;
+	u32* retired;
+	u32 nretired;
+	u32 retired_capacity;
+
+	struct PagerShadowStats stats;
+};
+
+/**
+ * @brief Read the newest valid root record of file and load the page map.
+ * An empty file is set up as an empty database.
+ *
+ * @return PAGER_OPEN_ERR if the file has no valid root record or was written
+ * with a different page size.
+ */
+enum pager_e pager_shadow_open(
+	struct PagerShadow** r_shadow,
+	struct PagerOps* ops,
+	void* file,
+	u32 disk_page_size);
+
+/**
+ * @brief Free the map; the file stays open. Changes since the last commit
+ * are lost.
+ */
+void pager_shadow_close(struct PagerShadow* shadow);
+
+/**
+ * @brief Physical page of page_id.
+ *
+ * @return 0 if the page was never written.
+ */
+char
+pager_shadow_find(struct PagerShadow* shadow, u32 page_id, u32* r_physical);
+
+/**
+ * @brief Physical page to write page_id to. Moves the page to a free
+ * physical page unless it already moved since the last commit.
+ */
+enum pager_e
+pager_shadow_place(struct PagerShadow* shadow, u32 page_id, u32* r_physical);
+
+/**
+ * @brief Make everything placed so far the database, with max_page pages.
+ *
+ * Writes the changed map pages and the directory, then the root record.
+ * With sync, the file is synced before the record, so it never points at
+ * pages that are not on disk yet, and again after it.
+ */
+enum pager_e
+pager_shadow_commit(struct PagerShadow* shadow, u32 max_page, char sync);
+
+#endif
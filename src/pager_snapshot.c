@@ -0,0 +1,310 @@
+#include "pager_snapshot.h"
+
+#include "page.h"
+#include "page_cache.h"
+#include "pagemeta.h"
+#include "pager.h"
+#include "pager_internal.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static u32
+image_slot(struct PagerSnapshot* snapshot, u32 page_id)
+{
+	// Fibonacci hashing; capacity is a power of two.
+	return (u32)(page_id * 2654435769u) & (snapshot->capacity - 1);
+}
+
+static struct Page*
+image_get(struct PagerSnapshot* snapshot, u32 page_id)
+{
+	if( snapshot->nimages == 0 )
+		return NULL;
+
+	u32 slot = image_slot(snapshot, page_id);
+	while( snapshot->image_ids[slot] != 0 )
+	{
+		if( snapshot->image_ids[slot] == page_id )
+			return snapshot->images[slot];
+
+		slot = (slot + 1) & (snapshot->capacity - 1);
+	}
+
+	return NULL;
+}
+
+static enum pager_e
+image_grow(struct PagerSnapshot* snapshot)
+{
+	u32 old_capacity = snapshot->capacity;
+	u32* old_ids = snapshot->image_ids;
+	struct Page** old_images = snapshot->images;
+	u32 capacity = old_capacity ? old_capacity * 2 : 64;
+
+	u32* ids = (u32*)calloc(capacity, sizeof(u32));
+	struct Page** images = (struct Page**)calloc(capacity, sizeof(*images));
+	if( !ids || !images )
+	{
+		free(ids);
+		free(images);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	snapshot->image_ids = ids;
+	snapshot->images = images;
+	snapshot->capacity = capacity;
+
+	for( u32 i = 0; i < old_capacity; i++ )
+	{
+		if( old_ids[i] == 0 )
+			continue;
+
+		u32 slot = image_slot(snapshot, old_ids[i]);
+		while( ids[slot] != 0 )
+			slot = (slot + 1) & (capacity - 1);
+
+		ids[slot] = old_ids[i];
+		images[slot] = old_images[i];
+	}
+
+	free(old_ids);
+	free(old_images);
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Takes ownership of image. The page must not be kept already.
+ */
+static enum pager_e
+image_put(struct PagerSnapshot* snapshot, struct Page* image)
+{
+	enum pager_e result = PAGER_OK;
+
+	// Keep the load at or under one half.
+	if( (snapshot->nimages + 1) * 2 > snapshot->capacity )
+	{
+		result = image_grow(snapshot);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	u32 slot = image_slot(snapshot, image->page_id);
+	while( snapshot->image_ids[slot] != 0 )
+		slot = (slot + 1) & (snapshot->capacity - 1);
+
+	snapshot->image_ids[slot] = image->page_id;
+	snapshot->images[slot] = image;
+	snapshot->nimages += 1;
+
+	return PAGER_OK;
+}
+
+static char
+needs_image(struct PagerSnapshot* snapshot, u32 page_id)
+{
+	return page_id <= snapshot->max_page && !image_get(snapshot, page_id);
+}
+
+enum pager_e
+pager_snapshot_open(struct Pager* pager, struct PagerSnapshot** r_snapshot)
+{
+	struct PagerSnapshot* snapshot =
+		(struct PagerSnapshot*)calloc(1, sizeof(struct PagerSnapshot));
+	if( !snapshot )
+		return PAGER_ERR_NO_MEM;
+
+	snapshot->pager = pager;
+
+	bt_rmutex_lock(&pager->lock);
+	snapshot->max_page = pager->max_page;
+	snapshot->next = pager->snapshots;
+	pager->snapshots = snapshot;
+	bt_rmutex_unlock(&pager->lock);
+
+	*r_snapshot = snapshot;
+	return PAGER_OK;
+}
+
+void
+pager_snapshot_close(struct PagerSnapshot* snapshot)
+{
+	struct Pager* pager = snapshot->pager;
+
+	bt_rmutex_lock(&pager->lock);
+	struct PagerSnapshot** link = &pager->snapshots;
+	while( *link != snapshot )
+	{
+		assert(*link);
+		link = &(*link)->next;
+	}
+	*link = snapshot->next;
+	bt_rmutex_unlock(&pager->lock);
+
+	for( u32 i = 0; i < snapshot->capacity; i++ )
+	{
+		if( snapshot->image_ids[i] != 0 )
+			page_destroy(pager, snapshot->images[i]);
+	}
+
+	free(snapshot->image_ids);
+	free(snapshot->images);
+	free(snapshot);
+}
+
+enum pager_e
+pager_snapshot_read(
+	struct PagerSnapshot* snapshot,
+	struct PageSelector* selector,
+	struct Page* page)
+{
+	enum pager_e result = PAGER_OK;
+	struct Pager* pager = snapshot->pager;
+
+	// Writers add images under the pager lock.
+	bt_rmutex_lock(&pager->lock);
+	struct Page* image = image_get(snapshot, selector->page_id);
+	if( !image )
+	{
+		result = pager_read_page(pager, selector, page);
+		goto end;
+	}
+
+	page_unborrow(pager, page);
+	pagemeta_memcpy_page(page, image, pager);
+
+	page->page_id = selector->page_id;
+	page->status = PAGER_OK;
+
+end:
+	bt_rmutex_unlock(&pager->lock);
+	return result;
+}
+
+enum pager_e
+pager_snapshot_read_ro(
+	struct PagerSnapshot* snapshot,
+	struct PageSelector* selector,
+	struct Page* page)
+{
+	enum pager_e result = PAGER_OK;
+	struct Pager* pager = snapshot->pager;
+
+	bt_rmutex_lock(&pager->lock);
+	struct Page* image = image_get(snapshot, selector->page_id);
+	if( !image )
+	{
+		result = pager_read_page_ro(pager, selector, page);
+		goto end;
+	}
+
+	// Images never change, so the page can go on borrowing it unlocked.
+	page_unborrow(pager, page);
+	page_borrow(page, pagemeta_deadjust_buffer(image->page_buffer));
+
+	page->page_id = selector->page_id;
+	page->status = PAGER_OK;
+
+end:
+	bt_rmutex_unlock(&pager->lock);
+	return result;
+}
+
+enum pager_e
+pager_snapshot_preserve(struct Pager* pager, u32 page_id)
+{
+	enum pager_e result = PAGER_OK;
+	struct Page* current = NULL;
+	struct PageSelector selector = {.page_id = page_id};
+
+	for( struct PagerSnapshot* snapshot = pager->snapshots; snapshot;
+		 snapshot = snapshot->next )
+	{
+		if( !needs_image(snapshot, page_id) )
+			continue;
+
+		// Read once; each snapshot after the first gets a copy.
+		if( !current )
+		{
+			result = page_create(pager, &current);
+			if( result != PAGER_OK )
+				goto end;
+
+			result = pager_internal_cached_read(pager, &selector, current);
+			// Never written, so nothing can have read it.
+			if( result == PAGER_ERR_NIF )
+			{
+				result = PAGER_OK;
+				goto end;
+			}
+			if( result != PAGER_OK )
+				goto end;
+		}
+
+		struct Page* image = current;
+		if( snapshot->next )
+		{
+			result = page_create(pager, &image);
+			if( result != PAGER_OK )
+				goto end;
+
+			image->page_id = page_id;
+			pagemeta_memcpy_page(image, current, pager);
+		}
+
+		result = image_put(snapshot, image);
+		if( result != PAGER_OK )
+		{
+			page_destroy(pager, image);
+			if( image == current )
+				current = NULL;
+			goto end;
+		}
+		if( image == current )
+			current = NULL;
+	}
+
+end:
+	if( current )
+		page_destroy(pager, current);
+	return result;
+}
+
+enum pager_e
+pager_snapshot_preserve_dirty(struct Pager* pager)
+{
+	enum pager_e result = PAGER_OK;
+	u32* page_ids = NULL;
+	struct Page** pages = NULL;
+	int num = 0;
+
+	if( pager->snapshots == NULL || pager->cache->ndirty == 0 )
+		return PAGER_OK;
+
+	// Preserving reads pages, which may reorder the cache; copy the ids
+	// out first.
+	pages = (struct Page**)malloc(sizeof(*pages) * pager->cache->ndirty);
+	page_ids = (u32*)malloc(sizeof(u32) * pager->cache->ndirty);
+	if( !pages || !page_ids )
+	{
+		result = PAGER_ERR_NO_MEM;
+		goto end;
+	}
+
+	num = page_cache_collect_dirty(pager->cache, pages);
+	for( int i = 0; i < num; i++ )
+		page_ids[i] = pages[i]->page_id;
+
+	for( int i = 0; i < num; i++ )
+	{
+		result = pager_snapshot_preserve(pager, page_ids[i]);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+end:
+	free(page_ids);
+	free(pages);
+	return result;
+}
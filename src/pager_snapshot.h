@@ -0,0 +1,94 @@
+#ifndef PAGER_SNAPSHOT_H_
+#define PAGER_SNAPSHOT_H_
+
+#include "btint.h"
+#include "page_defs.h"
+
+/**
+ * Snapshot reads.
+ *
+ * A snapshot sees every page as it was when the snapshot was opened, while
+ * the pager goes on writing. Nothing is copied up front. The first time a
+ * page changes after the snapshot was opened, its image at that point is
+ * kept in the snapshot; reading a page the snapshot holds an image of
+ * returns the image, any other page is read from the pager as usual.
+ *
+ * Images are kept per snapshot and only freed when it is closed, so a long
+ * scan under heavy writes holds one copy of each page written meanwhile.
+ * Pages past the end of the database when the snapshot was opened are
+ * never kept; nothing in the snapshot refers to them.
+ */
+
+struct PagerSnapshot
+{
+	struct Pager* pager;
+	// Database size in pages when the snapshot was opened.
+	u32 max_page;
+
+	// Page id -> image; open addressing, 0 ids are empty slots.
+	u32* image_ids;
+	struct Page** images;
+	u32 capacity;
+	u32 nimages;
+
+	// Next open snapshot of the pager.
+	struct PagerSnapshot* next;
+};
+
+/**
+ * @brief Open a snapshot of the pager's pages as they are now, including
+ * those written in an open transaction. Close it before the pager is
+ * destroyed.
+ *
+ * @return enum pager_e
+ */
+enum pager_e
+pager_snapshot_open(struct Pager* pager, struct PagerSnapshot** r_snapshot);
+
+/**
+ * @brief Free the snapshot and its images. Pages borrowed from it with
+ * pager_snapshot_read_ro must be reread or destroyed first.
+ */
+void pager_snapshot_close(struct PagerSnapshot* snapshot);
+
+/**
+ * @brief pager_read_page as of the snapshot.
+ *
+ * @param page An already allocated page.
+ * @return enum pager_e
+ */
+enum pager_e pager_snapshot_read(
+	struct PagerSnapshot* snapshot,
+	struct PageSelector* selector,
+	struct Page* page);
+
+/**
+ * @brief pager_read_page_ro as of the snapshot; a kept image is borrowed
+ * rather than copied.
+ *
+ * @param page An already allocated page.
+ * @return enum pager_e
+ */
+enum pager_e pager_snapshot_read_ro(
+	struct PagerSnapshot* snapshot,
+	struct PageSelector* selector,
+	struct Page* page);
+
+/**
+ * @brief Keep the current image of page_id in every open snapshot that
+ * needs it. The pager calls this before a cached page changes.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_snapshot_preserve(struct Pager* pager, u32 page_id);
+
+/**
+ * @brief pager_snapshot_preserve every dirty page. A rollback drops the
+ * transaction's dirty pages without writing them, so it calls this first;
+ * snapshots opened in the transaction saw those pages.
+ *
+ * @return enum pager_e
+ */
+enum pager_e pager_snapshot_preserve_dirty(struct Pager* pager);
+
+#endif
@@ -6,7 +6,15 @@
 #include "pager.h"
 #include "pager_freelist.h"
 #include "pager_ops_cstd.h"
+#include "pager_ops_mmap.h"
+#include "pager_ops_posix.h"
+#include "pager_ops_uring.h"
+#include "pager_shadow.h"
+#include "pager_snapshot.h"
+#include "pager_wal.h"
+#include "serialization.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -50,6 +58,529 @@ end:
 	return result;
 }
 
+int
+pager_test_read_write_posix()
+{
+	char buffer[] = "test_string";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	remove("test_posix_.db");
+	page_cache_create(&cache, 5);
+	pager_posix_create(&pager, cache, "test_posix_.db", 0x1000);
+
+	struct Page* page;
+	page_create(pager, &page);
+
+	// Nothing on disk yet.
+	struct PageSelector selector;
+	pager_reselect(&selector, 1);
+	if( pager_read_page(pager, &selector, page) != PAGER_ERR_NIF )
+		goto end;
+
+	memcpy(page->page_buffer, buffer, sizeof(buffer));
+	if( pager_write_page(pager, page) != PAGER_OK )
+		goto end;
+
+	// Reopen with an empty cache so the bytes come from pread.
+	page_destroy(pager, page);
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_create(&cache, 5);
+	pager_posix_create(&pager, cache, "test_posix_.db", 0x1000);
+	page_create(pager, &page);
+
+	if( pager->max_page != 1 )
+		goto end;
+
+	if( pager_read_page(pager, &selector, page) != PAGER_OK )
+		goto end;
+
+	result = memcmp(page->page_buffer, buffer, sizeof(buffer)) == 0;
+
+end:
+	page_destroy(pager, page);
+
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove("test_posix_.db");
+
+	return result;
+}
+
+int
+pager_test_read_ro_mmap()
+{
+	char buffer[] = "test_string";
+	char other[] = "other_string";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	remove("test_mmap_.db");
+	page_cache_create(&cache, 5);
+	pager_mmap_create(&pager, cache, "test_mmap_.db", 0x1000);
+
+	struct Page* page;
+	page_create(pager, &page);
+
+	struct PageSelector selector;
+	pager_reselect(&selector, 1);
+	if( pager_read_page_ro(pager, &selector, page) != PAGER_ERR_NIF )
+		goto end;
+
+	memcpy(page->page_buffer, buffer, sizeof(buffer));
+	if( pager_write_page(pager, page) != PAGER_OK )
+		goto end;
+
+	// Not written back yet; the read borrows the cache frame.
+	if( pager_read_page_ro(pager, &selector, page) != PAGER_OK ||
+		page->pinned_frame == NULL ||
+		memcmp(page->page_buffer, buffer, sizeof(buffer)) != 0 )
+		goto end;
+
+	if( pager_flush(pager) != PAGER_OK )
+		goto end;
+
+	if( pager_read_page_ro(pager, &selector, page) != PAGER_OK ||
+		!page_is_borrowed(page) || page->pinned_frame != NULL ||
+		memcmp(page->page_buffer, buffer, sizeof(buffer)) != 0 )
+		goto end;
+
+	// Writing a borrowed page copies it first.
+	if( page_make_writable(pager, page) != PAGER_OK || page_is_borrowed(page) )
+		goto end;
+	memcpy(page->page_buffer, other, sizeof(other));
+	if( pager_write_page(pager, page) != PAGER_OK )
+		goto end;
+
+	// The mapping sees the write once it is flushed.
+	if( pager_flush(pager) != PAGER_OK ||
+		pager_read_page_ro(pager, &selector, page) != PAGER_OK ||
+		!page_is_borrowed(page) )
+		goto end;
+
+	result = memcmp(page->page_buffer, other, sizeof(other)) == 0;
+
+	// A normal read goes back to the page's own buffer.
+	if( pager_read_page(pager, &selector, page) != PAGER_OK ||
+		page_is_borrowed(page) )
+		result = 0;
+
+end:
+	page_destroy(pager, page);
+
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove("test_mmap_.db");
+
+	return result;
+}
+
+int
+pager_test_read_ro_pinned()
+{
+	char const* db_name = "test_pinned_.db";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	struct Page* pinned = NULL;
+	struct Page* page = NULL;
+	struct Page* frame = NULL;
+	struct PageSelector selector;
+	remove(db_name);
+	page_cache_create(&cache, 2);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &pinned);
+	page_create(pager, &page);
+
+	for( int i = 0; i < 4; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		memset(page->page_buffer, 'a' + i, pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK )
+			goto end;
+	}
+
+	// The read borrows the cache frame; no copy.
+	pager_reselect(&selector, 1);
+	if( pager_read_page_ro(pager, &selector, pinned) != PAGER_OK ||
+		pinned->pinned_frame == NULL ||
+		((char*)pinned->page_buffer)[0] != 'a' )
+		goto end;
+
+	if( page_cache_peek(cache, 1, &frame) != PAGER_OK ||
+		frame->page_buffer != pinned->page_buffer )
+		goto end;
+	page_cache_release(cache, frame);
+
+	// Reading everything else through a 2 page cache can't evict the pinned
+	// frame.
+	for( int i = 2; i <= 4; i++ )
+	{
+		pager_reselect(&selector, i);
+		if( pager_read_page(pager, &selector, page) != PAGER_OK ||
+			((char*)page->page_buffer)[0] != 'a' + i - 1 )
+			goto end;
+	}
+
+	if( page_cache_peek(cache, 1, &frame) != PAGER_OK )
+		goto end;
+	page_cache_release(cache, frame);
+
+	// Copy-on-write unpins.
+	if( page_make_writable(pager, pinned) != PAGER_OK ||
+		page_is_borrowed(pinned) || pinned->pinned_frame != NULL ||
+		((char*)pinned->page_buffer)[0] != 'a' )
+		goto end;
+
+	if( page_cache_peek(cache, 1, &frame) != PAGER_OK ||
+		frame->page_buffer == pinned->page_buffer )
+		goto end;
+	page_cache_release(cache, frame);
+
+	result = 1;
+
+end:
+	page_destroy(pager, pinned);
+	page_destroy(pager, page);
+
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+pager_test_page_pool()
+{
+	char const* db_name = "test_page_pool_.db";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct Page* other = NULL;
+	struct PageSelector selector;
+	remove(db_name);
+	page_cache_create(&cache, 4);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+
+	// Disk buffers are cache line aligned and zeroed.
+	if( page_create(pager, &page) != PAGER_OK ||
+		((uintptr_t)pagemeta_deadjust_buffer(page->page_buffer) & 63) != 0 ||
+		((char*)page->page_buffer)[0] != 0 )
+		goto end;
+
+	for( int i = 0; i < 8; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		memset(page->page_buffer, 'a' + i, pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK )
+			goto end;
+	}
+
+	struct PagePoolStats before = {0};
+	struct PagePoolStats after = {0};
+	for( int round = 0; round < 16; round++ )
+	{
+		// The first round warms up the pool.
+		if( round == 1 )
+			page_pool_stats(pager, &before);
+
+		for( int i = 1; i <= 8; i++ )
+		{
+			if( page_create(pager, &other) != PAGER_OK )
+				goto end;
+
+			pager_reselect(&selector, i);
+			if( pager_read_page(pager, &selector, other) != PAGER_OK ||
+				((char*)other->page_buffer)[0] != 'a' + i - 1 )
+				goto end;
+
+			page_destroy(pager, other);
+			other = NULL;
+		}
+	}
+
+	// Misses evict a frame and create another; all of it comes from the
+	// free list.
+	page_pool_stats(pager, &after);
+	if( after.block_allocs != before.block_allocs ||
+		after.page_creates <= before.page_creates )
+		goto end;
+
+	result = 1;
+end:
+	if( other )
+		page_destroy(pager, other);
+	if( page )
+		page_destroy(pager, page);
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+pager_test_write_pages_batched()
+{
+	char const* db_name = "test_batched_.db";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	struct Page* pages[3] = {0};
+	struct Page* read_page = NULL;
+	u32 page_ids[3] = {0};
+	remove(db_name);
+	page_cache_create(&cache, 5);
+	pager_uring_create(&pager, cache, db_name, 0x1000);
+
+	for( int i = 0; i < 3; i++ )
+	{
+		page_create(pager, &pages[i]);
+		memset(pages[i]->page_buffer, 'a' + i, pager->page_size);
+	}
+	page_create(pager, &read_page);
+
+	// One page with an id and two new ones, like a root split.
+	pages[0]->page_id = 1;
+	if( pager_write_pages(pager, pages, 3) != PAGER_OK )
+		goto end;
+
+	if( pages[1]->page_id != 2 || pages[2]->page_id != 3 ||
+		pager->max_page != 3 )
+		goto end;
+
+	for( int i = 0; i < 3; i++ )
+		page_ids[i] = pages[i]->page_id;
+	if( pager_prefetch(pager, page_ids, 3) != PAGER_OK )
+		goto end;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		struct PageSelector selector;
+		pager_reselect(&selector, page_ids[i]);
+		if( pager_read_page(pager, &selector, read_page) != PAGER_OK ||
+			((char*)read_page->page_buffer)[0] != 'a' + i )
+			goto end;
+	}
+
+	result = 1;
+
+end:
+	for( int i = 0; i < 3; i++ )
+		page_destroy(pager, pages[i]);
+	page_destroy(pager, read_page);
+
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+pager_test_write_back()
+{
+	char const* db_name = "test_write_back_.db";
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	remove(db_name);
+	page_cache_create(&cache, 3);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &page);
+
+	// Writes stay in the cache until flushed.
+	memset(page->page_buffer, 'a', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK || page->page_id != 1 )
+		goto end;
+
+	if( pager->ops->size(pager->file) != 0 )
+		goto end;
+
+	if( pager_sync(pager) != PAGER_OK ||
+		pager->ops->size(pager->file) != pager->disk_page_size )
+		goto end;
+
+	// More pages than the cache holds; evicted pages are written back.
+	for( int i = 1; i < 8; i++ )
+	{
+		page_destroy(pager, page);
+		page_create(pager, &page);
+		memset(page->page_buffer, 'a' + i, pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK ||
+			page->page_id != i + 1 )
+			goto end;
+	}
+
+	if( pager->ops->size(pager->file) >= 8 * pager->disk_page_size )
+		goto end;
+
+	// Reopen; pager_destroy writes back what is left.
+	page_destroy(pager, page);
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_create(&cache, 3);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &page);
+
+	if( pager->max_page != 8 )
+		goto end;
+
+	for( int i = 0; i < 8; i++ )
+	{
+		struct PageSelector selector;
+		pager_reselect(&selector, i + 1);
+		if( pager_read_page(pager, &selector, page) != PAGER_OK ||
+			((char*)page->page_buffer)[0] != 'a' + i ||
+			((char*)page->page_buffer)[pager->page_size - 1] != 'a' + i )
+			goto end;
+	}
+
+	result = 1;
+
+end:
+	page_destroy(pager, page);
+
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+int
+pager_test_cache_page_table()
+{
+	int result = 0;
+	struct PageCache* cache = NULL;
+	struct Page pages[64] = {0};
+	struct Page* page = NULL;
+	struct Page* evicted = NULL;
+	struct Page* dirty[8] = {0};
+	page_cache_create(&cache, 8);
+
+	for( int i = 0; i < 64; i++ )
+		pages[i].page_id = i + 1;
+
+	// Cycle every page through the cache; each insert past the first 8
+	// evicts the least recently used page.
+	for( int i = 0; i < 64; i++ )
+	{
+		evicted = NULL;
+		page_cache_insert(cache, &pages[i], &evicted, NULL);
+		page_cache_release(cache, &pages[i]);
+
+		if( i >= 8 && evicted != &pages[i - 8] )
+			goto end;
+	}
+
+	// Only the last 8 are still found after all the table deletions.
+	for( int i = 0; i < 64; i++ )
+	{
+		enum pager_e found = page_cache_acquire(cache, i + 1, &page);
+		if( found == PAGER_OK )
+			page_cache_release(cache, page);
+
+		if( (found == PAGER_OK) != (i >= 56) )
+			goto end;
+	}
+
+	// A referenced page is never the victim, even when least recently used.
+	page_cache_acquire(cache, 57, &page);
+	for( int i = 58; i <= 64; i++ )
+	{
+		page_cache_acquire(cache, i, &page);
+		page_cache_release(cache, page);
+	}
+	page_cache_set_dirty(cache, 63, 1);
+	page_cache_set_dirty(cache, 58, 1);
+	evicted = NULL;
+	page_cache_insert(cache, &pages[0], &evicted, NULL);
+	page_cache_release(cache, &pages[0]);
+	if( evicted != &pages[57] )
+		goto end;
+
+	if( cache->ndirty != 1 || page_cache_collect_dirty(cache, dirty) != 1 ||
+		dirty[0] != &pages[62] || !page_cache_is_dirty(cache, 63) )
+		goto end;
+
+	result = 1;
+
+end:
+	page_cache_destroy(cache);
+
+	return result;
+}
+
+int
+pager_test_cache_policies()
+{
+	int result = 0;
+	struct PageCache* clock = NULL;
+	struct PageCache* two_q = NULL;
+	struct Page pages[32] = {0};
+	struct Page* page = NULL;
+	struct Page* evicted = NULL;
+	page_cache_create_ex(&clock, 3, PAGE_CACHE_CLOCK);
+	page_cache_create_ex(&two_q, 8, PAGE_CACHE_2Q);
+
+	for( int i = 0; i < 32; i++ )
+		pages[i].page_id = i + 1;
+
+	// CLOCK gives page 1 a second chance because it was used.
+	for( int i = 0; i < 3; i++ )
+	{
+		page_cache_insert(clock, &pages[i], &evicted, NULL);
+		page_cache_release(clock, &pages[i]);
+	}
+	page_cache_acquire(clock, 1, &page);
+	page_cache_release(clock, page);
+
+	evicted = NULL;
+	page_cache_insert(clock, &pages[3], &evicted, NULL);
+	page_cache_release(clock, &pages[3]);
+	if( evicted != &pages[1] || clock->hits != 1 )
+		goto end;
+
+	// 2Q: page 1 comes back soon after leaving probation, so it is promoted
+	// and survives a scan of pages that are each read once.
+	for( int i = 0; i < 9; i++ )
+	{
+		evicted = NULL;
+		page_cache_insert(two_q, &pages[i], &evicted, NULL);
+		page_cache_release(two_q, &pages[i]);
+	}
+	if( evicted != &pages[0] )
+		goto end;
+
+	page_cache_insert(two_q, &pages[0], &evicted, NULL);
+	page_cache_release(two_q, &pages[0]);
+
+	for( int i = 9; i < 32; i++ )
+	{
+		page_cache_insert(two_q, &pages[i], &evicted, NULL);
+		page_cache_release(two_q, &pages[i]);
+		if( evicted == &pages[0] )
+			goto end;
+	}
+
+	if( page_cache_acquire(two_q, 1, &page) != PAGER_OK )
+		goto end;
+	page_cache_release(two_q, page);
+
+	result = 1;
+
+end:
+	page_cache_destroy(clock);
+	page_cache_destroy(two_q);
+
+	return result;
+}
+
 int
 pager_test_page_loads_caching()
 {
@@ -140,6 +671,15 @@ pager_test_free_page_list(void)
 
 	pager_freelist_push_page(pager, page_two);
 
+	// Frees are queued until the flush.
+	pager_read_page(pager, &(struct PageSelector){.page_id = 1}, page_one);
+	pagemeta_read(&meta, page_one);
+
+	if( meta.next_free_page != 0 )
+		goto fail;
+
+	pager_flush(pager);
+
 	pager_read_page(pager, &(struct PageSelector){.page_id = 1}, page_one);
 	pagemeta_read(&meta, page_one);
 
@@ -177,6 +717,8 @@ pager_test_free_page_list(void)
 	if( page_two->page_id != 2 )
 		goto fail;
 
+	pager_flush(pager);
+
 	pager_read_page(pager, &(struct PageSelector){.page_id = 1}, page_one);
 	pagemeta_read(&meta, page_one);
 
@@ -198,4 +740,924 @@ end:
 fail:
 	result = 0;
 	goto end;
-}
\ No newline at end of file
+}
+
+int
+pager_test_free_page_trunks(void)
+{
+	char page_filename[] = "test_freelist_trunks.db";
+	remove(page_filename);
+	int result = 0;
+	struct Pager* pager;
+	struct PageCache* cache = NULL;
+	struct PageMetadata meta = {0};
+	struct Page* page = NULL;
+	char seen[21] = {0};
+	u32 count = 0;
+	u32 trunks = 0;
+	u32 free_pages = 0;
+	page_cache_create(&cache, 8);
+	// Room for a count and 4 page ids per trunk.
+	pager_cstd_create(
+		&pager, cache, page_filename, pager_disk_page_size_for(5 * 4));
+	page_create(pager, &page);
+
+	for( int i = 1; i <= 20; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		if( pager_write_page(pager, page) != PAGER_OK || page->page_id != i )
+			goto end;
+	}
+
+	for( int i = 2; i <= 20; i++ )
+	{
+		if( pager_freelist_push(pager, i) != PAGER_OK )
+			goto end;
+	}
+
+	if( pager_flush(pager) != PAGER_OK )
+		goto end;
+
+	// 19 pages fit in 4 trunks of up to 5 pages each.
+	pager_read_page(pager, &(struct PageSelector){.page_id = 1}, page);
+	pagemeta_read(&meta, page);
+	while( meta.next_free_page != 0 )
+	{
+		pager_read_page(
+			pager,
+			&(struct PageSelector){.page_id = meta.next_free_page},
+			page);
+		pagemeta_read(&meta, page);
+		if( !meta.is_free )
+			goto end;
+
+		ser_read_32bit_le(&count, page->page_buffer);
+		trunks += 1;
+		free_pages += 1 + count;
+	}
+
+	if( trunks != 4 || free_pages != 19 )
+		goto end;
+
+	// Every freed page comes back exactly once, then the file grows.
+	for( int i = 2; i <= 20; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		if( pager_write_page(pager, page) != PAGER_OK ||
+			page->page_id < 2 || page->page_id > 20 ||
+			seen[page->page_id] )
+			goto end;
+		seen[page->page_id] = 1;
+	}
+
+	page->page_id = PAGE_CREATE_NEW_PAGE;
+	if( pager_write_page(pager, page) != PAGER_OK || page->page_id != 21 )
+		goto end;
+
+	pager_flush(pager);
+	pager_read_page(pager, &(struct PageSelector){.page_id = 1}, page);
+	pagemeta_read(&meta, page);
+	if( meta.next_free_page != 0 )
+		goto end;
+
+	result = 1;
+end:
+	page_destroy(pager, page);
+	pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(page_filename);
+
+	return result;
+}
+
+static int
+copy_file(char const* from, char const* to)
+{
+	char buffer[0x1000];
+	size_t n = 0;
+	FILE* in = fopen(from, "rb");
+	FILE* out = fopen(to, "wb");
+	int result = in && out;
+
+	while( result && (n = fread(buffer, 1, sizeof(buffer), in)) > 0 )
+		result = fwrite(buffer, 1, n, out) == n;
+
+	if( in )
+		fclose(in);
+	if( out )
+		fclose(out);
+
+	return result;
+}
+
+static int
+flip_byte(char const* filename, long offset)
+{
+	FILE* fp = fopen(filename, "rb+");
+	int c = 0;
+
+	if( !fp )
+		return 0;
+
+	fseek(fp, offset, SEEK_SET);
+	c = fgetc(fp);
+	fseek(fp, offset, SEEK_SET);
+	fputc(c ^ 0xFF, fp);
+	fclose(fp);
+
+	return c != EOF;
+}
+
+static int
+file_exists(char const* filename)
+{
+	FILE* fp = fopen(filename, "rb");
+	if( fp )
+		fclose(fp);
+	return fp != NULL;
+}
+
+static int
+check_page(struct Pager* pager, struct Page* page, u32 page_id, char expected)
+{
+	return pager_read_page(
+			   pager, &(struct PageSelector){.page_id = page_id}, page) ==
+			   PAGER_OK &&
+		   ((char*)page->page_buffer)[0] == expected;
+}
+
+int
+pager_test_wal_recovery(void)
+{
+	char const* db_name = "test_wal_.db";
+	char const* wal_name = "test_wal_.db-wal";
+	char const* copy_name = "test_wal_copy.db";
+	char const* copy_wal_name = "test_wal_copy.db-wal";
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct Pager* copy = NULL;
+	struct PageCache* cache = NULL;
+	struct PageCache* copy_cache = NULL;
+	struct Page* page = NULL;
+	struct Page* copy_page = NULL;
+	remove(db_name);
+	remove(wal_name);
+	remove(copy_name);
+	remove(copy_wal_name);
+	page_cache_create(&cache, 4);
+	page_cache_create(&copy_cache, 4);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	if( pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	for( int i = 0; i < 3; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		memset(page->page_buffer, 'a' + i, pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK )
+			goto end;
+	}
+
+	if( pager_flush(pager) != PAGER_OK || pager->wal->stats.commits != 1 )
+		goto end;
+
+	// The commit is in the log only.
+	if( pager->ops->size(pager->file) != 0 )
+		goto end;
+
+	// Appended but never committed.
+	memset(page->page_buffer, 'z', pager->page_size);
+	page->page_id = 2;
+	void* disk_page = pagemeta_deadjust_buffer(page->page_buffer);
+	if( pager_wal_append(pager->wal, &page->page_id, &disk_page, 1, 0, NULL) !=
+		PAGER_OK )
+		goto end;
+
+	// Crash: take the files as they are now.
+	if( !copy_file(db_name, copy_name) || !copy_file(wal_name, copy_wal_name) )
+		goto end;
+
+	pager_cstd_create(&copy, copy_cache, copy_name, 0x1000);
+	if( pager_enable_wal(copy) != PAGER_OK || copy->max_page != 3 )
+		goto end;
+
+	page_create(copy, &copy_page);
+	if( !check_page(copy, copy_page, 1, 'a') ||
+		!check_page(copy, copy_page, 2, 'b') ||
+		!check_page(copy, copy_page, 3, 'c') )
+		goto end;
+
+	// Closing checkpoints the log into the database file and removes it.
+	page_destroy(copy, copy_page);
+	copy_page = NULL;
+	pager_destroy(copy);
+	copy = NULL;
+	if( file_exists(copy_wal_name) )
+		goto end;
+
+	pager_cstd_create(&copy, copy_cache, copy_name, 0x1000);
+	page_create(copy, &copy_page);
+	if( copy->max_page != 3 || !check_page(copy, copy_page, 2, 'b') )
+		goto end;
+	page_destroy(copy, copy_page);
+	copy_page = NULL;
+	pager_destroy(copy);
+	copy = NULL;
+
+	// A damaged frame ends the log; the commit it belonged to is lost.
+	remove(copy_name);
+	if( !copy_file(db_name, copy_name) || !copy_file(wal_name, copy_wal_name) ||
+		!flip_byte(
+			copy_wal_name,
+			PAGER_WAL_HEADER_SIZE + PAGER_WAL_FRAME_HEADER_SIZE + 100) )
+		goto end;
+
+	pager_cstd_create(&copy, copy_cache, copy_name, 0x1000);
+	if( pager_enable_wal(copy) != PAGER_OK || copy->max_page != 0 ||
+		copy->wal->nframes != 0 )
+		goto end;
+
+	result = 1;
+end:
+	if( copy_page )
+		page_destroy(copy, copy_page);
+	if( copy )
+		pager_destroy(copy);
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_destroy(copy_cache);
+	remove(db_name);
+	remove(wal_name);
+	remove(copy_name);
+	remove(copy_wal_name);
+
+	return result;
+}
+
+static enum pager_e
+write_round(struct Pager* pager, struct Page* page, u32 npages, char c)
+{
+	enum pager_e result = PAGER_OK;
+
+	for( u32 page_id = 1; page_id <= npages; page_id++ )
+	{
+		page->page_id =
+			page_id > pager->max_page ? PAGE_CREATE_NEW_PAGE : page_id;
+		memset(page->page_buffer, c, pager->page_size);
+		result = pager_write_page(pager, page);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	return pager_flush(pager);
+}
+
+int
+pager_test_wal_checkpointer(void)
+{
+	char const* db_name = "test_ckpt_.db";
+	char const* wal_name = "test_ckpt_.db-wal";
+	char const* copy_name = "test_ckpt_copy.db";
+	u32 const npages = 6;
+	u32 const nrounds = 40;
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct Pager* copy = NULL;
+	struct PageCache* cache = NULL;
+	struct PageCache* copy_cache = NULL;
+	struct Page* page = NULL;
+	struct Page* copy_page = NULL;
+	struct PagerCheckpointerStats stats = {0};
+	// Small batches with a pause, so commits land mid-round.
+	struct PagerCheckpointerOpts opts = {.batch_pages = 2, .pause_ms = 1};
+	char last = 'a' + nrounds - 1;
+	remove(db_name);
+	remove(wal_name);
+	remove(copy_name);
+	page_cache_create(&cache, 4);
+	page_cache_create(&copy_cache, 4);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	if( pager_enable_wal(pager) != PAGER_OK ||
+		pager_start_checkpointer(pager, &opts) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	for( u32 round = 0; round < nrounds; round++ )
+	{
+		if( write_round(pager, page, npages, 'a' + round) != PAGER_OK )
+			goto end;
+	}
+
+	if( pager_wait_checkpoint(pager) != PAGER_OK )
+		goto end;
+
+	pager_checkpoint_stats(pager, &stats);
+	if( stats.lag_frames != 0 || stats.lag_bytes != 0 || stats.rounds == 0 ||
+		stats.pages_written < npages ||
+		stats.bytes_written != stats.pages_written * pager->disk_page_size )
+		goto end;
+
+	// Caught up; the database file alone holds the last commit.
+	if( !copy_file(db_name, copy_name) )
+		goto end;
+
+	pager_cstd_create(&copy, copy_cache, copy_name, 0x1000);
+	page_create(copy, &copy_page);
+	if( copy->max_page != npages )
+		goto end;
+	for( u32 page_id = 1; page_id <= npages; page_id++ )
+	{
+		if( !check_page(copy, copy_page, page_id, last) )
+			goto end;
+	}
+
+	// The next commit starts the log over.
+	u64 restarts = pager->wal->stats.restarts;
+	if( write_round(pager, page, npages, 'z') != PAGER_OK ||
+		pager->wal->stats.restarts != restarts + 1 ||
+		pager->wal->stats.checkpoints != 0 )
+		goto end;
+
+	page_destroy(pager, page);
+	page = NULL;
+	pager_destroy(pager);
+	pager = NULL;
+	if( file_exists(wal_name) )
+		goto end;
+
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &page);
+	for( u32 page_id = 1; page_id <= npages; page_id++ )
+	{
+		if( !check_page(pager, page, page_id, 'z') )
+			goto end;
+	}
+
+	result = 1;
+end:
+	if( copy_page )
+		page_destroy(copy, copy_page);
+	if( copy )
+		pager_destroy(copy);
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_destroy(copy_cache);
+	remove(db_name);
+	remove(wal_name);
+	remove(copy_name);
+
+	return result;
+}
+
+static int durability_syncs = 0;
+
+static enum pager_e
+counting_sync(void* file)
+{
+	durability_syncs += 1;
+	return PosixOps.sync(file);
+}
+
+/**
+ * @brief Syncs made by a flush and by a commit, with and without a log, and
+ * that nothing syncs at all with durability off.
+ */
+static int
+durability_case(
+	enum pager_durability_e durability,
+	char wal,
+	int flush_syncs,
+	int commit_syncs)
+{
+	char const* db_name = "test_durability_.db";
+	char const* wal_name = "test_durability_.db-wal";
+	int result = 0;
+	struct PagerOps ops = PosixOps;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	remove(db_name);
+	remove(wal_name);
+	ops.sync = &counting_sync;
+	page_cache_create(&cache, 4);
+	pager_create(&pager, &ops, cache, 0x1000);
+	if( pager_open(pager, db_name) != PAGER_OK )
+		goto end;
+
+	pager_set_durability(pager, durability);
+	if( wal && pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	memset(page->page_buffer, 'a', pager->page_size);
+	durability_syncs = 0;
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_flush(pager) != PAGER_OK || durability_syncs != flush_syncs )
+		goto end;
+
+	memset(page->page_buffer, 'b', pager->page_size);
+	durability_syncs = 0;
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_sync(pager) != PAGER_OK || durability_syncs != commit_syncs )
+		goto end;
+
+	page_destroy(pager, page);
+	page = NULL;
+	durability_syncs = 0;
+	pager_destroy(pager);
+	pager = NULL;
+	if( durability == PAGER_DURABILITY_OFF && durability_syncs != 0 )
+		goto end;
+
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	page_create(pager, &page);
+	if( !check_page(pager, page, 1, 'b') )
+		goto end;
+
+	result = 1;
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+	remove(wal_name);
+
+	return result;
+}
+
+int
+pager_test_durability(void)
+{
+	int result = 1;
+
+	for( char wal = 0; wal < 2; wal++ )
+	{
+		result &= durability_case(PAGER_DURABILITY_OFF, wal, 0, 0);
+		result &= durability_case(PAGER_DURABILITY_NORMAL, wal, 0, 1);
+		// The commit's flush does the sync.
+		result &= durability_case(PAGER_DURABILITY_FULL, wal, 1, 1);
+	}
+
+	return result;
+}
+
+/**
+ * @brief Write npages new pages and page 1, all starting with c.
+ */
+static enum pager_e
+write_txn_pages(struct Pager* pager, struct Page* page, int npages, char c)
+{
+	enum pager_e result = PAGER_OK;
+
+	memset(page->page_buffer, c, pager->page_size);
+	for( int i = 0; i < npages && result == PAGER_OK; i++ )
+	{
+		page->page_id = PAGE_CREATE_NEW_PAGE;
+		result = pager_write_page(pager, page);
+	}
+
+	page->page_id = 1;
+	if( result == PAGER_OK )
+		result = pager_write_page(pager, page);
+
+	return result;
+}
+
+/**
+ * @brief A transaction bigger than the cache touches neither the database
+ * file nor the log until it commits; rollback puts the pager back.
+ */
+static int
+transaction_case(char wal, enum page_cache_policy_e policy)
+{
+	char const* db_name = "test_txn_.db";
+	char const* wal_name = "test_txn_.db-wal";
+	int const npages = 12;
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	remove(db_name);
+	remove(wal_name);
+	page_cache_create_ex(&cache, 4, policy);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	if( wal && pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	memset(page->page_buffer, 'a', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_sync(pager) != PAGER_OK )
+		goto end;
+
+	i64 file_size = pager->ops->size(pager->file);
+	u32 nframes = wal ? pager->wal->nframes : 0;
+
+	if( pager_begin(pager) != PAGER_OK ||
+		write_txn_pages(pager, page, npages, 'x') != PAGER_OK )
+		goto end;
+
+	// Flushes wait for the commit.
+	if( pager_sync(pager) != PAGER_OK || cache->capacity <= 4 ||
+		cache->ndirty != npages + 1 ||
+		pager->ops->size(pager->file) != file_size ||
+		(wal && pager->wal->nframes != nframes) )
+		goto end;
+
+	if( pager_rollback(pager) != PAGER_OK || pager->max_page != 1 ||
+		cache->capacity != 4 || !check_page(pager, page, 1, 'a') )
+		goto end;
+
+	if( pager_begin(pager) != PAGER_OK ||
+		write_txn_pages(pager, page, npages, 'y') != PAGER_OK ||
+		pager_commit(pager) != PAGER_OK )
+		goto end;
+
+	// The rolled back pages were handed out again.
+	if( pager->max_page != npages + 1 || cache->capacity != 4 ||
+		cache->ndirty != 0 || pager_in_transaction(pager) )
+		goto end;
+
+	page_destroy(pager, page);
+	page = NULL;
+	pager_destroy(pager);
+	pager = NULL;
+
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+	if( wal && pager_enable_wal(pager) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	if( !check_page(pager, page, 1, 'y') ||
+		!check_page(pager, page, npages + 1, 'y') )
+		goto end;
+
+	result = 1;
+end:
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+	remove(wal_name);
+
+	return result;
+}
+
+int
+pager_test_transaction(void)
+{
+	int result = 1;
+
+	for( char wal = 0; wal < 2; wal++ )
+	{
+		result &= transaction_case(wal, PAGE_CACHE_LRU);
+		result &= transaction_case(wal, PAGE_CACHE_CLOCK);
+		result &= transaction_case(wal, PAGE_CACHE_2Q);
+	}
+
+	return result;
+}
+
+static enum pager_e
+open_shadow(struct Pager** r_pager, struct PageCache* cache, char const* name)
+{
+	enum pager_e result = pager_posix_create(r_pager, cache, name, 0x1000);
+	if( result == PAGER_OK )
+		result = pager_enable_shadow(*r_pager);
+
+	return result;
+}
+
+/**
+ * @brief Commits move pages instead of overwriting them, so a crash at any
+ * point, a torn root record included, leaves the last commit intact.
+ */
+int
+pager_test_shadow(void)
+{
+	char const* db_name = "test_shadow_.db";
+	char const* copy_name = "test_shadow_copy.db";
+	u32 const npages = 10;
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct Pager* copy = NULL;
+	struct PageCache* cache = NULL;
+	struct PageCache* copy_cache = NULL;
+	struct Page* page = NULL;
+	struct Page* copy_page = NULL;
+	u32 before = 0;
+	u32 after = 0;
+	remove(db_name);
+	remove(copy_name);
+	page_cache_create(&cache, 4);
+	page_cache_create(&copy_cache, 4);
+
+	if( open_shadow(&pager, cache, db_name) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	if( write_round(pager, page, npages, 'a') != PAGER_OK ||
+		pager_sync(pager) != PAGER_OK ||
+		!pager_shadow_find(pager->shadow, 2, &before) )
+		goto end;
+
+	// The old image is free once the commit that replaced it is in.
+	if( write_round(pager, page, npages, 'b') != PAGER_OK ||
+		pager_sync(pager) != PAGER_OK ||
+		!pager_shadow_find(pager->shadow, 2, &after) || after == before ||
+		pager->shadow->state[before - 1] != PAGER_SHADOW_FREE )
+		goto end;
+
+	// A root record torn as it was written falls back to the commit
+	// before it, whose pages nothing has reused yet.
+	u32 slot = pager->shadow->generation & 1;
+	if( !copy_file(db_name, copy_name) ||
+		!flip_byte(copy_name, slot * PAGER_SHADOW_SLOT_STRIDE + 8) ||
+		open_shadow(&copy, copy_cache, copy_name) != PAGER_OK )
+		goto end;
+
+	page_create(copy, &copy_page);
+	if( !check_page(copy, copy_page, 2, 'a') )
+		goto end;
+
+	page_destroy(copy, copy_page);
+	copy_page = NULL;
+	pager_destroy(copy);
+	copy = NULL;
+
+	// Written out but not committed; a crash now loses it.
+	if( write_round(pager, page, npages, 'c') != PAGER_OK ||
+		!copy_file(db_name, copy_name) )
+		goto end;
+
+	if( open_shadow(&copy, copy_cache, copy_name) != PAGER_OK )
+		goto end;
+
+	page_create(copy, &copy_page);
+	if( copy->max_page != npages || !check_page(copy, copy_page, 1, 'b') ||
+		!check_page(copy, copy_page, npages, 'b') )
+		goto end;
+
+	page_destroy(copy, copy_page);
+	copy_page = NULL;
+	pager_destroy(copy);
+	copy = NULL;
+
+	// A file written in place has no root record.
+	remove(copy_name);
+	pager_posix_create(&copy, copy_cache, copy_name, 0x1000);
+	page_create(copy, &copy_page);
+	if( write_round(copy, copy_page, 2, 'p') != PAGER_OK )
+		goto end;
+	page_destroy(copy, copy_page);
+	copy_page = NULL;
+	pager_destroy(copy);
+	copy = NULL;
+	if( open_shadow(&copy, copy_cache, copy_name) != PAGER_OPEN_ERR )
+		goto end;
+	pager_destroy(copy);
+	copy = NULL;
+
+	page_destroy(pager, page);
+	page = NULL;
+	pager_destroy(pager);
+	pager = NULL;
+
+	if( open_shadow(&pager, cache, db_name) != PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	if( pager->max_page != npages || !check_page(pager, page, 1, 'c') ||
+		!check_page(pager, page, npages, 'c') )
+		goto end;
+
+	result = 1;
+end:
+	if( copy_page )
+		page_destroy(copy, copy_page);
+	if( copy )
+		pager_destroy(copy);
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	page_cache_destroy(copy_cache);
+	remove(db_name);
+	remove(copy_name);
+
+	return result;
+}
+
+static int
+check_snapshot_page(
+	struct PagerSnapshot* snapshot, struct Page* page, u32 page_id, char c)
+{
+	struct PageSelector selector = {.page_id = page_id};
+
+	if( pager_snapshot_read(snapshot, &selector, page) != PAGER_OK ||
+		((char*)page->page_buffer)[0] != c )
+		return 0;
+
+	return pager_snapshot_read_ro(snapshot, &selector, page) == PAGER_OK &&
+		   ((char*)page->page_buffer)[0] == c;
+}
+
+/**
+ * @brief A snapshot keeps seeing pages as they were when it was opened:
+ * through overwrites, evictions, the free list reusing its pages and a
+ * rollback.
+ */
+int
+pager_test_snapshot(void)
+{
+	char const* db_name = "test_snapshot_.db";
+	u32 const npages = 10;
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct PagerSnapshot* first = NULL;
+	struct PagerSnapshot* second = NULL;
+	struct PagerSnapshot* txn = NULL;
+	u32 new_page_id = 0;
+	remove(db_name);
+	page_cache_create(&cache, 4);
+	pager_posix_create(&pager, cache, db_name, 0x1000);
+
+	page_create(pager, &page);
+	if( write_round(pager, page, npages, 'a') != PAGER_OK ||
+		pager_snapshot_open(pager, &first) != PAGER_OK )
+		goto end;
+
+	// Most of the pages are evicted to the file on the way.
+	if( write_round(pager, page, npages, 'b') != PAGER_OK ||
+		first->nimages != npages || !check_page(pager, page, 2, 'b') ||
+		!check_snapshot_page(first, page, 2, 'a') ||
+		!check_snapshot_page(first, page, npages, 'a') )
+		goto end;
+
+	if( pager_snapshot_open(pager, &second) != PAGER_OK )
+		goto end;
+
+	page->page_id = 3;
+	memset(page->page_buffer, 'c', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		!check_snapshot_page(first, page, 3, 'a') ||
+		!check_snapshot_page(second, page, 3, 'b') ||
+		!check_page(pager, page, 3, 'c') )
+		goto end;
+
+	// The free list writes a trunk over page 5.
+	if( pager_freelist_push(pager, 5) != PAGER_OK ||
+		pager_flush(pager) != PAGER_OK ||
+		!check_snapshot_page(first, page, 5, 'a') ||
+		!check_snapshot_page(second, page, 5, 'b') )
+		goto end;
+
+	// Pages added since are nobody's business.
+	u32 nimages = second->nimages;
+	if( pager_extend(pager, &new_page_id) != PAGER_OK ||
+		new_page_id != npages + 1 || second->nimages != nimages )
+		goto end;
+
+	// A snapshot opened in a transaction sees its pages, also after the
+	// rollback; those it didn't see are still taken before they change.
+	if( pager_begin(pager) != PAGER_OK )
+		goto end;
+	page->page_id = 4;
+	memset(page->page_buffer, 'd', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_snapshot_open(pager, &txn) != PAGER_OK )
+		goto end;
+	page->page_id = 6;
+	memset(page->page_buffer, 'e', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_rollback(pager) != PAGER_OK ||
+		!check_snapshot_page(txn, page, 4, 'd') ||
+		!check_snapshot_page(txn, page, 6, 'b') ||
+		!check_page(pager, page, 4, 'b') || !check_page(pager, page, 6, 'b') )
+		goto end;
+
+	result = 1;
+end:
+	if( txn )
+		pager_snapshot_close(txn);
+	if( second )
+		pager_snapshot_close(second);
+	if( first )
+		pager_snapshot_close(first);
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+static int
+snapshot_rollback(char shadow)
+{
+	char const* db_name = "test_snapshot_rollback_.db";
+	u32 const npages = 6;
+	int result = 0;
+	struct Pager* pager = NULL;
+	struct PageCache* cache = NULL;
+	struct Page* page = NULL;
+	struct PagerSnapshot* before = NULL;
+	struct PagerSnapshot* during = NULL;
+	u32 new_page_id = 0;
+	remove(db_name);
+	page_cache_create(&cache, 16);
+
+	if( shadow ? open_shadow(&pager, cache, db_name) != PAGER_OK
+			   : pager_posix_create(&pager, cache, db_name, 0x1000) !=
+					 PAGER_OK )
+		goto end;
+
+	page_create(pager, &page);
+	if( write_round(pager, page, npages, 'a') != PAGER_OK ||
+		pager_snapshot_open(pager, &before) != PAGER_OK ||
+		pager_begin(pager) != PAGER_OK )
+		goto end;
+
+	// Pages 1 to 3 are dirty when the snapshot opens; 1 is never written
+	// again, so only the rollback can keep it.
+	for( u32 page_id = 1; page_id <= 3; page_id++ )
+	{
+		page->page_id = page_id;
+		memset(page->page_buffer, 'b', pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK )
+			goto end;
+	}
+	if( pager_snapshot_open(pager, &during) != PAGER_OK )
+		goto end;
+	for( u32 page_id = 2; page_id <= 4; page_id++ )
+	{
+		page->page_id = page_id;
+		memset(page->page_buffer, 'c', pager->page_size);
+		if( pager_write_page(pager, page) != PAGER_OK )
+			goto end;
+	}
+	if( pager_extend(pager, &new_page_id) != PAGER_OK ||
+		pager_rollback(pager) != PAGER_OK )
+		goto end;
+
+	for( u32 page_id = 1; page_id <= npages; page_id++ )
+	{
+		char seen = page_id <= 3 ? 'b' : 'a';
+		if( !check_snapshot_page(before, page, page_id, 'a') ||
+			!check_snapshot_page(during, page, page_id, seen) ||
+			!check_page(pager, page, page_id, 'a') )
+			goto end;
+	}
+	if( pager->max_page != npages )
+		goto end;
+
+	// What the rollback kept is not overwritten by later writes.
+	page->page_id = 1;
+	memset(page->page_buffer, 'd', pager->page_size);
+	if( pager_write_page(pager, page) != PAGER_OK ||
+		pager_flush(pager) != PAGER_OK ||
+		!check_snapshot_page(during, page, 1, 'b') ||
+		!check_snapshot_page(before, page, 1, 'a') )
+		goto end;
+
+	result = 1;
+end:
+	if( during )
+		pager_snapshot_close(during);
+	if( before )
+		pager_snapshot_close(before);
+	if( page )
+		page_destroy(pager, page);
+	if( pager )
+		pager_destroy(pager);
+	page_cache_destroy(cache);
+	remove(db_name);
+
+	return result;
+}
+
+/**
+ * @brief A rollback drops the transaction's dirty pages; a snapshot opened
+ * in the transaction keeps seeing them, with and without shadow paging.
+ */
+int
+pager_test_snapshot_rollback(void)
+{
+	return snapshot_rollback(0) && snapshot_rollback(1);
+}
@@ -3,8 +3,34 @@
 
 int pager_test_read_write_cstd();
 
+int pager_test_read_write_posix();
+
+int pager_test_read_ro_mmap();
+
+int pager_test_read_ro_pinned();
+
+int pager_test_page_pool();
+
+int pager_test_write_pages_batched();
+
+int pager_test_write_back();
+
+int pager_test_cache_page_table();
+
+int pager_test_cache_policies();
+
 int pager_test_page_loads_caching();
 
 int pager_test_free_page_list();
 
+int pager_test_free_page_trunks();
+
+int pager_test_wal_recovery();
+int pager_test_wal_checkpointer();
+int pager_test_durability();
+int pager_test_transaction();
+int pager_test_shadow();
+int pager_test_snapshot();
+int pager_test_snapshot_rollback(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,770 @@
+#include "pager_wal.h"
+
+#include "serialization.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WAL_MAGIC 0x57414C31
+#define WAL_VERSION 1
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * @brief FNV-1a over 32-bit words, then any trailing bytes. Word steps keep
+ * it to about a microsecond per 4KB frame.
+ */
+static u32
+checksum(u32 seed, void const* data, u32 size)
+{
+	u8 const* bytes = (u8 const*)data;
+	u32 hash = seed;
+	u32 i = 0;
+
+	for( ; i + 4 <= size; i += 4 )
+	{
+		u32 word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash ^= word;
+		hash *= FNV_PRIME;
+	}
+
+	for( ; i < size; i++ )
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static u32
+frame_size(struct PagerWal* wal)
+{
+	return PAGER_WAL_FRAME_HEADER_SIZE + wal->disk_page_size;
+}
+
+static u64
+frame_offset(struct PagerWal* wal, u32 frame)
+{
+	return PAGER_WAL_HEADER_SIZE + (u64)frame * frame_size(wal);
+}
+
+static u32
+index_slot(struct PagerWal* wal, u32 page_id)
+{
+	// Fibonacci hashing; capacity is a power of two.
+	return (u32)(page_id * 2654435769u) & (wal->index_capacity - 1);
+}
+
+static enum pager_e
+index_grow(struct PagerWal* wal)
+{
+	u32 old_capacity = wal->index_capacity;
+	u32* old_pages = wal->index_pages;
+	u32* old_frames = wal->index_frames;
+	u32 capacity = old_capacity ? old_capacity * 2 : 256;
+
+	u32* pages = (u32*)calloc(capacity, sizeof(u32));
+	u32* frames = (u32*)calloc(capacity, sizeof(u32));
+	if( !pages || !frames )
+	{
+		free(pages);
+		free(frames);
+		return PAGER_ERR_NO_MEM;
+	}
+
+	wal->index_pages = pages;
+	wal->index_frames = frames;
+	wal->index_capacity = capacity;
+
+	for( u32 i = 0; i < old_capacity; i++ )
+	{
+		if( old_frames[i] == 0 )
+			continue;
+
+		u32 slot = index_slot(wal, old_pages[i]);
+		while( frames[slot] != 0 )
+			slot = (slot + 1) & (capacity - 1);
+
+		pages[slot] = old_pages[i];
+		frames[slot] = old_frames[i];
+	}
+
+	free(old_pages);
+	free(old_frames);
+
+	return PAGER_OK;
+}
+
+static enum pager_e
+index_put(struct PagerWal* wal, u32 page_id, u32 frame)
+{
+	enum pager_e result = PAGER_OK;
+
+	// Keep the load at or under one half.
+	if( (wal->index_size + 1) * 2 > wal->index_capacity )
+	{
+		result = index_grow(wal);
+		if( result != PAGER_OK )
+			return result;
+	}
+
+	u32 slot = index_slot(wal, page_id);
+	while( wal->index_frames[slot] != 0 && wal->index_pages[slot] != page_id )
+		slot = (slot + 1) & (wal->index_capacity - 1);
+
+	if( wal->index_frames[slot] == 0 )
+		wal->index_size += 1;
+
+	wal->index_pages[slot] = page_id;
+	wal->index_frames[slot] = frame + 1;
+
+	return PAGER_OK;
+}
+
+static char
+index_get(struct PagerWal* wal, u32 page_id, u32* r_frame)
+{
+	if( wal->index_size == 0 )
+		return 0;
+
+	u32 slot = index_slot(wal, page_id);
+	while( wal->index_frames[slot] != 0 )
+	{
+		if( wal->index_pages[slot] == page_id )
+		{
+			*r_frame = wal->index_frames[slot] - 1;
+			return 1;
+		}
+
+		slot = (slot + 1) & (wal->index_capacity - 1);
+	}
+
+	return 0;
+}
+
+static void
+index_clear(struct PagerWal* wal)
+{
+	if( wal->index_capacity )
+	{
+		memset(wal->index_pages, 0x00, sizeof(u32) * wal->index_capacity);
+		memset(wal->index_frames, 0x00, sizeof(u32) * wal->index_capacity);
+	}
+	wal->index_size = 0;
+}
+
+static enum pager_e
+write_header(struct PagerWal* wal)
+{
+	byte header[PAGER_WAL_HEADER_SIZE] = {0};
+	int bytes = 0;
+
+	ser_write_32bit_le(header, WAL_MAGIC);
+	ser_write_32bit_le(header + 4, WAL_VERSION);
+	ser_write_32bit_le(header + 8, wal->disk_page_size);
+	ser_write_32bit_le(header + 12, wal->salt);
+	ser_write_32bit_le(header + 16, checksum(FNV_OFFSET, header, 16));
+
+	return wal->ops->write(wal->file, header, 0, sizeof(header), &bytes);
+}
+
+/**
+ * @brief Start the log over with a new salt; the caller holds the mutex.
+ *
+ * Old frames no longer match the salt; they are overwritten as the log
+ * grows again. A commit's sync also covers this header write.
+ */
+static enum pager_e
+restart(struct PagerWal* wal)
+{
+	enum pager_e result = PAGER_OK;
+
+	wal->salt += 1;
+	result = write_header(wal);
+	if( result != PAGER_OK )
+		return result;
+
+	wal->end_base += frame_offset(wal, wal->nframes);
+	wal->checksum = wal->salt ^ FNV_OFFSET;
+	wal->nframes = 0;
+	wal->ncommitted = 0;
+	wal->ndurable = 0;
+	wal->nbackfilled = 0;
+	index_clear(wal);
+
+	return PAGER_OK;
+}
+
+/**
+ * @brief Read the header; 0 if there is no valid one.
+ */
+static char
+read_header(struct PagerWal* wal, u32* r_disk_page_size, u32* r_salt)
+{
+	byte header[PAGER_WAL_HEADER_SIZE] = {0};
+	u32 magic = 0;
+	u32 version = 0;
+	u32 header_checksum = 0;
+	int bytes = 0;
+
+	if( wal->ops->size(wal->file) < PAGER_WAL_HEADER_SIZE )
+		return 0;
+
+	if( wal->ops->read(wal->file, header, 0, sizeof(header), &bytes) !=
+		PAGER_OK )
+		return 0;
+
+	ser_read_32bit_le(&magic, header);
+	ser_read_32bit_le(&version, header + 4);
+	ser_read_32bit_le(r_disk_page_size, header + 8);
+	ser_read_32bit_le(r_salt, header + 12);
+	ser_read_32bit_le(&header_checksum, header + 16);
+
+	return magic == WAL_MAGIC && version == WAL_VERSION &&
+		   header_checksum == checksum(FNV_OFFSET, header, 16);
+}
+
+static u32
+frame_checksum(
+	u32 seed, byte const* frame_header, void const* disk_page, u32 size)
+{
+	// The checksum field itself is not covered.
+	u32 sum = checksum(seed, frame_header, PAGER_WAL_FRAME_HEADER_SIZE - 4);
+	return checksum(sum, disk_page, size);
+}
+
+/**
+ * @brief Scan the frames and index the ones up to the last commit.
+ */
+static enum pager_e
+recover(struct PagerWal* wal)
+{
+	enum pager_e result = PAGER_OK;
+	u32 size = frame_size(wal);
+	byte* frame = (byte*)malloc(size);
+	u32* page_ids = NULL;
+	u32 page_ids_capacity = 0;
+	u32 nframes = 0;
+	u32 sum = wal->salt ^ FNV_OFFSET;
+	int bytes = 0;
+
+	if( !frame )
+		return PAGER_ERR_NO_MEM;
+
+	wal->checksum = sum;
+
+	while( 1 )
+	{
+		u32 page_id = 0;
+		u32 commit_max_page = 0;
+		u32 salt = 0;
+		u32 frame_sum = 0;
+
+		if( wal->ops->read(
+				wal->file, frame, frame_offset(wal, nframes), size, &bytes) !=
+			PAGER_OK )
+			break;
+
+		ser_read_32bit_le(&page_id, frame);
+		ser_read_32bit_le(&commit_max_page, frame + 4);
+		ser_read_32bit_le(&salt, frame + 8);
+		ser_read_32bit_le(&frame_sum, frame + 12);
+
+		if( salt != wal->salt || page_id == 0 )
+			break;
+
+		sum = frame_checksum(
+			sum,
+			frame,
+			frame + PAGER_WAL_FRAME_HEADER_SIZE,
+			wal->disk_page_size);
+		if( sum != frame_sum )
+			break;
+
+		if( nframes == page_ids_capacity )
+		{
+			page_ids_capacity = page_ids_capacity ? page_ids_capacity * 2 : 64;
+			u32* grown =
+				(u32*)realloc(page_ids, sizeof(u32) * page_ids_capacity);
+			if( !grown )
+			{
+				result = PAGER_ERR_NO_MEM;
+				goto end;
+			}
+			page_ids = grown;
+		}
+
+		page_ids[nframes] = page_id;
+		nframes += 1;
+
+		if( commit_max_page != 0 )
+		{
+			wal->ncommitted = nframes;
+			wal->max_page = commit_max_page;
+			wal->checksum = sum;
+		}
+	}
+
+	// Frames after the last commit never happened.
+	for( u32 i = 0; i < wal->ncommitted; i++ )
+	{
+		result = index_put(wal, page_ids[i], i);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	wal->nframes = wal->ncommitted;
+	wal->ndurable = wal->ncommitted;
+
+end:
+	free(frame);
+	free(page_ids);
+	return result;
+}
+
+enum pager_e
+pager_wal_open(
+	struct PagerWal** r_wal,
+	struct PagerOps* ops,
+	char const* filename,
+	u32 disk_page_size)
+{
+	enum pager_e result = PAGER_OK;
+	struct PagerWal* wal =
+		(struct PagerWal*)calloc(1, sizeof(struct PagerWal));
+	u32 log_page_size = 0;
+	u32 salt = 0;
+
+	if( !wal )
+		return PAGER_ERR_NO_MEM;
+
+	strncpy(wal->filename, filename, sizeof(wal->filename) - 1);
+	wal->ops = ops;
+	wal->disk_page_size = disk_page_size;
+	wal->group_commit = 1;
+	bt_mutex_init(&wal->mutex);
+	bt_cond_init(&wal->synced);
+
+	result = ops->open(&wal->file, wal->filename);
+	if( result != PAGER_OK )
+	{
+		wal->file = NULL;
+		goto err;
+	}
+
+	if( read_header(wal, &log_page_size, &salt) )
+	{
+		if( log_page_size != disk_page_size )
+		{
+			result = PAGER_OPEN_ERR;
+			goto err;
+		}
+
+		wal->salt = salt;
+		result = recover(wal);
+		if( result != PAGER_OK )
+			goto err;
+	}
+	else
+	{
+		wal->salt = (u32)time(NULL);
+		wal->checksum = wal->salt ^ FNV_OFFSET;
+		result = write_header(wal);
+		if( result != PAGER_OK )
+			goto err;
+	}
+
+	wal->synced_end = frame_offset(wal, wal->nframes);
+
+	*r_wal = wal;
+	return PAGER_OK;
+
+err:
+	pager_wal_close(wal, 0);
+	*r_wal = NULL;
+	return result;
+}
+
+enum pager_e
+pager_wal_close(struct PagerWal* wal, char remove_log)
+{
+	enum pager_e result = PAGER_OK;
+
+	if( wal->file )
+		result = wal->ops->close(wal->file);
+
+	if( remove_log && result == PAGER_OK )
+		remove(wal->filename);
+
+	bt_cond_destroy(&wal->synced);
+	bt_mutex_destroy(&wal->mutex);
+	free(wal->index_pages);
+	free(wal->index_frames);
+	free(wal);
+
+	return result;
+}
+
+char
+pager_wal_find(struct PagerWal* wal, u32 page_id, u32* r_frame)
+{
+	bt_mutex_lock(&wal->mutex);
+	char found = index_get(wal, page_id, r_frame);
+	bt_mutex_unlock(&wal->mutex);
+
+	return found;
+}
+
+enum pager_e
+pager_wal_read(struct PagerWal* wal, u32 frame, void* disk_page)
+{
+	return pager_wal_read_file(wal, wal->file, frame, disk_page);
+}
+
+enum pager_e
+pager_wal_read_file(
+	struct PagerWal* wal, void* file, u32 frame, void* disk_page)
+{
+	int bytes = 0;
+
+	return wal->ops->read(
+		file,
+		disk_page,
+		frame_offset(wal, frame) + PAGER_WAL_FRAME_HEADER_SIZE,
+		wal->disk_page_size,
+		&bytes);
+}
+
+enum pager_e
+pager_wal_append(
+	struct PagerWal* wal,
+	u32 const* page_ids,
+	void* const* disk_pages,
+	int num,
+	u32 commit_max_page,
+	u64* r_end)
+{
+	enum pager_e result = PAGER_OK;
+	u32 size = frame_size(wal);
+	byte* frames = NULL;
+	int bytes = 0;
+
+	if( num == 0 )
+		return PAGER_OK;
+
+	frames = (byte*)malloc((size_t)size * num);
+	if( !frames )
+		return PAGER_ERR_NO_MEM;
+
+	bt_mutex_lock(&wal->mutex);
+
+	// A background checkpoint copied the whole log; start it over instead
+	// of growing it.
+	if( wal->nframes > 0 && wal->nbackfilled == wal->nframes )
+	{
+		result = restart(wal);
+		if( result != PAGER_OK )
+			goto end;
+		wal->stats.restarts += 1;
+	}
+
+	u32 first = wal->nframes;
+	u32 sum = wal->checksum;
+	for( int i = 0; i < num; i++ )
+	{
+		byte* frame = frames + (size_t)size * i;
+		char commit = commit_max_page != 0 && i == num - 1;
+
+		ser_write_32bit_le(frame, page_ids[i]);
+		ser_write_32bit_le(frame + 4, commit ? commit_max_page : 0);
+		ser_write_32bit_le(frame + 8, wal->salt);
+		memcpy(
+			frame + PAGER_WAL_FRAME_HEADER_SIZE,
+			disk_pages[i],
+			wal->disk_page_size);
+
+		sum = frame_checksum(
+			sum,
+			frame,
+			frame + PAGER_WAL_FRAME_HEADER_SIZE,
+			wal->disk_page_size);
+		ser_write_32bit_le(frame + 12, sum);
+	}
+
+	// One write for the whole run of frames.
+	result = wal->ops->write(
+		wal->file, frames, frame_offset(wal, first), size * num, &bytes);
+	if( result != PAGER_OK )
+		goto end;
+
+	for( int i = 0; i < num; i++ )
+	{
+		result = index_put(wal, page_ids[i], first + i);
+		if( result != PAGER_OK )
+			goto end;
+	}
+
+	wal->checksum = sum;
+	wal->nframes = first + num;
+	wal->stats.frames += num;
+
+	if( commit_max_page != 0 )
+	{
+		wal->ncommitted = wal->nframes;
+		wal->max_page = commit_max_page;
+		wal->stats.commits += 1;
+	}
+
+	if( wal->nosync )
+	{
+		wal->synced_end = wal->end_base + frame_offset(wal, wal->nframes);
+		wal->ndurable = wal->ncommitted;
+	}
+
+	if( r_end )
+		*r_end = wal->end_base + frame_offset(wal, wal->nframes);
+
+end:
+	bt_mutex_unlock(&wal->mutex);
+	free(frames);
+	return result;
+}
+
+enum pager_e
+pager_wal_commit_pending(
+	struct PagerWal* wal, u32 commit_max_page, u64* r_end)
+{
+	enum pager_e result = PAGER_OK;
+	u32 size = frame_size(wal);
+	byte* frame = NULL;
+	u32 page_id = 0;
+	int bytes = 0;
+
+	bt_mutex_lock(&wal->mutex);
+	u32 last = wal->nframes;
+	char pending = wal->nframes > wal->ncommitted;
+	bt_mutex_unlock(&wal->mutex);
+
+	if( !pending )
+		return PAGER_OK;
+
+	frame = (byte*)malloc(size);
+	if( !frame )
+		return PAGER_ERR_NO_MEM;
+
+	result = wal->ops->read(
+		wal->file, frame, frame_offset(wal, last - 1), size, &bytes);
+	if( result != PAGER_OK )
+		goto end;
+
+	ser_read_32bit_le(&page_id, frame);
+
+	void* disk_page = frame + PAGER_WAL_FRAME_HEADER_SIZE;
+	result =
+		pager_wal_append(wal, &page_id, &disk_page, 1, commit_max_page, r_end);
+
+end:
+	free(frame);
+	return result;
+}
+
+enum pager_e
+pager_wal_sync(struct PagerWal* wal, u64 end)
+{
+	enum pager_e result = PAGER_OK;
+
+	bt_mutex_lock(&wal->mutex);
+
+	// Without group commit every commit pays for a sync of its own, even if
+	// another commit's sync already covered its frames.
+	char own_sync = !wal->group_commit && !wal->nosync;
+
+	while( wal->synced_end < end || own_sync )
+	{
+		if( wal->syncing )
+		{
+			bt_cond_wait(&wal->synced, &wal->mutex);
+			continue;
+		}
+
+		own_sync = 0;
+
+		u64 base = wal->end_base;
+		u64 target = base + frame_offset(wal, wal->nframes);
+		u32 durable = wal->ncommitted;
+		wal->syncing = 1;
+		bt_mutex_unlock(&wal->mutex);
+
+		if( wal->ops->sync )
+			result = wal->ops->sync(wal->file);
+
+		bt_mutex_lock(&wal->mutex);
+		wal->syncing = 0;
+		wal->stats.syncs += 1;
+		if( result == PAGER_OK && target > wal->synced_end )
+			wal->synced_end = target;
+		// Frame numbers start over when the log restarts.
+		if( result == PAGER_OK && base == wal->end_base &&
+			durable > wal->ndurable )
+			wal->ndurable = durable;
+		bt_cond_broadcast(&wal->synced);
+
+		if( result != PAGER_OK )
+			break;
+	}
+	bt_mutex_unlock(&wal->mutex);
+
+	return result;
+}
+
+u64
+pager_wal_end(struct PagerWal* wal)
+{
+	bt_mutex_lock(&wal->mutex);
+	u64 end = wal->end_base + frame_offset(wal, wal->nframes);
+	bt_mutex_unlock(&wal->mutex);
+
+	return end;
+}
+
+static int
+entry_cmp(void const* left, void const* right)
+{
+	u32 l = ((struct PagerWalEntry const*)left)->page_id;
+	u32 r = ((struct PagerWalEntry const*)right)->page_id;
+	return l < r ? -1 : l > r;
+}
+
+enum pager_e
+pager_wal_collect(
+	struct PagerWal* wal, struct PagerWalEntry** r_entries, u32* r_num)
+{
+	struct PagerWalEntry* entries = NULL;
+	u32 num = 0;
+
+	bt_mutex_lock(&wal->mutex);
+
+	if( wal->index_size > 0 )
+	{
+		entries = (struct PagerWalEntry*)malloc(
+			sizeof(struct PagerWalEntry) * wal->index_size);
+		if( !entries )
+		{
+			bt_mutex_unlock(&wal->mutex);
+			return PAGER_ERR_NO_MEM;
+		}
+	}
+
+	for( u32 i = 0; i < wal->index_capacity; i++ )
+	{
+		if( wal->index_frames[i] == 0 )
+			continue;
+
+		entries[num].page_id = wal->index_pages[i];
+		entries[num].frame = wal->index_frames[i] - 1;
+		num++;
+	}
+
+	bt_mutex_unlock(&wal->mutex);
+
+	if( num > 1 )
+		qsort(entries, num, sizeof(struct PagerWalEntry), entry_cmp);
+
+	*r_entries = entries;
+	*r_num = num;
+
+	return PAGER_OK;
+}
+
+enum pager_e
+pager_wal_backfill_collect(
+	struct PagerWal* wal,
+	u32* r_mark,
+	struct PagerWalEntry** r_entries,
+	u32* r_num)
+{
+	struct PagerWalEntry* entries = NULL;
+	u32 mark = 0;
+	u32 num = 0;
+
+	bt_mutex_lock(&wal->mutex);
+
+	if( wal->ndurable > wal->nbackfilled )
+	{
+		mark = wal->ndurable;
+		entries = (struct PagerWalEntry*)malloc(
+			sizeof(struct PagerWalEntry) * wal->index_size);
+		if( !entries )
+		{
+			bt_mutex_unlock(&wal->mutex);
+			return PAGER_ERR_NO_MEM;
+		}
+
+		for( u32 i = 0; i < wal->index_capacity; i++ )
+		{
+			u32 frame = wal->index_frames[i];
+			// Pages whose latest frame is below nbackfilled were copied by
+			// an earlier round.
+			if( frame == 0 || frame - 1 >= mark ||
+				frame - 1 < wal->nbackfilled )
+				continue;
+
+			entries[num].page_id = wal->index_pages[i];
+			entries[num].frame = frame - 1;
+			num++;
+		}
+	}
+
+	bt_mutex_unlock(&wal->mutex);
+
+	if( num > 1 )
+		qsort(entries, num, sizeof(struct PagerWalEntry), entry_cmp);
+
+	*r_mark = mark;
+	*r_entries = entries;
+	*r_num = num;
+
+	return PAGER_OK;
+}
+
+void
+pager_wal_backfill_done(struct PagerWal* wal, u32 mark)
+{
+	bt_mutex_lock(&wal->mutex);
+	assert(mark <= wal->ndurable);
+	if( mark > wal->nbackfilled )
+		wal->nbackfilled = mark;
+	bt_mutex_unlock(&wal->mutex);
+}
+
+u32
+pager_wal_lag(struct PagerWal* wal)
+{
+	bt_mutex_lock(&wal->mutex);
+	u32 lag = wal->ncommitted - wal->nbackfilled;
+	bt_mutex_unlock(&wal->mutex);
+
+	return lag;
+}
+
+enum pager_e
+pager_wal_reset(struct PagerWal* wal)
+{
+	enum pager_e result = PAGER_OK;
+
+	bt_mutex_lock(&wal->mutex);
+
+	result = restart(wal);
+	if( result == PAGER_OK )
+		wal->stats.checkpoints += 1;
+
+	bt_mutex_unlock(&wal->mutex);
+
+	return result;
+}
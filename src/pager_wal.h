@@ -0,0 +1,222 @@
+#ifndef PAGER_WAL_H_
+#define PAGER_WAL_H_
+
+#include "btint.h"
+#include "btthread.h"
+#include "pager_e.h"
+#include "pager_ops.h"
+
+/**
+ * Write-ahead log.
+ *
+ * The log is a header followed by frames. A frame is a frame header and a
+ * full disk page image. The frame header holds the page id, the database
+ * size in pages if the frame ends a commit (0 otherwise), the log's salt
+ * and a checksum chained through every frame before it.
+ *
+ * On open the log is scanned up to the first frame whose salt or checksum
+ * doesn't match; frames after the last commit frame are dropped. A
+ * checkpoint copies the latest image of each page into the database file
+ * and restarts the log with a new salt, so frames left over from before
+ * the restart can never validate.
+ *
+ * A background checkpoint copies pages while commits keep appending; see
+ * pager_wal_backfill_collect. The log restarts on the first append after
+ * it has caught up.
+ */
+
+// magic, version, disk page size, salt, header checksum; padded.
+#define PAGER_WAL_HEADER_SIZE 32
+// page id, commit size, salt, checksum.
+#define PAGER_WAL_FRAME_HEADER_SIZE 16
+
+// Frames in the log before a commit checkpoints it.
+#define PAGER_WAL_AUTOCHECKPOINT 1000
+
+struct PagerWalStats
+{
+	u64 frames;
+	u64 commits;
+	// fsyncs of the log; fewer than commits when group commit batches them.
+	u64 syncs;
+	u64 checkpoints;
+	// Restarts after a background checkpoint caught up.
+	u64 restarts;
+};
+
+/**
+ * @brief Latest frame of a page; see pager_wal_collect.
+ */
+struct PagerWalEntry
+{
+	u32 page_id;
+	u32 frame;
+};
+
+struct PagerWal
+{
+	char filename[64];
+	struct PagerOps* ops;
+	void* file;
+	u32 disk_page_size;
+
+	u32 salt;
+	// Checksum of the last appended frame; seeds the next one.
+	u32 checksum;
+	u32 nframes;
+	// Frames up to here are part of a commit.
+	u32 ncommitted;
+	// Database size in pages as of the last commit.
+	u32 max_page;
+	// Frames up to here are commits known to be durable.
+	u32 ndurable;
+	// Frames up to here have their pages in the database file.
+	u32 nbackfilled;
+
+	// Open addressing, page id -> latest frame. Slots hold frame + 1; 0 is
+	// empty.
+	u32* index_pages;
+	u32* index_frames;
+	u32 index_capacity;
+	u32 index_size;
+
+	// Group commit; one sync covers every frame appended before it starts.
+	// When off, each commit waits for a sync of its own.
+	char group_commit;
+	// Durability off: nothing is synced and frames count as durable as soon
+	// as they are written.
+	char nosync;
+	char syncing;
+	// Log offset known to be durable. Offsets handed out by append keep
+	// growing across restarts; end_base is where the current log starts.
+	u64 synced_end;
+	u64 end_base;
+
+	// Guards everything above. Commits from several threads may share a
+	// log.
+	bt_mutex mutex;
+	bt_cond synced;
+
+	struct PagerWalStats stats;
+};
+
+/**
+ * @brief Open or create the log and recover the committed frames.
+ *
+ * @return PAGER_OPEN_ERR if the log exists but was written with a different
+ * page size.
+ */
+enum pager_e pager_wal_open(
+	struct PagerWal** r_wal,
+	struct PagerOps* ops,
+	char const* filename,
+	u32 disk_page_size);
+
+/**
+ * @brief Close the log; remove_log deletes the file, e.g. after a final
+ * checkpoint.
+ */
+enum pager_e pager_wal_close(struct PagerWal* wal, char remove_log);
+
+/**
+ * @brief Find the latest frame holding page_id.
+ *
+ * @return 0 if the page isn't in the log.
+ */
+char pager_wal_find(struct PagerWal* wal, u32 page_id, u32* r_frame);
+
+/**
+ * @brief Read a frame's page image; disk_page is disk_page_size bytes.
+ */
+enum pager_e pager_wal_read(struct PagerWal* wal, u32 frame, void* disk_page);
+
+/**
+ * @brief pager_wal_read through another handle on the log file, e.g. one
+ * owned by another thread.
+ */
+enum pager_e pager_wal_read_file(
+	struct PagerWal* wal, void* file, u32 frame, void* disk_page);
+
+/**
+ * @brief Append page images. If commit_max_page is not 0 the last frame
+ * commits everything appended so far, with the database at that many pages.
+ *
+ * Nothing is synced; see pager_wal_sync.
+ *
+ * @param r_end Optional; log offset past the last frame.
+ */
+enum pager_e pager_wal_append(
+	struct PagerWal* wal,
+	u32 const* page_ids,
+	void* const* disk_pages,
+	int num,
+	u32 commit_max_page,
+	u64* r_end);
+
+/**
+ * @brief Commit frames that were appended without one, e.g. pages written
+ * back on eviction, when there is nothing new to append. The last frame is
+ * appended again as the commit frame.
+ */
+enum pager_e pager_wal_commit_pending(
+	struct PagerWal* wal, u32 commit_max_page, u64* r_end);
+
+/**
+ * @brief Wait until the log is durable up to end (from pager_wal_append).
+ *
+ * Safe to call from several threads at once. One caller syncs while the
+ * others wait for it; with group_commit that sync also covers their frames.
+ */
+enum pager_e pager_wal_sync(struct PagerWal* wal, u64 end);
+
+/**
+ * @brief Log offset past the last appended frame, for pager_wal_sync.
+ */
+u64 pager_wal_end(struct PagerWal* wal);
+
+/**
+ * @brief The latest frame of each page in the log, sorted by page id.
+ *
+ * Free *r_entries with free().
+ */
+enum pager_e pager_wal_collect(
+	struct PagerWal* wal, struct PagerWalEntry** r_entries, u32* r_num);
+
+/**
+ * @brief Durable commits whose pages are not in the database file yet: the
+ * latest frame of each page, if it is below *r_mark, sorted by page id.
+ *
+ * *r_mark is 0 if every durable commit is already in the database file.
+ * Commits that were not synced yet are left alone; if the log lost them in
+ * a crash, the database file must not have them either.
+ * Once the entries are copied and the database file is synced, pass the mark
+ * to pager_wal_backfill_done. Pages whose latest frame is at or past the
+ * mark are left for a later round. The log can't restart in between.
+ *
+ * Free *r_entries with free().
+ */
+enum pager_e pager_wal_backfill_collect(
+	struct PagerWal* wal,
+	u32* r_mark,
+	struct PagerWalEntry** r_entries,
+	u32* r_num);
+
+/**
+ * @brief Every frame below mark is in the database file. If that covers the
+ * whole log, the next append restarts it.
+ */
+void pager_wal_backfill_done(struct PagerWal* wal, u32 mark);
+
+/**
+ * @brief Committed frames that are not in the database file yet, durable or
+ * not.
+ */
+u32 pager_wal_lag(struct PagerWal* wal);
+
+/**
+ * @brief Empty the log after its pages were checkpointed. Bumps the salt so
+ * the old frames are dead.
+ */
+enum pager_e pager_wal_reset(struct PagerWal* wal);
+
+#endif
@@ -353,4 +353,119 @@ end:
 fail:
 	result = 0;
 	goto end;
+}
+static u32
+serialize_name_age(char const* name, u32 age, byte* buffer)
+{
+	u32 name_size = strlen(name);
+
+	ser_write_32bit_le(buffer, name_size);
+	memcpy(buffer + 4, name, name_size);
+	ser_write_32bit_le(buffer + 4 + name_size, age);
+
+	return 4 + name_size + 4;
+}
+
+/**
+ * @brief Compare a stored record with a key, the record given in two windows
+ * split at split, as a node gives a prefixed cell. 2 on a bad window.
+ */
+static int
+compare_split(
+	struct IBTLSCompareContext* ctx,
+	byte* stored,
+	u32 stored_size,
+	byte* key,
+	u32 key_size,
+	u32 split)
+{
+	u32 nbytes_compared = 0;
+	u32 nkey_bytes_remaining = 0;
+
+	ctx->initted = false;
+	ibtls_reset_compare(ctx);
+	int result = ibtls_compare(
+		ctx,
+		stored,
+		split,
+		stored_size,
+		key,
+		key_size,
+		0,
+		&nbytes_compared,
+		&nkey_bytes_remaining);
+	if( result != 0 || nkey_bytes_remaining == 0 )
+		return result;
+
+	if( nbytes_compared != split )
+		return 2;
+
+	result = ibtls_compare(
+		ctx,
+		stored + split,
+		stored_size - split,
+		stored_size,
+		key,
+		key_size,
+		split,
+		&nbytes_compared,
+		&nkey_bytes_remaining);
+	if( result == 0 && nkey_bytes_remaining != 0 )
+		return 2;
+
+	return result;
+}
+
+/**
+ * @brief Records compare column by column, a shorter string first, however
+ * the stored record is split into windows.
+ */
+int
+schema_compare_columns_test(void)
+{
+	struct IBTreeLayoutSchema schema = {.key_offset = 0};
+	schema.nkey_definitions = 2;
+	schema.key_definitions[0].type = IBTLSK_TYPE_VARSIZE;
+	schema.key_definitions[1].type = IBTLSK_TYPE_FIXED;
+	schema.key_definitions[1].size = sizeof(u32);
+
+	struct IBTLSCompareContext ctx = {0};
+	ibtls_init_compare_context_from_schema(
+		&ctx, &schema, PAYLOAD_COMPARE_TYPE_KEY);
+
+	struct
+	{
+		char const* stored_name;
+		u32 stored_age;
+		char const* key_name;
+		u32 key_age;
+		int expected;
+	} cases[] = {
+		{"ab", 1, "abc", 1, -1},
+		{"abc", 1, "ab", 1, 1},
+		{"ab", 1, "ab", 2, -1},
+		{"ab", 7, "ab", 7, 0},
+		{"abd", 0, "abc", 9, 1},
+		{"", 3, "a", 3, -1},
+	};
+
+	byte stored[0x40];
+	byte key[0x40];
+	for( u32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+	{
+		u32 stored_size = serialize_name_age(
+			cases[i].stored_name, cases[i].stored_age, stored);
+		u32 key_size =
+			serialize_name_age(cases[i].key_name, cases[i].key_age, key);
+
+		for( u32 split = 1; split < stored_size; split++ )
+		{
+			if( compare_split(
+					&ctx, stored, stored_size, key, key_size, split) !=
+				cases[i].expected )
+				return 0;
+		}
+	}
+
+	return 1;
 }
\ No newline at end of file
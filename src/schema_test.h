@@ -5,4 +5,6 @@ int schema_compare_test(void);
 
 int schema_comparer_test(void);
 
+int schema_compare_columns_test(void);
+
 #endif
\ No newline at end of file
@@ -13,6 +13,8 @@ enum sql_e
 	SQL_ERR_TABLE_DNE,
 	SQL_ERR_NOT_FOUND,
 	SQL_ERR_SCAN_DONE,
+	// BEGIN inside a transaction, or COMMIT/ROLLBACK outside one.
+	SQL_ERR_TRANSACTION,
 };
 
 #endif
\ No newline at end of file
@@ -24,6 +24,9 @@ sql_parse_destroy(struct SQLParse* parse)
 	case SQL_PARSE_DELETE:
 		sql_parsed_delete_cleanup(&parse->parse.delete);
 		break;
+	case SQL_PARSE_BEGIN:
+	case SQL_PARSE_COMMIT:
+	case SQL_PARSE_ROLLBACK:
 	case SQL_PARSE_INVALID:
 		break;
 	}
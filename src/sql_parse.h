@@ -11,6 +11,9 @@ enum sql_parse_e
 	SQL_PARSE_SELECT,
 	SQL_PARSE_UPDATE,
 	SQL_PARSE_DELETE,
+	SQL_PARSE_BEGIN,
+	SQL_PARSE_COMMIT,
+	SQL_PARSE_ROLLBACK,
 };
 
 struct SQLParse
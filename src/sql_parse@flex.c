@@ -333,6 +333,37 @@ fail:
 	goto end;
 }
 
+/**
+ * @brief BEGIN, COMMIT and ROLLBACK; the lexer has no keywords for them, so
+ * they come in as identifiers. Nothing may follow them.
+ */
+static enum sql_parse_e
+parse_transaction(struct Lexer* lex)
+{
+	static struct
+	{
+		char const* word;
+		enum sql_parse_e type;
+	} const words[] = {
+		{"BEGIN", SQL_PARSE_BEGIN},
+		{"COMMIT", SQL_PARSE_COMMIT},
+		{"ROLLBACK", SQL_PARSE_ROLLBACK},
+	};
+	enum sql_parse_e type = SQL_PARSE_INVALID;
+
+	for( u32 i = 0; i < sizeof(words) / sizeof(words[0]); i++ )
+	{
+		if( leng(lex) == strlen(words[i].word) &&
+			memcmp(text(lex), words[i].word, leng(lex)) == 0 )
+			type = words[i].type;
+	}
+
+	if( next(lex) != 0 )
+		return SQL_PARSE_INVALID;
+
+	return type;
+}
+
 struct SQLParse*
 sql_parse_create(struct SQLString const* str)
 {
@@ -370,6 +401,9 @@ sql_parse_create(struct SQLString const* str)
 		parse->parse.delete = parse_delete(&lexer, &parse_success);
 		parse->type = SQL_PARSE_DELETE;
 		break;
+	case SQL_IDENTIFIER:
+		parse->type = parse_transaction(&lexer);
+		goto cleanup;
 	default:
 		parse->type = SQL_PARSE_INVALID;
 		goto cleanup;
@@ -16,13 +16,25 @@
 
 enum sql_e
 sqldb_create(struct SQLDB** out_sqldb, char const* filename)
+{
+	return sqldb_create_ex(out_sqldb, filename, NULL);
+}
+
+enum sql_e
+sqldb_create_ex(
+	struct SQLDB** out_sqldb,
+	char const* filename,
+	struct PagerFactoryOpts const* opts)
 {
 	enum sql_e result = SQL_OK;
+	struct Pager* pager = btree_factory_pager_create_ex(filename, opts);
+	if( !pager )
+		return SQL_ERR_UNKNOWN;
+
 	struct SQLDB* db = (struct SQLDB*)malloc(sizeof(struct SQLDB));
 	memset(db, 0x00, sizeof(*db));
-
-	struct Pager* pager = btree_factory_pager_create(filename);
 	db->pager = pager;
+	db->scan_ordered = true;
 
 	result = sqldb_meta_tables_create(db, pager);
 
@@ -31,6 +43,13 @@ sqldb_create(struct SQLDB** out_sqldb, char const* filename)
 	return result;
 }
 
+void
+sqldb_set_scan_workers(struct SQLDB* sqldb, u32 workers, bool ordered)
+{
+	sqldb->scan_workers = workers;
+	sqldb->scan_ordered = ordered;
+}
+
 enum sql_e
 sqldb_create_table(struct SQLDB* sqldb, struct SQLTable* table)
 {
@@ -1,12 +1,29 @@
 #ifndef SQLDB_H_
 #define SQLDB_H_
 
+#include "btree_factory.h"
 #include "sql_defs.h"
 #include "sql_table.h"
 #include "sqldb_defs.h"
 
 enum sql_e sqldb_create(struct SQLDB** out_sqldb, char const* filename);
 
+/**
+ * @brief sqldb_create with pager options, e.g. the durability level; opts
+ * may be NULL for the defaults.
+ */
+enum sql_e sqldb_create_ex(
+	struct SQLDB** out_sqldb,
+	char const* filename,
+	struct PagerFactoryOpts const* opts);
+
+/**
+ * @brief Scan tables with workers threads from now on, handing rows to
+ * statements in row id order if ordered. 0 or 1 scans on the calling thread,
+ * the default.
+ */
+void sqldb_set_scan_workers(struct SQLDB* sqldb, u32 workers, bool ordered);
+
 // TODO: Not sure if this belongs here.
 // TODO: RecordRC
 // enum sql_e sqldb_prepare_record(struct SQLDB* sqldb, );
@@ -5,6 +5,8 @@
 #include "pager.h"
 #include "sql_table.h"
 
+#include <stdbool.h>
+
 struct SQLDBMetaTable
 {
 	struct BTree* tree;
@@ -16,6 +18,11 @@ struct SQLDB
 	struct Pager* pager;
 	struct SQLDBMetaTable tb_tables;
 	struct SQLDBMetaTable tb_sequences;
+
+	// Threads full table scans read with, and whether they keep row id
+	// order; see SQLDBScanOpts. 0 or 1 scans on the calling thread.
+	u32 scan_workers;
+	bool scan_ordered;
 };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "btree_op_scan.h"
 #include "btree_op_select.h"
 #include "btree_op_update.h"
+#include "pager.h"
 #include "sql_ibtree.h"
 #include "sql_parsegen.h"
 #include "sql_utils.h"
@@ -159,6 +160,32 @@ fail:
 	goto end;
 }
 
+static bool
+where_filter(struct SQLRecord const* record, void* ctx)
+{
+	return match_where(record, (struct SQLParsedWhereClause*)ctx);
+}
+
+/**
+ * @brief Scan the table with the database's workers, filtering by where in
+ * them.
+ */
+static enum sql_e
+scan_acquire(
+	struct SQLDB* db,
+	struct SQLString* table_name,
+	struct SQLParsedWhereClause* where,
+	struct SQLDBScan* scan)
+{
+	struct SQLDBScanOpts opts = {0};
+	opts.workers = db->scan_workers;
+	opts.ordered = db->scan_ordered;
+	opts.filter = &where_filter;
+	opts.filter_ctx = where;
+
+	return sqldb_scan_acquire_ex(db, table_name, &opts, scan);
+}
+
 static void
 print_record(struct SQLRecord* record)
 {
@@ -181,7 +208,7 @@ select_s(struct SQLDB* db, struct SQLParsedSelect* select)
 	enum sql_e result = SQL_OK;
 
 	struct SQLDBScan scan = {0};
-	result = sqldb_scan_acquire(db, select->table_name, &scan);
+	result = scan_acquire(db, select->table_name, &select->where, &scan);
 	if( result != SQL_OK )
 		goto end;
 
@@ -195,8 +222,7 @@ select_s(struct SQLDB* db, struct SQLParsedSelect* select)
 		if( !record )
 			goto end;
 
-		if( match_where(record, &select->where) )
-			print_record(record);
+		print_record(record);
 	} while( !sqldb_scan_done(&scan) && result == SQL_OK );
 
 end:
@@ -272,7 +298,7 @@ delete_s(struct SQLDB* db, struct SQLParsedDelete* delete)
 	enum sql_e result = SQL_OK;
 
 	struct SQLDBScan scan = {0};
-	result = sqldb_scan_acquire(db, delete->table_name, &scan);
+	result = scan_acquire(db, delete->table_name, &delete->where, &scan);
 	if( result != SQL_OK )
 		goto end;
 
@@ -286,8 +312,7 @@ delete_s(struct SQLDB* db, struct SQLParsedDelete* delete)
 		if( !record )
 			goto end;
 
-		if( match_where(record, &delete->where) )
-			delete_record(&scan, delete, record);
+		delete_record(&scan, delete, record);
 	} while( !sqldb_scan_done(&scan) && result == SQL_OK );
 
 end:
@@ -301,7 +326,7 @@ update(struct SQLDB* db, struct SQLParsedUpdate* update)
 	enum sql_e result = SQL_OK;
 
 	struct SQLDBScan scan = {0};
-	result = sqldb_scan_acquire(db, update->table_name, &scan);
+	result = scan_acquire(db, update->table_name, &update->where, &scan);
 	if( result != SQL_OK )
 		goto end;
 
@@ -315,8 +340,7 @@ update(struct SQLDB* db, struct SQLParsedUpdate* update)
 		if( !record )
 			goto end;
 
-		if( match_where(record, &update->where) )
-			update_record(&scan, update, record);
+		update_record(&scan, update, record);
 	} while( !sqldb_scan_done(&scan) && result == SQL_OK );
 
 end:
@@ -324,6 +348,29 @@ end:
 	return result;
 }
 
+/**
+ * @brief BEGIN, COMMIT and ROLLBACK. Between BEGIN and COMMIT statements are
+ * not committed on their own; the pager keeps their pages in the cache.
+ */
+static enum sql_e
+transaction(struct SQLDB* db, enum sql_parse_e type)
+{
+	char in_transaction = pager_in_transaction(db->pager);
+
+	if( in_transaction != (type != SQL_PARSE_BEGIN) )
+		return SQL_ERR_TRANSACTION;
+
+	switch( type )
+	{
+	case SQL_PARSE_BEGIN:
+		return sqlpager_err(pager_begin(db->pager));
+	case SQL_PARSE_COMMIT:
+		return sqlpager_err(pager_commit(db->pager));
+	default:
+		return sqlpager_err(pager_rollback(db->pager));
+	}
+}
+
 enum sql_e
 sqldb_interpret(struct SQLDB* db, struct SQLParse* parsed)
 {
@@ -347,6 +394,20 @@ sqldb_interpret(struct SQLDB* db, struct SQLParse* parsed)
 	case SQL_PARSE_DELETE:
 		result = delete_s(db, &parsed->parse.delete);
 		break;
+	case SQL_PARSE_BEGIN:
+	case SQL_PARSE_COMMIT:
+	case SQL_PARSE_ROLLBACK:
+		return transaction(db, parsed->type);
+	}
+
+	// Writes sit in the page cache until flushed. Outside a transaction each
+	// statement is its own commit, synced as the pager's durability level
+	// says; inside one the pager ignores the sync.
+	if( parsed->type != SQL_PARSE_SELECT && parsed->type != SQL_PARSE_INVALID )
+	{
+		enum sql_e flush_result = sqlpager_err(pager_sync(db->pager));
+		if( result == SQL_OK )
+			result = flush_result;
 	}
 
 	return result;
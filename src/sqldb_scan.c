@@ -3,8 +3,12 @@
 #include "btree_defs.h"
 #include "btree_factory.h"
 #include "btree_op_scan.h"
+#include "btree_op_update.h"
+#include "noderc.h"
+#include "pager_snapshot.h"
 #include "sql_ibtree.h"
 #include "sql_utils.h"
+#include "sqldb_scan_parallel.h"
 #include "sqldb_scanbuffer.h"
 #include "sqldb_table.h"
 #include "sqldb_table_tbl.h"
@@ -17,6 +21,7 @@ enum scan_e
 	SE_INIT,
 	SE_BEGIN,
 	SE_SCAN,
+	SE_PARALLEL,
 	SE_END,
 	SE_FINALIZED,
 };
@@ -24,9 +29,19 @@ enum scan_e
 struct ScanState
 {
 	enum scan_e step;
+	struct SQLDBScanOpts opts;
 
 	struct OpScan op;
+	// With more than one worker, rows come from here instead of op.
+	struct SQLDBScanParallel* parallel;
+	u32 parallel_row_id;
+	// Reads the table as of the snapshot, so writes made during the scan,
+	// through it or not, don't move the rows under it.
+	struct PagerSnapshot* snapshot;
 	struct BTreeView tv;
+	// The table as it is now; updates and deletes through the scan find
+	// their row here by row id. Acquired on the first one.
+	struct BTreeView live;
 	struct SQLDBScanBuffer buffer;
 	struct SQLTable* table;
 	struct SQLRecordSchema* record_schema;
@@ -36,6 +51,16 @@ struct ScanState
 enum sql_e
 sqldb_scan_acquire(
 	struct SQLDB* db, struct SQLString* name, struct SQLDBScan* scan)
+{
+	return sqldb_scan_acquire_ex(db, name, NULL, scan);
+}
+
+enum sql_e
+sqldb_scan_acquire_ex(
+	struct SQLDB* db,
+	struct SQLString* name,
+	struct SQLDBScanOpts const* opts,
+	struct SQLDBScan* scan)
 {
 	scan->db = db;
 	scan->table_name = sql_string_copy(name);
@@ -43,6 +68,8 @@ sqldb_scan_acquire(
 	struct ScanState* fsm = (struct ScanState*)malloc(sizeof(struct ScanState));
 	memset(fsm, 0x00, sizeof(*fsm));
 	fsm->step = SE_INIT;
+	if( opts )
+		fsm->opts = *opts;
 
 	scan->internal = fsm;
 
@@ -62,6 +89,8 @@ sqldb_scan_next(struct SQLDBScan* scan)
 		goto begin;
 	case SE_SCAN:
 		goto scan;
+	case SE_PARALLEL:
+		goto parallel;
 	case SE_END:
 		goto end;
 	case SE_FINALIZED:
@@ -75,9 +104,33 @@ init:
 	if( result != SQL_OK )
 		goto end;
 
+	result = sqlpager_err(pager_snapshot_open(scan->db->pager, &fsm->snapshot));
+	if( result != SQL_OK )
+		goto end;
+
 	result = sqldb_table_btree_acquire(scan->db, fsm->table, &fsm->tv);
 	if( result != SQL_OK )
 		goto end;
+	noderc_set_snapshot(fsm->tv.rcer, fsm->snapshot);
+
+	if( fsm->opts.workers > 1 )
+	{
+		result = sqldb_scan_parallel_start(
+			fsm->tv.tree, fsm->table, &fsm->opts, &fsm->parallel);
+		if( result != SQL_OK )
+			goto end;
+
+		fsm->step = SE_PARALLEL;
+	parallel:
+		result = sqldb_scan_parallel_next(
+			fsm->parallel, &scan->current_record, &fsm->parallel_row_id);
+		if( result == SQL_OK )
+			goto await;
+		if( result == SQL_ERR_SCAN_DONE )
+			result = SQL_OK;
+		scan->current_record = NULL;
+		goto end;
+	}
 
 	result = sqlbt_err(btree_op_scan_acquire(fsm->tv.tree, &fsm->op));
 	if( result != SQL_OK )
@@ -113,6 +166,10 @@ begin:
 		if( result != SQL_OK )
 			goto end;
 
+		if( fsm->opts.filter &&
+			!fsm->opts.filter(fsm->record, fsm->opts.filter_ctx) )
+			goto scan;
+
 		scan->current_record = fsm->record;
 		fsm->step = SE_SCAN;
 		goto await;
@@ -132,9 +189,16 @@ begin:
 	fsm->step = SE_END;
 end:
 
+	if( fsm->parallel )
+		sqldb_scan_parallel_stop(fsm->parallel);
+	fsm->parallel = NULL;
 	sqldb_scanbuffer_free(&fsm->buffer);
 	btree_op_scan_release(&fsm->op);
 	sqldb_table_btree_release(scan->db, fsm->table, &fsm->tv);
+	sqldb_table_btree_release(scan->db, fsm->table, &fsm->live);
+	if( fsm->snapshot )
+		pager_snapshot_close(fsm->snapshot);
+	fsm->snapshot = NULL;
 	sql_record_schema_destroy(fsm->record_schema);
 	sql_record_destroy(fsm->record);
 	sql_table_destroy(fsm->table);
@@ -145,25 +209,63 @@ await:
 	return result;
 }
 
+/**
+ * @brief Row id of the current record, and the live table to change it in.
+ */
+static enum sql_e
+current_row(struct SQLDBScan* scan, u32* out_row_id)
+{
+	enum sql_e result = SQL_OK;
+	struct ScanState* fsm = (struct ScanState*)scan->internal;
+
+	if( fsm->parallel )
+		*out_row_id = fsm->parallel_row_id;
+	else
+		result = sqlbt_err(btree_op_scan_key(&fsm->op, out_row_id));
+	if( result != SQL_OK )
+		return result;
+
+	if( !fsm->live.tree )
+		result = sqldb_table_btree_acquire(scan->db, fsm->table, &fsm->live);
+
+	return result;
+}
+
 enum sql_e
 sqldb_scan_update(struct SQLDBScan* scan, struct SQLRecord* record)
 {
 	enum sql_e result = SQL_OK;
 	struct ScanState* fsm = (struct ScanState*)scan->internal;
 	struct SQLSerializedRecord serred = {0};
+	struct OpUpdate upsert = {0};
+	u32 row_id = 0;
 
 	u32 newsize = sql_ibtree_serialize_record_size(record);
 	sqldb_scanbuffer_resize(&fsm->buffer, newsize);
 
+	result = current_row(scan, &row_id);
+	if( result != SQL_OK )
+		goto end;
+
 	result = sql_ibtree_serialize_record_acquire(&serred, fsm->table, record);
 	if( result != SQL_OK )
 		goto end;
 
-	result = sqlbt_err(btree_op_scan_update(&fsm->op, serred.buf, serred.size));
+	result = sqlbt_err(
+		btree_op_update_acquire_tbl(fsm->live.tree, &upsert, row_id, NULL));
 	if( result != SQL_OK )
 		goto end;
 
+	// A row deleted since the snapshot stays deleted.
+	result = sqlbt_err(btree_op_update_prepare(&upsert));
+	if( result == SQL_ERR_NOT_FOUND )
+		result = SQL_OK;
+	else if( result == SQL_OK )
+		result = sqlbt_err(
+			btree_op_update_commit(&upsert, serred.buf, serred.size));
+
 end:
+	btree_op_update_release(&upsert);
 	sql_ibtree_serialize_record_release(&serred);
 	return result;
 }
@@ -173,12 +275,27 @@ sqldb_scan_delete(struct SQLDBScan* scan)
 {
 	enum sql_e result = SQL_OK;
 	struct ScanState* fsm = (struct ScanState*)scan->internal;
+	struct OpUpdate op = {0};
+	u32 row_id = 0;
 
-	result = sqlbt_err(btree_op_scan_delete(&fsm->op));
+	result = current_row(scan, &row_id);
 	if( result != SQL_OK )
 		goto end;
 
+	result = sqlbt_err(
+		btree_op_update_acquire_tbl(fsm->live.tree, &op, row_id, NULL));
+	if( result != SQL_OK )
+		goto end;
+
+	// Already gone is fine.
+	result = sqlbt_err(btree_op_update_prepare(&op));
+	if( result == SQL_OK )
+		result = sqlbt_err(btree_op_update_delete(&op));
+	if( result == SQL_ERR_NOT_FOUND )
+		result = SQL_OK;
+
 end:
+	btree_op_update_release(&op);
 	return result;
 }
 
@@ -212,6 +329,8 @@ sqldb_scan_record(struct SQLDBScan* scan)
 
 	if( fsm->step == SE_SCAN )
 		return fsm->record;
+	else if( fsm->step == SE_PARALLEL )
+		return scan->current_record;
 	else
 		return NULL;
 }
\ No newline at end of file
@@ -7,6 +7,24 @@
 
 #include <stdbool.h>
 
+/**
+ * @brief Whether the scan hands out record. Runs on the thread that read the
+ * row, so it must not touch anything another row's call could.
+ */
+typedef bool (*sqldb_scan_filter_fn)(struct SQLRecord const* record, void* ctx);
+
+struct SQLDBScanOpts
+{
+	// Threads reading the table at once, each its own range of row ids; 0 or
+	// 1 reads it on the caller's thread.
+	u32 workers;
+	// With workers, hand rows out in row id order rather than as read.
+	bool ordered;
+	// Skips the rows it rejects; NULL for every row.
+	sqldb_scan_filter_fn filter;
+	void* filter_ctx;
+};
+
 struct SQLDBScan
 {
 	struct SQLDB* db;
@@ -18,6 +36,16 @@ struct SQLDBScan
 
 enum sql_e
 sqldb_scan_acquire(struct SQLDB*, struct SQLString*, struct SQLDBScan*);
+
+/**
+ * @brief sqldb_scan_acquire with opts; NULL for the defaults. Updates and
+ * deletes through the scan are made on the caller's thread either way.
+ */
+enum sql_e sqldb_scan_acquire_ex(
+	struct SQLDB*,
+	struct SQLString*,
+	struct SQLDBScanOpts const*,
+	struct SQLDBScan*);
 enum sql_e sqldb_scan_next(struct SQLDBScan*);
 enum sql_e sqldb_scan_update(struct SQLDBScan*, struct SQLRecord*);
 enum sql_e sqldb_scan_delete(struct SQLDBScan*);
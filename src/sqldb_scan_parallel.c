@@ -0,0 +1,384 @@
+#include "sqldb_scan_parallel.h"
+
+#include "btree_op_scan.h"
+#include "btthread.h"
+#include "sql_ibtree.h"
+#include "sql_utils.h"
+#include "sqldb_scanbuffer.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ranges to split the table into per worker.
+#define SCAN_RANGES_PER_WORKER 4
+// Rows a worker collects before queueing them at once.
+#define SCAN_BATCH_ROWS 64
+// Rows a queue holds before the workers feeding it wait.
+#define SCAN_QUEUE_ROWS 1024
+
+struct ScanRow
+{
+	struct ScanRow* next;
+	u32 row_id;
+	struct SQLRecordSchema* schema;
+	struct SQLRecord* record;
+};
+
+struct ScanQueue
+{
+	struct ScanRow* head;
+	struct ScanRow* tail;
+	u32 nrows;
+	// Ranges that may still add rows.
+	u32 open;
+};
+
+struct SQLDBScanParallel
+{
+	struct BTree* tree;
+	struct SQLTable* table;
+	struct SQLDBScanOpts opts;
+
+	// Range i holds the row ids after bounds[i - 1] up to bounds[i].
+	u32* bounds;
+	u32 nranges;
+
+	bt_thread* threads;
+	u32 nthreads;
+
+	// Guards everything below. Workers and the reader wait on cond for
+	// room in, or rows on, a queue.
+	bt_mutex lock;
+	bt_cond cond;
+	u32 next_range;
+	struct ScanQueue* queues;
+	u32 nqueues;
+	// The queue the reader takes rows from.
+	u32 current_queue;
+	bool stop;
+	enum sql_e error;
+
+	// Rows the reader took off the queue at once, and the one handed out;
+	// only the reader touches them.
+	struct ScanRow* taken;
+	struct ScanRow* current;
+};
+
+static void
+row_destroy(struct ScanRow* row)
+{
+	sql_record_schema_destroy(row->schema);
+	sql_record_destroy(row->record);
+	free(row);
+}
+
+static void
+rows_destroy(struct ScanRow* row)
+{
+	while( row )
+	{
+		struct ScanRow* next = row->next;
+		row_destroy(row);
+		row = next;
+	}
+}
+
+/**
+ * @brief Queue the batch for the reader, waiting for room first.
+ */
+static void
+queue_rows(
+	struct SQLDBScanParallel* scan,
+	u32 range,
+	struct ScanRow* head,
+	struct ScanRow* tail,
+	u32 nrows)
+{
+	struct ScanQueue* queue = &scan->queues[scan->opts.ordered ? range : 0];
+
+	bt_mutex_lock(&scan->lock);
+	while( !scan->stop && queue->nrows >= SCAN_QUEUE_ROWS )
+		bt_cond_wait(&scan->cond, &scan->lock);
+
+	if( scan->stop )
+	{
+		bt_mutex_unlock(&scan->lock);
+		rows_destroy(head);
+		return;
+	}
+
+	if( queue->tail )
+		queue->tail->next = head;
+	else
+		queue->head = head;
+	queue->tail = tail;
+	queue->nrows += nrows;
+
+	bt_cond_broadcast(&scan->cond);
+	bt_mutex_unlock(&scan->lock);
+}
+
+static bool
+stopped(struct SQLDBScanParallel* scan)
+{
+	bt_mutex_lock(&scan->lock);
+	bool stop = scan->stop;
+	bt_mutex_unlock(&scan->lock);
+
+	return stop;
+}
+
+static enum sql_e
+scan_range(
+	struct SQLDBScanParallel* scan, u32 range, struct SQLDBScanBuffer* buffer)
+{
+	enum sql_e result = SQL_OK;
+	struct OpScan op = {0};
+	struct ScanRow* row = NULL;
+	struct ScanRow* head = NULL;
+	struct ScanRow* tail = NULL;
+	u32 nrows = 0;
+	bool last = range == scan->nranges - 1;
+	u32 high = last ? 0 : scan->bounds[range];
+
+	result = sqlbt_err(btree_op_scan_acquire(scan->tree, &op));
+	if( result != SQL_OK )
+		goto end;
+
+	if( range == 0 )
+		result = sqlbt_err(btree_op_scan_prepare(&op));
+	else
+		result = sqlbt_err(
+			btree_op_scan_prepare_from(&op, scan->bounds[range - 1] + 1));
+	if( result != SQL_OK )
+		goto end;
+
+	while( !btree_op_scan_done(&op) )
+	{
+		u32 row_id = 0;
+		result = sqlbt_err(btree_op_scan_key(&op, &row_id));
+		if( result != SQL_OK )
+			goto end;
+
+		if( !last && row_id > high )
+			break;
+
+		sqldb_scanbuffer_resize(buffer, op.data_size);
+		result = sqlbt_err(
+			btree_op_scan_current(&op, buffer->buffer, buffer->size));
+		if( result != SQL_OK )
+			goto end;
+
+		row = (struct ScanRow*)malloc(sizeof(struct ScanRow));
+		row->next = NULL;
+		row->row_id = row_id;
+		row->schema = sql_record_schema_create();
+		row->record = sql_record_create();
+
+		result = sql_ibtree_deserialize_record(
+			scan->table,
+			row->schema,
+			row->record,
+			buffer->buffer,
+			buffer->size);
+		if( result != SQL_OK )
+			goto end;
+
+		if( scan->opts.filter &&
+			!scan->opts.filter(row->record, scan->opts.filter_ctx) )
+		{
+			row_destroy(row);
+		}
+		else
+		{
+			if( tail )
+				tail->next = row;
+			else
+				head = row;
+			tail = row;
+			nrows += 1;
+		}
+		row = NULL;
+
+		if( nrows == SCAN_BATCH_ROWS )
+		{
+			queue_rows(scan, range, head, tail, nrows);
+			head = tail = NULL;
+			nrows = 0;
+
+			if( stopped(scan) )
+				goto end;
+		}
+
+		result = sqlbt_err(btree_op_scan_next(&op));
+		if( result != SQL_OK )
+			goto end;
+	}
+
+end:
+	if( row )
+		row_destroy(row);
+	if( head )
+		queue_rows(scan, range, head, tail, nrows);
+	btree_op_scan_release(&op);
+
+	return result;
+}
+
+static void*
+worker(void* arg)
+{
+	struct SQLDBScanParallel* scan = (struct SQLDBScanParallel*)arg;
+	struct SQLDBScanBuffer buffer = {0};
+
+	bt_mutex_lock(&scan->lock);
+	while( !scan->stop && scan->next_range < scan->nranges )
+	{
+		u32 range = scan->next_range++;
+		bt_mutex_unlock(&scan->lock);
+
+		enum sql_e result = scan_range(scan, range, &buffer);
+
+		bt_mutex_lock(&scan->lock);
+		if( result != SQL_OK && scan->error == SQL_OK )
+		{
+			scan->error = result;
+			scan->stop = true;
+		}
+		scan->queues[scan->opts.ordered ? range : 0].open -= 1;
+		bt_cond_broadcast(&scan->cond);
+	}
+	bt_mutex_unlock(&scan->lock);
+
+	sqldb_scanbuffer_free(&buffer);
+	return NULL;
+}
+
+enum sql_e
+sqldb_scan_parallel_start(
+	struct BTree* tree,
+	struct SQLTable* table,
+	struct SQLDBScanOpts const* opts,
+	struct SQLDBScanParallel** out_scan)
+{
+	assert(opts->workers > 1);
+	enum sql_e result = SQL_OK;
+	u32 nbounds = 0;
+	u32 max_bounds = opts->workers * SCAN_RANGES_PER_WORKER - 1;
+
+	struct SQLDBScanParallel* scan =
+		(struct SQLDBScanParallel*)calloc(1, sizeof(struct SQLDBScanParallel));
+	scan->tree = tree;
+	scan->table = table;
+	scan->opts = *opts;
+	scan->error = SQL_OK;
+	bt_mutex_init(&scan->lock);
+	bt_cond_init(&scan->cond);
+	*out_scan = scan;
+
+	scan->bounds = (u32*)malloc(sizeof(u32) * max_bounds);
+	result = sqlbt_err(
+		btree_op_scan_bounds(tree, scan->bounds, max_bounds, &nbounds));
+	if( result != SQL_OK )
+		return result;
+	scan->nranges = nbounds + 1;
+
+	scan->nqueues = opts->ordered ? scan->nranges : 1;
+	scan->queues =
+		(struct ScanQueue*)calloc(scan->nqueues, sizeof(struct ScanQueue));
+	for( u32 i = 0; i < scan->nqueues; i++ )
+		scan->queues[i].open = opts->ordered ? 1 : scan->nranges;
+
+	u32 nthreads =
+		opts->workers < scan->nranges ? opts->workers : scan->nranges;
+	scan->threads = (bt_thread*)malloc(sizeof(bt_thread) * nthreads);
+	for( ; scan->nthreads < nthreads; scan->nthreads++ )
+	{
+		if( bt_thread_create(
+				&scan->threads[scan->nthreads], &worker, scan) != 0 )
+		{
+			result = SQL_ERR_UNKNOWN;
+			break;
+		}
+	}
+
+	// Workers already started carry on with every range.
+	if( scan->nthreads != 0 )
+		result = SQL_OK;
+
+	return result;
+}
+
+enum sql_e
+sqldb_scan_parallel_next(
+	struct SQLDBScanParallel* scan,
+	struct SQLRecord** out_record,
+	u32* out_row_id)
+{
+	enum sql_e result = SQL_OK;
+
+	if( scan->current )
+		row_destroy(scan->current);
+	scan->current = NULL;
+
+	if( !scan->taken )
+	{
+		bt_mutex_lock(&scan->lock);
+		while( !scan->taken && result == SQL_OK )
+		{
+			struct ScanQueue* queue = &scan->queues[scan->current_queue];
+			if( scan->error != SQL_OK )
+				result = scan->error;
+			else if( queue->head )
+			{
+				scan->taken = queue->head;
+				queue->head = queue->tail = NULL;
+				queue->nrows = 0;
+				bt_cond_broadcast(&scan->cond);
+			}
+			else if( queue->open != 0 )
+				bt_cond_wait(&scan->cond, &scan->lock);
+			else if( scan->current_queue + 1 < scan->nqueues )
+				scan->current_queue += 1;
+			else
+				result = SQL_ERR_SCAN_DONE;
+		}
+		bt_mutex_unlock(&scan->lock);
+
+		if( result != SQL_OK )
+			return result;
+	}
+
+	scan->current = scan->taken;
+	scan->taken = scan->taken->next;
+
+	*out_record = scan->current->record;
+	*out_row_id = scan->current->row_id;
+	return result;
+}
+
+void
+sqldb_scan_parallel_stop(struct SQLDBScanParallel* scan)
+{
+	bt_mutex_lock(&scan->lock);
+	scan->stop = true;
+	bt_cond_broadcast(&scan->cond);
+	bt_mutex_unlock(&scan->lock);
+
+	for( u32 i = 0; i < scan->nthreads; i++ )
+		bt_thread_join(scan->threads[i]);
+
+	for( u32 i = 0; i < scan->nqueues; i++ )
+		rows_destroy(scan->queues[i].head);
+	rows_destroy(scan->taken);
+	if( scan->current )
+		row_destroy(scan->current);
+
+	bt_cond_destroy(&scan->cond);
+	bt_mutex_destroy(&scan->lock);
+	free(scan->queues);
+	free(scan->threads);
+	free(scan->bounds);
+	free(scan);
+}
\ No newline at end of file
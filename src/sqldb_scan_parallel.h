@@ -0,0 +1,51 @@
+#ifndef SQLDB_SCAN_PARALLEL_H_
+#define SQLDB_SCAN_PARALLEL_H_
+
+#include "btree_defs.h"
+#include "sql_defs.h"
+#include "sql_record.h"
+#include "sql_table.h"
+#include "sqldb_scan.h"
+
+/**
+ * Parallel table scans.
+ *
+ * The table's row ids are split into ranges at separator keys near the root
+ * (see btree_op_scan_bounds), a few per worker so one slow range doesn't hold
+ * up the rest. Workers take the ranges in order, each scanning it with its
+ * own cursor, and deserialize and filter the rows they read. Rows that pass
+ * are queued, in batches, for the thread calling sqldb_scan_parallel_next:
+ * one queue per range when ordered, handed out range by range, otherwise a
+ * single queue. A worker whose queue is full waits for it to drain, so
+ * memory stays bounded however far ahead the workers get.
+ *
+ * The tree must read from a snapshot that stays open until the scan is
+ * stopped; workers share its view.
+ */
+
+struct SQLDBScanParallel;
+
+enum sql_e sqldb_scan_parallel_start(
+	struct BTree* tree,
+	struct SQLTable* table,
+	struct SQLDBScanOpts const* opts,
+	struct SQLDBScanParallel** out_scan);
+
+/**
+ * @brief The next row. It stays valid until the next call or stop.
+ *
+ * @return SQL_ERR_SCAN_DONE after the last row, or the first error any
+ * worker met.
+ */
+enum sql_e sqldb_scan_parallel_next(
+	struct SQLDBScanParallel* scan,
+	struct SQLRecord** out_record,
+	u32* out_row_id);
+
+/**
+ * @brief Stop the workers, wait for them and free the scan and every row it
+ * still holds.
+ */
+void sqldb_scan_parallel_stop(struct SQLDBScanParallel* scan);
+
+#endif
\ No newline at end of file
@@ -17,10 +17,42 @@ main()
 	int result = 0;
 	result = pager_test_read_write_cstd();
 	printf("read/write page: %d\n", result);
+	result = pager_test_read_write_posix();
+	printf("read/write page posix: %d\n", result);
+	result = pager_test_read_ro_mmap();
+	printf("read only page mmap: %d\n", result);
+	result = pager_test_read_ro_pinned();
+	printf("read only page pinned: %d\n", result);
+	result = pager_test_page_pool();
+	printf("page pool: %d\n", result);
+	result = pager_test_write_pages_batched();
+	printf("write pages batched: %d\n", result);
+	result = pager_test_write_back();
+	printf("pager write back: %d\n", result);
+	result = pager_test_cache_page_table();
+	printf("page cache page table: %d\n", result);
+	result = pager_test_cache_policies();
+	printf("page cache policies: %d\n", result);
 	result = pager_test_page_loads_caching();
 	printf("pager shared pages from cache: %d\n", result);
 	result = pager_test_free_page_list();
 	printf("pager free list: %d\n", result);
+	result = pager_test_free_page_trunks();
+	printf("pager free list trunks: %d\n", result);
+	result = pager_test_wal_recovery();
+	printf("pager wal recovery: %d\n", result);
+	result = pager_test_wal_checkpointer();
+	printf("pager wal checkpointer: %d\n", result);
+	result = pager_test_durability();
+	printf("pager durability: %d\n", result);
+	result = pager_test_transaction();
+	printf("pager transaction: %d\n", result);
+	result = pager_test_shadow();
+	printf("pager shadow: %d\n", result);
+	result = pager_test_snapshot();
+	printf("pager snapshot: %d\n", result);
+	result = pager_test_snapshot_rollback();
+	printf("pager snapshot rollback: %d\n", result);
 
 	result = btree_alg_test_split_nonleaf();
 	printf("alg split non-leaf: %d\n", result);
@@ -43,6 +75,8 @@ main()
 	printf("free heap calcs: %d\n", result);
 	result = btree_utils_test_bin_search_keys();
 	printf("bin search keys: %d\n", result);
+	result = btree_utils_test_lower_bound_keys();
+	printf("lower bound keys: %d\n", result);
 	result = btree_test_deep_tree();
 	printf("deep tree test: %d\n", result);
 	result = btree_overflow_test_overflow_rw();
@@ -56,9 +90,37 @@ main()
 	printf("ibtree insert split_root: %d\n", result);
 	result = btree_test_freelist();
 	printf("freelist: %d\n", result);
+	result = btree_test_wal_reopen();
+	printf("wal reopen: %d\n", result);
+	result = btree_test_shadow_reopen();
+	printf("shadow reopen: %d\n", result);
+	result = btree_test_snapshot_scan();
+	printf("snapshot scan: %d\n", result);
+	result = btree_test_leaf_links();
+	printf("leaf links: %d\n", result);
+	result = btree_test_scan_bounds();
+	printf("scan bounds: %d\n", result);
+	result = btree_test_node_format_v0();
+	printf("node format v0: %d\n", result);
+	result = btree_test_baseline_pages();
+	printf("baseline pages: %d\n", result);
+	result = btree_test_concurrent();
+	printf("concurrent: %d\n", result);
+	result = btree_test_concurrent_mixed();
+	printf("concurrent mixed: %d\n", result);
 
 	result = ibtree_test_deep_tree();
 	printf("ibtree deep test: %d\n", result);
+	result = ibtree_test_concurrent();
+	printf("ibtree concurrent: %d\n", result);
+	result = ibtree_test_prefix_compression();
+	printf("ibtree prefix compression: %d\n", result);
+	result = ibtree_test_short_separators();
+	printf("ibtree short separators: %d\n", result);
+	result = ibtree_test_reopen_write_back();
+	printf("ibtree reopen write back: %d\n", result);
+	result = ibtree_test_abbreviated_keys();
+	printf("ibtree abbreviated keys: %d\n", result);
 	result = ibta_rotate_test();
 	printf("rotate: %d\n", result);
 	result = ibta_merge_test();
@@ -93,6 +155,8 @@ main()
 	printf("schema comparer test: %d\n", result);
 	result = schema_compare_test();
 	printf("schema compare test: %d\n", result);
+	result = schema_compare_columns_test();
+	printf("schema compare columns test: %d\n", result);
 	result = cursor_iter_btree_test();
 	printf("cursor_iter_btree_test: %d\n", result);
 	result = cursor_iter_ibtree_test();